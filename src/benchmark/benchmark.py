@@ -0,0 +1,384 @@
+"""
+Benchmark driver for every program built by the top-level Makefile.
+
+    command to execute (from the repository root, after `make all`):
+    python3 src/benchmark/benchmark.py [--algorithms mergesort,quicksort,...]
+        [--sizes small,medium] [--threads 1,2,4] [--warmup 1] [--repeat 5]
+        [--csv results.csv] [--json results.json]
+
+Each (algorithm, size, threads) case is run `warmup` times untimed and then
+`repeat` times. The programs report their own kernel time, so file parsing
+and allocation are not part of the measurement.
+"""
+
+import argparse
+import csv
+import json
+import os
+import platform
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+
+SECONDS_PATTERN = re.compile(r'([0-9]+\.[0-9]+) seconds')
+
+
+def inputs(path):
+    return os.path.join(ROOT, 'src', path, 'inputs')
+
+
+def count_values(filename):
+    with open(filename) as f:
+        return sum(len(line.split()) for line in f)
+
+
+def matrix_size(filename):
+    with open(filename) as f:
+        return int(f.readline())
+
+
+def array_case(directory, name, extra=()):
+    filename = os.path.join(inputs(directory), name)
+    return lambda: ([filename, '{threads}'] + list(extra), count_values(filename))
+
+
+def search_case(directory, name, target):
+    filename = os.path.join(inputs(directory), name)
+    return lambda: ([filename, '{threads}', str(target)], count_values(filename))
+
+
+def matrix_case(directory, size, extra=()):
+    a = os.path.join(inputs(directory), 'matrix_A_{}.txt'.format(size))
+    b = os.path.join(inputs(directory), 'matrix_B_{}.txt'.format(size))
+    return lambda: ([a, b, '{threads}'] + list(extra), matrix_size(a))
+
+
+def sparse_case(size):
+    a = os.path.join(inputs('matrix_multiplication/parallel_sparse'), 'sparse_matrix_A_{}.txt'.format(size))
+    b = os.path.join(inputs('matrix_multiplication/parallel_sparse'), 'sparse_matrix_B_{}.txt'.format(size))
+    return lambda: ([a, b, '{threads}'], matrix_size(a))
+
+
+def fixed_case(args, n):
+    return lambda: (list(args), n)
+
+
+# Every algorithm: the binary the Makefile builds, the text marking the timing
+# line to keep ("Time taken" unless given), and its cases by size name. Cases
+# whose argument list has no '{threads}' get the thread count appended.
+# Left out: sorted_store runs for a fixed time and reports throughput and
+# latency rather than the time of a fixed amount of work, search_server needs
+# a search_client in a second process, and summa needs mpirun.
+ALGORITHMS = {
+    'mergesort': {
+        'binary': 'merge_sort',
+        'sizes': {
+            'small': array_case('sorting/parallel_merge_sort', 'small_input.txt'),
+            'medium': array_case('sorting/parallel_merge_sort', 'medium_input.txt'),
+        },
+    },
+    'mergesort-adaptive': {
+        'binary': 'merge_sort',
+        'sizes': {
+            'small': array_case('sorting/parallel_merge_sort', 'small_input.txt', ['--adaptive']),
+            'medium': array_case('sorting/parallel_merge_sort', 'medium_input.txt', ['--adaptive']),
+            'sorted': array_case('search/parallel_binary_search', 'medium_sorted_input.txt', ['--adaptive']),
+        },
+    },
+    'quicksort': {
+        'binary': 'quick_sort',
+        'sizes': {
+            'small': array_case('sorting/parallel_quick_sort', 'small_input.txt'),
+            'medium': array_case('sorting/parallel_quick_sort', 'medium_input.txt'),
+        },
+    },
+    # The same sorts on the work-stealing runtime instead of OpenMP tasks and sections
+    'mergesort-ws': {
+        'binary': 'merge_sort',
+        'sizes': {
+            'small': array_case('sorting/parallel_merge_sort', 'small_input.txt', ['--runtime=ws']),
+            'medium': array_case('sorting/parallel_merge_sort', 'medium_input.txt', ['--runtime=ws']),
+        },
+    },
+    'quicksort-ws': {
+        'binary': 'quick_sort',
+        'sizes': {
+            'small': array_case('sorting/parallel_quick_sort', 'small_input.txt', ['--runtime=ws']),
+            'medium': array_case('sorting/parallel_quick_sort', 'medium_input.txt', ['--runtime=ws']),
+        },
+    },
+    'quickselect': {
+        'binary': 'quick_select',
+        'sizes': {
+            'small': array_case('sorting/parallel_quick_sort', 'small_input.txt'),
+            'medium': array_case('sorting/parallel_quick_sort', 'medium_input.txt'),
+        },
+    },
+    # The planner's pick on each input shape; random and presorted keys favour different engines
+    'sortplanner': {
+        'binary': 'sort_planner',
+        'sizes': {
+            'medium': array_case('sorting/parallel_quick_sort', 'medium_input.txt'),
+            'random': fixed_case(['--random', '10000000', '{threads}'], 10000000),
+            'nearly': fixed_case(['--random', '10000000', '{threads}', '--pattern=nearly'], 10000000),
+            'dups': fixed_case(['--random', '10000000', '{threads}', '--pattern=dups'], 10000000),
+        },
+    },
+    'binarysearch': {
+        'binary': 'binary_search',
+        'sizes': {
+            'small': search_case('search/parallel_binary_search', 'small_sorted_input.txt', 50),
+            'medium': search_case('search/parallel_binary_search', 'medium_sorted_input.txt', 50),
+        },
+    },
+    'ternarysearch': {
+        'binary': 'ternary_search',
+        'sizes': {
+            'small': search_case('search/parallel_ternary_search', 'small_sorted_input.txt', 50),
+            'medium': search_case('search/parallel_ternary_search', 'medium_sorted_input.txt', 50),
+        },
+    },
+    # The timing line is the compressed batch; the uncompressed ones are printed above it
+    'compressedsearch': {
+        'binary': 'compressed_search',
+        'sizes': {
+            'small': array_case('search/parallel_binary_search', 'small_sorted_input.txt', ['100000']),
+            'medium': fixed_case(['--random', '10000000', '{threads}', '1000000'], 10000000),
+        },
+    },
+    # The timing line is the mean BFS time; the TEPS figures are printed above it
+    'graphsearch': {
+        'binary': 'graph_search',
+        'sizes': {
+            'small': array_case('search/parallel_graph_search', 'small_graph.txt'),
+            'medium': fixed_case(['--rmat', '18', '{threads}'], 1 << 18),
+        },
+    },
+    'matrixmult': {
+        'binary': 'matrix_multiplication',
+        'sizes': {
+            'small': matrix_case('matrix_multiplication/parallel_naive', 100),
+            'medium': matrix_case('matrix_multiplication/parallel_naive', 1000),
+        },
+    },
+    'matrixmult-int8': {
+        'binary': 'matrix_multiplication',
+        'sizes': {
+            'small': matrix_case('matrix_multiplication/parallel_naive', 100, ['--precision=auto']),
+            'medium': matrix_case('matrix_multiplication/parallel_naive', 1000, ['--precision=auto']),
+        },
+    },
+    'strassenmatrixmult': {
+        'binary': 'strassen_matrix_multiplication',
+        'sizes': {
+            'small': matrix_case('matrix_multiplication/parallel_strassen', 100),
+            'medium': matrix_case('matrix_multiplication/parallel_strassen', 1000),
+        },
+    },
+    'strassenmatrixmult-ws': {
+        'binary': 'strassen_matrix_multiplication',
+        'sizes': {
+            'small': matrix_case('matrix_multiplication/parallel_strassen', 100, ['--runtime=ws']),
+            'medium': matrix_case('matrix_multiplication/parallel_strassen', 1000, ['--runtime=ws']),
+        },
+    },
+    'sparsematrixmult': {
+        'binary': 'sparse_matrix_multiplication',
+        'sizes': {
+            'small': sparse_case(100),
+            'medium': sparse_case(1000),
+        },
+    },
+    'batchedmatrixmult': {
+        'binary': 'batched_matrix_multiplication',
+        'line': 'as one batch with',
+        'sizes': {
+            'small': fixed_case(['8', '100000'], 8),
+            'medium': fixed_case(['32', '10000'], 32),
+        },
+    },
+    'mortonmatrixmult': {
+        'binary': 'morton_matrix_multiplication',
+        'line': 'Morton recursive:',
+        'sizes': {
+            'small': matrix_case('matrix_multiplication/parallel_naive', 100),
+            'medium': matrix_case('matrix_multiplication/parallel_naive', 1000),
+        },
+    },
+    # One island per thread at a fixed population: weak scaling, so the ideal time stays flat
+    'islandga': {
+        'binary': 'island_ga',
+        'sizes': {
+            'small': fixed_case(['{threads}', '--generations=200'], 1000),
+            'medium': fixed_case(['{threads}', '--items=20000', '--generations=50'], 20000),
+        },
+    },
+}
+
+
+def percentile(values, fraction):
+    """Linear interpolation between closest ranks, like numpy's default."""
+    ordered = sorted(values)
+    position = (len(ordered) - 1) * fraction
+    lower = int(position)
+    upper = min(lower + 1, len(ordered) - 1)
+    return ordered[lower] + (ordered[upper] - ordered[lower]) * (position - lower)
+
+
+def parse_time(output, line_filter):
+    for line in output.splitlines():
+        if line_filter not in line:
+            continue
+        match = SECONDS_PATTERN.search(line)
+        if match:
+            return float(match.group(1))
+    return None
+
+
+def run_once(command, line_filter):
+    completed = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                               universal_newlines=True, cwd=ROOT)
+    if completed.returncode != 0:
+        raise RuntimeError('{} exited with status {}: {}'.format(
+            ' '.join(command), completed.returncode, completed.stderr.strip()))
+    seconds = parse_time(completed.stdout, line_filter)
+    if seconds is None:
+        raise RuntimeError('no "{}" timing line in the output of {}'.format(line_filter, ' '.join(command)))
+    return seconds
+
+
+def build_command(binary, args, threads):
+    command = [binary]
+    if any('{threads}' in arg for arg in args):
+        command += [arg.format(threads=threads) for arg in args]
+    else:
+        command += args + [str(threads)]
+    return command
+
+
+def default_threads():
+    count = os.cpu_count() or 1
+    threads = [1]
+    while threads[-1] * 2 <= count:
+        threads.append(threads[-1] * 2)
+    if threads[-1] != count:
+        threads.append(count)
+    return threads
+
+
+def git_commit():
+    try:
+        return subprocess.check_output(['git', 'rev-parse', '--short', 'HEAD'], cwd=ROOT,
+                                       stderr=subprocess.DEVNULL, universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+
+def split_list(value):
+    return [item for item in value.split(',') if item]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Run every algorithm over sizes and thread counts.')
+    parser.add_argument('--algorithms', type=split_list, default=list(ALGORITHMS),
+                        help='comma separated subset of: ' + ', '.join(ALGORITHMS))
+    parser.add_argument('--sizes', type=split_list, default=['small', 'medium'])
+    parser.add_argument('--threads', type=lambda v: [int(t) for t in split_list(v)], default=default_threads(),
+                        help='comma separated thread counts (default: powers of two up to the CPU count)')
+    parser.add_argument('--warmup', type=int, default=1)
+    parser.add_argument('--repeat', type=int, default=5)
+    parser.add_argument('--bin-dir', default=ROOT, help='directory holding the programs built by make')
+    parser.add_argument('--csv', help='write one row per case to this file')
+    parser.add_argument('--json', help='write the results and run metadata to this file')
+    options = parser.parse_args()
+
+    for name in options.algorithms:
+        if name not in ALGORITHMS:
+            parser.error('unknown algorithm {}'.format(name))
+    if options.repeat < 1 or options.warmup < 0:
+        parser.error('--repeat must be at least 1 and --warmup at least 0')
+    if 1 not in options.threads:
+        # Speedup and efficiency are relative to the one thread run
+        options.threads = [1] + options.threads
+    options.threads = sorted(set(options.threads))
+
+    results = []
+    failed = False
+    print('{:<20} {:<7} {:>10} {:>7} {:>12} {:>12} {:>12} {:>8} {:>10}'.format(
+        'algorithm', 'size', 'n', 'threads', 'median (s)', 'p5 (s)', 'p95 (s)', 'speedup', 'efficiency'))
+    for name in options.algorithms:
+        spec = ALGORITHMS[name]
+        binary = os.path.join(os.path.abspath(options.bin_dir), spec['binary'])
+        if not os.path.exists(binary):
+            print('{}: {} not found, run `make all` first'.format(name, binary), file=sys.stderr)
+            failed = True
+            continue
+        for size in options.sizes:
+            if size not in spec['sizes']:
+                continue
+            args, n = spec['sizes'][size]()
+            baseline = None
+            for threads in options.threads:
+                command = build_command(binary, args, threads)
+                try:
+                    for _ in range(options.warmup):
+                        run_once(command, spec.get('line', 'Time taken'))
+                    samples = [run_once(command, spec.get('line', 'Time taken')) for _ in range(options.repeat)]
+                except RuntimeError as error:
+                    print('{}: {}'.format(name, error), file=sys.stderr)
+                    failed = True
+                    break
+
+                median = statistics.median(samples)
+                if threads == 1:
+                    baseline = median
+                speedup = baseline / median if baseline is not None and median > 0 else float('nan')
+                row = {
+                    'algorithm': name,
+                    'size': size,
+                    'n': n,
+                    'threads': threads,
+                    'repeat': options.repeat,
+                    'median': median,
+                    'p5': percentile(samples, 0.05),
+                    'p95': percentile(samples, 0.95),
+                    'mean': statistics.mean(samples),
+                    'min': min(samples),
+                    'max': max(samples),
+                    'speedup': speedup,
+                    'efficiency': speedup / threads,
+                    'samples': samples,
+                }
+                results.append(row)
+                print('{:<20} {:<7} {:>10} {:>7} {:>12.6f} {:>12.6f} {:>12.6f} {:>8.2f} {:>10.2f}'.format(
+                    name, size, n, threads, row['median'], row['p5'], row['p95'], row['speedup'], row['efficiency']))
+
+    if options.csv:
+        fields = ['algorithm', 'size', 'n', 'threads', 'repeat', 'median', 'p5', 'p95', 'mean', 'min', 'max',
+                  'speedup', 'efficiency']
+        with open(options.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=fields, extrasaction='ignore')
+            writer.writeheader()
+            writer.writerows(results)
+    if options.json:
+        metadata = {
+            'commit': git_commit(),
+            'host': platform.node(),
+            'machine': platform.machine(),
+            'cpus': os.cpu_count(),
+            'date': time.strftime('%Y-%m-%dT%H:%M:%S%z'),
+            'warmup': options.warmup,
+            'repeat': options.repeat,
+        }
+        with open(options.json, 'w') as f:
+            json.dump({'metadata': metadata, 'results': results}, f, indent=2)
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,326 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <omp.h>
+#include "numa_support.h"
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+/*
+    Shared NUMA helpers for the benchmark programs. Build with
+    -DHAVE_LIBNUMA -lnuma to enable interleaving and the page locality and
+    placement reports;
+    without libnuma only thread pinning and first-touch placement are available.
+*/
+
+#define LOCALITY_BATCH 1024
+
+void defaultNumaOptions(NumaOptions *options) {
+    options->pin = PIN_NONE;
+    options->placement = PLACEMENT_DEFAULT;
+}
+
+// Returns 1 when `arg` was a NUMA option, 0 when it belongs to the caller, and
+// exits on a NUMA option with an unknown value
+int parseNumaOption(const char *arg, NumaOptions *options) {
+    if (strncmp(arg, "--pin=", 6) == 0) {
+        const char *value = arg + 6;
+        if (strcmp(value, "none") == 0) options->pin = PIN_NONE;
+        else if (strcmp(value, "compact") == 0) options->pin = PIN_COMPACT;
+        else if (strcmp(value, "scatter") == 0) options->pin = PIN_SCATTER;
+        else {
+            fprintf(stderr, "--pin must be one of none, compact or scatter\n");
+            exit(EXIT_FAILURE);
+        }
+        return 1;
+    }
+    if (strncmp(arg, "--numa=", 7) == 0) {
+        const char *value = arg + 7;
+        if (strcmp(value, "default") == 0) options->placement = PLACEMENT_DEFAULT;
+        else if (strcmp(value, "firsttouch") == 0) options->placement = PLACEMENT_FIRST_TOUCH;
+        else if (strcmp(value, "interleave") == 0) options->placement = PLACEMENT_INTERLEAVE;
+        else {
+            fprintf(stderr, "--numa must be one of default, firsttouch or interleave\n");
+            exit(EXIT_FAILURE);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static int nodeOfCpu(int cpu) {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        int node = numa_node_of_cpu(cpu);
+        return node >= 0 ? node : 0;
+    }
+#endif
+    (void)cpu;
+    return 0;
+}
+
+// Order the CPUs this process may run on. Compact fills one node before the
+// next; scatter deals CPUs out round-robin across nodes. The mask is read once,
+// before the first pinning narrows the calling thread's own.
+static int buildCpuOrder(PinPolicy pin, int *order, int capacity) {
+    static cpu_set_t allowed;
+    static int have_allowed = 0;
+    if (!have_allowed) {
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            return 0;
+        }
+        have_allowed = 1;
+    }
+
+    int cpus[CPU_SETSIZE], nodes[CPU_SETSIZE];
+    int count = 0, max_node = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < capacity; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        cpus[count] = cpu;
+        nodes[count] = nodeOfCpu(cpu);
+        if (nodes[count] > max_node) max_node = nodes[count];
+        count++;
+    }
+
+    int placed = 0;
+    if (pin == PIN_COMPACT) {
+        for (int node = 0; node <= max_node; node++) {
+            for (int i = 0; i < count; i++) {
+                if (nodes[i] == node) order[placed++] = cpus[i];
+            }
+        }
+    } else {
+        int *next = calloc(max_node + 1, sizeof(int));
+        if (next == NULL) {
+            fprintf(stderr, "Memory allocation failed for CPU ordering\n");
+            exit(EXIT_FAILURE);
+        }
+        while (placed < count) {
+            for (int node = 0; node <= max_node; node++) {
+                // Find the next unused CPU on this node, if it has any left
+                for (int i = next[node]; i < count; i++) {
+                    next[node] = i + 1;
+                    if (nodes[i] == node) {
+                        order[placed++] = cpus[i];
+                        break;
+                    }
+                }
+            }
+        }
+        free(next);
+    }
+    return placed;
+}
+
+// tid 0 is the calling thread
+static int pinThread(pid_t tid, int cpu) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return sched_setaffinity(tid, sizeof(mask), &mask);
+}
+
+// Pin every thread of the OpenMP team to one CPU. libgomp reuses its pool
+// threads, so later parallel regions of the same size keep the binding.
+void applyThreadPinning(const NumaOptions *options) {
+    if (options->pin == PIN_NONE) return;
+
+    int order[CPU_SETSIZE];
+    int count = buildCpuOrder(options->pin, order, CPU_SETSIZE);
+    if (count == 0) {
+        fprintf(stderr, "Thread pinning unavailable: could not read the CPU affinity mask\n");
+        return;
+    }
+
+    #pragma omp parallel
+    {
+        if (pinThread(0, order[omp_get_thread_num() % count]) != 0) {
+            #pragma omp critical
+            fprintf(stderr, "Failed to pin thread %d\n", omp_get_thread_num());
+        }
+    }
+}
+
+// Pin threads no OpenMP region reaches, such as the workers of a work-stealing
+// pool, by kernel thread id in the same CPU order. Threads inherit the mask of
+// their creator, so without this a pool started by a pinned thread shares its CPU.
+void applyThreadIdPinning(const NumaOptions *options, const int *tids, int threads) {
+    if (options->pin == PIN_NONE || threads == 0) return;
+
+    int order[CPU_SETSIZE];
+    int count = buildCpuOrder(options->pin, order, CPU_SETSIZE);
+    if (count == 0) {
+        fprintf(stderr, "Thread pinning unavailable: could not read the CPU affinity mask\n");
+        return;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (pinThread(tids[t], order[t % count]) != 0) {
+            fprintf(stderr, "Failed to pin thread %d\n", t);
+        }
+    }
+}
+
+void* numaAllocate(size_t bytes, const NumaOptions *options) {
+    void *data = NULL;
+    if (options->placement == PLACEMENT_INTERLEAVE) {
+#ifdef HAVE_LIBNUMA
+        if (numa_available() >= 0) {
+            data = numa_alloc_interleaved(bytes);
+        }
+#endif
+        if (data == NULL) {
+            static int warned = 0;
+            if (!warned) fprintf(stderr, "NUMA interleaving unavailable, falling back to first touch\n");
+            warned = 1;
+            data = malloc(bytes);
+            if (data != NULL) firstTouch(data, bytes);
+        }
+    } else {
+        data = malloc(bytes);
+        if (data != NULL && options->placement == PLACEMENT_FIRST_TOUCH) {
+            firstTouch(data, bytes);
+        }
+    }
+    return data;
+}
+
+void numaFree(void *data, size_t bytes, const NumaOptions *options) {
+#ifdef HAVE_LIBNUMA
+    if (options->placement == PLACEMENT_INTERLEAVE && numa_available() >= 0) {
+        numa_free(data, bytes);
+        return;
+    }
+#endif
+    (void)bytes;
+    (void)options;
+    free(data);
+}
+
+// Write each page from the thread that will later compute on it. The static
+// split matches `parallel for schedule(static)` over the same elements.
+void firstTouch(void *data, size_t bytes) {
+    char *bytes_ptr = data;
+    long page = sysconf(_SC_PAGESIZE);
+    long pages = (long)((bytes + page - 1) / page);
+    #pragma omp parallel for schedule(static)
+    for (long p = 0; p < pages; p++) {
+        size_t offset = (size_t)p * page;
+        size_t length = bytes - offset < (size_t)page ? bytes - offset : (size_t)page;
+        memset(bytes_ptr + offset, 0, length);
+    }
+}
+
+#ifdef HAVE_LIBNUMA
+// Add the resident pages under [data, data + bytes) to pages[node] for the
+// node each is on; pages not yet touched are not counted
+static void countPagesByNode(const void *data, size_t bytes, long *pages_per_node, int nodes) {
+    if (bytes == 0) return;
+    long page = sysconf(_SC_PAGESIZE);
+    char *first = (char *)((unsigned long)data & ~(unsigned long)(page - 1));
+    char *last = (char *)data + bytes;
+
+    void *pages[LOCALITY_BATCH];
+    int status[LOCALITY_BATCH];
+    char *cursor = first;
+    while (cursor < last) {
+        int count = 0;
+        while (count < LOCALITY_BATCH && cursor < last) {
+            pages[count++] = cursor;
+            cursor += page;
+        }
+        if (numa_move_pages(0, count, pages, NULL, status, 0) != 0) return;
+        for (int i = 0; i < count; i++) {
+            if (status[i] >= 0 && status[i] < nodes) pages_per_node[status[i]]++;
+        }
+    }
+}
+#endif
+
+// Classify the pages under [data, data + bytes) as local or remote to the node
+// the calling thread is running on. Pages not yet touched are not counted.
+void countPageLocality(const void *data, size_t bytes, long *local_pages, long *remote_pages) {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() < 0 || bytes == 0) return;
+    int nodes = numa_max_node() + 1;
+    long *pages = calloc(nodes, sizeof(long));
+    if (pages == NULL) {
+        fprintf(stderr, "Memory allocation failed for the page locality report\n");
+        exit(EXIT_FAILURE);
+    }
+    countPagesByNode(data, bytes, pages, nodes);
+    int my_node = nodeOfCpu(sched_getcpu());
+    for (int node = 0; node < nodes; node++) {
+        if (node == my_node) *local_pages += pages[node];
+        else *remote_pages += pages[node];
+    }
+    free(pages);
+#else
+    (void)data;
+    (void)bytes;
+    (void)local_pages;
+    (void)remote_pages;
+#endif
+}
+
+void printLocality(const char *label, long local_pages, long remote_pages) {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        long total = local_pages + remote_pages;
+        printf("NUMA locality of %s: %ld local pages, %ld remote pages (%.1f%% local)\n",
+               label, local_pages, remote_pages, total > 0 ? 100.0 * local_pages / total : 0.0);
+        return;
+    }
+#endif
+    (void)local_pages;
+    (void)remote_pages;
+    printf("NUMA locality of %s: unavailable (built without libnuma)\n", label);
+}
+
+// Each thread checks the static share of a flat array it computes on
+void reportArrayLocality(const char *label, const void *data, size_t bytes) {
+    long local_pages = 0, remote_pages = 0;
+    #pragma omp parallel reduction(+:local_pages, remote_pages)
+    {
+        int threads = omp_get_num_threads();
+        int tid = omp_get_thread_num();
+        size_t share = (bytes + threads - 1) / threads;
+        size_t begin = share * tid < bytes ? share * tid : bytes;
+        size_t end = begin + share < bytes ? begin + share : bytes;
+        countPageLocality((const char *)data + begin, end - begin, &local_pages, &remote_pages);
+    }
+    printLocality(label, local_pages, remote_pages);
+}
+
+// Row-pointer matrices: the rows are not tied to the thread that computes on
+// them, so count where their resident pages are rather than how local they are
+void reportRowsPlacement(const char *label, void **rows, int count, size_t row_bytes) {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        int nodes = numa_max_node() + 1;
+        long *pages = calloc(nodes, sizeof(long));
+        if (pages == NULL) {
+            fprintf(stderr, "Memory allocation failed for the page placement report\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < count; i++) {
+            countPagesByNode(rows[i], row_bytes, pages, nodes);
+        }
+        printf("NUMA placement of %s:", label);
+        for (int node = 0; node < nodes; node++) {
+            printf("%s %ld pages on node %d", node > 0 ? "," : "", pages[node], node);
+        }
+        printf("\n");
+        free(pages);
+        return;
+    }
+#endif
+    (void)rows;
+    (void)count;
+    (void)row_bytes;
+    printf("NUMA placement of %s: unavailable (built without libnuma)\n", label);
+}
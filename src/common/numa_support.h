@@ -0,0 +1,31 @@
+#ifndef NUMA_SUPPORT_H
+#define NUMA_SUPPORT_H
+
+#include <stddef.h>
+
+typedef enum { PIN_NONE, PIN_COMPACT, PIN_SCATTER } PinPolicy;
+typedef enum { PLACEMENT_DEFAULT, PLACEMENT_FIRST_TOUCH, PLACEMENT_INTERLEAVE } PlacementPolicy;
+
+typedef struct {
+    PinPolicy pin;
+    PlacementPolicy placement;
+} NumaOptions;
+
+#define NUMA_OPTIONS_USAGE "[--pin=none|compact|scatter] [--numa=default|firsttouch|interleave]"
+
+void defaultNumaOptions(NumaOptions *options);
+int parseNumaOption(const char *arg, NumaOptions *options);
+
+void applyThreadPinning(const NumaOptions *options);
+void applyThreadIdPinning(const NumaOptions *options, const int *tids, int threads);
+
+void* numaAllocate(size_t bytes, const NumaOptions *options);
+void numaFree(void *data, size_t bytes, const NumaOptions *options);
+void firstTouch(void *data, size_t bytes);
+
+void countPageLocality(const void *data, size_t bytes, long *local_pages, long *remote_pages);
+void reportArrayLocality(const char *label, const void *data, size_t bytes);
+void reportRowsPlacement(const char *label, void **rows, int count, size_t row_bytes);
+void printLocality(const char *label, long local_pages, long remote_pages);
+
+#endif
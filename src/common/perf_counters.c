@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <omp.h>
+#include "perf_counters.h"
+
+/*
+    Per-kernel, per-thread counters read through perf_event_open. Counters
+    exclude the kernel so they open without root whenever perf_event_paranoid
+    is 2 or lower; events the CPU, VM or policy does not expose are reported
+    as n/a and the rest of the report still prints.
+
+    Build with -DPERF_COUNT_MALLOC -Wl,--wrap=malloc -Wl,--wrap=calloc
+    -Wl,--wrap=realloc to count the allocations the program itself makes.
+*/
+
+#define CACHE_EVENT(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+static const struct {
+    const char *name;
+    unsigned int type;
+    unsigned long long config;
+} perf_events[PERF_EVENT_COUNT] = {
+    [PERF_CYCLES] = { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [PERF_INSTRUCTIONS] = { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [PERF_LLC_MISSES] = { "LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    [PERF_DTLB_MISSES] = { "dTLB misses", PERF_TYPE_HW_CACHE,
+                           CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    [PERF_TASK_CLOCK] = { "task clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    [PERF_PAGE_FAULTS] = { "page faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+#define CACHE_LINE_BYTES 64
+
+#ifdef PERF_COUNT_MALLOC
+static long malloc_calls = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void *data, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    __atomic_fetch_add(&malloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&malloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void *data, size_t size) {
+    __atomic_fetch_add(&malloc_calls, 1, __ATOMIC_RELAXED);
+    return __real_realloc(data, size);
+}
+
+long perfMallocCalls(void) {
+    return __atomic_load_n(&malloc_calls, __ATOMIC_RELAXED);
+}
+#else
+long perfMallocCalls(void) {
+    return -1;
+}
+#endif
+
+long perfPeakRssKb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    return usage.ru_maxrss;
+}
+
+void defaultPerfOptions(PerfOptions *options) {
+    options->enabled = 0;
+}
+
+int parsePerfOption(const char *arg, PerfOptions *options) {
+    if (strcmp(arg, "--perf") == 0) {
+        options->enabled = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int openCounter(PerfEvent event, pid_t tid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[event].type;
+    attr.config = perf_events[event].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // cpu -1: count the thread (0 for the calling one) wherever it runs
+    return syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+}
+
+static void explainUnavailable(PerfEvent event, int error) {
+    fprintf(stderr, "perf: %s unavailable (%s)", perf_events[event].name, strerror(error));
+    if (error == ENOENT || error == EOPNOTSUPP) {
+        fprintf(stderr, ", the CPU or hypervisor does not expose it");
+    } else if (error == EACCES || error == EPERM) {
+        FILE *file = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+        int paranoid;
+        if (file != NULL && fscanf(file, "%d", &paranoid) == 1) {
+            fprintf(stderr, ", perf_event_paranoid is %d and must be 2 or lower", paranoid);
+        }
+        if (file != NULL) fclose(file);
+    }
+    fprintf(stderr, "\n");
+}
+
+// Open every event on every thread of the next parallel region. libgomp keeps
+// its pool threads, so the kernel's own parallel regions run on the same
+// threads the counters are attached to.
+void perfRegionBegin(PerfRegion *region, const PerfOptions *options, const char *label) {
+    perfRegionBeginThreads(region, options, label, NULL, 0);
+}
+
+// Open every event on the given kernel threads instead, such as the workers of
+// a work-stealing pool that no OpenMP region reaches; count 0 means the team
+void perfRegionBeginThreads(PerfRegion *region, const PerfOptions *options, const char *label,
+                            const int *tids, int count) {
+    region->label = label;
+    region->enabled = options->enabled;
+    if (!region->enabled) return;
+
+    region->threads = count > 0 ? count : omp_get_max_threads();
+    region->fds = malloc((size_t)region->threads * PERF_EVENT_COUNT * sizeof(int));
+    region->counts = calloc((size_t)region->threads * PERF_EVENT_COUNT, sizeof(long long));
+    if (region->fds == NULL || region->counts == NULL) {
+        fprintf(stderr, "Memory allocation failed for performance counters\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int errors[PERF_EVENT_COUNT] = { 0 };
+    if (count > 0) {
+        for (int t = 0; t < count; t++) {
+            for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+                region->fds[t * PERF_EVENT_COUNT + e] = openCounter(e, tids[t]);
+                if (region->fds[t * PERF_EVENT_COUNT + e] < 0) errors[e] = errno;
+            }
+        }
+    } else {
+        #pragma omp parallel num_threads(region->threads)
+        {
+            int *fds = region->fds + omp_get_thread_num() * PERF_EVENT_COUNT;
+            for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+                fds[e] = openCounter(e, 0);
+                if (fds[e] < 0) {
+                    #pragma omp critical
+                    errors[e] = errno;
+                }
+            }
+        }
+    }
+
+    // Only warn once per event per process
+    static int warned[PERF_EVENT_COUNT];
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (errors[e] != 0 && !warned[e]) {
+            explainUnavailable(e, errors[e]);
+            warned[e] = 1;
+        }
+    }
+
+    region->malloc_calls_start = perfMallocCalls();
+    for (int i = 0; i < region->threads * PERF_EVENT_COUNT; i++) {
+        if (region->fds[i] >= 0) {
+            ioctl(region->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(region->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    region->start_time = omp_get_wtime();
+}
+
+static void formatCount(char *buffer, size_t length, int available, long long value) {
+    if (available) snprintf(buffer, length, "%lld", value);
+    else snprintf(buffer, length, "n/a");
+}
+
+static void formatRatio(char *buffer, size_t length, int available, double value) {
+    if (available) snprintf(buffer, length, "%.2f", value);
+    else snprintf(buffer, length, "n/a");
+}
+
+static void printCountersRow(const char *name, const long long *counts, const int *available) {
+    char cycles[24], instructions[24], ipc[16], llc[24], dtlb[24], task_clock[24], faults[24];
+    formatCount(cycles, sizeof(cycles), available[PERF_CYCLES], counts[PERF_CYCLES]);
+    formatCount(instructions, sizeof(instructions), available[PERF_INSTRUCTIONS], counts[PERF_INSTRUCTIONS]);
+    formatRatio(ipc, sizeof(ipc), available[PERF_CYCLES] && available[PERF_INSTRUCTIONS] && counts[PERF_CYCLES] > 0,
+                (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES]);
+    formatCount(llc, sizeof(llc), available[PERF_LLC_MISSES], counts[PERF_LLC_MISSES]);
+    formatCount(dtlb, sizeof(dtlb), available[PERF_DTLB_MISSES], counts[PERF_DTLB_MISSES]);
+    formatRatio(task_clock, sizeof(task_clock), available[PERF_TASK_CLOCK], counts[PERF_TASK_CLOCK] / 1e6);
+    formatCount(faults, sizeof(faults), available[PERF_PAGE_FAULTS], counts[PERF_PAGE_FAULTS]);
+    printf("  %-8s %14s %14s %6s %12s %12s %12s %10s\n", name, cycles, instructions, ipc, llc, dtlb, task_clock, faults);
+}
+
+// Stop the counters and print one row per thread plus the totals. `elements`
+// is the problem size and `bytes_moved` the bytes the kernel must read and
+// write at minimum; either may be 0 to skip the derived figures.
+void perfRegionEnd(PerfRegion *region, long elements, double bytes_moved) {
+    if (!region->enabled) return;
+    double seconds = omp_get_wtime() - region->start_time;
+    long malloc_calls = perfMallocCalls();
+
+    long long totals[PERF_EVENT_COUNT] = { 0 };
+    int total_available[PERF_EVENT_COUNT] = { 0 };
+    for (int i = 0; i < region->threads * PERF_EVENT_COUNT; i++) {
+        int fd = region->fds[i];
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        // value, time enabled, time running; scale up when the PMU multiplexed us
+        unsigned long long values[3];
+        if (read(fd, values, sizeof(values)) == sizeof(values)) {
+            double scale = values[2] > 0 ? (double)values[1] / values[2] : 0.0;
+            region->counts[i] = (long long)(values[0] * scale);
+        } else {
+            region->fds[i] = -1;
+        }
+        close(fd);
+    }
+
+    printf("Performance counters for %s with %d threads (%f seconds):\n", region->label, region->threads, seconds);
+    printf("  %-8s %14s %14s %6s %12s %12s %12s %10s\n",
+           "thread", "cycles", "instructions", "IPC", "LLC misses", "dTLB misses", "task ms", "faults");
+    for (int t = 0; t < region->threads; t++) {
+        const long long *counts = region->counts + t * PERF_EVENT_COUNT;
+        int available[PERF_EVENT_COUNT];
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+            available[e] = region->fds[t * PERF_EVENT_COUNT + e] >= 0;
+            if (available[e]) {
+                totals[e] += counts[e];
+                total_available[e] = 1;
+            }
+        }
+        char name[16];
+        snprintf(name, sizeof(name), "%d", t);
+        printCountersRow(name, counts, available);
+    }
+    printCountersRow("total", totals, total_available);
+
+    long peak_rss = perfPeakRssKb();
+    if (peak_rss >= 0) printf("  Peak RSS: %ld KB", peak_rss);
+    else printf("  Peak RSS: n/a");
+    if (malloc_calls >= 0) printf(", allocations during the kernel: %ld\n", malloc_calls - region->malloc_calls_start);
+    else printf(", allocations n/a (build with -DPERF_COUNT_MALLOC and --wrap)\n");
+
+    if (elements > 0 && bytes_moved > 0) {
+        printf("  Bytes per element: %.2f, achieved bandwidth: %.2f GB/s",
+               bytes_moved / elements, seconds > 0 ? bytes_moved / seconds / 1e9 : 0.0);
+        if (total_available[PERF_LLC_MISSES]) {
+            printf(", LLC miss traffic: %.2f bytes per element",
+                   (double)totals[PERF_LLC_MISSES] * CACHE_LINE_BYTES / elements);
+        }
+        printf("\n");
+    }
+
+    free(region->fds);
+    free(region->counts);
+    region->fds = NULL;
+    region->counts = NULL;
+}
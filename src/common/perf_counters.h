@@ -0,0 +1,44 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stddef.h>
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_TASK_CLOCK,
+    PERF_PAGE_FAULTS,
+    PERF_EVENT_COUNT
+} PerfEvent;
+
+typedef struct {
+    int enabled;
+} PerfOptions;
+
+// One instrumented kernel: a counter per event on every thread of the team or pool
+typedef struct {
+    const char *label;
+    int enabled;
+    int threads;
+    int *fds;                // threads x PERF_EVENT_COUNT, -1 where the event could not be opened
+    long long *counts;
+    double start_time;
+    long malloc_calls_start;
+} PerfRegion;
+
+#define PERF_OPTIONS_USAGE "[--perf]"
+
+void defaultPerfOptions(PerfOptions *options);
+int parsePerfOption(const char *arg, PerfOptions *options);
+
+void perfRegionBegin(PerfRegion *region, const PerfOptions *options, const char *label);
+void perfRegionBeginThreads(PerfRegion *region, const PerfOptions *options, const char *label,
+                            const int *tids, int count);
+void perfRegionEnd(PerfRegion *region, long elements, double bytes_moved);
+
+long perfMallocCalls(void);
+long perfPeakRssKb(void);
+
+#endif
@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "task_trace.h"
+
+/*
+    Task tracer for the OpenMP kernels. Every thread appends to its own ring
+    buffer, so recording a task costs two clock reads and no locking. After the
+    run traceReport rebuilds the task tree and prints work (T1), span (T-inf),
+    parallelism and the time threads spent outside task bodies, and can write
+    the whole run as Chrome trace JSON for chrome://tracing or ui.perfetto.dev.
+
+    A task's own work is its duration minus the waits it declares with
+    traceWaitBegin/End and minus anything else run inside it on the same
+    thread. Children that start inside one wait form a phase that runs in
+    parallel; phases follow each other. Children spawned without a wait are
+    joined at the end of the parallel region.
+*/
+
+#define TRACE_RING_CAPACITY (1 << 18)
+#define TRACE_MAX_THREADS 256
+
+typedef enum { TRACE_TASK, TRACE_WAIT } TraceKind;
+
+typedef struct {
+    double spawn, start, end;
+    const char *name;
+    int id;                  // the task, or for a wait the task that waited
+    int parent;
+    int kind;
+} TraceRecord;
+
+typedef struct {
+    TraceRecord *records;
+    long written;
+    int thread;
+} TraceBuffer;
+
+typedef struct {
+    double spawn, start, end, self, span;
+    const char *name;
+    int parent, thread, present;
+    int critical_child;      // largest span among the children of its phase
+    int critical;
+} TaskInfo;
+
+typedef struct {
+    double start, end;
+    int task;
+} WaitInfo;
+
+static int trace_enabled = 0;
+static const char *trace_output = NULL;
+static int next_task_id = 0;
+static TraceBuffer *buffers[TRACE_MAX_THREADS];
+static int buffer_count = 0;
+static __thread TraceBuffer *local_buffer = NULL;
+static __thread int current_task = -1;
+
+void defaultTraceOptions(TraceOptions *options) {
+    options->enabled = 0;
+    options->output = NULL;
+}
+
+// --trace prints the analysis, --trace=file also writes the Chrome trace
+int parseTraceOption(const char *arg, TraceOptions *options) {
+    if (strcmp(arg, "--trace") == 0) {
+        options->enabled = 1;
+        return 1;
+    }
+    if (strncmp(arg, "--trace=", 8) == 0) {
+        options->enabled = 1;
+        options->output = arg + 8;
+        return 1;
+    }
+    return 0;
+}
+
+void traceStart(const TraceOptions *options) {
+    trace_output = options->output;
+    next_task_id = 0;
+    for (int b = 0; b < buffer_count; b++) {
+        buffers[b]->written = 0;
+    }
+    trace_enabled = options->enabled;
+}
+
+void traceStop(void) {
+    trace_enabled = 0;
+}
+
+static TraceBuffer* threadBuffer(void) {
+    if (local_buffer != NULL) return local_buffer;
+    TraceBuffer *buffer = malloc(sizeof(TraceBuffer));
+    TraceRecord *records = malloc(TRACE_RING_CAPACITY * sizeof(TraceRecord));
+    if (buffer == NULL || records == NULL) {
+        fprintf(stderr, "Memory allocation failed for the trace buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    buffer->records = records;
+    buffer->written = 0;
+    #pragma omp critical(trace_register)
+    {
+        if (buffer_count == TRACE_MAX_THREADS) {
+            fprintf(stderr, "Too many threads to trace (at most %d)\n", TRACE_MAX_THREADS);
+            exit(EXIT_FAILURE);
+        }
+        buffer->thread = buffer_count;
+        buffers[buffer_count++] = buffer;
+    }
+    local_buffer = buffer;
+    return buffer;
+}
+
+static void appendRecord(const TraceRecord *record) {
+    TraceBuffer *buffer = threadBuffer();
+    // Full rings overwrite their oldest records; traceReport says how many were lost
+    buffer->records[buffer->written % TRACE_RING_CAPACITY] = *record;
+    buffer->written++;
+}
+
+TraceSpawn traceSpawn(void) {
+    TraceSpawn spawn = { current_task, 0.0 };
+    if (trace_enabled) spawn.time = omp_get_wtime();
+    return spawn;
+}
+
+void traceTaskBegin(TraceTask *task, const char *name, TraceSpawn spawn) {
+    if (!trace_enabled) {
+        task->id = -1;
+        return;
+    }
+    task->id = __atomic_fetch_add(&next_task_id, 1, __ATOMIC_RELAXED);
+    task->previous = current_task;
+    task->parent = spawn.parent;
+    task->spawn = spawn.time;
+    task->name = name;
+    current_task = task->id;
+    task->start = omp_get_wtime();
+}
+
+void traceTaskEnd(TraceTask *task) {
+    if (task->id < 0) return;
+    TraceRecord record;
+    record.end = omp_get_wtime();
+    record.spawn = task->spawn;
+    record.start = task->start;
+    record.name = task->name;
+    record.id = task->id;
+    record.parent = task->parent;
+    record.kind = TRACE_TASK;
+    appendRecord(&record);
+    current_task = task->previous;
+}
+
+// Bracket the point where the current task waits for the children it spawned
+double traceWaitBegin(void) {
+    if (!trace_enabled || current_task < 0) return -1.0;
+    return omp_get_wtime();
+}
+
+void traceWaitEnd(double start) {
+    if (start < 0 || current_task < 0) return;
+    TraceRecord record;
+    record.end = omp_get_wtime();
+    record.spawn = start;
+    record.start = start;
+    record.name = "wait";
+    record.id = current_task;
+    record.parent = -1;
+    record.kind = TRACE_WAIT;
+    appendRecord(&record);
+}
+
+static int compareByStart(const void *a, const void *b) {
+    const TraceRecord *x = a, *y = b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    // Equal starts: the longer interval encloses the shorter one
+    if (x->end != y->end) return x->end > y->end ? -1 : 1;
+    // and a task sorts before a wait with the same interval
+    return (x->kind == TRACE_WAIT) - (y->kind == TRACE_WAIT);
+}
+
+static int compareWaits(const void *a, const void *b) {
+    const WaitInfo *x = a, *y = b;
+    if (x->task != y->task) return x->task - y->task;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+static void* allocateOrExit(size_t bytes) {
+    void *data = calloc(1, bytes > 0 ? bytes : 1);
+    if (data == NULL) {
+        fprintf(stderr, "Memory allocation failed for the trace analysis\n");
+        exit(EXIT_FAILURE);
+    }
+    return data;
+}
+
+static void writeChromeTrace(const char *filename, const TaskInfo *tasks, int task_count,
+                             const WaitInfo *waits, long wait_count, double origin) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        perror("Error opening trace file");
+        return;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"tasks\"}}");
+    for (int b = 0; b < buffer_count; b++) {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}", b, b);
+    }
+    for (int i = 0; i < task_count; i++) {
+        const TaskInfo *task = &tasks[i];
+        if (!task->present) continue;
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                      "\"args\":{\"id\":%d,\"parent\":%d,\"self_us\":%.3f,\"span_us\":%.3f}}",
+                task->name, task->critical ? "task,critical" : "task", task->thread,
+                (task->start - origin) * 1e6, (task->end - task->start) * 1e6,
+                i, task->parent, task->self * 1e6, task->span * 1e6);
+        // Flow arrow from the spawn point in the parent to the child's start
+        if (task->parent >= 0 && tasks[task->parent].present) {
+            fprintf(file, ",\n{\"name\":\"spawn\",\"cat\":\"spawn\",\"ph\":\"s\",\"id\":%d,\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                    i, tasks[task->parent].thread, (task->spawn - origin) * 1e6);
+            fprintf(file, ",\n{\"name\":\"spawn\",\"cat\":\"spawn\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%d,\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                    i, task->thread, (task->start - origin) * 1e6);
+        }
+    }
+    for (long w = 0; w < wait_count; w++) {
+        const WaitInfo *wait = &waits[w];
+        fprintf(file, ",\n{\"name\":\"wait\",\"cat\":\"wait\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"task\":%d}}",
+                tasks[wait->task].thread, (wait->start - origin) * 1e6, (wait->end - wait->start) * 1e6, wait->task);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    printf("  Chrome trace written to %s\n", filename);
+}
+
+// Rebuild the task tree from the rings and print the work/span analysis
+void traceReport(const char *label) {
+    int task_count = next_task_id;
+    if (task_count == 0) return;
+
+    TaskInfo *tasks = allocateOrExit(task_count * sizeof(TaskInfo));
+    long retained = 0, dropped = 0;
+    for (int b = 0; b < buffer_count; b++) {
+        long written = buffers[b]->written;
+        retained += written < TRACE_RING_CAPACITY ? written : TRACE_RING_CAPACITY;
+        dropped += written > TRACE_RING_CAPACITY ? written - TRACE_RING_CAPACITY : 0;
+    }
+    WaitInfo *waits = allocateOrExit(retained * sizeof(WaitInfo));
+    long wait_count = 0;
+
+    // Own work: sweep each thread's intervals in start order; anything nested
+    // directly inside an interval is subtracted from it
+    TraceRecord *records = allocateOrExit(TRACE_RING_CAPACITY * sizeof(TraceRecord));
+    double *nested = allocateOrExit(TRACE_RING_CAPACITY * sizeof(double));
+    int *stack = allocateOrExit(TRACE_RING_CAPACITY * sizeof(int));
+    double *thread_busy = allocateOrExit(buffer_count * sizeof(double));
+    for (int b = 0; b < buffer_count; b++) {
+        long count = buffers[b]->written < TRACE_RING_CAPACITY ? buffers[b]->written : TRACE_RING_CAPACITY;
+        memcpy(records, buffers[b]->records, count * sizeof(TraceRecord));
+        qsort(records, count, sizeof(TraceRecord), compareByStart);
+        int depth = 0;
+        for (long r = 0; r < count; r++) {
+            while (depth > 0 && records[stack[depth - 1]].end <= records[r].start) depth--;
+            if (depth > 0) nested[stack[depth - 1]] += records[r].end - records[r].start;
+            nested[r] = 0.0;
+            stack[depth++] = r;
+        }
+        for (long r = 0; r < count; r++) {
+            const TraceRecord *record = &records[r];
+            if (record->kind == TRACE_WAIT) {
+                waits[wait_count].start = record->start;
+                waits[wait_count].end = record->end;
+                waits[wait_count].task = record->id;
+                wait_count++;
+                continue;
+            }
+            TaskInfo *task = &tasks[record->id];
+            task->spawn = record->spawn;
+            task->start = record->start;
+            task->end = record->end;
+            task->self = record->end - record->start - nested[r];
+            task->name = record->name;
+            task->parent = record->parent;
+            task->thread = b;
+            task->present = 1;
+            task->critical_child = 0;
+            thread_busy[b] += task->self;
+        }
+    }
+    free(records);
+    free(nested);
+    free(stack);
+
+    // Waits grouped by task, in time order
+    qsort(waits, wait_count, sizeof(WaitInfo), compareWaits);
+    long *wait_begin = allocateOrExit((task_count + 1) * sizeof(long));
+    for (long w = 0; w < wait_count; w++) wait_begin[waits[w].task + 1]++;
+    for (int i = 0; i < task_count; i++) wait_begin[i + 1] += wait_begin[i];
+
+    // Children grouped by parent
+    int *child_begin = allocateOrExit((task_count + 1) * sizeof(int));
+    int *children = allocateOrExit(task_count * sizeof(int));
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i].present && tasks[i].parent >= 0 && tasks[tasks[i].parent].present) {
+            child_begin[tasks[i].parent + 1]++;
+        }
+    }
+    for (int i = 0; i < task_count; i++) child_begin[i + 1] += child_begin[i];
+    int *fill = allocateOrExit(task_count * sizeof(int));
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i].present && tasks[i].parent >= 0 && tasks[tasks[i].parent].present) {
+            int parent = tasks[i].parent;
+            children[child_begin[parent] + fill[parent]++] = i;
+        }
+    }
+    free(fill);
+
+    // Span bottom-up: children always have larger ids than their parent
+    long max_waits = 0;
+    for (int i = 0; i < task_count; i++) {
+        if (wait_begin[i + 1] - wait_begin[i] > max_waits) max_waits = wait_begin[i + 1] - wait_begin[i];
+    }
+    double *phase_span = allocateOrExit((max_waits + 1) * sizeof(double));
+    int *phase_child = allocateOrExit((max_waits + 1) * sizeof(int));
+    for (int i = task_count - 1; i >= 0; i--) {
+        TaskInfo *task = &tasks[i];
+        if (!task->present) continue;
+        long first_wait = wait_begin[i], phases = wait_begin[i + 1] - wait_begin[i];
+        for (long k = 0; k <= phases; k++) {
+            phase_span[k] = 0.0;
+            phase_child[k] = -1;
+        }
+        for (int c = child_begin[i]; c < child_begin[i + 1]; c++) {
+            const TaskInfo *child = &tasks[children[c]];
+            // A child belongs to the first wait that ends after it was spawned; it may
+            // start inside that wait or, when the waiting thread runs it, later still
+            long k = 0;
+            while (k < phases && child->spawn > waits[first_wait + k].end) k++;
+            if (child->span > phase_span[k]) {
+                phase_span[k] = child->span;
+                phase_child[k] = children[c];
+            }
+        }
+        task->span = task->self;
+        for (long k = 0; k <= phases; k++) {
+            task->span += phase_span[k];
+            if (phase_child[k] >= 0) tasks[phase_child[k]].critical_child = 1;
+        }
+    }
+    free(phase_span);
+    free(phase_child);
+
+    double work = 0.0, span = 0.0, latency = 0.0;
+    double first_start = 0.0, last_end = 0.0;
+    int present = 0, spawned = 0, critical_tasks = 0;
+    for (int i = 0; i < task_count; i++) {
+        TaskInfo *task = &tasks[i];
+        if (!task->present) continue;
+        int root = task->parent < 0 || !tasks[task->parent].present;
+        // Roots are traced one after another from the serial part of the program
+        if (root) span += task->span;
+        task->critical = root || (task->critical_child && tasks[task->parent].critical);
+        critical_tasks += task->critical;
+        work += task->self;
+        if (!root) {
+            latency += task->start - task->spawn;
+            spawned++;
+        }
+        if (present == 0 || task->start < first_start) first_start = task->start;
+        if (present == 0 || task->end > last_end) last_end = task->end;
+        present++;
+    }
+
+    double wall = last_end - first_start;
+    double capacity = wall * buffer_count;
+    printf("Task trace of %s: %d tasks on %d threads over %f seconds\n", label, present, buffer_count, wall);
+    printf("  Work T1: %f seconds\n", work);
+    printf("  Span T-inf: %f seconds (%d tasks on the critical path)\n", span, critical_tasks);
+    printf("  Parallelism T1/T-inf: %.2f\n", span > 0 ? work / span : 0.0);
+    printf("  Scheduler overhead and idle time: %f thread-seconds (%.1f%% of %d x %f)\n",
+           capacity - work, capacity > 0 ? 100.0 * (capacity - work) / capacity : 0.0, buffer_count, wall);
+    if (spawned > 0) {
+        printf("  Mean spawn-to-start latency: %.3f us\n", 1e6 * latency / spawned);
+    }
+    for (int b = 0; b < buffer_count; b++) {
+        printf("  Thread %d busy %f seconds (%.1f%%)\n", b, thread_busy[b], wall > 0 ? 100.0 * thread_busy[b] / wall : 0.0);
+    }
+    if (dropped > 0) {
+        printf("  Warning: %ld records were overwritten in full ring buffers; the analysis covers the rest\n", dropped);
+    }
+    if (trace_output != NULL) {
+        writeChromeTrace(trace_output, tasks, task_count, waits, wait_count, first_start);
+    }
+
+    free(tasks);
+    free(waits);
+    free(wait_begin);
+    free(child_begin);
+    free(children);
+    free(thread_busy);
+}
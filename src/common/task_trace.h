@@ -0,0 +1,41 @@
+#ifndef TASK_TRACE_H
+#define TASK_TRACE_H
+
+typedef struct {
+    int enabled;
+    const char *output;      // Chrome trace JSON file, NULL to only print the analysis
+} TraceOptions;
+
+// Captured by the parent right before it creates a task or section and
+// handed to the child, so the child knows who spawned it and when
+typedef struct {
+    int parent;
+    double time;
+} TraceSpawn;
+
+// Lives on the stack of the traced task between traceTaskBegin and traceTaskEnd
+typedef struct {
+    int id;
+    int previous;            // task that was running on this thread before
+    int parent;
+    double spawn;
+    double start;
+    const char *name;
+} TraceTask;
+
+#define TRACE_OPTIONS_USAGE "[--trace[=trace.json]]"
+
+void defaultTraceOptions(TraceOptions *options);
+int parseTraceOption(const char *arg, TraceOptions *options);
+
+void traceStart(const TraceOptions *options);
+void traceStop(void);
+void traceReport(const char *label);
+
+TraceSpawn traceSpawn(void);
+void traceTaskBegin(TraceTask *task, const char *name, TraceSpawn spawn);
+void traceTaskEnd(TraceTask *task);
+double traceWaitBegin(void);
+void traceWaitEnd(double start);
+
+#endif
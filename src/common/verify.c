@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <omp.h>
+#include "verify.h"
+
+/*
+    Freivalds' check of C = A * B for the matrix programs: draw r from
+    {0,1}^n and compare A(Br) with Cr in O(n^2). If C != AB a single trial
+    catches it with probability at least 1/2. The sums wrap modulo 2^32
+    just like the int kernels, so overflow never raises false alarms.
+*/
+
+void defaultVerifyOptions(VerifyOptions *options) {
+    options->trials = 0;
+}
+
+int parseVerifyOption(const char *arg, VerifyOptions *options) {
+    if (strcmp(arg, "--verify") == 0) {
+        options->trials = DEFAULT_VERIFY_TRIALS;
+        return 1;
+    }
+    if (strncmp(arg, "--verify=", 9) == 0) {
+        // Anything but a whole non-negative count is left for the caller to reject
+        char *end;
+        long trials = strtol(arg + 9, &end, 10);
+        if (end == arg + 9 || *end != '\0' || trials < 0 || trials > INT_MAX) return 0;
+        options->trials = (int)trials;
+        return 1;
+    }
+    return 0;
+}
+
+VerifyMatrix verifyRows(int **rows, int size) {
+    VerifyMatrix matrix = { rows, NULL, size };
+    return matrix;
+}
+
+VerifyMatrix verifyFlat(const int *data, int size) {
+    VerifyMatrix matrix = { NULL, data, size };
+    return matrix;
+}
+
+static const int* matrixRow(VerifyMatrix matrix, int i) {
+    return matrix.rows != NULL ? matrix.rows[i] : matrix.flat + (long)i * matrix.size;
+}
+
+// splitmix64 finalizer, used to derive independent random bits per (trial, index)
+static unsigned int randomBit(unsigned long long seed, int trial, int index) {
+    unsigned long long z = seed + ((unsigned long long)trial << 32) + (unsigned int)index;
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)((z ^ (z >> 31)) & 1);
+}
+
+// Returns the number of trials that found C != AB
+int freivaldsVerify(VerifyMatrix A, VerifyMatrix B, VerifyMatrix C, int trials, unsigned long long seed) {
+    int size = C.size;
+    unsigned int *r = malloc(size * sizeof(unsigned int));
+    unsigned int *Br = malloc(size * sizeof(unsigned int));
+    if (r == NULL || Br == NULL) {
+        fprintf(stderr, "Memory allocation failed for verification vectors\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int failures = 0;
+    for (int t = 0; t < trials; t++) {
+        #pragma omp parallel for
+        for (int i = 0; i < size; i++) {
+            r[i] = randomBit(seed, t, i);
+        }
+
+        #pragma omp parallel for
+        for (int i = 0; i < size; i++) {
+            const int *b_row = matrixRow(B, i);
+            unsigned int sum = 0;
+            for (int j = 0; j < size; j++) {
+                sum += (unsigned int)b_row[j] * r[j];
+            }
+            Br[i] = sum;
+        }
+
+        int mismatch = 0;
+        #pragma omp parallel for reduction(||:mismatch)
+        for (int i = 0; i < size; i++) {
+            const int *a_row = matrixRow(A, i), *c_row = matrixRow(C, i);
+            unsigned int ABr = 0, Cr = 0;
+            for (int j = 0; j < size; j++) {
+                ABr += (unsigned int)a_row[j] * Br[j];
+                Cr += (unsigned int)c_row[j] * r[j];
+            }
+            mismatch = mismatch || ABr != Cr;
+        }
+        failures += mismatch;
+    }
+
+    free(r);
+    free(Br);
+    return failures;
+}
+
+// Returns the process exit status: 0 when every trial agreed with C
+int reportVerification(VerifyMatrix A, VerifyMatrix B, VerifyMatrix C, int trials) {
+    double start = omp_get_wtime();
+    int failures = freivaldsVerify(A, B, C, trials, (unsigned long long)time(NULL));
+    double end = omp_get_wtime();
+
+    if (failures == 0) {
+        double bound = 1.0;
+        for (int t = 0; t < trials; t++) bound /= 2.0;
+        printf("Verification passed: %d Freivalds trials in %f seconds (false-positive probability <= %g)\n", trials, end - start, bound);
+        return 0;
+    }
+    printf("Verification FAILED: %d of %d Freivalds trials found C != A*B (%f seconds)\n", failures, trials, end - start);
+    return 1;
+}
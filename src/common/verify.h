@@ -0,0 +1,29 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#define DEFAULT_VERIFY_TRIALS 20
+
+// A square matrix either as row pointers or as one flat row-major array;
+// exactly one of rows and flat is set
+typedef struct {
+    int **rows;
+    const int *flat;
+    int size;
+} VerifyMatrix;
+
+typedef struct {
+    int trials;              // 0 when --verify was not given
+} VerifyOptions;
+
+#define VERIFY_OPTIONS_USAGE "[--verify[=trials]]"
+
+void defaultVerifyOptions(VerifyOptions *options);
+int parseVerifyOption(const char *arg, VerifyOptions *options);
+
+VerifyMatrix verifyRows(int **rows, int size);
+VerifyMatrix verifyFlat(const int *data, int size);
+
+int freivaldsVerify(VerifyMatrix A, VerifyMatrix B, VerifyMatrix C, int trials, unsigned long long seed);
+int reportVerification(VerifyMatrix A, VerifyMatrix B, VerifyMatrix C, int trials);
+
+#endif
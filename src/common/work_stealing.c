@@ -0,0 +1,410 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <omp.h>
+#include "work_stealing.h"
+#include "xorshift.h"
+
+/*
+    A work-stealing task runtime to compare against OpenMP tasks and sections.
+    Every worker owns a Chase-Lev deque: it pushes and pops at the bottom
+    without locks while thieves take from the top with one compare-and-swap.
+    An idle worker steals from a random victim, spins for a while and then
+    parks on a condition variable until a spawn wakes it. wsJoin helps first:
+    while the joined task is unfinished the joiner runs its own newest tasks
+    and steals, so no worker ever blocks on a child.
+
+    The thread calling wsRun becomes worker 0 for the duration of the run and
+    the pool starts the other workers once, so repeated runs reuse warm
+    threads. Workers run any OpenMP loop they reach with a single thread.
+*/
+
+#define WS_INITIAL_CAPACITY 256      // tasks per deque before it grows, a power of two
+#define WS_SPIN_ROUNDS 4096          // failed steal rounds before an idle worker parks
+#define WS_YIELD_INTERVAL 64         // spinning workers yield the CPU this often
+#define WS_PARK_TIMEOUT_NS 1000000   // parked workers look for work every millisecond regardless
+#define WS_CACHE_LINE 64
+
+typedef struct WsArray {
+    long capacity;
+    struct WsArray *retired;         // the array this one replaced; thieves may still read it
+    WsTask *slots[];
+} WsArray;
+
+typedef struct {
+    long top;
+    char top_padding[WS_CACHE_LINE - sizeof(long)];
+    long bottom;
+    WsArray *array;
+} WsDeque;
+
+typedef enum { WS_EXECUTED, WS_SPAWNED, WS_STOLEN, WS_FAILED_STEALS, WS_PARKS, WS_STAT_COUNT } WsStat;
+
+typedef struct {
+    WsDeque deque;
+    WsPool *pool;
+    int id;
+    uint64_t random;             // xorshift64* state, one stream per worker
+    pthread_t thread;
+    int tid;                     // kernel thread id, set once the worker runs
+    // Written only by the owning worker, read with relaxed loads by the report
+    long stats[WS_STAT_COUNT];
+    long baseline[WS_STAT_COUNT];
+} __attribute__((aligned(WS_CACHE_LINE))) WsWorker;
+
+struct WsPool {
+    int workers;
+    WsWorker *worker;
+    int shutdown;
+    int sleepers;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    double run_time;
+};
+
+static __thread WsWorker *current_worker = NULL;
+
+void defaultRuntimeOptions(RuntimeOptions *options) {
+    options->kind = RUNTIME_OMP;
+}
+
+int parseRuntimeOption(const char *arg, RuntimeOptions *options) {
+    if (strcmp(arg, "--runtime=omp") == 0) {
+        options->kind = RUNTIME_OMP;
+        return 1;
+    }
+    if (strcmp(arg, "--runtime=ws") == 0) {
+        options->kind = RUNTIME_WS;
+        return 1;
+    }
+    return 0;
+}
+
+static void countStat(WsWorker *worker, WsStat stat) {
+    __atomic_store_n(&worker->stats[stat], __atomic_load_n(&worker->stats[stat], __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+static WsArray* newArray(long capacity, WsArray *retired) {
+    WsArray *array = malloc(sizeof(WsArray) + capacity * sizeof(WsTask *));
+    if (array == NULL) {
+        fprintf(stderr, "Memory allocation failed for a work-stealing deque\n");
+        exit(EXIT_FAILURE);
+    }
+    array->capacity = capacity;
+    array->retired = retired;
+    return array;
+}
+
+// Owner only: double the array, keeping every task at the same logical index
+static WsArray* dequeGrow(WsDeque *deque, WsArray *array, long top, long bottom) {
+    WsArray *bigger = newArray(array->capacity * 2, array);
+    for (long i = top; i < bottom; i++) {
+        WsTask *task = __atomic_load_n(&array->slots[i & (array->capacity - 1)], __ATOMIC_RELAXED);
+        __atomic_store_n(&bigger->slots[i & (bigger->capacity - 1)], task, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&deque->array, bigger, __ATOMIC_RELEASE);
+    return bigger;
+}
+
+static void dequePush(WsDeque *deque, WsTask *task) {
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    WsArray *array = __atomic_load_n(&deque->array, __ATOMIC_RELAXED);
+    if (bottom - top > array->capacity - 1) {
+        array = dequeGrow(deque, array, top, bottom);
+    }
+    __atomic_store_n(&array->slots[bottom & (array->capacity - 1)], task, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+// Owner only: pop the newest task, racing the thieves when it is the last one
+static WsTask* dequeTake(WsDeque *deque) {
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    WsArray *array = __atomic_load_n(&deque->array, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    WsTask *task = __atomic_load_n(&array->slots[bottom & (array->capacity - 1)], __ATOMIC_RELAXED);
+    if (top == bottom) {
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            task = NULL;
+        }
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+// Any thread: take the oldest task, or NULL when empty or another thief won
+static WsTask* dequeSteal(WsDeque *deque) {
+    long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) return NULL;
+
+    WsArray *array = __atomic_load_n(&deque->array, __ATOMIC_ACQUIRE);
+    WsTask *task = __atomic_load_n(&array->slots[top & (array->capacity - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return task;
+}
+
+static int dequeEmpty(WsDeque *deque) {
+    return __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE) - __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE) <= 0;
+}
+
+
+static WsTask* stealOnce(WsWorker *self) {
+    WsPool *pool = self->pool;
+    if (pool->workers < 2) return NULL;
+    int victim = (unsigned int)(nextRandom(&self->random) >> 32) % (pool->workers - 1);
+    if (victim >= self->id) victim++;
+    WsTask *task = dequeSteal(&pool->worker[victim].deque);
+    countStat(self, task != NULL ? WS_STOLEN : WS_FAILED_STEALS);
+    return task;
+}
+
+static WsTask* findTask(WsWorker *self) {
+    WsTask *task = dequeTake(&self->deque);
+    if (task != NULL) return task;
+    return stealOnce(self);
+}
+
+static void execute(WsWorker *self, WsTask *task) {
+    task->function(task->arg);
+    countStat(self, WS_EXECUTED);
+    __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+}
+
+static void spinPause(int round) {
+    if (round % WS_YIELD_INTERVAL == 0) {
+        sched_yield();
+    } else {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+static int anyWork(WsPool *pool) {
+    for (int w = 0; w < pool->workers; w++) {
+        if (!dequeEmpty(&pool->worker[w].deque)) return 1;
+    }
+    return 0;
+}
+
+static void park(WsWorker *self) {
+    WsPool *pool = self->pool;
+    pthread_mutex_lock(&pool->lock);
+    __atomic_fetch_add(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    // A spawn that read the old sleeper count pushed before this scan, so it is seen here
+    if (!anyWork(pool) && !__atomic_load_n(&pool->shutdown, __ATOMIC_ACQUIRE)) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += WS_PARK_TIMEOUT_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&pool->wake, &pool->lock, &deadline);
+        countStat(self, WS_PARKS);
+    }
+    __atomic_fetch_sub(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void wakeSleeper(WsPool *pool) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void* workerMain(void *arg) {
+    WsWorker *self = arg;
+    WsPool *pool = self->pool;
+    current_worker = self;
+    __atomic_store_n(&self->tid, (int)syscall(SYS_gettid), __ATOMIC_RELEASE);
+    omp_set_num_threads(1);
+
+    int idle = 0;
+    while (!__atomic_load_n(&pool->shutdown, __ATOMIC_ACQUIRE)) {
+        WsTask *task = findTask(self);
+        if (task != NULL) {
+            execute(self, task);
+            idle = 0;
+        } else if (++idle < WS_SPIN_ROUNDS) {
+            spinPause(idle);
+        } else {
+            park(self);
+            idle = 0;
+        }
+    }
+    return NULL;
+}
+
+WsPool* wsPoolCreate(int workers) {
+    WsPool *pool = malloc(sizeof(WsPool));
+    WsWorker *worker = NULL;
+    if (pool != NULL && posix_memalign((void **)&worker, WS_CACHE_LINE, workers * sizeof(WsWorker)) != 0) {
+        worker = NULL;
+    }
+    if (pool == NULL || worker == NULL) {
+        fprintf(stderr, "Memory allocation failed for the work-stealing pool\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(worker, 0, workers * sizeof(WsWorker));
+    pool->workers = workers;
+    pool->worker = worker;
+    pool->shutdown = 0;
+    pool->sleepers = 0;
+    pool->run_time = 0.0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (int w = 0; w < workers; w++) {
+        worker[w].pool = pool;
+        worker[w].id = w;
+        worker[w].random = 0x9E3779B97F4A7C15ULL * (w + 1);
+        worker[w].deque.array = newArray(WS_INITIAL_CAPACITY, NULL);
+    }
+    // Worker 0 is whichever thread calls wsRun
+    for (int w = 1; w < workers; w++) {
+        if (pthread_create(&worker[w].thread, NULL, workerMain, &worker[w]) != 0) {
+            fprintf(stderr, "Failed to start work-stealing worker %d\n", w);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+void wsPoolDestroy(WsPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    __atomic_store_n(&pool->shutdown, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 1; w < pool->workers; w++) {
+        pthread_join(pool->worker[w].thread, NULL);
+    }
+    for (int w = 0; w < pool->workers; w++) {
+        WsArray *array = pool->worker[w].deque.array;
+        while (array != NULL) {
+            WsArray *retired = array->retired;
+            free(array);
+            array = retired;
+        }
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->worker);
+    free(pool);
+}
+
+// Start a new reporting interval: wsReportStats counts from here, over
+// however many wsRuns follow
+void wsResetStats(WsPool *pool) {
+    for (int w = 0; w < pool->workers; w++) {
+        for (int s = 0; s < WS_STAT_COUNT; s++) {
+            pool->worker[w].baseline[s] = __atomic_load_n(&pool->worker[w].stats[s], __ATOMIC_RELAXED);
+        }
+    }
+    pool->run_time = 0.0;
+}
+
+// Kernel thread ids of the workers for per-thread counters or pinning, worker
+// 0 being the calling thread, which must be the one that calls wsRun; waits
+// for workers that have not started yet and returns the worker count
+int wsPoolThreadIds(WsPool *pool, int *tids) {
+    tids[0] = (int)syscall(SYS_gettid);
+    for (int w = 1; w < pool->workers; w++) {
+        while ((tids[w] = __atomic_load_n(&pool->worker[w].tid, __ATOMIC_ACQUIRE)) == 0) {
+            sched_yield();
+        }
+    }
+    return pool->workers;
+}
+
+// Run function(arg) as the root task and return once it and every task it
+// spawned and joined have finished
+void wsRun(WsPool *pool, WsFunction function, void *arg) {
+    WsWorker *previous = current_worker;
+    int omp_threads = omp_get_max_threads();
+    current_worker = &pool->worker[0];
+    omp_set_num_threads(1);
+
+    double start = omp_get_wtime();
+    WsTask root = { function, arg, 0 };
+    execute(current_worker, &root);
+    pool->run_time += omp_get_wtime() - start;
+
+    omp_set_num_threads(omp_threads);
+    current_worker = previous;
+}
+
+// Counts and time in wsRun since the last wsResetStats, per worker and in total
+void wsReportStats(WsPool *pool, const char *label) {
+    long totals[WS_STAT_COUNT] = { 0 };
+    printf("Work-stealing runtime for %s with %d workers (%f seconds):\n", label, pool->workers, pool->run_time);
+    printf("  %-8s %12s %12s %12s %14s %8s\n", "worker", "executed", "spawned", "stolen", "failed steals", "parks");
+    for (int w = 0; w < pool->workers; w++) {
+        long counts[WS_STAT_COUNT];
+        for (int s = 0; s < WS_STAT_COUNT; s++) {
+            counts[s] = __atomic_load_n(&pool->worker[w].stats[s], __ATOMIC_RELAXED) - pool->worker[w].baseline[s];
+            totals[s] += counts[s];
+        }
+        printf("  %-8d %12ld %12ld %12ld %14ld %8ld\n", w, counts[WS_EXECUTED], counts[WS_SPAWNED],
+               counts[WS_STOLEN], counts[WS_FAILED_STEALS], counts[WS_PARKS]);
+    }
+    printf("  %-8s %12ld %12ld %12ld %14ld %8ld\n", "total", totals[WS_EXECUTED], totals[WS_SPAWNED],
+           totals[WS_STOLEN], totals[WS_FAILED_STEALS], totals[WS_PARKS]);
+    if (totals[WS_EXECUTED] > 0) {
+        printf("  %.1f%% of tasks were stolen, %.1f ns of wall time per task\n",
+               100.0 * totals[WS_STOLEN] / totals[WS_EXECUTED], 1e9 * pool->run_time / totals[WS_EXECUTED]);
+    }
+}
+
+// Make the task available to thieves; outside a pool it simply runs now
+void wsSpawn(WsTask *task, WsFunction function, void *arg) {
+    task->function = function;
+    task->arg = arg;
+    task->done = 0;
+    WsWorker *self = current_worker;
+    if (self == NULL) {
+        function(arg);
+        task->done = 1;
+        return;
+    }
+    dequePush(&self->deque, task);
+    countStat(self, WS_SPAWNED);
+    wakeSleeper(self->pool);
+}
+
+// Help-first join: until the task is done, run our own newest tasks (the
+// joined one itself unless a thief got it) and steal from others
+void wsJoin(WsTask *task) {
+    WsWorker *self = current_worker;
+    int idle = 0;
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+        WsTask *next = findTask(self);
+        if (next != NULL) {
+            execute(self, next);
+            idle = 0;
+        } else {
+            spinPause(++idle);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+typedef enum { RUNTIME_OMP, RUNTIME_WS } RuntimeKind;
+
+typedef struct {
+    RuntimeKind kind;
+} RuntimeOptions;
+
+#define RUNTIME_OPTIONS_USAGE "[--runtime=omp|ws]"
+
+void defaultRuntimeOptions(RuntimeOptions *options);
+int parseRuntimeOption(const char *arg, RuntimeOptions *options);
+
+typedef void (*WsFunction)(void *arg);
+
+// Lives on the spawning task's stack between wsSpawn and wsJoin
+typedef struct {
+    WsFunction function;
+    void *arg;
+    int done;
+} WsTask;
+
+typedef struct WsPool WsPool;
+
+WsPool* wsPoolCreate(int workers);
+void wsPoolDestroy(WsPool *pool);
+void wsResetStats(WsPool *pool);
+int wsPoolThreadIds(WsPool *pool, int *tids);
+void wsRun(WsPool *pool, WsFunction function, void *arg);
+void wsReportStats(WsPool *pool, const char *label);
+
+void wsSpawn(WsTask *task, WsFunction function, void *arg);
+void wsJoin(WsTask *task);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef XORSHIFT_H
+#define XORSHIFT_H
+
+#include <stdint.h>
+
+// xorshift64*: a fast generator for sampling and load generation, not for
+// anything that needs unpredictability. Seed the state with a non-zero
+// value; the high bits of the result are the best ones.
+static inline uint64_t nextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+#endif
@@ -0,0 +1,507 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <omp.h>
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -O2 -fopenmp -o calibrate calibrate.c
+    command to execute:
+    ./calibrate [max number of threads] [output json]
+
+    Measures the machine parameters the cost models need and writes them as
+    JSON for predict.py: per-operation costs of the kernels' inner loops, and
+    for every thread count the memory bandwidth, the BSP barrier latency L and
+    per-word cost g, the cost of a fork/join and of a task, and the LogP
+    latency L, overhead o and gap g.
+
+    Build it with the same flags as the programs being modelled; the
+    per-operation costs are only meaningful at the same optimization level.
+    The Makefile builds it, libpcm and the Strassen program at -O2.
+*/
+
+#define CACHE_LINE 64
+#define OP_ELEMENTS (1 << 20)
+#define MADD_SIZE 256
+#define MADD_LARGE_SIZE 768
+#define STRASSEN_LEAF 32     // parallel_strassenMultiply multiplies directly at or below this size
+#define TRIAD_ELEMENTS (1 << 22)
+#define H_RELATION_WORDS (1 << 16)
+#define MAX_REPEATS 2000
+#define TIME_BUDGET 0.05     // seconds per measurement, so oversubscribed runs stay short
+#define SPIN_BEFORE_YIELD 1000
+#define LOGP_MESSAGES 1000
+
+// Keeps results alive so the timed loops are not removed
+volatile long sink;
+
+static unsigned long long rngState = 42;
+static unsigned int nextRandom(void) {
+    rngState = rngState * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(rngState >> 33);
+}
+
+static int* allocateInts(long count) {
+    int *data = malloc(count * sizeof(int));
+    if (data == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    return data;
+}
+
+// Serial replica of merge() in libpcm, which merges through the context's scratch
+static void mergeRuns(int *arr, int *scratch, int left, int mid, int right) {
+    for (int i = left; i <= right; i++) scratch[i] = arr[i];
+    int i = left, j = mid + 1, k = left;
+    while (i <= mid && j <= right) {
+        if (scratch[i] <= scratch[j]) arr[k++] = scratch[i++];
+        else arr[k++] = scratch[j++];
+    }
+    while (i <= mid) arr[k++] = scratch[i++];
+    while (j <= right) arr[k++] = scratch[j++];
+}
+
+static void serialMergeSort(int *arr, int *scratch, int left, int right) {
+    if (left < right) {
+        int mid = left + (right - left) / 2;
+        serialMergeSort(arr, scratch, left, mid);
+        serialMergeSort(arr, scratch, mid + 1, right);
+        mergeRuns(arr, scratch, left, mid, right);
+    }
+}
+
+// Nanoseconds per element per level of pcmMergeSort without its parallel regions
+static double mergeCost(void) {
+    int *arr = allocateInts(OP_ELEMENTS);
+    int *scratch = allocateInts(OP_ELEMENTS);
+    for (int i = 0; i < OP_ELEMENTS; i++) arr[i] = nextRandom() % 1000;
+    double levels = 0.0;
+    while ((1L << (long)levels) < OP_ELEMENTS) levels++;
+
+    double start = omp_get_wtime();
+    serialMergeSort(arr, scratch, 0, OP_ELEMENTS - 1);
+    double seconds = omp_get_wtime() - start;
+
+    sink = arr[OP_ELEMENTS / 3];
+    free(arr);
+    free(scratch);
+    return seconds * 1e9 / (OP_ELEMENTS * levels);
+}
+
+// Nanoseconds per element of the Hoare-style partition in pcmPartition
+static double partitionCost(void) {
+    int *arr = allocateInts(OP_ELEMENTS);
+    for (int i = 0; i < OP_ELEMENTS; i++) arr[i] = nextRandom() % 1000;
+    int pivot = 500;
+    arr[OP_ELEMENTS - 1] = pivot;
+
+    double start = omp_get_wtime();
+    int i = -1, j = OP_ELEMENTS - 1;
+    for (;;) {
+        while (arr[++i] < pivot) {
+        }
+        while (j > 0 && pivot < arr[--j]) {
+        }
+        if (i >= j) break;
+        int temp = arr[i];
+        arr[i] = arr[j];
+        arr[j] = temp;
+    }
+    double seconds = omp_get_wtime() - start;
+
+    sink = i;
+    free(arr);
+    return seconds * 1e9 / OP_ELEMENTS;
+}
+
+// Nanoseconds per probe of a binary search over a sorted array that is not cached
+static double probeCost(void) {
+    int *arr = allocateInts(OP_ELEMENTS * 16);
+    for (int i = 0; i < OP_ELEMENTS * 16; i++) arr[i] = i;
+    int searches = 20000;
+    long probes = 0, found = 0;
+
+    double start = omp_get_wtime();
+    for (int s = 0; s < searches; s++) {
+        int target = (int)(nextRandom() % (OP_ELEMENTS * 16));
+        int low = 0, high = OP_ELEMENTS * 16 - 1;
+        while (low <= high) {
+            int mid = low + (high - low) / 2;
+            probes++;
+            if (arr[mid] == target) {
+                found++;
+                break;
+            } else if (arr[mid] < target) {
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+    }
+    double seconds = omp_get_wtime() - start;
+
+    sink = found;
+    free(arr);
+    return seconds * 1e9 / probes;
+}
+
+static int** allocateMatrix(int size) {
+    int **matrix = malloc(size * sizeof(int *));
+    if (matrix == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < size; i++) {
+        matrix[i] = allocateInts(size);
+        for (int j = 0; j < size; j++) matrix[i][j] = nextRandom() % 100;
+    }
+    return matrix;
+}
+
+static void freeMatrix(int **matrix, int size) {
+    for (int i = 0; i < size; i++) free(matrix[i]);
+    free(matrix);
+}
+
+// Nanoseconds per multiply-add of multiplyRows in libpcm, the flat row-major
+// i-j-k loop behind pcmMultiply and so the naive program. The column walk
+// over B makes the cost depend on whether B fits in cache, so it is measured
+// at two sizes.
+static double multiplyAddCost(int size) {
+    long elements = (long)size * size;
+    int *A = allocateInts(elements), *B = allocateInts(elements), *C = allocateInts(elements);
+    for (long i = 0; i < elements; i++) {
+        A[i] = nextRandom() % 100;
+        B[i] = nextRandom() % 100;
+    }
+    double start = omp_get_wtime();
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            C[(size_t)i * size + j] = 0;
+            for (int k = 0; k < size; k++) {
+                C[(size_t)i * size + j] += A[(size_t)i * size + k] * B[(size_t)k * size + j];
+            }
+        }
+    }
+    double seconds = omp_get_wtime() - start;
+    sink = C[elements / 2 + size / 3];
+    free(A);
+    free(B);
+    free(C);
+    return seconds * 1e9 / ((double)size * size * size);
+}
+
+// Nanoseconds per multiply-add of the Strassen program's leaves: the same loop
+// over row-pointer matrices of STRASSEN_LEAF, which stay in cache, repeated
+// to fill the time budget
+static double leafMultiplyAddCost(void) {
+    int size = STRASSEN_LEAF;
+    int **A = allocateMatrix(size), **B = allocateMatrix(size), **C = allocateMatrix(size);
+    long repeats = 0;
+    double start = omp_get_wtime(), seconds;
+    do {
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < size; j++) {
+                C[i][j] = 0;
+                for (int k = 0; k < size; k++) {
+                    C[i][j] += A[i][k] * B[k][j];
+                }
+            }
+        }
+        A[repeats % size][0] = C[size / 2][size / 3] % 100;
+        repeats++;
+        seconds = omp_get_wtime() - start;
+    } while (seconds < TIME_BUDGET && repeats < MAX_REPEATS);
+    sink = C[size / 2][size / 3];
+    freeMatrix(A, size);
+    freeMatrix(B, size);
+    freeMatrix(C, size);
+    return seconds * 1e9 / ((double)repeats * size * size * size);
+}
+
+// Nanoseconds per element of a matrix addition, Strassen's other operation
+static double addCost(void) {
+    int size = MADD_SIZE * 4;
+    int **A = allocateMatrix(size), **B = allocateMatrix(size), **C = allocateMatrix(size);
+    double start = omp_get_wtime();
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            C[i][j] = A[i][j] + B[i][j];
+        }
+    }
+    double seconds = omp_get_wtime() - start;
+    sink = C[size / 2][size / 3];
+    freeMatrix(A, size);
+    freeMatrix(B, size);
+    freeMatrix(C, size);
+    return seconds * 1e9 / ((double)size * size);
+}
+
+// Best-of-three STREAM triad bandwidth in GB/s with the current team size
+static double triadBandwidth(int threads) {
+    double *a = malloc(TRIAD_ELEMENTS * sizeof(double));
+    double *b = malloc(TRIAD_ELEMENTS * sizeof(double));
+    double *c = malloc(TRIAD_ELEMENTS * sizeof(double));
+    if (a == NULL || b == NULL || c == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long i = 0; i < TRIAD_ELEMENTS; i++) {
+        a[i] = 0.0;
+        b[i] = 1.0;
+        c[i] = 2.0;
+    }
+
+    double best = 0.0;
+    for (int trial = 0; trial < 3; trial++) {
+        double start = omp_get_wtime();
+        #pragma omp parallel for schedule(static) num_threads(threads)
+        for (long i = 0; i < TRIAD_ELEMENTS; i++) {
+            a[i] = b[i] + 3.0 * c[i];
+        }
+        double seconds = omp_get_wtime() - start;
+        double bandwidth = 3.0 * sizeof(double) * TRIAD_ELEMENTS / seconds / 1e9;
+        if (bandwidth > best) best = bandwidth;
+    }
+    sink = (long)a[TRIAD_ELEMENTS / 2];
+    free(a);
+    free(b);
+    free(c);
+    return best;
+}
+
+// Microseconds to open and join a parallel region of `threads` threads
+static double forkJoinCost(int threads) {
+    int repeats = 0;
+    double start = omp_get_wtime();
+    while (repeats < MAX_REPEATS && omp_get_wtime() - start < TIME_BUDGET) {
+        #pragma omp parallel num_threads(threads)
+        {
+            sink = omp_get_thread_num();
+        }
+        repeats++;
+    }
+    return (omp_get_wtime() - start) * 1e6 / repeats;
+}
+
+// Microseconds per task when one thread spawns empty tasks for the team, as
+// parallel_quickSort does
+static double taskCost(int threads) {
+    int tasks = 0;
+    double start = omp_get_wtime();
+    #pragma omp parallel num_threads(threads)
+    {
+        #pragma omp single
+        {
+            while (tasks < MAX_REPEATS * 10 && omp_get_wtime() - start < TIME_BUDGET) {
+                for (int t = 0; t < 100; t++) {
+                    #pragma omp task
+                    {
+                        sink = t;
+                    }
+                }
+                tasks += 100;
+            }
+        }
+    }
+    return (omp_get_wtime() - start) * 1e6 / tasks;
+}
+
+// BSP superstep of an h-relation: every thread writes `words` words into its
+// neighbour's mailbox, then all threads synchronize. Returns microseconds.
+static double superstepTime(int threads, int *mailboxes, int words) {
+    int repeats = 0;
+    double elapsed = 0.0;
+    #pragma omp parallel num_threads(threads)
+    {
+        int tid = omp_get_thread_num();
+        int *target = mailboxes + (long)((tid + 1) % threads) * words;
+        for (int r = 0; r < MAX_REPEATS; r++) {
+            #pragma omp barrier
+            double start = omp_get_wtime();
+            for (int w = 0; w < words; w++) target[w] = r + w;
+            #pragma omp barrier
+            #pragma omp master
+            {
+                elapsed += omp_get_wtime() - start;
+                repeats++;
+            }
+            // Every thread must agree on when to stop
+            int stop;
+            #pragma omp master
+            sink = elapsed > TIME_BUDGET;
+            #pragma omp barrier
+            stop = sink;
+            if (stop) break;
+        }
+    }
+    return elapsed * 1e6 / repeats;
+}
+
+typedef struct {
+    double latency, overhead, gap;   // microseconds
+} LogPParameters;
+
+// One cache line per direction; the flag is the message sequence number
+typedef struct {
+    volatile long flag;
+    long payload;
+    char padding[CACHE_LINE - 2 * sizeof(long)];
+} Mailbox;
+
+static void waitForFlag(volatile long *flag, long value) {
+    int spins = 0;
+    while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) < value) {
+        // Yield now and then so oversubscribed threads still make progress
+        if (++spins == SPIN_BEFORE_YIELD) {
+            spins = 0;
+            sched_yield();
+        }
+    }
+}
+
+// Ping-pong between threads 0 and 1: the round trip is 2L + 4o, a send
+// without waiting is o, and a stream of sends into a ring of slots runs at g
+static LogPParameters measureLogP(void) {
+    LogPParameters logp = { 0.0, 0.0, 0.0 };
+    Mailbox *boxes = aligned_alloc(CACHE_LINE, (LOGP_MESSAGES + 2) * sizeof(Mailbox));
+    if (boxes == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(boxes, 0, (LOGP_MESSAGES + 2) * sizeof(Mailbox));
+    Mailbox *ping = &boxes[0], *pong = &boxes[1], *stream = &boxes[2];
+    int round_trips = 0;
+    double round_trip_time = 0.0, stream_time = 0.0;
+
+    #pragma omp parallel num_threads(2)
+    {
+        if (omp_get_thread_num() == 0) {
+            double start = omp_get_wtime();
+            for (long r = 1; r <= LOGP_MESSAGES && omp_get_wtime() - start < TIME_BUDGET; r++) {
+                ping->payload = r;
+                __atomic_store_n(&ping->flag, r, __ATOMIC_RELEASE);
+                waitForFlag(&pong->flag, r);
+                round_trips++;
+            }
+            round_trip_time = omp_get_wtime() - start;
+            // Tell the partner how many rounds there were
+            __atomic_store_n(&ping->flag, -round_trips, __ATOMIC_RELEASE);
+        } else {
+            for (long r = 1;; r++) {
+                long flag;
+                int spins = 0;
+                while ((flag = __atomic_load_n(&ping->flag, __ATOMIC_ACQUIRE)) < r && flag >= 0) {
+                    if (++spins == SPIN_BEFORE_YIELD) {
+                        spins = 0;
+                        sched_yield();
+                    }
+                }
+                if (flag < 0) break;
+                pong->payload = ping->payload;
+                __atomic_store_n(&pong->flag, r, __ATOMIC_RELEASE);
+            }
+        }
+        #pragma omp barrier
+
+        // Streaming sends: thread 0 fills one line per message, thread 1 drains them
+        if (omp_get_thread_num() == 0) {
+            double start = omp_get_wtime();
+            for (long m = 0; m < LOGP_MESSAGES; m++) {
+                stream[m].payload = m;
+                __atomic_store_n(&stream[m].flag, 1, __ATOMIC_RELEASE);
+            }
+            waitForFlag(&pong->flag, round_trips + 1);
+            stream_time = omp_get_wtime() - start;
+        } else {
+            for (long m = 0; m < LOGP_MESSAGES; m++) waitForFlag(&stream[m].flag, 1);
+            __atomic_store_n(&pong->flag, round_trips + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    // Overhead: the sender's cost of composing and publishing one message alone
+    double start = omp_get_wtime();
+    for (long m = 0; m < LOGP_MESSAGES; m++) {
+        stream[m].payload = -m;
+        __atomic_store_n(&stream[m].flag, 2, __ATOMIC_RELEASE);
+    }
+    logp.overhead = (omp_get_wtime() - start) * 1e6 / LOGP_MESSAGES;
+
+    double round_trip = round_trips > 0 ? round_trip_time * 1e6 / round_trips : 0.0;
+    logp.gap = stream_time * 1e6 / LOGP_MESSAGES;
+    logp.latency = round_trip / 2.0 - 2.0 * logp.overhead;
+    if (logp.latency < 0.0) logp.latency = 0.0;
+    free(boxes);
+    return logp;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : omp_get_num_procs();
+    const char *output = argc > 2 ? argv[2] : NULL;
+    if (max_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    omp_set_dynamic(0);
+
+    double merge_ns = mergeCost();
+    double partition_ns = partitionCost();
+    double probe_ns = probeCost();
+    double madd_ns = multiplyAddCost(MADD_SIZE);
+    double madd_large_ns = multiplyAddCost(MADD_LARGE_SIZE);
+    double madd_leaf_ns = leafMultiplyAddCost();
+    double add_ns = addCost();
+    printf("Per-operation costs: merge %.3f ns, partition %.3f ns, probe %.3f ns, multiply-add %.3f ns (%d) and %.3f ns (%d), "
+           "Strassen leaf multiply-add %.3f ns (%d), add %.3f ns\n", merge_ns, partition_ns, probe_ns, madd_ns, MADD_SIZE,
+           madd_large_ns, MADD_LARGE_SIZE, madd_leaf_ns, STRASSEN_LEAF, add_ns);
+
+    LogPParameters logp = measureLogP();
+    printf("LogP between two threads: L %.3f us, o %.3f us, g %.3f us\n", logp.latency, logp.overhead, logp.gap);
+
+    // Powers of two up to the maximum, and the maximum itself
+    int counts[64], count = 0;
+    for (int p = 1; p < max_threads && count < 63; p *= 2) counts[count++] = p;
+    counts[count++] = max_threads;
+
+    int *mailboxes = allocateInts((long)max_threads * H_RELATION_WORDS);
+    double bandwidth[64], fork_join[64], task[64], bsp_L[64], bsp_g[64];
+    for (int c = 0; c < count; c++) {
+        int p = counts[c];
+        bandwidth[c] = triadBandwidth(p);
+        fork_join[c] = forkJoinCost(p);
+        task[c] = taskCost(p);
+        bsp_L[c] = superstepTime(p, mailboxes, 1);
+        double full = superstepTime(p, mailboxes, H_RELATION_WORDS);
+        bsp_g[c] = full > bsp_L[c] ? (full - bsp_L[c]) * 1e3 / (H_RELATION_WORDS - 1) : 0.0;
+        printf("%3d threads: bandwidth %.2f GB/s, fork/join %.3f us, task %.3f us, BSP L %.3f us, BSP g %.4f ns/word\n",
+               p, bandwidth[c], fork_join[c], task[c], bsp_L[c], bsp_g[c]);
+    }
+    free(mailboxes);
+
+    if (output != NULL) {
+        FILE *file = fopen(output, "w");
+        if (file == NULL) {
+            perror("Error opening output file");
+            return -1;
+        }
+        fprintf(file, "{\n  \"processors\": %d,\n  \"max_active_levels\": %d,\n", omp_get_num_procs(), omp_get_max_active_levels());
+        fprintf(file, "  \"op_ns\": {\"merge\": %.6f, \"partition\": %.6f, \"probe\": %.6f, \"madd\": %.6f, \"madd_large\": %.6f, "
+                "\"madd_leaf\": %.6f, \"add\": %.6f},\n", merge_ns, partition_ns, probe_ns, madd_ns, madd_large_ns, madd_leaf_ns, add_ns);
+        fprintf(file, "  \"madd_sizes\": [%d, %d],\n", MADD_SIZE, MADD_LARGE_SIZE);
+        fprintf(file, "  \"logp\": {\"L_us\": %.6f, \"o_us\": %.6f, \"g_us\": %.6f},\n", logp.latency, logp.overhead, logp.gap);
+        fprintf(file, "  \"threads\": [\n");
+        for (int c = 0; c < count; c++) {
+            fprintf(file, "    {\"p\": %d, \"bandwidth_gbs\": %.6f, \"fork_join_us\": %.6f, \"task_us\": %.6f, \"bsp_L_us\": %.6f, \"bsp_g_ns\": %.6f}%s\n",
+                    counts[c], bandwidth[c], fork_join[c], task[c], bsp_L[c], bsp_g[c], c + 1 < count ? "," : "");
+        }
+        fprintf(file, "  ]\n}\n");
+        fclose(file);
+        printf("Parameters written to %s\n", output);
+    }
+    return 0;
+}
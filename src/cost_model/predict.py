@@ -0,0 +1,262 @@
+"""
+Predict the benchmark programs' run times under PRAM, BSP and LogP and
+compare them with measured runs.
+
+    command to execute (from the repository root):
+    ./calibrate [max number of threads] cost_model_params.json
+    python3 src/benchmark/benchmark.py --csv bench_results.csv
+    python3 src/cost_model/predict.py cost_model_params.json bench_results.csv [--algorithms mergesort,...]
+
+The machine parameters come from calibrate.c and the measured medians from
+the benchmark driver's CSV. PRAM charges only the operations, spread over the
+processors the algorithm can use. BSP adds a barrier L and a per-word cost g
+for every superstep and a memory-bandwidth bound. LogP charges latency L,
+overhead o and gap g for the cache-line messages that move data between
+threads.
+"""
+
+import argparse
+import csv
+import json
+import math
+import sys
+
+WORDS_PER_LINE = 16          # ints per 64-byte cache line, one LogP message
+STRASSEN_CUTOFF = 32         # parallel_strassenMultiply multiplies directly at or below this size
+MERGESORT_SERIAL_CUTOFF = 8192  # pcmMergeSort sorts shorter ranges on one thread
+
+
+class Machine:
+    def __init__(self, params):
+        self.params = params
+        self.processors = params['processors']
+        # With one active level the nested sections in Strassen run serially
+        self.nested = params['max_active_levels'] > 1
+        self.op = params['op_ns']
+        self.logp = params['logp']
+
+    def madd_leaf(self):
+        """Multiply-add cost in seconds of Strassen's row-pointer leaves."""
+        return self.op.get('madd_leaf', self.op['madd']) * 1e-9
+
+    def madd(self, n):
+        """Multiply-add cost in seconds, interpolated between the two calibrated sizes."""
+        small, large = self.params['madd_sizes']
+        if n <= small:
+            cost = self.op['madd']
+        elif n >= large:
+            cost = self.op['madd_large']
+        else:
+            fraction = (n - small) / float(large - small)
+            cost = self.op['madd'] + fraction * (self.op['madd_large'] - self.op['madd'])
+        return cost * 1e-9
+
+    def at(self, threads):
+        """Parameters measured for the largest calibrated thread count <= threads."""
+        rows = sorted(self.params['threads'], key=lambda row: row['p'])
+        chosen = rows[0]
+        for row in rows:
+            if row['p'] <= threads:
+                chosen = row
+        return chosen
+
+    def usable(self, threads, branching=None):
+        """Threads that can work at once: limited by the recursion's branching
+        when nesting is off, and by physical processors for BSP and LogP."""
+        ideal = threads if branching is None or self.nested else min(threads, branching)
+        return ideal, max(1, min(ideal, self.processors))
+
+
+def brent(work, depth, processors):
+    # Brent's bound, made exact at one processor
+    return work / processors + depth * (1.0 - 1.0 / processors)
+
+
+def logp_transfer(machine, words):
+    messages = max(1.0, words / WORDS_PER_LINE)
+    logp = machine.logp
+    return 1e-6 * (logp['L_us'] + 2.0 * logp['o_us'] + (messages - 1.0) * max(logp['g_us'], logp['o_us']))
+
+
+def merge_sort(machine, n, threads):
+    ideal, physical = machine.usable(threads)
+    at = machine.at(threads)
+    merge = machine.op['merge'] * 1e-9
+    levels = max(1.0, math.log2(n))
+    parallel_levels = math.log2(ideal) if ideal > 1 else 0.0
+    work = merge * n * levels
+    # The merges above the parallel levels shrink geometrically: n + n/2 + ...
+    depth = merge * n * (2.0 - 2.0 / ideal) if ideal > 1 else 0.0
+    pram = work / ideal + depth
+
+    # One parallel region; every node above the serial cutoff is a task
+    tasks = 2.0 * n / MERGESORT_SERIAL_CUTOFF
+    scheduling = tasks * at['task_us'] * 1e-6 / physical + at['fork_join_us'] * 1e-6
+    compute = max(work / physical + depth, 16.0 * n * levels / (at['bandwidth_gbs'] * 1e9))
+    supersteps = parallel_levels + 1.0
+    bsp = compute + scheduling + supersteps * (at['bsp_L_us'] * 1e-6 + at['bsp_g_ns'] * 1e-9 * n / ideal)
+    logp = compute + scheduling + parallel_levels * logp_transfer(machine, n / ideal)
+    return pram, bsp, logp
+
+
+def quick_sort(machine, n, threads):
+    ideal, physical = machine.usable(threads)
+    at = machine.at(threads)
+    partition = machine.op['partition'] * 1e-9
+    levels = max(1.0, math.log2(n))
+    # Expected comparisons of randomized quick sort: 2 n ln n
+    work = partition * 1.386 * n * levels
+    depth = partition * 2.0 * n
+    tasks = 2.0 * n
+    pram = brent(work, depth, ideal)
+
+    parallel_levels = math.log2(ideal) if ideal > 1 else 0.0
+    compute = max(brent(work, depth, physical), 8.0 * n * 1.386 * levels / (at['bandwidth_gbs'] * 1e9))
+    scheduling = tasks * at['task_us'] * 1e-6 / physical + at['fork_join_us'] * 1e-6
+    bsp = compute + scheduling + parallel_levels * (at['bsp_L_us'] * 1e-6 + at['bsp_g_ns'] * 1e-9 * n / ideal)
+    logp = compute + scheduling + parallel_levels * logp_transfer(machine, n / ideal)
+    return pram, bsp, logp
+
+
+def search(machine, n, threads, ternary):
+    ideal, physical = machine.usable(threads)
+    at = machine.at(threads)
+    probe = machine.op['probe'] * 1e-9
+    slice_size = max(2.0, n / ideal)
+    # Ternary search compares against two midpoints per step
+    probes = 2.0 * math.log(slice_size, 3) if ternary else math.log2(slice_size) + 1.0
+    # Threads beyond the processors take turns
+    rounds = math.ceil(ideal / physical)
+    pram = probe * probes
+    bsp = probe * probes * rounds + at['fork_join_us'] * 1e-6 + at['bsp_L_us'] * 1e-6
+    logp = probe * probes * rounds + at['fork_join_us'] * 1e-6 + logp_transfer(machine, 1)
+    return pram, bsp, logp
+
+
+def naive_multiply(machine, n, threads):
+    ideal, physical = machine.usable(threads)
+    at = machine.at(threads)
+    work = machine.madd(n) * n ** 3
+    pram = work / ideal
+    # One superstep: each thread reads its rows of A and all of B, writes its rows of C
+    words = 2.0 * n * n / ideal + n * n
+    bsp = work / physical + at['fork_join_us'] * 1e-6 + at['bsp_L_us'] * 1e-6 + at['bsp_g_ns'] * 1e-9 * words
+    logp = work / physical + at['fork_join_us'] * 1e-6 + logp_transfer(machine, words)
+    return pram, bsp, logp
+
+
+def strassen_serial(machine, n):
+    """Operations of the recursion below the top level, run by one thread."""
+    if n <= STRASSEN_CUTOFF:
+        return machine.madd_leaf() * n ** 3, 0
+    half = (n + 1) // 2
+    below, nodes = strassen_serial(machine, half)
+    # 10 additions inside the products, 8 to combine, and split/join copies
+    additions = machine.op['add'] * 1e-9 * (18.0 * half * half + 3.0 * n * n)
+    return 7.0 * below + additions, 7 * nodes + 1
+
+
+def strassen_multiply(machine, n, threads):
+    ideal, physical = machine.usable(threads, branching=7)
+    at = machine.at(threads)
+    if n <= STRASSEN_CUTOFF:
+        work = machine.madd_leaf() * n ** 3
+        return work, work, work
+    half = (n + 1) // 2
+    product, nodes = strassen_serial(machine, half)
+    add = machine.op['add'] * 1e-9 * half * half
+    split_join = machine.op['add'] * 1e-9 * 3.0 * n * n
+
+    def top_level(processors):
+        # Seven products then four combinations, dealt out as sections
+        products = math.ceil(7.0 / processors) * (product + 2.0 * add)
+        combine = math.ceil(4.0 / processors) * 3.0 * add
+        return split_join / processors + products + combine
+
+    pram = top_level(ideal)
+    # Each inner node opens two sections regions and three parallel loops
+    nested_regions = 7 * nodes * 5 * machine.at(1)['fork_join_us'] * 1e-6 / physical
+    words = 3.0 * half * half * math.ceil(7.0 / ideal)
+    sync = 2.0 * (at['fork_join_us'] + at['bsp_L_us']) * 1e-6
+    bsp = top_level(physical) + nested_regions + sync + at['bsp_g_ns'] * 1e-9 * words
+    logp = top_level(physical) + nested_regions + 2.0 * at['fork_join_us'] * 1e-6 + 2.0 * logp_transfer(machine, words)
+    return pram, bsp, logp
+
+
+MODELS = {
+    'mergesort': merge_sort,
+    'quicksort': quick_sort,
+    'binarysearch': lambda machine, n, p: search(machine, n, p, ternary=False),
+    'ternarysearch': lambda machine, n, p: search(machine, n, p, ternary=True),
+    'matrixmult': naive_multiply,
+    'strassenmatrixmult': strassen_multiply,
+}
+
+
+def error(predicted, measured):
+    return 100.0 * (predicted - measured) / measured if measured > 0 else float('nan')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare PRAM, BSP and LogP predictions with measured runs.')
+    parser.add_argument('params', help='JSON written by calibrate')
+    parser.add_argument('measurements', help='CSV written by src/benchmark/benchmark.py --csv')
+    parser.add_argument('--algorithms', default=','.join(MODELS),
+                        help='comma separated subset of: ' + ', '.join(MODELS))
+    options = parser.parse_args()
+
+    with open(options.params) as f:
+        machine = Machine(json.load(f))
+    wanted = [name for name in options.algorithms.split(',') if name]
+    for name in wanted:
+        if name not in MODELS:
+            parser.error('no cost model for {}'.format(name))
+
+    rows = []
+    with open(options.measurements) as f:
+        for row in csv.DictReader(f):
+            if row['algorithm'] in wanted:
+                rows.append(row)
+    if not rows:
+        print('No measurements for the requested algorithms in {}'.format(options.measurements), file=sys.stderr)
+        return 1
+
+    print('{:<20} {:<7} {:>10} {:>7} {:>12} {:>12} {:>8} {:>12} {:>8} {:>12} {:>8}'.format(
+        'algorithm', 'size', 'n', 'threads', 'measured (s)', 'PRAM (s)', 'err %', 'BSP (s)', 'err %', 'LogP (s)', 'err %'))
+    errors = {}
+    choices = {}
+    for row in rows:
+        name, size = row['algorithm'], row['size']
+        n, threads, measured = int(row['n']), int(row['threads']), float(row['median'])
+        predictions = MODELS[name](machine, n, threads)
+        print('{:<20} {:<7} {:>10} {:>7} {:>12.6f} {:>12.6f} {:>8.1f} {:>12.6f} {:>8.1f} {:>12.6f} {:>8.1f}'.format(
+            name, size, n, threads, measured,
+            predictions[0], error(predictions[0], measured),
+            predictions[1], error(predictions[1], measured),
+            predictions[2], error(predictions[2], measured)))
+        for model, predicted in zip(('PRAM', 'BSP', 'LogP'), predictions):
+            errors.setdefault((name, model), []).append(abs(error(predicted, measured)))
+        choice = choices.setdefault((name, size), {'measured': [], 'PRAM': [], 'BSP': [], 'LogP': []})
+        choice['measured'].append((measured, threads))
+        for model, predicted in zip(('PRAM', 'BSP', 'LogP'), predictions):
+            choice[model].append((predicted, threads))
+
+    print()
+    print('Mean absolute error per model:')
+    for name in wanted:
+        if (name, 'PRAM') not in errors:
+            continue
+        print('  {:<20} PRAM {:>8.1f}%   BSP {:>8.1f}%   LogP {:>8.1f}%'.format(
+            name, *[sum(errors[(name, model)]) / len(errors[(name, model)]) for model in ('PRAM', 'BSP', 'LogP')]))
+
+    print()
+    print('Fastest thread count, measured and as each model would choose:')
+    for (name, size), choice in choices.items():
+        best = {key: min(values)[1] for key, values in choice.items()}
+        print('  {:<20} {:<7} measured {:>3}   PRAM {:>3}   BSP {:>3}   LogP {:>3}'.format(
+            name, size, best['measured'], best['PRAM'], best['BSP'], best['LogP']))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
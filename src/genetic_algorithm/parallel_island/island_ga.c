@@ -0,0 +1,485 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <omp.h>
+#include "../../common/xorshift.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -O2 -o island_ga island_ga.c
+    command to execute:
+    ./island_ga [number of threads] [--items=N] [--population=N] [--generations=N] [--migration-interval=K] [--migrants=M] [--target=q] [--seed=N]
+
+    Island-model genetic algorithm on a generated 0/1 knapsack instance
+    (strongly correlated: value = weight + 100). Every thread is an island
+    with its own population and random stream. Populations are stored item
+    by item (genes[item * population + individual]), so fitness evaluation
+    and one-point crossover run as SIMD loops over the individuals.
+
+    Every K generations an island posts copies of its best M individuals to
+    the next island's mailbox and takes in whatever its own mailbox holds,
+    replacing its worst individuals. Mailboxes are single-writer sequence
+    locks, so no island ever waits for another.
+
+    The optimum comes from dynamic programming when the table is small
+    enough, otherwise the LP relaxation bound stands in for it. The report
+    gives generations per second and the time until the best feasible
+    solution reached the target fraction of that reference.
+*/
+
+#define TOURNAMENT 2
+#define MUTATIONS_PER_CHILD 1
+#define DP_LIMIT 2000000000L    // items x capacity cells for the exact optimum
+#define MAX_ITEMS (INT_MAX / 1100)  // values are at most 1100, so value and weight sums fit an int
+
+typedef struct {
+    int items;
+    long capacity;
+    int *weights;
+    int *values;
+    int penalty;            // per unit of excess weight, more than any item's value per weight
+} Knapsack;
+
+// One island, allocated by its own thread so its pages are local to it
+typedef struct {
+    int population;
+    unsigned char *genes;       // genes[item * population + individual]
+    unsigned char *next;
+    int *value;
+    int *weight;
+    int *fitness;               // value, minus the penalty for excess weight
+    int *parent_a;
+    int *parent_b;
+    int *cut;                   // child takes items below cut from parent_a
+    uint64_t rng;
+    long best_value;            // best feasible value so far
+    double reached_time;        // seconds until best_value met the target, -1 before
+    long generations;
+} Island;
+
+// Written by the previous island only; an odd version means a write is in progress
+typedef struct {
+    unsigned long version;
+    int count;
+    unsigned char *genes;       // migrants one after another, items bytes each
+    int *value;
+    int *weight;
+    int *fitness;
+    char padding[64];
+} Mailbox;
+
+static uint64_t splitmix(uint64_t x) {
+    uint64_t z = x * 0x9E3779B97F4A7C15ULL + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int randomBelow(uint64_t *state, int bound) {
+    return (int)((nextRandom(state) >> 32) * (uint64_t)bound >> 32);
+}
+
+static int generateKnapsack(Knapsack *problem, int items, uint64_t seed) {
+    problem->items = items;
+    problem->weights = malloc(items * sizeof(int));
+    problem->values = malloc(items * sizeof(int));
+    if (problem->weights == NULL || problem->values == NULL) return -1;
+    long total = 0;
+    int penalty = 1;
+    for (int i = 0; i < items; i++) {
+        problem->weights[i] = 1 + (int)(splitmix(seed * 1000003 + i) % 1000);
+        problem->values[i] = problem->weights[i] + 100;
+        total += problem->weights[i];
+        int ratio = (problem->values[i] + problem->weights[i] - 1) / problem->weights[i];
+        if (ratio >= penalty) penalty = ratio + 1;
+    }
+    problem->capacity = total / 2;
+    problem->penalty = penalty;
+    return 0;
+}
+
+// Exact optimum by dynamic programming over the capacity, or -1 if too large
+static long knapsackOptimum(const Knapsack *problem) {
+    if ((long)problem->items * problem->capacity > DP_LIMIT) return -1;
+    long *best = calloc(problem->capacity + 1, sizeof(long));
+    if (best == NULL) return -1;
+    for (int i = 0; i < problem->items; i++) {
+        int w = problem->weights[i], v = problem->values[i];
+        for (long c = problem->capacity; c >= w; c--) {
+            if (best[c - w] + v > best[c]) best[c] = best[c - w] + v;
+        }
+    }
+    long optimum = best[problem->capacity];
+    free(best);
+    return optimum;
+}
+
+typedef struct {
+    double ratio;
+    int item;
+} ItemRatio;
+
+static int compareRatios(const void *a, const void *b) {
+    double x = ((const ItemRatio *)a)->ratio, y = ((const ItemRatio *)b)->ratio;
+    return (x < y) - (x > y);
+}
+
+// Dantzig's bound: items by value per weight, the last one taken fractionally
+static long knapsackBound(const Knapsack *problem) {
+    ItemRatio *order = malloc(problem->items * sizeof(ItemRatio));
+    if (order == NULL) return -1;
+    for (int i = 0; i < problem->items; i++) {
+        order[i].ratio = (double)problem->values[i] / problem->weights[i];
+        order[i].item = i;
+    }
+    qsort(order, problem->items, sizeof(ItemRatio), compareRatios);
+    long room = problem->capacity, bound = 0;
+    for (int i = 0; i < problem->items && room > 0; i++) {
+        int item = order[i].item;
+        if (problem->weights[item] <= room) {
+            room -= problem->weights[item];
+            bound += problem->values[item];
+        } else {
+            bound += (long)problem->values[item] * room / problem->weights[item];
+            room = 0;
+        }
+    }
+    free(order);
+    return bound;
+}
+
+static int allocateIsland(Island *island, int items, int population, uint64_t seed) {
+    long genes = (long)items * population;
+    island->population = population;
+    island->genes = malloc(genes);
+    island->next = malloc(genes);
+    island->value = malloc(population * sizeof(int));
+    island->weight = malloc(population * sizeof(int));
+    island->fitness = malloc(population * sizeof(int));
+    island->parent_a = malloc(population * sizeof(int));
+    island->parent_b = malloc(population * sizeof(int));
+    island->cut = malloc(population * sizeof(int));
+    if (island->genes == NULL || island->next == NULL || island->value == NULL || island->weight == NULL ||
+        island->fitness == NULL || island->parent_a == NULL || island->parent_b == NULL || island->cut == NULL) {
+        return -1;
+    }
+    island->rng = splitmix(seed) | 1;
+    island->best_value = 0;
+    island->reached_time = -1.0;
+    island->generations = 0;
+    // Each item packed with probability 0.45, so about half the start is feasible
+    for (long g = 0; g < genes; g++) {
+        island->genes[g] = randomBelow(&island->rng, 100) < 45;
+    }
+    return 0;
+}
+
+static void freeIsland(Island *island) {
+    free(island->genes);
+    free(island->next);
+    free(island->value);
+    free(island->weight);
+    free(island->fitness);
+    free(island->parent_a);
+    free(island->parent_b);
+    free(island->cut);
+}
+
+// One item at a time over all individuals: a vector of accumulators per row
+__attribute__((target_clones("avx2", "default")))
+static void evaluate(const Knapsack *problem, Island *island) {
+    int population = island->population;
+    int *restrict value = island->value;
+    int *restrict weight = island->weight;
+    for (int p = 0; p < population; p++) {
+        value[p] = 0;
+        weight[p] = 0;
+    }
+    for (int i = 0; i < problem->items; i++) {
+        const unsigned char *restrict row = island->genes + (long)i * population;
+        const int v = problem->values[i], w = problem->weights[i];
+        #pragma omp simd
+        for (int p = 0; p < population; p++) {
+            value[p] += v * row[p];
+            weight[p] += w * row[p];
+        }
+    }
+    const int capacity = (int)problem->capacity, penalty = problem->penalty;
+    int *restrict fitness = island->fitness;
+    #pragma omp simd
+    for (int p = 0; p < population; p++) {
+        // penalty * excess passes INT_MAX long before the sums do; clamp instead of wrapping
+        long long excess = weight[p] > capacity ? weight[p] - capacity : 0;
+        long long penalized = value[p] - penalty * excess;
+        fitness[p] = penalized < INT_MIN ? INT_MIN : (int)penalized;
+    }
+}
+
+static int tournament(Island *island) {
+    int best = randomBelow(&island->rng, island->population);
+    for (int t = 1; t < TOURNAMENT; t++) {
+        int other = randomBelow(&island->rng, island->population);
+        if (island->fitness[other] > island->fitness[best]) best = other;
+    }
+    return best;
+}
+
+// Child 0 is the elite; every other child is a one-point crossover plus mutations
+__attribute__((target_clones("avx2", "default")))
+static void breed(const Knapsack *problem, Island *island, int elite) {
+    int population = island->population, items = problem->items;
+    int *restrict parent_a = island->parent_a;
+    int *restrict parent_b = island->parent_b;
+    int *restrict cut = island->cut;
+    parent_a[0] = parent_b[0] = elite;
+    cut[0] = items;
+    for (int c = 1; c < population; c++) {
+        parent_a[c] = tournament(island);
+        parent_b[c] = tournament(island);
+        cut[c] = randomBelow(&island->rng, items + 1);
+    }
+    for (int i = 0; i < items; i++) {
+        const unsigned char *restrict row = island->genes + (long)i * population;
+        unsigned char *restrict out = island->next + (long)i * population;
+        #pragma omp simd
+        for (int c = 0; c < population; c++) {
+            out[c] = row[i < cut[c] ? parent_a[c] : parent_b[c]];
+        }
+    }
+    for (int m = 0; m < (population - 1) * MUTATIONS_PER_CHILD; m++) {
+        int c = 1 + randomBelow(&island->rng, population - 1);
+        int i = randomBelow(&island->rng, items);
+        island->next[(long)i * population + c] ^= 1;
+    }
+    unsigned char *swap = island->genes;
+    island->genes = island->next;
+    island->next = swap;
+}
+
+static void postMigrants(const Knapsack *problem, const Island *island, Mailbox *mailbox, int migrants) {
+    int population = island->population;
+    int chosen[migrants];
+    int count = 0;
+    // The best individuals by repeated scans; migrants is small
+    for (int m = 0; m < migrants && m < population; m++) {
+        int best = -1;
+        for (int p = 0; p < population; p++) {
+            int taken = 0;
+            for (int k = 0; k < count; k++) taken |= chosen[k] == p;
+            if (!taken && (best < 0 || island->fitness[p] > island->fitness[best])) best = p;
+        }
+        chosen[count++] = best;
+    }
+
+    __atomic_store_n(&mailbox->version, mailbox->version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (int k = 0; k < count; k++) {
+        for (int i = 0; i < problem->items; i++) {
+            mailbox->genes[(long)k * problem->items + i] = island->genes[(long)i * population + chosen[k]];
+        }
+        mailbox->value[k] = island->value[chosen[k]];
+        mailbox->weight[k] = island->weight[chosen[k]];
+        mailbox->fitness[k] = island->fitness[chosen[k]];
+    }
+    mailbox->count = count;
+    __atomic_store_n(&mailbox->version, mailbox->version + 1, __ATOMIC_RELEASE);
+}
+
+// Copies the mailbox unless it is being written or holds nothing new; returns the migrants taken
+static int takeMigrants(const Knapsack *problem, Island *island, Mailbox *mailbox, unsigned long *seen,
+                        unsigned char *genes, int *value, int *weight, int *fitness) {
+    unsigned long version = __atomic_load_n(&mailbox->version, __ATOMIC_ACQUIRE);
+    if (version % 2 == 1 || version == *seen) return 0;
+    int count = mailbox->count;
+    memcpy(genes, mailbox->genes, (long)count * problem->items);
+    memcpy(value, mailbox->value, count * sizeof(int));
+    memcpy(weight, mailbox->weight, count * sizeof(int));
+    memcpy(fitness, mailbox->fitness, count * sizeof(int));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&mailbox->version, __ATOMIC_RELAXED) != version) return 0;
+    *seen = version;
+
+    // Each migrant replaces the current worst individual
+    int population = island->population;
+    for (int k = 0; k < count; k++) {
+        int worst = 0;
+        for (int p = 1; p < population; p++) {
+            if (island->fitness[p] < island->fitness[worst]) worst = p;
+        }
+        if (fitness[k] <= island->fitness[worst]) continue;
+        for (int i = 0; i < problem->items; i++) {
+            island->genes[(long)i * population + worst] = genes[(long)k * problem->items + i];
+        }
+        island->value[worst] = value[k];
+        island->weight[worst] = weight[k];
+        island->fitness[worst] = fitness[k];
+    }
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <num_of_threads> [--items=N] [--population=N] [--generations=N] [--migration-interval=K] [--migrants=M] [--target=q] [--seed=N]\n", argv[0]);
+        return -1;
+    }
+
+    int items = 1000, population = 256, generations = 1000, interval = 20, migrants = 4;
+    double target = 0.98;
+    uint64_t seed = 1;
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "--items=", 8) == 0) {
+            items = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--population=", 13) == 0) {
+            population = atoi(argv[i] + 13);
+        } else if (strncmp(argv[i], "--generations=", 14) == 0) {
+            generations = atoi(argv[i] + 14);
+        } else if (strncmp(argv[i], "--migration-interval=", 21) == 0) {
+            interval = atoi(argv[i] + 21);
+        } else if (strncmp(argv[i], "--migrants=", 11) == 0) {
+            migrants = atoi(argv[i] + 11);
+        } else if (strncmp(argv[i], "--target=", 9) == 0) {
+            target = atof(argv[i] + 9);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    int num_threads = atoi(argv[1]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    if (items < 1 || items > MAX_ITEMS || population < 2 || generations < 1 || interval < 1 || migrants < 0 ||
+        migrants > population / 2 || target <= 0.0 || target > 1.0) {
+        fprintf(stderr, "Items must be in [1, %d], generations at least 1, the population at least 2, the interval at least 1, "
+                        "migrants at most half the population and the target in (0, 1]\n", MAX_ITEMS);
+        return -1;
+    }
+    omp_set_dynamic(0);
+    omp_set_num_threads(num_threads);
+
+    Knapsack problem;
+    if (generateKnapsack(&problem, items, seed) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    double reference_start = omp_get_wtime();
+    long reference = knapsackOptimum(&problem);
+    int exact = reference >= 0;
+    if (!exact) reference = knapsackBound(&problem);
+    double reference_time = omp_get_wtime() - reference_start;
+    long goal = (long)(target * reference + 0.999999);
+    printf("Knapsack: %d items, capacity %ld, %s %ld (%f seconds)\n", items, problem.capacity,
+           exact ? "optimum" : "LP bound", reference, reference_time);
+
+    Island *islands = calloc(num_threads, sizeof(Island));
+    Mailbox *mailboxes = calloc(num_threads, sizeof(Mailbox));
+    if (islands == NULL || mailboxes == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    int failed = 0;
+    for (int t = 0; t < num_threads; t++) {
+        mailboxes[t].genes = malloc((long)(migrants > 0 ? migrants : 1) * items);
+        mailboxes[t].value = malloc((migrants > 0 ? migrants : 1) * sizeof(int));
+        mailboxes[t].weight = malloc((migrants > 0 ? migrants : 1) * sizeof(int));
+        mailboxes[t].fitness = malloc((migrants > 0 ? migrants : 1) * sizeof(int));
+        failed |= mailboxes[t].genes == NULL || mailboxes[t].value == NULL || mailboxes[t].weight == NULL ||
+                  mailboxes[t].fitness == NULL;
+    }
+
+    double start_time = omp_get_wtime();
+    #pragma omp parallel
+    {
+        int id = omp_get_thread_num(), islands_count = omp_get_num_threads();
+        Island *island = &islands[id];
+        int migrant_space = migrants > 0 ? migrants : 1;
+        unsigned char *incoming = malloc((long)migrant_space * items);
+        int *incoming_value = malloc(migrant_space * sizeof(int));
+        int *incoming_weight = malloc(migrant_space * sizeof(int));
+        int *incoming_fitness = malloc(migrant_space * sizeof(int));
+        unsigned long seen = 0;
+        if (allocateIsland(island, items, population, seed + 0x1000 * (id + 1)) != 0 || incoming == NULL ||
+            incoming_value == NULL || incoming_weight == NULL || incoming_fitness == NULL) {
+            __atomic_store_n(&failed, 1, __ATOMIC_RELAXED);
+        }
+        #pragma omp barrier
+        if (!__atomic_load_n(&failed, __ATOMIC_RELAXED)) {
+            int migrating = islands_count > 1 && migrants > 0;
+            for (int g = 0; g < generations; g++) {
+                evaluate(&problem, island);
+                if (migrating && g > 0 && g % interval == 0) {
+                    takeMigrants(&problem, island, &mailboxes[id], &seen, incoming, incoming_value,
+                                 incoming_weight, incoming_fitness);
+                }
+
+                int elite = 0;
+                for (int p = 0; p < population; p++) {
+                    if (island->fitness[p] > island->fitness[elite]) elite = p;
+                    if (island->weight[p] <= problem.capacity && island->value[p] > island->best_value) {
+                        island->best_value = island->value[p];
+                    }
+                }
+                if (island->reached_time < 0 && island->best_value >= goal) {
+                    island->reached_time = omp_get_wtime() - start_time;
+                }
+
+                if (migrating && g % interval == 0) {
+                    postMigrants(&problem, island, &mailboxes[(id + 1) % islands_count], migrants);
+                }
+                breed(&problem, island, elite);
+                island->generations++;
+            }
+        }
+        free(incoming);
+        free(incoming_value);
+        free(incoming_weight);
+        free(incoming_fitness);
+    }
+    double end_time = omp_get_wtime();
+    if (failed) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    long best = 0, total_generations = 0;
+    double reached = -1.0;
+    for (int t = 0; t < num_threads; t++) {
+        if (islands[t].best_value > best) best = islands[t].best_value;
+        if (islands[t].reached_time >= 0 && (reached < 0 || islands[t].reached_time < reached)) {
+            reached = islands[t].reached_time;
+        }
+        total_generations += islands[t].generations;
+    }
+    double elapsed = end_time - start_time;
+
+    printf("%d islands x %d individuals, %d generations, %d migrants every %d generations\n", num_threads,
+           population, generations, num_threads > 1 ? migrants : 0, interval);
+    printf("Best value: %ld (%.4f of the %s)\n", best, (double)best / reference, exact ? "optimum" : "LP bound");
+    if (reached >= 0) {
+        printf("Reached %.4f of the %s after %f seconds\n", target, exact ? "optimum" : "LP bound", reached);
+    } else {
+        printf("Did not reach %.4f of the %s\n", target, exact ? "optimum" : "LP bound");
+    }
+    printf("Generations per second: %.1f per island, %.1f in total\n", generations / elapsed,
+           total_generations / elapsed);
+    printf("Time taken: %f seconds with %d threads\n", elapsed, num_threads);
+
+    for (int t = 0; t < num_threads; t++) {
+        freeIsland(&islands[t]);
+        free(mailboxes[t].genes);
+        free(mailboxes[t].value);
+        free(mailboxes[t].weight);
+        free(mailboxes[t].fitness);
+    }
+    free(islands);
+    free(mailboxes);
+    free(problem.weights);
+    free(problem.values);
+    return 0;
+}
@@ -0,0 +1,2313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <omp.h>
+#include "pcm.h"
+#include "quantized_kernels.h"
+#include "../common/task_trace.h"
+#include "../common/xorshift.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -O2 -fopenmp -pthread -fPIC -c pcm.c quantized_kernels.c ../common/work_stealing.c ../common/task_trace.c
+    ar rcs libpcm.a pcm.o quantized_kernels.o work_stealing.o task_trace.o
+    gcc -shared -fopenmp -pthread -o libpcm.so pcm.o quantized_kernels.o work_stealing.o task_trace.o
+*/
+
+// Rows of C per work-stealing task are chosen so every worker gets about this many tasks
+#define TASKS_PER_WORKER 4
+// pcmMergeSort sorts ranges shorter than this on one thread
+#define MERGESORT_SERIAL_CUTOFF (1 << 13)
+// Ranges at most this long are selected by one thread
+#define PARALLEL_SELECT_CUTOFF (1 << 16)
+// pcmQuickSort hands ranges at most this long to serialSort
+#define QUICKSORT_SERIAL_CUTOFF (1 << 12)
+// Partitions one pcmQuickSort task may make; 2 * floorLog2(INT_MAX) fits
+#define QUICKSORT_MAX_DEPTH 64
+#define SELECT_INSERTION_CUTOFF 16
+// Sample sizes for pcmMultiSelect; smaller inputs are selected in a copy
+#define MULTISELECT_MIN_SAMPLE 4096
+#define MULTISELECT_MAX_SAMPLE (1 << 20)
+// pcmNaturalMergeSort extends shorter runs to this length by insertion sort
+#define NATURAL_MIN_RUN 32
+// Merges and subtrees of the run tree smaller than this stay on one thread
+#define PARALLEL_MERGE_CUTOFF (1 << 16)
+// Widest radix digit; pcmRadixSort uses 8 bits, the planner may pick up to this
+#define RADIX_MAX_BITS 11
+// Sample sort draws SAMPLE_OVERSAMPLING keys per bucket to place the splitters
+#define SAMPLE_SORT_MAX_BUCKETS 256
+#define SAMPLE_OVERSAMPLING 32
+#define SORT_SAMPLE_CAPACITY (SAMPLE_SORT_MAX_BUCKETS * SAMPLE_OVERSAMPLING)
+// Inputs at most this long are sorted by one thread in pcmSampleSort
+#define SAMPLE_SORT_SERIAL_CUTOFF (1 << 12)
+// The planner profiles windows of this many consecutive keys
+#define PROFILE_WINDOW 32
+
+struct PcmContext {
+    int threads;
+    RuntimeKind runtime;
+    WsPool *pool;
+    int *scratch;
+    int scratch_elements;
+    int *block_counts;      // 3 per block of the parallel passes
+    int *runs;              // run starts, then merge powers, for pcmNaturalMergeSort
+    int run_capacity;
+    int *digit_counts;      // 1 << RADIX_MAX_BITS per block, for the radix and sample sort passes
+    int *sort_sample;       // SORT_SAMPLE_CAPACITY keys drawn by sample sort and the planner
+    int *splitters;         // sample sort's splitters, then its bucket starts
+    int in_call;            // set while an API call runs others, which then keep its statistics
+};
+
+void pcmDefaultOptions(PcmOptions *options) {
+    options->threads = omp_get_max_threads();
+    options->runtime = RUNTIME_OMP;
+}
+
+PcmContext* pcmContextCreate(const PcmOptions *options) {
+    if (options->threads < 1) return NULL;
+    PcmContext *context = malloc(sizeof(PcmContext));
+    if (context == NULL) return NULL;
+    context->threads = options->threads;
+    context->runtime = options->runtime;
+    context->pool = NULL;
+    context->scratch = NULL;
+    context->scratch_elements = 0;
+    context->runs = NULL;
+    context->run_capacity = 0;
+    context->in_call = 0;
+    context->block_counts = malloc(3 * (size_t)context->threads * TASKS_PER_WORKER * sizeof(int));
+    context->digit_counts = malloc(((size_t)context->threads * TASKS_PER_WORKER << RADIX_MAX_BITS) * sizeof(int));
+    context->sort_sample = malloc(SORT_SAMPLE_CAPACITY * sizeof(int));
+    context->splitters = malloc((2 * SAMPLE_SORT_MAX_BUCKETS + 1) * sizeof(int));
+    if (context->block_counts == NULL || context->digit_counts == NULL || context->sort_sample == NULL ||
+        context->splitters == NULL) {
+        free(context->block_counts);
+        free(context->digit_counts);
+        free(context->sort_sample);
+        free(context->splitters);
+        free(context);
+        return NULL;
+    }
+
+    if (context->runtime == RUNTIME_WS) {
+        context->pool = wsPoolCreate(context->threads);
+    } else {
+        // libgomp keeps the team of the first region alive for the later ones
+        #pragma omp parallel num_threads(context->threads)
+        {
+        }
+    }
+    return context;
+}
+
+void pcmContextDestroy(PcmContext *context) {
+    if (context == NULL) return;
+    if (context->pool != NULL) wsPoolDestroy(context->pool);
+    free(context->scratch);
+    free(context->block_counts);
+    free(context->runs);
+    free(context->digit_counts);
+    free(context->sort_sample);
+    free(context->splitters);
+    free(context);
+}
+
+int pcmContextThreads(const PcmContext *context) {
+    return context->threads;
+}
+
+RuntimeKind pcmContextRuntime(const PcmContext *context) {
+    return context->runtime;
+}
+
+// Grow the scratch buffer to at least `elements` ints, and the run list to the
+// most runs such an input can have; neither ever shrinks
+int pcmReserve(PcmContext *context, int elements) {
+    if (elements < 0) return PCM_ERROR_ARGUMENT;
+    if (elements <= context->scratch_elements) return PCM_OK;
+    // Every block ends at most one run shorter than NATURAL_MIN_RUN; one more for the end
+    int run_capacity = elements / NATURAL_MIN_RUN + context->threads * TASKS_PER_WORKER + 1;
+    int *runs = realloc(context->runs, 2 * (size_t)run_capacity * sizeof(int));
+    if (runs == NULL) return PCM_ERROR_ALLOCATION;
+    context->runs = runs;
+    context->run_capacity = run_capacity;
+    int *scratch = realloc(context->scratch, (size_t)elements * sizeof(int));
+    if (scratch == NULL) return PCM_ERROR_ALLOCATION;
+    context->scratch = scratch;
+    context->scratch_elements = elements;
+    return PCM_OK;
+}
+
+// The work-stealing counters of the latest call; nothing for the OpenMP runtime
+void pcmReportRuntime(PcmContext *context, const char *label) {
+    if (context->pool != NULL) wsReportStats(context->pool, label);
+}
+
+// The pool workers' kernel thread ids, the caller's first; 0 for the OpenMP
+// runtime, whose team the caller reaches with its own parallel region
+int pcmRuntimeThreadIds(PcmContext *context, int *tids) {
+    if (context->pool == NULL) return 0;
+    return wsPoolThreadIds(context->pool, tids);
+}
+
+// Every API call that may run on the pool starts here, so pcmReportRuntime
+// covers all of its passes and nothing before it
+static void beginCall(PcmContext *context) {
+    if (context->pool != NULL && !context->in_call) wsResetStats(context->pool);
+}
+
+const char* pcmStatusString(int status) {
+    switch (status) {
+        case PCM_OK: return "success";
+        case PCM_ERROR_ARGUMENT: return "invalid argument";
+        case PCM_ERROR_ALLOCATION: return "memory allocation failed";
+        default: return "unknown status";
+    }
+}
+
+static int checkArray(const void *data, int n) {
+    return n >= 0 && (data != NULL || n == 0);
+}
+
+// Merge data[left..mid] and data[mid+1..right] through the same range of
+// scratch; concurrent merges cover disjoint ranges, so one buffer serves all
+static void merge(int *data, int *scratch, int left, int mid, int right) {
+    for (int i = left; i <= right; i++) {
+        scratch[i] = data[i];
+    }
+
+    int i = left, j = mid + 1, k = left;
+    while (i <= mid && j <= right) {
+        if (scratch[i] <= scratch[j]) {
+            data[k++] = scratch[i++];
+        } else {
+            data[k++] = scratch[j++];
+        }
+    }
+    while (i <= mid) {
+        data[k++] = scratch[i++];
+    }
+    while (j <= right) {
+        data[k++] = scratch[j++];
+    }
+}
+
+static void insertionSort(int *data, int low, int high);
+
+// Top-down merge sort on one thread, the leaves of both parallel versions
+static void serialMergeSort(int *data, int *scratch, int left, int right) {
+    if (right - left < SELECT_INSERTION_CUTOFF) {
+        insertionSort(data, left, right);
+        return;
+    }
+    int mid = left + (right - left) / 2;
+    serialMergeSort(data, scratch, left, mid);
+    serialMergeSort(data, scratch, mid + 1, right);
+    merge(data, scratch, left, mid, right);
+}
+
+// One task per half inside the caller's parallel region, like mergeSortTask
+static void mergeSort(int *data, int *scratch, int left, int right) {
+    if (right - left < MERGESORT_SERIAL_CUTOFF) {
+        serialMergeSort(data, scratch, left, right);
+        return;
+    }
+    int mid = left + (right - left) / 2;
+
+    #pragma omp task
+    {
+        mergeSort(data, scratch, left, mid);
+    }
+    mergeSort(data, scratch, mid + 1, right);
+    #pragma omp taskwait
+
+    merge(data, scratch, left, mid, right);
+}
+
+typedef struct {
+    int *data;
+    int *scratch;
+    int left;
+    int right;
+} MergeSortRange;
+
+static void ws_mergeSort(int *data, int *scratch, int left, int right);
+
+static void mergeSortTask(void *arg) {
+    MergeSortRange *range = arg;
+    ws_mergeSort(range->data, range->scratch, range->left, range->right);
+}
+
+// The lower half is offered to thieves while this worker sorts the upper half
+static void ws_mergeSort(int *data, int *scratch, int left, int right) {
+    if (right - left < MERGESORT_SERIAL_CUTOFF) {
+        serialMergeSort(data, scratch, left, right);
+    } else {
+        int mid = left + (right - left) / 2;
+
+        MergeSortRange lower = { data, scratch, left, mid };
+        WsTask task;
+        wsSpawn(&task, mergeSortTask, &lower);
+        ws_mergeSort(data, scratch, mid + 1, right);
+        wsJoin(&task);
+
+        merge(data, scratch, left, mid, right);
+    }
+}
+
+int pcmMergeSort(PcmContext *context, int *data, int n) {
+    beginCall(context);
+    if (!checkArray(data, n)) return PCM_ERROR_ARGUMENT;
+    int status = pcmReserve(context, n);
+    if (status != PCM_OK) return status;
+
+    if (context->runtime == RUNTIME_WS) {
+        MergeSortRange root = { data, context->scratch, 0, n - 1 };
+        wsRun(context->pool, mergeSortTask, &root);
+    } else {
+        #pragma omp parallel num_threads(context->threads)
+        {
+            #pragma omp single
+            {
+                mergeSort(data, context->scratch, 0, n - 1);
+            }
+        }
+    }
+    return PCM_OK;
+}
+
+static int floorLog2(int n) {
+    int log = 0;
+    while (n > 1) {
+        n >>= 1;
+        log++;
+    }
+    return log;
+}
+
+static void swap(int *a, int *b) {
+    int temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+// Index of the median of data[a], data[b] and data[c]
+static int medianOfThree(const int *data, int a, int b, int c) {
+    if (data[a] < data[b]) {
+        if (data[b] < data[c]) return b;
+        return data[a] < data[c] ? c : a;
+    }
+    if (data[a] < data[c]) return a;
+    return data[b] < data[c] ? c : b;
+}
+
+// Hoare-style partition (Sedgewick's variant) around the median of the first,
+// middle and last keys; returns the pivot's final index. Sorted input splits
+// evenly, and both scans stop on keys equal to the pivot, so runs of
+// duplicates split in the middle instead of one key at a time
+int pcmPartition(int *data, int low, int high) {
+    if (high - low >= 2) {
+        swap(&data[medianOfThree(data, low, low + (high - low) / 2, high)], &data[high]);
+    }
+    int pivot = data[high];
+    int i = low - 1, j = high;
+
+    for (;;) {
+        while (data[++i] < pivot) {
+        }
+        while (j > low && pivot < data[--j]) {
+        }
+        if (i >= j) break;
+        swap(&data[i], &data[j]);
+    }
+    swap(&data[i], &data[high]);
+    return i;
+}
+
+// Dutch national flag partition: keys equal to pivot end up in
+// data[*equal_first..*equal_last], smaller keys before, larger keys after
+void pcmPartitionThreeWay(int *data, int low, int high, int pivot, int *equal_first, int *equal_last) {
+    int lt = low, i = low, gt = high;
+    while (i <= gt) {
+        if (data[i] < pivot) {
+            swap(&data[lt++], &data[i++]);
+        } else if (data[i] > pivot) {
+            swap(&data[i], &data[gt--]);
+        } else {
+            i++;
+        }
+    }
+    *equal_first = lt;
+    *equal_last = gt;
+}
+
+static void serialSort(int *data, int low, int high);
+
+// Introsort over OpenMP tasks: each partition spawns the smaller side and the
+// task loops on the larger, so no task nests more than log2(n) deep. After
+// depth partitions (2 * log2(n) at the root) the range median-of-three keeps
+// splitting badly, as in reversed or sawtooth input, and finishes by serialSort
+static void parallel_quickSort(int *data, int low, int high, int depth, TraceSpawn spawn) {
+    TraceTask trace;
+    traceTaskBegin(&trace, "quickSort", spawn);
+
+    while (high - low >= QUICKSORT_SERIAL_CUTOFF && depth > 0) {
+        depth--;
+        int pi = pcmPartition(data, low, high);
+        int small_low = low, small_high = pi - 1;
+        if (pi - low < high - pi) {
+            low = pi + 1;
+        } else {
+            small_low = pi + 1;
+            small_high = high;
+            high = pi - 1;
+        }
+
+        TraceSpawn child = traceSpawn();
+        #pragma omp task firstprivate(small_low, small_high, depth, child)
+        {
+            parallel_quickSort(data, small_low, small_high, depth, child);
+        }
+    }
+    serialSort(data, low, high);
+
+    traceTaskEnd(&trace);
+}
+
+typedef struct {
+    int *data;
+    int low;
+    int high;
+    int depth;
+    TraceSpawn spawn;
+} QuickSortRange;
+
+static void ws_quickSort(int *data, int low, int high, int depth, TraceSpawn spawn);
+
+static void quickSortTask(void *arg) {
+    QuickSortRange *range = arg;
+    ws_quickSort(range->data, range->low, range->high, range->depth, range->spawn);
+}
+
+// The same introsort on the work-stealing runtime: the smaller sides are
+// offered to thieves and joined, newest first, once the larger side is sorted
+static void ws_quickSort(int *data, int low, int high, int depth, TraceSpawn spawn) {
+    TraceTask trace;
+    traceTaskBegin(&trace, "quickSort", spawn);
+
+    QuickSortRange smaller[QUICKSORT_MAX_DEPTH];
+    WsTask tasks[QUICKSORT_MAX_DEPTH];
+    int spawned = 0;
+    while (high - low >= QUICKSORT_SERIAL_CUTOFF && depth > 0) {
+        depth--;
+        int pi = pcmPartition(data, low, high);
+        QuickSortRange *range = &smaller[spawned];
+        *range = (QuickSortRange){ data, low, pi - 1, depth, traceSpawn() };
+        if (pi - low < high - pi) {
+            low = pi + 1;
+        } else {
+            range->low = pi + 1;
+            range->high = high;
+            high = pi - 1;
+        }
+        wsSpawn(&tasks[spawned], quickSortTask, range);
+        spawned++;
+    }
+    serialSort(data, low, high);
+
+    double wait = traceWaitBegin();
+    while (spawned > 0) {
+        wsJoin(&tasks[--spawned]);
+    }
+    traceWaitEnd(wait);
+
+    traceTaskEnd(&trace);
+}
+
+int pcmQuickSort(PcmContext *context, int *data, int n) {
+    beginCall(context);
+    if (!checkArray(data, n)) return PCM_ERROR_ARGUMENT;
+
+    if (context->runtime == RUNTIME_WS) {
+        QuickSortRange root = { data, 0, n - 1, 2 * floorLog2(n), traceSpawn() };
+        wsRun(context->pool, quickSortTask, &root);
+    } else {
+        #pragma omp parallel num_threads(context->threads)
+        {
+            #pragma omp single
+            {
+                parallel_quickSort(data, 0, n - 1, 2 * floorLog2(n), traceSpawn());
+            }
+        }
+    }
+    return PCM_OK;
+}
+
+typedef void (*BlockFunction)(void *arg, int block);
+
+// Blocks first..last of a parallel pass
+typedef struct {
+    BlockFunction function;
+    void *arg;
+    int first;
+    int last;
+} BlockRange;
+
+static void blockTask(void *arg) {
+    BlockRange *range = arg;
+    if (range->first == range->last) {
+        range->function(range->arg, range->first);
+        return;
+    }
+    int middle = range->first + (range->last - range->first) / 2;
+    BlockRange lower = *range, upper = *range;
+    lower.last = middle;
+    upper.first = middle + 1;
+    WsTask task;
+    wsSpawn(&task, blockTask, &lower);
+    blockTask(&upper);
+    wsJoin(&task);
+}
+
+// function(arg, b) for every b in [0, blocks) on the context's threads
+static void forEachBlock(PcmContext *context, BlockFunction function, void *arg, int blocks) {
+    if (blocks <= 0) return;
+    if (context->runtime == RUNTIME_WS) {
+        BlockRange root = { function, arg, 0, blocks - 1 };
+        wsRun(context->pool, blockTask, &root);
+    } else {
+        #pragma omp parallel for num_threads(context->threads) schedule(static)
+        for (int b = 0; b < blocks; b++) {
+            function(arg, b);
+        }
+    }
+}
+
+static int blockStart(int low, int size, int blocks, int b) {
+    return low + (int)((long)size * b / blocks);
+}
+
+static void insertionSort(int *data, int low, int high) {
+    for (int i = low + 1; i <= high; i++) {
+        int key = data[i];
+        int j = i - 1;
+        while (j >= low && data[j] > key) {
+            data[j + 1] = data[j];
+            j--;
+        }
+        data[j + 1] = key;
+    }
+}
+
+static void introSelect(int *data, int low, int high, int k);
+
+// Median of the medians of groups of five; gathers the medians at the front
+static int medianOfMedians(int *data, int low, int high) {
+    int count = 0;
+    for (int i = low; i <= high; i += 5) {
+        int end = i + 4 < high ? i + 4 : high;
+        insertionSort(data, i, end);
+        swap(&data[low + count], &data[i + (end - i) / 2]);
+        count++;
+    }
+    int middle = low + (count - 1) / 2;
+    introSelect(data, low, low + count - 1, middle);
+    return data[middle];
+}
+
+// Quickselect with median-of-three pivots; after 2 log2(n) rounds it switches
+// to median-of-medians pivots, which bound the rest to linear time
+static void introSelect(int *data, int low, int high, int k) {
+    int budget = 2 * floorLog2(high - low + 1);
+    while (high - low > SELECT_INSERTION_CUTOFF) {
+        int pivot = budget-- > 0 ? data[medianOfThree(data, low, low + (high - low) / 2, high)]
+                                 : medianOfMedians(data, low, high);
+        int equal_first, equal_last;
+        pcmPartitionThreeWay(data, low, high, pivot, &equal_first, &equal_last);
+        if (k < equal_first) {
+            high = equal_first - 1;
+        } else if (k > equal_last) {
+            low = equal_last + 1;
+        } else {
+            return;
+        }
+    }
+    insertionSort(data, low, high);
+}
+
+// Median of three medians of three, spread over data[low..high]
+static int ninther(const int *data, int low, int high) {
+    int step = (high - low) / 8;
+    int mid = low + (high - low) / 2;
+    int a = medianOfThree(data, low, low + step, low + 2 * step);
+    int b = medianOfThree(data, mid - step, mid, mid + step);
+    int c = medianOfThree(data, high - 2 * step, high - step, high);
+    int keys[3] = { data[a], data[b], data[c] };
+    return keys[medianOfThree(keys, 0, 1, 2)];
+}
+
+// Three-way partition of data[low..high] through the scratch buffer: count
+// per block, turn the counts into output offsets, scatter, copy back
+typedef struct {
+    int *data;
+    int *scratch;
+    int low;
+    int size;
+    int pivot;
+    int blocks;
+    int *counts;    // less, equal and greater per block
+} PartitionPass;
+
+static void partitionCount(void *arg, int b) {
+    PartitionPass *pass = arg;
+    int start = blockStart(pass->low, pass->size, pass->blocks, b);
+    int end = blockStart(pass->low, pass->size, pass->blocks, b + 1);
+    int less = 0, equal = 0;
+    for (int i = start; i < end; i++) {
+        less += pass->data[i] < pass->pivot;
+        equal += pass->data[i] == pass->pivot;
+    }
+    pass->counts[3 * b] = less;
+    pass->counts[3 * b + 1] = equal;
+    pass->counts[3 * b + 2] = end - start - less - equal;
+}
+
+static void partitionScatter(void *arg, int b) {
+    PartitionPass *pass = arg;
+    int start = blockStart(pass->low, pass->size, pass->blocks, b);
+    int end = blockStart(pass->low, pass->size, pass->blocks, b + 1);
+    int *offset = pass->counts + 3 * b;
+    for (int i = start; i < end; i++) {
+        int key = pass->data[i];
+        int side = key < pass->pivot ? 0 : (key == pass->pivot ? 1 : 2);
+        pass->scratch[offset[side]++] = key;
+    }
+}
+
+static void partitionCopyBack(void *arg, int b) {
+    PartitionPass *pass = arg;
+    int start = blockStart(pass->low, pass->size, pass->blocks, b);
+    int end = blockStart(pass->low, pass->size, pass->blocks, b + 1);
+    memcpy(pass->data + start, pass->scratch + start, (size_t)(end - start) * sizeof(int));
+}
+
+static void parallelPartitionThreeWay(PcmContext *context, int *data, int low, int high, int pivot,
+                                      int *equal_first, int *equal_last) {
+    PartitionPass pass = { data, context->scratch, low, high - low + 1, pivot,
+                           context->threads * TASKS_PER_WORKER, context->block_counts };
+    forEachBlock(context, partitionCount, &pass, pass.blocks);
+
+    int less = 0, equal = 0;
+    for (int b = 0; b < pass.blocks; b++) {
+        less += pass.counts[3 * b];
+        equal += pass.counts[3 * b + 1];
+    }
+    int offset[3] = { low, low + less, low + less + equal };
+    for (int b = 0; b < pass.blocks; b++) {
+        for (int side = 0; side < 3; side++) {
+            int count = pass.counts[3 * b + side];
+            pass.counts[3 * b + side] = offset[side];
+            offset[side] += count;
+        }
+    }
+    forEachBlock(context, partitionScatter, &pass, pass.blocks);
+    forEachBlock(context, partitionCopyBack, &pass, pass.blocks);
+
+    *equal_first = low + less;
+    *equal_last = low + less + equal - 1;
+}
+
+// Quickselect whose partitions run on all threads until the range is short
+int pcmSelect(PcmContext *context, int *data, int n, int k) {
+    beginCall(context);
+    if (!checkArray(data, n) || k < 0 || k >= n) return PCM_ERROR_ARGUMENT;
+    int low = 0, high = n - 1;
+
+    if (context->threads > 1 && n > PARALLEL_SELECT_CUTOFF) {
+        int status = pcmReserve(context, n);
+        if (status != PCM_OK) return status;
+        int budget = 2 * floorLog2(n);
+        while (high - low >= PARALLEL_SELECT_CUTOFF) {
+            int pivot = budget-- > 0 ? ninther(data, low, high) : medianOfMedians(data, low, high);
+            int equal_first, equal_last;
+            parallelPartitionThreeWay(context, data, low, high, pivot, &equal_first, &equal_last);
+            if (k < equal_first) {
+                high = equal_first - 1;
+            } else if (k > equal_last) {
+                low = equal_last + 1;
+            } else {
+                return PCM_OK;
+            }
+        }
+    }
+    introSelect(data, low, high, k);
+    return PCM_OK;
+}
+
+typedef struct {
+    int rank;
+    int index;      // position in the caller's ranks and values
+} RankSlot;
+
+static int compareRankSlots(const void *a, const void *b) {
+    int x = ((const RankSlot *)a)->rank, y = ((const RankSlot *)b)->rank;
+    return (x > y) - (x < y);
+}
+
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorted ranks first..last within data[low..high], whose keys are those of
+// ranks base.. of the whole input: the middle rank splits the range and the
+// ranks on either side, so the work is O(n log count) rather than O(n count)
+static void selectRanks(int *data, int low, int high, const RankSlot *ranks, int first, int last,
+                        long base, int *values) {
+    if (first > last) return;
+    int middle = first + (last - first) / 2;
+    int k = (int)(ranks[middle].rank - base);
+    introSelect(data, low, high, k);
+
+    int left = middle, right = middle;
+    while (left > first && ranks[left - 1].rank == ranks[middle].rank) left--;
+    while (right < last && ranks[right + 1].rank == ranks[middle].rank) right++;
+    for (int r = left; r <= right; r++) {
+        values[ranks[r].index] = data[k];
+    }
+    selectRanks(data, low, k - 1, ranks, first, left - 1, base, values);
+    selectRanks(data, k + 1, high, ranks, right + 1, last, base, values);
+}
+
+// Keys are classed into slots: gap 0, bracket 0, gap 1, bracket 1, ..., gap B,
+// where bracket j is [lows[j], highs[j]] and gaps hold the keys in between
+typedef struct {
+    const int *data;
+    int n;
+    int blocks;
+    int brackets;
+    const int *lows;
+    const int *highs;
+    int top_step;       // the largest power of two <= brackets
+    int slots;
+    int *counts;        // slots per block; the bracket counts become offsets
+    int **kept;         // per block, the keys inside brackets in input order
+    int *kept_count;
+    int *kept_capacity;
+    int failed;         // a block could not grow its buffer
+    int *candidates;    // the keys inside brackets, grouped by bracket
+} BracketPass;
+
+// Branch-free search for the number of lows <= key; the steps only depend on
+// the bracket count, so a random key costs no mispredictions
+static int bracketSlot(const BracketPass *pass, int key) {
+    int position = 0;
+    for (int step = pass->top_step; step > 0; step >>= 1) {
+        int next = position + step;
+        position = next <= pass->brackets && pass->lows[next - 1] <= key ? next : position;
+    }
+    return position > 0 && key <= pass->highs[position - 1] ? 2 * position - 1 : 2 * position;
+}
+
+// The one pass over the input: count every slot and keep the bracket keys
+static void bracketClassify(void *arg, int b) {
+    BracketPass *pass = arg;
+    int *counts = pass->counts + (size_t)b * pass->slots;
+    int *kept = pass->kept[b];
+    int kept_count = 0, capacity = pass->kept_capacity[b];
+    int end = blockStart(0, pass->n, pass->blocks, b + 1);
+    for (int i = blockStart(0, pass->n, pass->blocks, b); i < end; i++) {
+        int key = pass->data[i];
+        int slot = bracketSlot(pass, key);
+        counts[slot]++;
+        if (slot & 1) {
+            if (kept_count == capacity) {
+                int *grown = realloc(kept, 2 * (size_t)capacity * sizeof(int));
+                if (grown == NULL) {
+                    __atomic_store_n(&pass->failed, 1, __ATOMIC_RELAXED);
+                    break;
+                }
+                kept = grown;
+                capacity *= 2;
+            }
+            kept[kept_count++] = key;
+        }
+    }
+    pass->kept[b] = kept;
+    pass->kept_count[b] = kept_count;
+    pass->kept_capacity[b] = capacity;
+}
+
+static void bracketScatter(void *arg, int b) {
+    BracketPass *pass = arg;
+    int *offsets = pass->counts + (size_t)b * pass->slots;
+    for (int i = 0; i < pass->kept_count[b]; i++) {
+        int key = pass->kept[b][i];
+        pass->candidates[offsets[bracketSlot(pass, key)]++] = key;
+    }
+}
+
+// The ranks of one bracket, selected among its candidates
+typedef struct {
+    const RankSlot *ranks;
+    const int *rank_first;      // ranks of bracket j are rank_first[j]..rank_first[j+1]-1
+    const long *below;          // keys below bracket j
+    const int *bracket_start;   // candidates of bracket j start here; one extra entry ends the last
+    int *candidates;
+    int *values;
+    int *missed;                // set when a rank fell outside its bracket
+} BracketSelect;
+
+static void bracketSelect(void *arg, int j) {
+    BracketSelect *select = arg;
+    int start = select->bracket_start[j];
+    int size = select->bracket_start[j + 1] - start;
+    int first = select->rank_first[j], last = select->rank_first[j + 1] - 1;
+    if (select->ranks[first].rank < select->below[j] || select->ranks[last].rank >= select->below[j] + size) {
+        __atomic_store_n(select->missed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    selectRanks(select->candidates + start, 0, size - 1, select->ranks, first, last, select->below[j], select->values);
+}
+
+// Floyd-Rivest style: a sorted random sample gives each rank a key bracket
+// that holds it with high probability. One parallel pass counts the keys
+// below every bracket and keeps the keys inside them, so only a small
+// fraction of the input is ever selected from
+int pcmMultiSelect(PcmContext *context, const int *data, int n, const int *ranks, int count, int *values) {
+    beginCall(context);
+    if (!checkArray(data, n) || count < 0 || (count > 0 && (ranks == NULL || values == NULL))) {
+        return PCM_ERROR_ARGUMENT;
+    }
+    for (int r = 0; r < count; r++) {
+        if (ranks[r] < 0 || ranks[r] >= n) return PCM_ERROR_ARGUMENT;
+    }
+    if (count == 0) return PCM_OK;
+
+    RankSlot *sorted = malloc((size_t)count * sizeof(RankSlot));
+    if (sorted == NULL) return PCM_ERROR_ALLOCATION;
+    for (int r = 0; r < count; r++) {
+        sorted[r].rank = ranks[r];
+        sorted[r].index = r;
+    }
+    qsort(sorted, count, sizeof(RankSlot), compareRankSlots);
+
+    int status = PCM_OK;
+    // A bracket spans about 4/sqrt(samples) of the input, so close ranks need
+    // more samples to keep their brackets apart; at most an eighth of the input
+    long samples = (long)count * count * 64 > n / 256 ? (long)count * count * 64 : n / 256;
+    if (samples > n / 8) samples = n / 8;
+    if (samples > MULTISELECT_MAX_SAMPLE) samples = MULTISELECT_MAX_SAMPLE;
+    if (samples < MULTISELECT_MIN_SAMPLE) samples = MULTISELECT_MIN_SAMPLE;
+    int missed = 1;
+    if (n >= 8 * MULTISELECT_MIN_SAMPLE) {
+        int blocks = context->threads * TASKS_PER_WORKER;
+        int *sample = malloc((size_t)samples * sizeof(int));
+        int *lows = malloc((size_t)count * sizeof(int));
+        int *highs = malloc((size_t)count * sizeof(int));
+        int *rank_first = malloc(((size_t)count + 1) * sizeof(int));
+        int *bracket_start = malloc(((size_t)count + 1) * sizeof(int));
+        long *below = malloc((size_t)count * sizeof(long));
+        int *counts = calloc((size_t)blocks * (2 * count + 1), sizeof(int));
+        int **kept = calloc(blocks, sizeof(int *));
+        int *kept_count = calloc(blocks, sizeof(int));
+        int *kept_capacity = calloc(blocks, sizeof(int));
+        int *candidates = NULL;
+        if (sample == NULL || lows == NULL || highs == NULL || rank_first == NULL || bracket_start == NULL ||
+            below == NULL || counts == NULL || kept == NULL || kept_count == NULL || kept_capacity == NULL) {
+            status = PCM_ERROR_ALLOCATION;
+            goto sample_done;
+        }
+
+        uint64_t state = 0x9E3779B97F4A7C15ULL ^ (uint64_t)n;
+        for (int s = 0; s < samples; s++) {
+            sample[s] = data[nextRandom(&state) % (uint64_t)n];
+        }
+        qsort(sample, samples, sizeof(int), compareInts);
+
+        // Each rank's bracket spans two standard deviations of its sample
+        // rank either side; brackets that overlap are merged
+        int spread = 1;
+        while (spread * spread < 4 * samples) spread++;
+        int brackets = 0;
+        long covered = 0, covered_end = 0;     // sample positions inside brackets
+        for (int r = 0; r < count; r++) {
+            long position = (long)sorted[r].rank * samples / n;
+            long first = position - spread, last = position + spread;
+            int low = first < 0 ? INT_MIN : sample[first];
+            int high = last >= samples ? INT_MAX : sample[last];
+            covered += last + 1 - (first > covered_end ? first : covered_end);
+            covered_end = last + 1;
+            if (brackets > 0 && low <= highs[brackets - 1]) {
+                if (high > highs[brackets - 1]) highs[brackets - 1] = high;
+            } else {
+                rank_first[brackets] = r;
+                lows[brackets] = low;
+                highs[brackets] = high;
+                brackets++;
+            }
+        }
+        rank_first[brackets] = count;
+        // Brackets over most of the input leave nothing to skip
+        if (covered > samples / 2) goto sample_done;
+
+        // Room for the expected share of each block, plus some slack
+        long expected = (long)((double)covered / samples * n / blocks) + 1024;
+        for (int b = 0; b < blocks; b++) {
+            kept_capacity[b] = expected + expected / 4;
+            kept[b] = malloc((size_t)kept_capacity[b] * sizeof(int));
+            if (kept[b] == NULL) {
+                status = PCM_ERROR_ALLOCATION;
+                goto sample_done;
+            }
+        }
+
+        int top_step = 1;
+        while (2 * top_step <= brackets) top_step *= 2;
+        BracketPass pass = { data, n, blocks, brackets, lows, highs, top_step, 2 * brackets + 1, counts,
+                             kept, kept_count, kept_capacity, 0, NULL };
+        forEachBlock(context, bracketClassify, &pass, blocks);
+        if (pass.failed) {
+            status = PCM_ERROR_ALLOCATION;
+            goto sample_done;
+        }
+
+        // Keys below each bracket, and each bracket's slice of the candidates
+        long keys_below = 0;
+        int offset = 0;
+        for (int j = 0; j < brackets; j++) {
+            for (int b = 0; b < blocks; b++) keys_below += counts[(size_t)b * pass.slots + 2 * j];
+            below[j] = keys_below;
+            bracket_start[j] = offset;
+            for (int b = 0; b < blocks; b++) {
+                int inside = counts[(size_t)b * pass.slots + 2 * j + 1];
+                counts[(size_t)b * pass.slots + 2 * j + 1] = offset;
+                offset += inside;
+                keys_below += inside;
+            }
+        }
+        bracket_start[brackets] = offset;
+
+        candidates = malloc((size_t)(offset > 0 ? offset : 1) * sizeof(int));
+        if (candidates == NULL) {
+            status = PCM_ERROR_ALLOCATION;
+            goto sample_done;
+        }
+        pass.candidates = candidates;
+        forEachBlock(context, bracketScatter, &pass, blocks);
+
+        missed = 0;
+        BracketSelect select = { sorted, rank_first, below, bracket_start, candidates, values, &missed };
+        forEachBlock(context, bracketSelect, &select, brackets);
+
+sample_done:
+        for (int b = 0; kept != NULL && b < blocks; b++) {
+            free(kept[b]);
+        }
+        free(sample);
+        free(lows);
+        free(highs);
+        free(rank_first);
+        free(bracket_start);
+        free(below);
+        free(counts);
+        free(kept);
+        free(kept_count);
+        free(kept_capacity);
+        free(candidates);
+    }
+
+    // Small inputs, dense ranks and the rare sample that misses a rank select in a copy
+    if (status == PCM_OK && missed) {
+        status = pcmReserve(context, n);
+        if (status == PCM_OK) {
+            memcpy(context->scratch, data, (size_t)n * sizeof(int));
+            selectRanks(context->scratch, 0, n - 1, sorted, 0, count - 1, 0, values);
+        }
+    }
+    free(sorted);
+    return status;
+}
+
+// One bounded max-heap per block keeps the k smallest keys seen so far;
+// after the first k keys most keys fail the comparison with the root
+typedef struct {
+    const int *data;
+    int n;
+    int k;
+    int blocks;
+    int *heaps;
+    int *sizes;
+} TopKPass;
+
+static void siftDown(int *heap, int size, int i) {
+    int key = heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= size) break;
+        if (child + 1 < size && heap[child + 1] > heap[child]) child++;
+        if (heap[child] <= key) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = key;
+}
+
+static void topKBlock(void *arg, int b) {
+    TopKPass *pass = arg;
+    int *heap = pass->heaps + (size_t)b * pass->k;
+    int size = 0;
+    int end = blockStart(0, pass->n, pass->blocks, b + 1);
+    for (int i = blockStart(0, pass->n, pass->blocks, b); i < end; i++) {
+        int key = pass->data[i];
+        if (size < pass->k) {
+            int child = size++;
+            while (child > 0 && heap[(child - 1) / 2] < key) {
+                heap[child] = heap[(child - 1) / 2];
+                child = (child - 1) / 2;
+            }
+            heap[child] = key;
+        } else if (key < heap[0]) {
+            heap[0] = key;
+            siftDown(heap, size, 0);
+        }
+    }
+    pass->sizes[b] = size;
+}
+
+int pcmTopK(PcmContext *context, const int *data, int n, int k, int *out) {
+    beginCall(context);
+    if (!checkArray(data, n) || k < 0 || k > n || (k > 0 && out == NULL)) return PCM_ERROR_ARGUMENT;
+    if (k == 0) return PCM_OK;
+
+    // Fewer heaps when they would hold more keys than the input
+    int blocks = context->threads;
+    if ((long)blocks * k > n) blocks = n / k;
+    int status = pcmReserve(context, blocks * k);
+    if (status != PCM_OK) return status;
+
+    TopKPass pass = { data, n, k, blocks, context->scratch, context->block_counts };
+    forEachBlock(context, topKBlock, &pass, blocks);
+
+    int kept = 0;
+    for (int b = 0; b < blocks; b++) {
+        memmove(context->scratch + kept, context->scratch + (size_t)b * k, (size_t)pass.sizes[b] * sizeof(int));
+        kept += pass.sizes[b];
+    }
+    introSelect(context->scratch, 0, kept - 1, k - 1);
+    memcpy(out, context->scratch, (size_t)k * sizeof(int));
+    qsort(out, k, sizeof(int), compareInts);
+    return PCM_OK;
+}
+
+// Natural merge sort: runs are found in parallel, each block of the input
+// reporting its own, and joined where they continue across a block boundary.
+// A run shorter than NATURAL_MIN_RUN is extended by insertion sort; strictly
+// descending runs are reversed by one more parallel pass. Sorted and
+// reverse-sorted input end up as a single run without any merging
+typedef struct {
+    int *data;
+    int n;
+    int blocks;
+    int *starts;    // block b writes its run starts from start_b / NATURAL_MIN_RUN + b
+    int *counts;
+} RunDetection;
+
+// Descending runs are listed as ~start until they have been reversed
+#define DESCENDING_RUN(start) (~(start))
+#define RUN_START(entry) ((entry) < 0 ? ~(entry) : (entry))
+
+static int runSlot(const RunDetection *detection, int b) {
+    return blockStart(0, detection->n, detection->blocks, b) / NATURAL_MIN_RUN + b;
+}
+
+static void detectRuns(void *arg, int b) {
+    RunDetection *detection = arg;
+    const int *data = detection->data;
+    int *starts = detection->starts + runSlot(detection, b);
+    int end = blockStart(0, detection->n, detection->blocks, b + 1);
+    int count = 0;
+    int i = blockStart(0, detection->n, detection->blocks, b);
+    while (i < end) {
+        int j = i + 1;
+        int descending = j < end && data[j] < data[i];
+        if (descending) {
+            while (j < end && data[j] < data[j - 1]) j++;
+        } else {
+            while (j < end && data[j] >= data[j - 1]) j++;
+        }
+        if (j - i < NATURAL_MIN_RUN && j < end) {
+            j = i + NATURAL_MIN_RUN < end ? i + NATURAL_MIN_RUN : end;
+            insertionSort(detection->data, i, j - 1);
+            descending = 0;
+        }
+        starts[count++] = descending ? DESCENDING_RUN(i) : i;
+        i = j;
+    }
+    detection->counts[b] = count;
+}
+
+// Swaps of all descending runs, numbered in run order and dealt out evenly
+typedef struct {
+    int *data;
+    const int *starts;      // runs + 1 entries, the last one n
+    const int *swaps_before;
+    int runs;
+    long swaps;
+    int blocks;
+} ReversePass;
+
+static void reverseBlock(void *arg, int b) {
+    ReversePass *pass = arg;
+    long first = pass->swaps * b / pass->blocks, last = pass->swaps * (b + 1) / pass->blocks;
+    if (first == last) return;
+    // The run holding swap `first`: the last run with swaps_before <= first
+    int low = 0, high = pass->runs - 1;
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (pass->swaps_before[mid] <= first) low = mid;
+        else high = mid - 1;
+    }
+    for (int r = low; r < pass->runs && first < last; r++) {
+        if (pass->starts[r] >= 0) continue;
+        int start = RUN_START(pass->starts[r]), end = RUN_START(pass->starts[r + 1]) - 1;
+        int swaps = (end - start + 1) / 2;
+        for (long k = first - pass->swaps_before[r]; k < swaps && first < last; k++, first++) {
+            swap(&pass->data[start + k], &pass->data[end - k]);
+        }
+    }
+}
+
+// Powersort's node power of the boundary between runs [start1, start2) and
+// [start2, end2): the first bit where their midpoints, as fractions of n, differ
+static int nodePower(int n, int start1, int start2, int end2) {
+    long a = (long)start1 + start2;     // twice the midpoints
+    long b = (long)start2 + end2;
+    long scale = 2L * n;
+    int power = 0;
+    for (;;) {
+        power++;
+        a *= 2;
+        b *= 2;
+        int a_bit = a >= scale, b_bit = b >= scale;
+        if (a_bit != b_bit) return power;
+        if (a_bit) {
+            a -= scale;
+            b -= scale;
+        }
+    }
+}
+
+typedef struct {
+    int *data;
+    int *scratch;
+    RuntimeKind runtime;
+    int threads;
+    const int *starts;      // run i is [starts[i], starts[i + 1])
+    const int *powers;      // powers[i] belongs to the boundary after run i
+} NaturalSort;
+
+typedef void (*PieceFunction)(void *arg, int piece);
+
+// Pieces of one merge as tasks of the runtime already running the sort
+static void runPieces(const NaturalSort *sort, PieceFunction function, void *arg, int pieces) {
+    if (sort->runtime == RUNTIME_WS) {
+        BlockRange root = { function, arg, 0, pieces - 1 };
+        blockTask(&root);
+    } else {
+        for (int p = 0; p < pieces; p++) {
+            #pragma omp task firstprivate(p)
+            function(arg, p);
+        }
+        #pragma omp taskwait
+    }
+}
+
+// A merge of data[left..mid] and data[mid+1..right] split into pieces of the
+// output; each piece finds where its output starts in both runs
+typedef struct {
+    int *data;
+    int *scratch;
+    int left;
+    int mid;
+    int right;
+    int pieces;
+} MergePieces;
+
+static void copyPiece(void *arg, int p) {
+    MergePieces *merge = arg;
+    int size = merge->right - merge->left + 1;
+    int start = blockStart(merge->left, size, merge->pieces, p);
+    int end = blockStart(merge->left, size, merge->pieces, p + 1);
+    memcpy(merge->scratch + start, merge->data + start, (size_t)(end - start) * sizeof(int));
+}
+
+// How many of the first k outputs come from a; a wins ties, which keeps the merge stable
+static int coRank(const int *a, int na, const int *b, int nb, int k) {
+    int low = k > nb ? k - nb : 0, high = k < na ? k : na;
+    while (low < high) {
+        int i = low + (high - low) / 2;
+        if (k - i > 0 && b[k - i - 1] >= a[i]) low = i + 1;
+        else high = i;
+    }
+    return low;
+}
+
+static void mergePiece(void *arg, int p) {
+    MergePieces *merge = arg;
+    const int *a = merge->scratch + merge->left, *b = merge->scratch + merge->mid + 1;
+    int na = merge->mid - merge->left + 1, nb = merge->right - merge->mid;
+    int k0 = (int)((long)(na + nb) * p / merge->pieces);
+    int k1 = (int)((long)(na + nb) * (p + 1) / merge->pieces);
+    int i = coRank(a, na, b, nb, k0), j = k0 - i;
+    int i_end = coRank(a, na, b, nb, k1), j_end = k1 - i_end;
+    int *out = merge->data + merge->left + k0;
+    while (i < i_end && j < j_end) {
+        *out++ = a[i] <= b[j] ? a[i++] : b[j++];
+    }
+    while (i < i_end) *out++ = a[i++];
+    while (j < j_end) *out++ = b[j++];
+}
+
+// First index in data[low..high] whose key is above key, or high + 1
+static int upperBound(const int *data, int low, int high, int key) {
+    high++;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (data[mid] <= key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// First index in data[low..high] whose key is not below key, or high + 1
+static int lowerBound(const int *data, int low, int high, int key) {
+    high++;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (data[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static void mergeAdjacentRuns(const NaturalSort *sort, int left, int mid, int right) {
+    int *data = sort->data;
+    if (data[mid] <= data[mid + 1]) return;
+    // Keys of the left run up to the right run's first key, and keys of the
+    // right run from the left run's last key on, are already in place
+    left = upperBound(data, left, mid, data[mid + 1]);
+    right = lowerBound(data, mid + 1, right, data[mid]) - 1;
+
+    int size = right - left + 1;
+    if (sort->threads == 1 || size < PARALLEL_MERGE_CUTOFF) {
+        merge(data, sort->scratch, left, mid, right);
+        return;
+    }
+    int pieces = sort->threads * TASKS_PER_WORKER;
+    MergePieces pieces_of = { data, sort->scratch, left, mid, right, pieces };
+    runPieces(sort, copyPiece, &pieces_of, pieces);
+    runPieces(sort, mergePiece, &pieces_of, pieces);
+}
+
+typedef struct {
+    const NaturalSort *sort;
+    int first;
+    int last;
+} RunRange;
+
+static void naturalMerge(const NaturalSort *sort, int first, int last);
+
+static void naturalMergeTask(void *arg) {
+    RunRange *range = arg;
+    naturalMerge(range->sort, range->first, range->last);
+}
+
+// Runs first..last merged along powersort's tree: the boundary of least power
+// (the leftmost on ties) is merged last, and the two sides are independent
+static void naturalMerge(const NaturalSort *sort, int first, int last) {
+    if (first == last) return;
+    int split = first;
+    for (int k = first + 1; k < last; k++) {
+        if (sort->powers[k] < sort->powers[split]) split = k;
+    }
+    int left = sort->starts[first], mid = sort->starts[split + 1] - 1, right = sort->starts[last + 1] - 1;
+
+    if (sort->threads == 1 || right - left + 1 < PARALLEL_MERGE_CUTOFF) {
+        naturalMerge(sort, first, split);
+        naturalMerge(sort, split + 1, last);
+    } else if (sort->runtime == RUNTIME_WS) {
+        RunRange lower = { sort, first, split };
+        WsTask task;
+        wsSpawn(&task, naturalMergeTask, &lower);
+        naturalMerge(sort, split + 1, last);
+        wsJoin(&task);
+    } else {
+        #pragma omp task
+        naturalMerge(sort, first, split);
+        naturalMerge(sort, split + 1, last);
+        #pragma omp taskwait
+    }
+    mergeAdjacentRuns(sort, left, mid, right);
+}
+
+int pcmNaturalMergeSort(PcmContext *context, int *data, int n) {
+    beginCall(context);
+    if (!checkArray(data, n)) return PCM_ERROR_ARGUMENT;
+    if (n < 2) return PCM_OK;
+    int status = pcmReserve(context, n);
+    if (status != PCM_OK) return status;
+
+    int blocks = context->threads * TASKS_PER_WORKER;
+    if (blocks > n / NATURAL_MIN_RUN) blocks = n / NATURAL_MIN_RUN > 0 ? n / NATURAL_MIN_RUN : 1;
+    int *starts = context->runs;
+    int *powers = context->runs + context->run_capacity;
+    RunDetection detection = { data, n, blocks, starts, context->block_counts };
+    forEachBlock(context, detectRuns, &detection, blocks);
+
+    // Gather the runs to the front, joining runs of one direction that
+    // continue each other; no block starts ahead of its slot, so the list
+    // compacts in place
+    int runs = 0;
+    for (int b = 0; b < blocks; b++) {
+        int slot = runSlot(&detection, b);
+        for (int r = 0; r < detection.counts[b]; r++) {
+            int entry = starts[slot + r], start = RUN_START(entry);
+            int joins = runs > 0 && (starts[runs - 1] < 0) == (entry < 0) &&
+                        (entry < 0 ? data[start - 1] > data[start] : data[start - 1] <= data[start]);
+            if (!joins) starts[runs++] = entry;
+        }
+    }
+    starts[runs] = n;
+
+    long swaps = 0;
+    for (int r = 0; r < runs; r++) {
+        powers[r] = (int)swaps;
+        if (starts[r] < 0) swaps += (RUN_START(starts[r + 1]) - RUN_START(starts[r])) / 2;
+    }
+    if (swaps > 0) {
+        ReversePass reverse = { data, starts, powers, runs, swaps, blocks };
+        forEachBlock(context, reverseBlock, &reverse, blocks);
+        // A reversed run may now continue into its neighbours
+        int kept = 0;
+        for (int r = 0; r < runs; r++) {
+            int start = RUN_START(starts[r]);
+            if (kept == 0 || data[start - 1] > data[start]) starts[kept++] = start;
+        }
+        runs = kept;
+        starts[runs] = n;
+    }
+    if (runs == 1) return PCM_OK;
+
+    for (int r = 0; r + 1 < runs; r++) {
+        powers[r] = nodePower(n, starts[r], starts[r + 1], starts[r + 2]);
+    }
+
+    NaturalSort sort = { data, context->scratch, context->runtime, context->threads, starts, powers };
+    if (context->runtime == RUNTIME_WS) {
+        RunRange root = { &sort, 0, runs - 1 };
+        wsRun(context->pool, naturalMergeTask, &root);
+    } else {
+        #pragma omp parallel num_threads(context->threads)
+        {
+            #pragma omp single
+            {
+                naturalMerge(&sort, 0, runs - 1);
+            }
+        }
+    }
+    return PCM_OK;
+}
+
+static void heapSort(int *data, int size) {
+    for (int i = size / 2 - 1; i >= 0; i--) {
+        siftDown(data, size, i);
+    }
+    for (int end = size - 1; end > 0; end--) {
+        swap(&data[0], &data[end]);
+        siftDown(data, end, 0);
+    }
+}
+
+// Introsort on one thread: recursing into the smaller side and looping on the
+// larger keeps the stack O(log n), and ranges that median-of-three keeps
+// splitting badly (reversed or organ-pipe input) finish by heap sort
+static void introSort(int *data, int low, int high, int depth) {
+    while (high - low >= SELECT_INSERTION_CUTOFF) {
+        if (depth-- == 0) {
+            heapSort(data + low, high - low + 1);
+            return;
+        }
+        int pi = pcmPartition(data, low, high);
+        if (pi - low < high - pi) {
+            introSort(data, low, pi - 1, depth);
+            low = pi + 1;
+        } else {
+            introSort(data, pi + 1, high, depth);
+            high = pi - 1;
+        }
+    }
+    insertionSort(data, low, high);
+}
+
+static void serialSort(int *data, int low, int high) {
+    introSort(data, low, high, 2 * floorLog2(high - low + 1));
+}
+
+// Copies source to target block by block
+typedef struct {
+    int *target;
+    const int *source;
+    int n;
+    int blocks;
+} CopyPass;
+
+static void copyBlock(void *arg, int b) {
+    CopyPass *copy = arg;
+    int start = blockStart(0, copy->n, copy->blocks, b);
+    int end = blockStart(0, copy->n, copy->blocks, b + 1);
+    memcpy(copy->target + start, copy->source + start, (size_t)(end - start) * sizeof(int));
+}
+
+// OR of key ^ data[0] over every block: the bits on which some key differs
+typedef struct {
+    const int *data;
+    int n;
+    int blocks;
+    unsigned int *varying;
+} VaryingPass;
+
+static void varyingBlock(void *arg, int b) {
+    VaryingPass *pass = arg;
+    int start = blockStart(0, pass->n, pass->blocks, b);
+    int end = blockStart(0, pass->n, pass->blocks, b + 1);
+    unsigned int first = (unsigned int)pass->data[0], varying = 0;
+    for (int i = start; i < end; i++) {
+        varying |= (unsigned int)pass->data[i] ^ first;
+    }
+    pass->varying[b] = varying;
+}
+
+// One LSD pass: count the digits per block, turn the counts into output
+// offsets digit by digit, then scatter; blocks keep their order, so the
+// pass is stable
+typedef struct {
+    const int *source;
+    int *target;
+    int n;
+    int blocks;
+    int shift;
+    int radix;
+    int *counts;        // radix per block
+} RadixPass;
+
+// Digits of the key with its sign bit flipped, so negative keys sort first
+static unsigned int radixDigit(int key, int shift, int radix) {
+    return (((unsigned int)key ^ 0x80000000u) >> shift) & (unsigned int)(radix - 1);
+}
+
+static void radixCount(void *arg, int b) {
+    RadixPass *pass = arg;
+    int start = blockStart(0, pass->n, pass->blocks, b);
+    int end = blockStart(0, pass->n, pass->blocks, b + 1);
+    int *counts = pass->counts + (size_t)b * pass->radix;
+    memset(counts, 0, (size_t)pass->radix * sizeof(int));
+    for (int i = start; i < end; i++) {
+        counts[radixDigit(pass->source[i], pass->shift, pass->radix)]++;
+    }
+}
+
+static void radixScatter(void *arg, int b) {
+    RadixPass *pass = arg;
+    int start = blockStart(0, pass->n, pass->blocks, b);
+    int end = blockStart(0, pass->n, pass->blocks, b + 1);
+    int *offsets = pass->counts + (size_t)b * pass->radix;
+    for (int i = start; i < end; i++) {
+        int key = pass->source[i];
+        pass->target[offsets[radixDigit(key, pass->shift, pass->radix)]++] = key;
+    }
+}
+
+static int radixSortBits(PcmContext *context, int *data, int n, int bits) {
+    if (!checkArray(data, n) || bits < 1 || bits > RADIX_MAX_BITS) return PCM_ERROR_ARGUMENT;
+    if (n < 2) return PCM_OK;
+    int status = pcmReserve(context, n);
+    if (status != PCM_OK) return status;
+
+    int blocks = context->threads * TASKS_PER_WORKER;
+    if (blocks > n) blocks = n;
+    VaryingPass varying = { data, n, blocks, (unsigned int *)context->block_counts };
+    forEachBlock(context, varyingBlock, &varying, blocks);
+    unsigned int differs = 0;
+    for (int b = 0; b < blocks; b++) {
+        differs |= varying.varying[b];
+    }
+
+    int radix = 1 << bits;
+    RadixPass pass = { data, context->scratch, n, blocks, 0, radix, context->digit_counts };
+    for (int shift = 0; shift < 32; shift += bits) {
+        // A digit all keys share leaves the order as it is
+        if (((differs >> shift) & (unsigned int)(radix - 1)) == 0) continue;
+        pass.shift = shift;
+        forEachBlock(context, radixCount, &pass, blocks);
+        int offset = 0;
+        for (int d = 0; d < radix; d++) {
+            for (int b = 0; b < blocks; b++) {
+                int count = pass.counts[(size_t)b * radix + d];
+                pass.counts[(size_t)b * radix + d] = offset;
+                offset += count;
+            }
+        }
+        forEachBlock(context, radixScatter, &pass, blocks);
+        int *sorted = pass.target;
+        pass.target = (int *)pass.source;
+        pass.source = sorted;
+    }
+    if (pass.source != data) {
+        CopyPass copy = { data, pass.source, n, blocks };
+        forEachBlock(context, copyBlock, &copy, blocks);
+    }
+    return PCM_OK;
+}
+
+int pcmRadixSort(PcmContext *context, int *data, int n) {
+    beginCall(context);
+    return radixSortBits(context, data, n, 8);
+}
+
+// Keys are classed into buckets between buckets - 1 splitters, counted per
+// block, scattered to the scratch buffer bucket by bucket, and every bucket
+// is then sorted on one thread and copied back
+typedef struct {
+    int *data;
+    int *scratch;
+    int n;
+    int blocks;
+    int buckets;
+    const int *splitters;
+    int top_step;       // the largest power of two < buckets
+    int *counts;        // buckets per block; become the output offsets
+    const int *starts;  // buckets + 1 bucket starts in the scratch buffer
+} SamplePass;
+
+// Branch-free search for the number of splitters <= key
+static int sampleBucket(const SamplePass *pass, int key) {
+    int position = 0;
+    for (int step = pass->top_step; step > 0; step >>= 1) {
+        int next = position + step;
+        position = next < pass->buckets && pass->splitters[next - 1] <= key ? next : position;
+    }
+    return position;
+}
+
+static void sampleCount(void *arg, int b) {
+    SamplePass *pass = arg;
+    int start = blockStart(0, pass->n, pass->blocks, b);
+    int end = blockStart(0, pass->n, pass->blocks, b + 1);
+    int *counts = pass->counts + (size_t)b * pass->buckets;
+    memset(counts, 0, (size_t)pass->buckets * sizeof(int));
+    for (int i = start; i < end; i++) {
+        counts[sampleBucket(pass, pass->data[i])]++;
+    }
+}
+
+static void sampleScatter(void *arg, int b) {
+    SamplePass *pass = arg;
+    int start = blockStart(0, pass->n, pass->blocks, b);
+    int end = blockStart(0, pass->n, pass->blocks, b + 1);
+    int *offsets = pass->counts + (size_t)b * pass->buckets;
+    for (int i = start; i < end; i++) {
+        int key = pass->data[i];
+        pass->scratch[offsets[sampleBucket(pass, key)]++] = key;
+    }
+}
+
+static void sortBucket(void *arg, int k) {
+    SamplePass *pass = arg;
+    int start = pass->starts[k], end = pass->starts[k + 1];
+    serialSort(pass->scratch, start, end - 1);
+    memcpy(pass->data + start, pass->scratch + start, (size_t)(end - start) * sizeof(int));
+}
+
+// 16 buckets per thread, so stealing and static scheduling both even out
+static int sampleBuckets(int threads) {
+    int buckets = threads * 16;
+    return buckets < 16 ? 16 : (buckets > SAMPLE_SORT_MAX_BUCKETS ? SAMPLE_SORT_MAX_BUCKETS : buckets);
+}
+
+static int sampleSort(PcmContext *context, int *data, int n, int buckets) {
+    if (!checkArray(data, n) || buckets < 2 || buckets > SAMPLE_SORT_MAX_BUCKETS) return PCM_ERROR_ARGUMENT;
+    if (n <= SAMPLE_SORT_SERIAL_CUTOFF) {
+        serialSort(data, 0, n - 1);
+        return PCM_OK;
+    }
+    int status = pcmReserve(context, n);
+    if (status != PCM_OK) return status;
+
+    // The sample is drawn from a fixed seed, so a run is repeatable
+    int *sample = context->sort_sample;
+    int samples = buckets * SAMPLE_OVERSAMPLING;
+    uint64_t state = 0x9E3779B97F4A7C15ULL ^ (uint64_t)n;
+    for (int i = 0; i < samples; i++) {
+        sample[i] = data[nextRandom(&state) % (uint64_t)n];
+    }
+    qsort(sample, samples, sizeof(int), compareInts);
+    int *splitters = context->splitters;
+    int *starts = context->splitters + SAMPLE_SORT_MAX_BUCKETS;
+    for (int j = 0; j + 1 < buckets; j++) {
+        splitters[j] = sample[(j + 1) * SAMPLE_OVERSAMPLING];
+    }
+
+    int blocks = context->threads * TASKS_PER_WORKER;
+    if (blocks > n) blocks = n;
+    int top_step = 1;
+    while (2 * top_step < buckets) top_step *= 2;
+    SamplePass pass = { data, context->scratch, n, blocks, buckets, splitters, top_step,
+                        context->digit_counts, starts };
+    forEachBlock(context, sampleCount, &pass, blocks);
+    int offset = 0;
+    for (int k = 0; k < buckets; k++) {
+        starts[k] = offset;
+        for (int b = 0; b < blocks; b++) {
+            int count = pass.counts[(size_t)b * buckets + k];
+            pass.counts[(size_t)b * buckets + k] = offset;
+            offset += count;
+        }
+    }
+    starts[buckets] = n;
+    forEachBlock(context, sampleScatter, &pass, blocks);
+    forEachBlock(context, sortBucket, &pass, buckets);
+    return PCM_OK;
+}
+
+int pcmSampleSort(PcmContext *context, int *data, int n) {
+    beginCall(context);
+    return sampleSort(context, data, n, sampleBuckets(context->threads));
+}
+
+const char* pcmSortEngineName(PcmSortEngine engine) {
+    switch (engine) {
+        case PCM_SORT_QUICK: return "quick";
+        case PCM_SORT_MERGE: return "merge";
+        case PCM_SORT_RADIX: return "radix";
+        case PCM_SORT_SAMPLE: return "sample";
+        case PCM_SORT_ADAPTIVE: return "adaptive";
+        default: return "unknown";
+    }
+}
+
+// Medians of three pcmCalibrateSortCosts runs on a 1-socket x86-64 machine
+// with libpcm at -O2; a single processor cannot time fork/join, so that
+// cost is the one measured on four threads
+void pcmDefaultSortCosts(PcmSortCosts *costs) {
+    costs->ns[PCM_SORT_QUICK] = 5.6;
+    costs->ns[PCM_SORT_MERGE] = 6.7;
+    costs->ns[PCM_SORT_RADIX] = 5.6;
+    costs->ns[PCM_SORT_SAMPLE] = 4.3;
+    costs->ns[PCM_SORT_ADAPTIVE] = 7.1;
+    costs->radix_wide_ns = 6.4;
+    costs->fork_join_us = 0.5;
+}
+
+// log2 of x, interpolated linearly between powers of two
+static double log2Of(double x) {
+    int log = 0;
+    while (x >= 2) {
+        x /= 2;
+        log++;
+    }
+    return x < 1 ? 0 : log + (x - 1);
+}
+
+// Units of work the costs are quoted in, for n keys
+static double comparisonWork(double n) {
+    return n * (log2Of(n) > 1 ? log2Of(n) : 1);
+}
+
+// The pass finding the varying bits counts as a quarter of a digit pass
+static double radixWork(double n, int passes) {
+    return n * (passes + 0.25);
+}
+
+// Finding the runs, then one level of merges per halving of the run count
+static double adaptiveWork(double n, double runs) {
+    return n * (1 + log2Of(runs));
+}
+
+static int radixPasses(unsigned int varying_bits, int bits) {
+    int passes = 0;
+    for (int shift = 0; shift < 32; shift += bits) {
+        passes += ((varying_bits >> shift) & ((1u << bits) - 1)) != 0;
+    }
+    return passes;
+}
+
+// The sample: windows of PROFILE_WINDOW consecutive keys spread evenly over
+// the input, so local order survives sampling; every block profiles a share
+// of the windows
+#define PROFILE_STATS 4     // ascending pairs, descending pairs, run starts, varying bits
+typedef struct {
+    const int *data;
+    int n;
+    int windows;
+    int length;         // keys per window
+    int blocks;
+    int *sample;
+    int *stats;
+} ProfilePass;
+
+static void profileBlock(void *arg, int b) {
+    ProfilePass *pass = arg;
+    const int *data = pass->data;
+    int ascending = 0, descending = 0, run_starts = 0;
+    unsigned int first = (unsigned int)data[0], varying = 0;
+    int end_window = blockStart(0, pass->windows, pass->blocks, b + 1);
+    for (int w = blockStart(0, pass->windows, pass->blocks, b); w < end_window; w++) {
+        int start = pass->windows == 1 ? 0 : (int)((long)(pass->n - pass->length) * w / (pass->windows - 1));
+        int end = start + pass->length;
+        memcpy(pass->sample + (size_t)w * pass->length, data + start, (size_t)pass->length * sizeof(int));
+        for (int i = start; i < end; i++) {
+            varying |= (unsigned int)data[i] ^ first;
+        }
+        for (int i = start; i + 1 < end; i++) {
+            ascending += data[i] <= data[i + 1];
+            descending += data[i] > data[i + 1];
+        }
+        // Runs as pcmNaturalMergeSort finds them: non-descending or strictly descending
+        int i = start;
+        while (i + 1 < end) {
+            if (data[i] <= data[i + 1]) {
+                while (i + 1 < end && data[i] <= data[i + 1]) i++;
+            } else {
+                while (i + 1 < end && data[i] > data[i + 1]) i++;
+            }
+            i++;
+            run_starts += i < end;
+        }
+    }
+    int *stats = pass->stats + (size_t)b * PROFILE_STATS;
+    stats[0] = ascending;
+    stats[1] = descending;
+    stats[2] = run_starts;
+    stats[3] = (int)varying;
+}
+
+int pcmProfileSort(PcmContext *context, const int *data, int n, PcmSortProfile *profile) {
+    beginCall(context);
+    if (!checkArray(data, n) || profile == NULL) return PCM_ERROR_ARGUMENT;
+    memset(profile, 0, sizeof(*profile));
+    profile->n = n;
+    profile->runs = 1;
+    if (n == 0) return PCM_OK;
+
+    int length = n < PROFILE_WINDOW ? n : PROFILE_WINDOW;
+    int windows = n / PROFILE_WINDOW;
+    if (windows > SORT_SAMPLE_CAPACITY / PROFILE_WINDOW) windows = SORT_SAMPLE_CAPACITY / PROFILE_WINDOW;
+    if (windows < 1) windows = 1;
+    int blocks = context->threads * TASKS_PER_WORKER;
+    if (blocks > windows) blocks = windows;
+    ProfilePass pass = { data, n, windows, length, blocks, context->sort_sample, context->digit_counts };
+    forEachBlock(context, profileBlock, &pass, blocks);
+
+    long ascending = 0, descending = 0, run_starts = 0;
+    unsigned int varying = 0;
+    for (int b = 0; b < blocks; b++) {
+        ascending += pass.stats[b * PROFILE_STATS];
+        descending += pass.stats[b * PROFILE_STATS + 1];
+        run_starts += pass.stats[b * PROFILE_STATS + 2];
+        varying |= (unsigned int)pass.stats[b * PROFILE_STATS + 3];
+    }
+    int sampled = windows * length;
+    qsort(pass.sample, sampled, sizeof(int), compareInts);
+    int distinct = 1;
+    for (int i = 1; i < sampled; i++) {
+        distinct += pass.sample[i] != pass.sample[i - 1];
+    }
+
+    long pairs = (long)windows * (length - 1);
+    profile->sampled = sampled;
+    profile->ascending = pairs > 0 ? (double)ascending / pairs : 1;
+    profile->descending = pairs > 0 ? (double)descending / pairs : 0;
+    profile->distinct = (double)distinct / sampled;
+    profile->varying_bits = varying;
+    // Runs shorter than NATURAL_MIN_RUN get extended, which caps the count
+    double runs = pairs > 0 ? 1 + (double)run_starts / pairs * (n - 1) : 1;
+    double most_runs = n / NATURAL_MIN_RUN + 1;
+    profile->runs = (long)(runs < most_runs ? runs : most_runs);
+    return PCM_OK;
+}
+
+// Predicted seconds for one engine on `threads` threads; radix sort also
+// reports the digit width it was predicted with
+static double predictSort(PcmSortEngine engine, const PcmSortCosts *costs, const PcmSortProfile *profile,
+                          RuntimeKind runtime, int threads, int *radix_bits) {
+    double n = profile->n;
+    int procs = omp_get_num_procs();
+    // Threads beyond the processors only add fork/join cost
+    double p = threads < procs ? threads : procs;
+    double fork_join = costs->fork_join_us * 1e-6 * threads;
+    double ns = costs->ns[engine] * 1e-9;
+    switch (engine) {
+        case PCM_SORT_QUICK: {
+            // The depth budget hands badly split ranges to heap sort, so the
+            // key order does not matter; the top partitions run on fewer
+            // threads than there are, about 2n serial steps
+            return ns * comparisonWork(n) / p + (p > 1 ? ns * 2 * n * (1 - 1 / p) : 0) + fork_join;
+        }
+        case PCM_SORT_MERGE: {
+            // The halves are tasks on both runtimes; the last merge is serial
+            return ns * (comparisonWork(n) - n) / p + ns * n + fork_join;
+        }
+        case PCM_SORT_RADIX: {
+            double best = 0;
+            int bits[2] = { 8, RADIX_MAX_BITS };
+            double bit_ns[2] = { ns, costs->radix_wide_ns * 1e-9 };
+            for (int i = 0; i < 2; i++) {
+                int passes = radixPasses(profile->varying_bits, bits[i]);
+                // Every pass turns threads * TASKS_PER_WORKER rows of counts into offsets
+                double prefix = 1e-9 * (double)threads * TASKS_PER_WORKER * (1 << bits[i]) * passes;
+                double time = bit_ns[i] * radixWork(n, passes) / p + prefix + fork_join * (2 * passes + 1);
+                if (i == 0 || time < best) {
+                    best = time;
+                    *radix_bits = bits[i];
+                }
+            }
+            return best;
+        }
+        case PCM_SORT_SAMPLE: {
+            if (profile->n <= SAMPLE_SORT_SERIAL_CUTOFF) return ns * comparisonWork(n);
+            // A key lands in one bucket however many copies it has, so few
+            // distinct keys leave the buckets, and the threads, idle
+            double keys = profile->distinct < 0.5 ? profile->distinct * profile->sampled : profile->distinct * n;
+            double split = p < keys ? p : (keys > 1 ? keys : 1);
+            return ns * comparisonWork(n) / split + fork_join * 3;
+        }
+        case PCM_SORT_ADAPTIVE:
+            return ns * adaptiveWork(n, profile->runs) / p + fork_join * 2;
+        default:
+            return 0;
+    }
+}
+
+int pcmPlanSort(PcmContext *context, const int *data, int n, const PcmSortCosts *costs, PcmSortPlan *plan) {
+    beginCall(context);
+    if (plan == NULL) return PCM_ERROR_ARGUMENT;
+    PcmSortCosts defaults;
+    if (costs == NULL) {
+        pcmDefaultSortCosts(&defaults);
+        costs = &defaults;
+    }
+    memset(plan, 0, sizeof(*plan));
+    int status = pcmProfileSort(context, data, n, &plan->profile);
+    if (status != PCM_OK) return status;
+
+    // The work-stealing pool always runs on all of its workers; OpenMP can
+    // take any power of two up to the context's threads, or all of them
+    int candidates[32], count = 0;
+    if (context->runtime == RUNTIME_OMP) {
+        for (int threads = 1; threads < context->threads; threads *= 2) candidates[count++] = threads;
+    }
+    candidates[count++] = context->threads;
+
+    plan->radix_bits = 8;
+    for (int e = 0; e < PCM_SORT_ENGINES; e++) {
+        for (int c = 0; c < count; c++) {
+            int bits = 8;
+            double time = predictSort(e, costs, &plan->profile, context->runtime, candidates[c], &bits);
+            if (c == 0 || time < plan->predicted[e]) {
+                plan->predicted[e] = time;
+                plan->engine_threads[e] = candidates[c];
+                if (e == PCM_SORT_RADIX) plan->radix_bits = bits;
+            }
+        }
+        if (plan->predicted[e] < plan->predicted[plan->engine]) plan->engine = e;
+    }
+    plan->threads = plan->engine_threads[plan->engine];
+    plan->sample_buckets = sampleBuckets(plan->engine_threads[PCM_SORT_SAMPLE]);
+    return PCM_OK;
+}
+
+int pcmSortWithPlan(PcmContext *context, int *data, int n, const PcmSortPlan *plan) {
+    beginCall(context);
+    if (!checkArray(data, n) || plan == NULL || plan->engine < 0 || plan->engine >= PCM_SORT_ENGINES) {
+        return PCM_ERROR_ARGUMENT;
+    }
+    // Reserved for all of the context's threads first: the run list is sized by them
+    int status = pcmReserve(context, n);
+    if (status != PCM_OK) return status;
+
+    int threads = context->threads;
+    if (context->runtime == RUNTIME_OMP && plan->threads >= 1 && plan->threads < threads) {
+        context->threads = plan->threads;
+    }
+    switch (plan->engine) {
+        case PCM_SORT_QUICK: status = pcmQuickSort(context, data, n); break;
+        case PCM_SORT_MERGE: status = pcmMergeSort(context, data, n); break;
+        case PCM_SORT_RADIX: status = radixSortBits(context, data, n, plan->radix_bits); break;
+        case PCM_SORT_SAMPLE: status = sampleSort(context, data, n, plan->sample_buckets); break;
+        default: status = pcmNaturalMergeSort(context, data, n); break;
+    }
+    context->threads = threads;
+    return status;
+}
+
+int pcmSortAuto(PcmContext *context, int *data, int n, const PcmSortCosts *costs, PcmSortPlan *plan) {
+    beginCall(context);
+    PcmSortPlan local;
+    if (plan == NULL) plan = &local;
+    // The plan and the sort are one call to pcmReportRuntime
+    context->in_call = 1;
+    int status = pcmPlanSort(context, data, n, costs, plan);
+    if (status == PCM_OK) status = pcmSortWithPlan(context, data, n, plan);
+    context->in_call = 0;
+    return status;
+}
+
+void pcmReportSortPlan(const PcmSortPlan *plan, FILE *out) {
+    const PcmSortProfile *profile = &plan->profile;
+    fprintf(out, "Sort plan for %d keys, %d sampled: %.1f%% ascending pairs, %.1f%% descending, "
+            "%.1f%% distinct, varying bits 0x%08x, about %ld runs\n", profile->n, profile->sampled,
+            100 * profile->ascending, 100 * profile->descending, 100 * profile->distinct,
+            profile->varying_bits, profile->runs);
+    for (int e = 0; e < PCM_SORT_ENGINES; e++) {
+        fprintf(out, "  %-8s %3d threads, predicted %f seconds", pcmSortEngineName(e),
+                plan->engine_threads[e], plan->predicted[e]);
+        if (e == PCM_SORT_RADIX) fprintf(out, " (%d-bit digits)", plan->radix_bits);
+        if (e == PCM_SORT_SAMPLE) fprintf(out, " (%d buckets)", plan->sample_buckets);
+        fprintf(out, "%s\n", e == (int)plan->engine ? "  <- chosen" : "");
+    }
+}
+
+int pcmCalibrateSortCosts(PcmSortCosts *costs) {
+    // Radix sort is timed on more keys: its cost per key grows once the
+    // scatter targets no longer fit the caches, the comparison sorts' barely
+    const int n = 1 << 18, radix_n = 1 << 21;
+    const int repeats = 3;
+    PcmOptions options = { 1, RUNTIME_OMP };
+    PcmContext *context = pcmContextCreate(&options);
+    int *keys = malloc((size_t)radix_n * sizeof(int));
+    int *work = malloc((size_t)radix_n * sizeof(int));
+    int status = context == NULL || keys == NULL || work == NULL ? PCM_ERROR_ALLOCATION : pcmReserve(context, radix_n);
+    if (status != PCM_OK) {
+        pcmContextDestroy(context);
+        free(keys);
+        free(work);
+        return status;
+    }
+
+    uint64_t state = 0x5EEDULL;
+    for (int i = 0; i < radix_n; i++) {
+        keys[i] = (int)(nextRandom(&state) >> 32);
+    }
+    // Random keys: every digit varies and the runs are extended to NATURAL_MIN_RUN
+    double work_units[PCM_SORT_ENGINES + 1] = {
+        comparisonWork(n), comparisonWork(n), radixWork(radix_n, radixPasses(UINT_MAX, 8)), comparisonWork(n),
+        adaptiveWork(n, n / NATURAL_MIN_RUN), radixWork(radix_n, radixPasses(UINT_MAX, RADIX_MAX_BITS))
+    };
+    PcmSortPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    plan.threads = 1;
+    plan.sample_buckets = sampleBuckets(1);
+    // The last round is radix sort on wide digits
+    for (int e = 0; e <= PCM_SORT_ENGINES; e++) {
+        plan.engine = e < PCM_SORT_ENGINES ? e : PCM_SORT_RADIX;
+        plan.radix_bits = e < PCM_SORT_ENGINES ? 8 : RADIX_MAX_BITS;
+        int keys_sorted = plan.engine == PCM_SORT_RADIX ? radix_n : n;
+        double best = 0;
+        for (int r = 0; r < repeats; r++) {
+            memcpy(work, keys, (size_t)keys_sorted * sizeof(int));
+            double start = omp_get_wtime();
+            pcmSortWithPlan(context, work, keys_sorted, &plan);
+            double time = omp_get_wtime() - start;
+            if (r == 0 || time < best) best = time;
+        }
+        double ns = best * 1e9 / work_units[e];
+        if (e < PCM_SORT_ENGINES) costs->ns[e] = ns;
+        else costs->radix_wide_ns = ns;
+    }
+
+    int procs = omp_get_num_procs();
+    const int regions = 200;
+    double start = omp_get_wtime();
+    for (int r = 0; r < regions; r++) {
+        #pragma omp parallel num_threads(procs)
+        {
+        }
+    }
+    costs->fork_join_us = (omp_get_wtime() - start) * 1e6 / regions / procs;
+
+    pcmContextDestroy(context);
+    free(keys);
+    free(work);
+    return PCM_OK;
+}
+
+// Search data[start..end] until this slice or another one finds the target
+static void binarySearchSlice(const int *data, int start, int end, int target, int *result) {
+    while (start <= end && __atomic_load_n(result, __ATOMIC_RELAXED) == -1) {
+        int mid = start + (end - start) / 2;
+        if (data[mid] == target) {
+            __atomic_store_n(result, mid, __ATOMIC_RELAXED);
+        } else if (data[mid] < target) {
+            start = mid + 1;
+        } else {
+            end = mid - 1;
+        }
+    }
+}
+
+static void ternarySearchSlice(const int *data, int start, int end, int target, int *result) {
+    while (start <= end && __atomic_load_n(result, __ATOMIC_RELAXED) == -1) {
+        int mid1 = start + (end - start) / 3;
+        int mid2 = end - (end - start) / 3;
+
+        if (data[mid1] == target) {
+            __atomic_store_n(result, mid1, __ATOMIC_RELAXED);
+        } else if (data[mid2] == target) {
+            __atomic_store_n(result, mid2, __ATOMIC_RELAXED);
+        } else if (target < data[mid1]) {
+            end = mid1 - 1;
+        } else if (target > data[mid2]) {
+            start = mid2 + 1;
+        } else {
+            start = mid1 + 1;
+            end = mid2 - 1;
+        }
+    }
+}
+
+typedef void (*SearchSlice)(const int *data, int start, int end, int target, int *result);
+
+// Slices first..last of `slices` equal slices; the last slice also takes the remainder
+typedef struct {
+    SearchSlice search;
+    const int *data;
+    int n;
+    int target;
+    int slices;
+    int first;
+    int last;
+    int *result;
+} SearchRange;
+
+static void searchTask(void *arg) {
+    SearchRange *range = arg;
+    if (range->first == range->last) {
+        int size = range->n / range->slices;
+        int start = range->first * size;
+        int end = range->first == range->slices - 1 ? range->n - 1 : start + size - 1;
+        range->search(range->data, start, end, range->target, range->result);
+        return;
+    }
+    int middle = range->first + (range->last - range->first) / 2;
+    SearchRange lower = *range, upper = *range;
+    lower.last = middle;
+    upper.first = middle + 1;
+    WsTask task;
+    wsSpawn(&task, searchTask, &lower);
+    searchTask(&upper);
+    wsJoin(&task);
+}
+
+static int parallelSearch(PcmContext *context, SearchSlice search, const int *data, int n, int target, int *index) {
+    if (!checkArray(data, n) || index == NULL) return PCM_ERROR_ARGUMENT;
+    int result = -1;
+    if (n == 0) {
+        *index = result;
+        return PCM_OK;
+    }
+
+    if (context->runtime == RUNTIME_WS) {
+        SearchRange root = { search, data, n, target, context->threads, 0, context->threads - 1, &result };
+        wsRun(context->pool, searchTask, &root);
+    } else {
+        #pragma omp parallel num_threads(context->threads)
+        {
+            // Every thread derives its own slice; the last one also takes the remainder
+            int num_threads = omp_get_num_threads();
+            int thread_start = omp_get_thread_num() * (n / num_threads);
+            int thread_end = thread_start + (n / num_threads) - 1;
+            if (omp_get_thread_num() == num_threads - 1) {
+                thread_end = n - 1;
+            }
+            search(data, thread_start, thread_end, target, &result);
+        }
+    }
+    *index = result;
+    return PCM_OK;
+}
+
+int pcmBinarySearch(PcmContext *context, const int *data, int n, int target, int *index) {
+    beginCall(context);
+    return parallelSearch(context, binarySearchSlice, data, n, target, index);
+}
+
+int pcmTernarySearch(PcmContext *context, const int *data, int n, int target, int *index) {
+    beginCall(context);
+    return parallelSearch(context, ternarySearchSlice, data, n, target, index);
+}
+
+static void multiplyRows(const int *A, const int *B, int *C, int n, int first, int last) {
+    for (int i = first; i < last; i++) {
+        for (int j = 0; j < n; j++) {
+            C[(size_t)i * n + j] = 0;
+            for (int k = 0; k < n; k++) {
+                C[(size_t)i * n + j] += A[(size_t)i * n + k] * B[(size_t)k * n + j];
+            }
+        }
+    }
+}
+
+typedef struct {
+    const int *A;
+    const int *B;
+    int *C;
+    int n;
+    int first;
+    int last;
+    int grain;
+} MultiplyRange;
+
+static void multiplyTask(void *arg) {
+    MultiplyRange *range = arg;
+    if (range->last - range->first <= range->grain) {
+        multiplyRows(range->A, range->B, range->C, range->n, range->first, range->last);
+        return;
+    }
+    int middle = range->first + (range->last - range->first) / 2;
+    MultiplyRange lower = *range, upper = *range;
+    lower.last = middle;
+    upper.first = middle;
+    WsTask task;
+    wsSpawn(&task, multiplyTask, &lower);
+    multiplyTask(&upper);
+    wsJoin(&task);
+}
+
+int pcmMultiply(PcmContext *context, const int *A, const int *B, int *C, int n) {
+    beginCall(context);
+    if (n < 0 || (n > 0 && (A == NULL || B == NULL || C == NULL))) return PCM_ERROR_ARGUMENT;
+
+    if (context->runtime == RUNTIME_WS) {
+        int grain = n / (context->threads * TASKS_PER_WORKER);
+        MultiplyRange root = { A, B, C, n, 0, n, grain > 0 ? grain : 1 };
+        wsRun(context->pool, multiplyTask, &root);
+    } else {
+        #pragma omp parallel for collapse(2) num_threads(context->threads)
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                C[(size_t)i * n + j] = 0;
+                for (int k = 0; k < n; k++) {
+                    C[(size_t)i * n + j] += A[(size_t)i * n + k] * B[(size_t)k * n + j];
+                }
+            }
+        }
+    }
+    return PCM_OK;
+}
+
+const char* pcmPrecisionName(PcmPrecision precision) {
+    switch (precision) {
+        case PCM_PRECISION_INT32: return "int32";
+        case PCM_PRECISION_INT16: return "int16";
+        case PCM_PRECISION_INT8: return "int8";
+        default: return "unknown";
+    }
+}
+
+const char* pcmIsaName(PcmIsa isa) {
+    switch (isa) {
+        case PCM_ISA_SCALAR: return "scalar";
+        case PCM_ISA_AVX2: return "avx2";
+        case PCM_ISA_AVX_VNNI: return "avx-vnni";
+        case PCM_ISA_AVX512_VNNI: return "avx512-vnni";
+        default: return "unknown";
+    }
+}
+
+PcmIsa pcmBestIsa(void) {
+    return quantizedBestIsa();
+}
+
+int pcmIsaSupported(PcmIsa isa) {
+    return quantizedIsaSupported(isa);
+}
+
+// Smallest and largest key of A and of B, per block of rows
+typedef struct {
+    const int *A;
+    const int *B;
+    int n;
+    int blocks;
+    int *ranges;    // min A, max A, min B, max B per block
+} RangePass;
+
+static void rangeBlock(void *arg, int b) {
+    RangePass *pass = arg;
+    size_t start = (size_t)blockStart(0, pass->n, pass->blocks, b) * pass->n;
+    size_t end = (size_t)blockStart(0, pass->n, pass->blocks, b + 1) * pass->n;
+    int min_a = INT_MAX, max_a = INT_MIN, min_b = INT_MAX, max_b = INT_MIN;
+    for (size_t i = start; i < end; i++) {
+        min_a = pass->A[i] < min_a ? pass->A[i] : min_a;
+        max_a = pass->A[i] > max_a ? pass->A[i] : max_a;
+        min_b = pass->B[i] < min_b ? pass->B[i] : min_b;
+        max_b = pass->B[i] > max_b ? pass->B[i] : max_b;
+    }
+    int *range = pass->ranges + 4 * b;
+    range[0] = min_a;
+    range[1] = max_a;
+    range[2] = min_b;
+    range[3] = max_b;
+}
+
+static int fitsPrecision(const int *range, PcmPrecision precision, PcmIsa isa) {
+    if (precision == PCM_PRECISION_INT8) {
+        if (range[0] < 0 || range[1] > UINT8_MAX || range[2] < INT8_MIN || range[3] > INT8_MAX) return 0;
+        // pmaddubsw saturates the sum of two neighbouring products to int16
+        int largest_b = -range[2] > range[3] ? -range[2] : range[3];
+        return isa != PCM_ISA_AVX2 || 2 * range[1] * largest_b <= INT16_MAX;
+    }
+    if (precision == PCM_PRECISION_INT16) {
+        return range[0] >= INT16_MIN && range[1] <= INT16_MAX && range[2] >= INT16_MIN && range[3] <= INT16_MAX;
+    }
+    return 1;
+}
+
+static void keyRange(PcmContext *context, const int *A, const int *B, int n, int *range) {
+    int blocks = context->threads * TASKS_PER_WORKER;
+    if (blocks > n) blocks = n;
+    RangePass pass = { A, B, n, blocks, context->digit_counts };
+    forEachBlock(context, rangeBlock, &pass, blocks);
+    range[0] = range[2] = INT_MAX;
+    range[1] = range[3] = INT_MIN;
+    for (int b = 0; b < blocks; b++) {
+        for (int side = 0; side < 4; side += 2) {
+            int low = pass.ranges[4 * b + side], high = pass.ranges[4 * b + side + 1];
+            range[side] = low < range[side] ? low : range[side];
+            range[side + 1] = high > range[side + 1] ? high : range[side + 1];
+        }
+    }
+}
+
+PcmPrecision pcmNarrowestPrecision(PcmContext *context, const int *A, const int *B, int n, PcmIsa isa) {
+    beginCall(context);
+    if (n <= 0 || A == NULL || B == NULL || !quantizedIsaSupported(isa)) return PCM_PRECISION_INT32;
+    int range[4];
+    keyRange(context, A, B, n, range);
+    if (fitsPrecision(range, PCM_PRECISION_INT8, isa)) return PCM_PRECISION_INT8;
+    if (fitsPrecision(range, PCM_PRECISION_INT16, isa)) return PCM_PRECISION_INT16;
+    return PCM_PRECISION_INT32;
+}
+
+// The narrow copies: A row-major with rows padded to QUANTIZED_MR and k to
+// whole groups, B in panels of QUANTIZED_NR columns (see quantized_kernels.h);
+// the padding is zeros, so it adds nothing to the sums
+typedef struct {
+    const int *A;
+    const int *B;
+    int *C;
+    int n;
+    PcmPrecision precision;
+    PcmIsa isa;
+    int group;          // k per group: 4 for int8, 2 for int16
+    int groups;
+    int row_tiles;
+    int panels;
+    int row_blocks;
+    void *a;
+    void *b;
+} QuantizedGemm;
+
+static void packRows(void *arg, int block) {
+    QuantizedGemm *gemm = arg;
+    size_t stride = (size_t)gemm->groups * gemm->group;
+    int rows = gemm->row_tiles * QUANTIZED_MR;
+    int end = blockStart(0, rows, gemm->row_blocks, block + 1);
+    for (int i = blockStart(0, rows, gemm->row_blocks, block); i < end; i++) {
+        for (size_t k = 0; k < stride; k++) {
+            int key = i < gemm->n && k < (size_t)gemm->n ? gemm->A[(size_t)i * gemm->n + k] : 0;
+            if (gemm->precision == PCM_PRECISION_INT8) ((uint8_t *)gemm->a)[i * stride + k] = (uint8_t)key;
+            else ((int16_t *)gemm->a)[i * stride + k] = (int16_t)key;
+        }
+    }
+}
+
+static void packPanel(void *arg, int p) {
+    QuantizedGemm *gemm = arg;
+    int group = gemm->group;
+    for (int g = 0; g < gemm->groups; g++) {
+        // Element index of the group's first column
+        size_t base = ((size_t)p * gemm->groups + g) * QUANTIZED_NR * group;
+        for (int c = 0; c < QUANTIZED_NR; c++) {
+            int j = p * QUANTIZED_NR + c;
+            for (int q = 0; q < group; q++) {
+                int k = g * group + q;
+                int key = j < gemm->n && k < gemm->n ? gemm->B[(size_t)k * gemm->n + j] : 0;
+                if (gemm->precision == PCM_PRECISION_INT8) ((int8_t *)gemm->b)[base + c * group + q] = (int8_t)key;
+                else ((int16_t *)gemm->b)[base + c * group + q] = (int16_t)key;
+            }
+        }
+    }
+}
+
+// Tiles go panel by panel, so neighbouring tiles share their panel of B
+static void multiplyTile(void *arg, int t) {
+    QuantizedGemm *gemm = arg;
+    int panel = t / gemm->row_tiles, first_row = (t % gemm->row_tiles) * QUANTIZED_MR;
+    size_t stride = (size_t)gemm->groups * gemm->group;
+    size_t panel_offset = (size_t)panel * gemm->groups * QUANTIZED_NR * gemm->group;
+    int32_t tile[QUANTIZED_MR * QUANTIZED_NR];
+    if (gemm->precision == PCM_PRECISION_INT8) {
+        quantizedTileInt8(gemm->isa, (const uint8_t *)gemm->a + first_row * stride, stride,
+                          (const int8_t *)gemm->b + panel_offset, gemm->groups, tile);
+    } else {
+        quantizedTileInt16(gemm->isa, (const int16_t *)gemm->a + first_row * stride, stride,
+                           (const int16_t *)gemm->b + panel_offset, gemm->groups, tile);
+    }
+    int rows = gemm->n - first_row < QUANTIZED_MR ? gemm->n - first_row : QUANTIZED_MR;
+    int first_column = panel * QUANTIZED_NR;
+    int columns = gemm->n - first_column < QUANTIZED_NR ? gemm->n - first_column : QUANTIZED_NR;
+    for (int r = 0; r < rows; r++) {
+        memcpy(gemm->C + (size_t)(first_row + r) * gemm->n + first_column, tile + r * QUANTIZED_NR,
+               (size_t)columns * sizeof(int));
+    }
+}
+
+int pcmMultiplyQuantized(PcmContext *context, const int *A, const int *B, int *C, int n,
+                         PcmPrecision precision, PcmIsa isa) {
+    beginCall(context);
+    if (n < 0 || (n > 0 && (A == NULL || B == NULL || C == NULL))) return PCM_ERROR_ARGUMENT;
+    if (precision < PCM_PRECISION_INT32 || precision > PCM_PRECISION_INT8 || !quantizedIsaSupported(isa)) {
+        return PCM_ERROR_ARGUMENT;
+    }
+    if (precision == PCM_PRECISION_INT32) return pcmMultiply(context, A, B, C, n);
+    if (n == 0) return PCM_OK;
+    int range[4];
+    keyRange(context, A, B, n, range);
+    if (!fitsPrecision(range, precision, isa)) return PCM_ERROR_ARGUMENT;
+
+    int group = precision == PCM_PRECISION_INT8 ? QUANTIZED_INT8_GROUP : QUANTIZED_INT16_GROUP;
+    int groups = (n + group - 1) / group;
+    int row_tiles = (n + QUANTIZED_MR - 1) / QUANTIZED_MR;
+    int panels = (n + QUANTIZED_NR - 1) / QUANTIZED_NR;
+    int row_blocks = context->threads * TASKS_PER_WORKER;
+    if (row_blocks > row_tiles * QUANTIZED_MR) row_blocks = row_tiles * QUANTIZED_MR;
+    // An int8 key is 1 byte and an int16 key 2, and a group always takes 4 bytes
+    size_t a_bytes = (size_t)row_tiles * QUANTIZED_MR * groups * 4;
+    size_t b_bytes = (size_t)panels * groups * QUANTIZED_GROUP_BYTES;
+    QuantizedGemm gemm = { A, B, C, n, precision, isa, group, groups, row_tiles, panels, row_blocks,
+                           malloc(a_bytes), malloc(b_bytes) };
+    if (gemm.a == NULL || gemm.b == NULL) {
+        free(gemm.a);
+        free(gemm.b);
+        return PCM_ERROR_ALLOCATION;
+    }
+    forEachBlock(context, packRows, &gemm, row_blocks);
+    forEachBlock(context, packPanel, &gemm, panels);
+    forEachBlock(context, multiplyTile, &gemm, row_tiles * panels);
+    free(gemm.a);
+    free(gemm.b);
+    return PCM_OK;
+}
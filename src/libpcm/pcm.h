@@ -0,0 +1,160 @@
+#ifndef PCM_H
+#define PCM_H
+
+#include <stdio.h>
+#include "../common/work_stealing.h"
+
+/*
+    libpcm: the sort, search and matrix multiplication kernels as a library.
+
+    A PcmContext owns a warm pool of worker threads (the OpenMP team or the
+    work-stealing pool, chosen by its runtime) and the scratch memory the
+    kernels need, so repeated calls create no threads and allocate nothing
+    once pcmReserve has sized the scratch. A context may be used by one
+    caller thread at a time; use one context per caller thread otherwise.
+    pcmMultiSelect and pcmMultiplyQuantized are the exceptions: their
+    working space depends on the ranks, the data or n, so they allocate on
+    every call.
+
+    Functions that can fail return PCM_OK or a negative PcmStatus.
+*/
+
+typedef enum {
+    PCM_OK = 0,
+    PCM_ERROR_ARGUMENT = -1,
+    PCM_ERROR_ALLOCATION = -2
+} PcmStatus;
+
+typedef struct {
+    int threads;
+    RuntimeKind runtime;
+} PcmOptions;
+
+typedef struct PcmContext PcmContext;
+
+void pcmDefaultOptions(PcmOptions *options);
+PcmContext* pcmContextCreate(const PcmOptions *options);
+void pcmContextDestroy(PcmContext *context);
+int pcmContextThreads(const PcmContext *context);
+RuntimeKind pcmContextRuntime(const PcmContext *context);
+int pcmReserve(PcmContext *context, int elements);
+// Work-stealing statistics of the most recent API call, over all of its passes
+void pcmReportRuntime(PcmContext *context, const char *label);
+// Kernel thread ids of the work-stealing workers, the calling thread first, into
+// tids of pcmContextThreads entries; returns how many, 0 for the OpenMP runtime
+int pcmRuntimeThreadIds(PcmContext *context, int *tids);
+const char* pcmStatusString(int status);
+
+// Sorting, ascending, in place
+int pcmMergeSort(PcmContext *context, int *data, int n);
+int pcmQuickSort(PcmContext *context, int *data, int n);
+// Adaptive: O(n) on sorted or reverse-sorted input, fewer merges the more presorted it is
+int pcmNaturalMergeSort(PcmContext *context, int *data, int n);
+// LSD radix sort on 8-bit digits, skipping digits on which all keys agree
+int pcmRadixSort(PcmContext *context, int *data, int n);
+// Sample sort: keys go to buckets between sampled splitters, then every bucket is sorted on its own
+int pcmSampleSort(PcmContext *context, int *data, int n);
+int pcmPartition(int *data, int low, int high);
+void pcmPartitionThreeWay(int *data, int low, int high, int pivot, int *equal_first, int *equal_last);
+
+// The sort planner samples the input, predicts every engine's time from a
+// cost table and runs the cheapest engine with the thread count and cutoffs
+// the prediction chose. The OpenMP runtime honours the planned thread count;
+// the work-stealing pool always runs on all of its workers.
+typedef enum {
+    PCM_SORT_QUICK,
+    PCM_SORT_MERGE,
+    PCM_SORT_RADIX,
+    PCM_SORT_SAMPLE,
+    PCM_SORT_ADAPTIVE,
+    PCM_SORT_ENGINES
+} PcmSortEngine;
+
+// Single-thread cost per unit of work in nanoseconds: per key and level of
+// n log2 n for quick, merge and sample sort, per key and digit pass for
+// radix sort, per key and merge level for the adaptive sort
+typedef struct {
+    double ns[PCM_SORT_ENGINES];
+    double radix_wide_ns;   // radix sort on 11-bit digits, per key and pass
+    double fork_join_us;    // per thread of one parallel phase
+} PcmSortCosts;
+
+typedef struct {
+    int n;
+    int sampled;
+    double ascending;       // fraction of sampled neighbour pairs in order (a <= b)
+    double descending;      // fraction strictly descending
+    double distinct;        // fraction of distinct keys in the sample
+    unsigned int varying_bits;  // bits on which the sampled keys differ
+    long runs;              // runs the adaptive sort is expected to merge
+} PcmSortProfile;
+
+typedef struct {
+    PcmSortEngine engine;
+    int threads;
+    int radix_bits;         // digit width when engine is radix
+    int sample_buckets;     // buckets when engine is sample
+    PcmSortProfile profile;
+    double predicted[PCM_SORT_ENGINES];     // seconds, each at its best thread count
+    int engine_threads[PCM_SORT_ENGINES];
+} PcmSortPlan;
+
+const char* pcmSortEngineName(PcmSortEngine engine);
+// Costs measured on a reference machine; calibrate for a better fit
+void pcmDefaultSortCosts(PcmSortCosts *costs);
+// Times every engine on one OpenMP thread on random keys; allocates its own context and input
+int pcmCalibrateSortCosts(PcmSortCosts *costs);
+int pcmProfileSort(PcmContext *context, const int *data, int n, PcmSortProfile *profile);
+int pcmPlanSort(PcmContext *context, const int *data, int n, const PcmSortCosts *costs, PcmSortPlan *plan);
+int pcmSortWithPlan(PcmContext *context, int *data, int n, const PcmSortPlan *plan);
+// Plan and sort; costs may be NULL for the defaults, plan NULL if not wanted
+int pcmSortAuto(PcmContext *context, int *data, int n, const PcmSortCosts *costs, PcmSortPlan *plan);
+void pcmReportSortPlan(const PcmSortPlan *plan, FILE *out);
+
+// Selection by 0-based rank. pcmSelect reorders data so data[k] holds the k-th
+// smallest key, with no larger key before it and no smaller key after it;
+// pcmMultiSelect sets values[i] to the ranks[i]-th smallest key and pcmTopK
+// writes the k smallest keys to out in ascending order, both leaving data as is
+int pcmSelect(PcmContext *context, int *data, int n, int k);
+int pcmMultiSelect(PcmContext *context, const int *data, int n, const int *ranks, int count, int *values);
+int pcmTopK(PcmContext *context, const int *data, int n, int k, int *out);
+
+// Searching a sorted array: *index is set to an index holding target, or
+// to -1 when no key equals target; the return value is the PcmStatus
+int pcmBinarySearch(PcmContext *context, const int *data, int n, int target, int *index);
+int pcmTernarySearch(PcmContext *context, const int *data, int n, int target, int *index);
+
+// C = A * B for n x n row-major matrices, wrapping like the int kernels
+int pcmMultiply(PcmContext *context, const int *A, const int *B, int *C, int n);
+
+// Quantized GEMM: A and B are copied to int8 (A unsigned, B signed) or
+// int16 and multiplied by SIMD dot-product instructions accumulating in
+// int32, so C matches pcmMultiply bit for bit whenever the keys fit.
+typedef enum {
+    PCM_PRECISION_INT32,
+    PCM_PRECISION_INT16,
+    PCM_PRECISION_INT8
+} PcmPrecision;
+
+// Kernels in order of preference: pmaddubsw/pmaddwd, then vpdpbusd/vpdpwssd on 256 and 512 bits
+typedef enum {
+    PCM_ISA_SCALAR,
+    PCM_ISA_AVX2,
+    PCM_ISA_AVX_VNNI,
+    PCM_ISA_AVX512_VNNI
+} PcmIsa;
+
+const char* pcmPrecisionName(PcmPrecision precision);
+const char* pcmIsaName(PcmIsa isa);
+// The best kernel this CPU runs
+PcmIsa pcmBestIsa(void);
+// Whether this CPU runs the isa kernel; a better one does not imply it
+int pcmIsaSupported(PcmIsa isa);
+// The narrowest precision whose isa kernel multiplies A and B exactly
+PcmPrecision pcmNarrowestPrecision(PcmContext *context, const int *A, const int *B, int n, PcmIsa isa);
+// PCM_ERROR_ARGUMENT when a key does not fit precision or the CPU lacks isa;
+// PCM_PRECISION_INT32 is pcmMultiply
+int pcmMultiplyQuantized(PcmContext *context, const int *A, const int *B, int *C, int n,
+                         PcmPrecision precision, PcmIsa isa);
+
+#endif
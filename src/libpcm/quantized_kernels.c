@@ -0,0 +1,183 @@
+#include <string.h>
+#include "quantized_kernels.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QUANTIZED_X86 1
+#endif
+
+int quantizedIsaSupported(PcmIsa isa) {
+#ifdef QUANTIZED_X86
+    __builtin_cpu_init();
+    switch (isa) {
+        case PCM_ISA_SCALAR: return 1;
+        case PCM_ISA_AVX2: return __builtin_cpu_supports("avx2") != 0;
+        case PCM_ISA_AVX_VNNI: return __builtin_cpu_supports("avxvnni") != 0;
+        case PCM_ISA_AVX512_VNNI: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vnni");
+        default: return 0;
+    }
+#else
+    return isa == PCM_ISA_SCALAR;
+#endif
+}
+
+PcmIsa quantizedBestIsa(void) {
+    for (int isa = PCM_ISA_AVX512_VNNI; isa > PCM_ISA_SCALAR; isa--) {
+        if (quantizedIsaSupported((PcmIsa)isa)) return (PcmIsa)isa;
+    }
+    return PCM_ISA_SCALAR;
+}
+
+// One group of A's row: 4 int8 or 2 int16 keys, broadcast as one int32
+static int32_t loadGroup(const void *p) {
+    int32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static void tileInt8Scalar(const uint8_t *a, size_t stride, const int8_t *b, int groups, int32_t *tile) {
+    for (int r = 0; r < QUANTIZED_MR; r++) {
+        for (int c = 0; c < QUANTIZED_NR; c++) {
+            uint32_t sum = 0;
+            for (int g = 0; g < groups; g++) {
+                for (int q = 0; q < QUANTIZED_INT8_GROUP; q++) {
+                    sum += (uint32_t)(a[r * stride + g * QUANTIZED_INT8_GROUP + q] *
+                                      b[(size_t)g * QUANTIZED_GROUP_BYTES + c * QUANTIZED_INT8_GROUP + q]);
+                }
+            }
+            tile[r * QUANTIZED_NR + c] = (int32_t)sum;
+        }
+    }
+}
+
+static void tileInt16Scalar(const int16_t *a, size_t stride, const int16_t *b, int groups, int32_t *tile) {
+    const int group_keys = QUANTIZED_GROUP_BYTES / sizeof(int16_t);
+    for (int r = 0; r < QUANTIZED_MR; r++) {
+        for (int c = 0; c < QUANTIZED_NR; c++) {
+            uint32_t sum = 0;
+            for (int g = 0; g < groups; g++) {
+                for (int q = 0; q < QUANTIZED_INT16_GROUP; q++) {
+                    sum += (uint32_t)(a[r * stride + g * QUANTIZED_INT16_GROUP + q] *
+                                      b[(size_t)g * group_keys + c * QUANTIZED_INT16_GROUP + q]);
+                }
+            }
+            tile[r * QUANTIZED_NR + c] = (int32_t)sum;
+        }
+    }
+}
+
+#ifdef QUANTIZED_X86
+// Four rows at a time against the panel's two halves of 8 columns: 8
+// accumulators, 2 panel loads and a broadcast fit the 16 ymm registers.
+// STEP(acc, a, b) adds one group's products of broadcast a and panel half b
+#define TILE_256(STEP, a, stride, b, groups, tile) do {                                                 \
+    for (int half = 0; half < QUANTIZED_MR; half += 4) {                                                \
+        __m256i c00 = _mm256_setzero_si256(), c01 = c00, c10 = c00, c11 = c00;                          \
+        __m256i c20 = c00, c21 = c00, c30 = c00, c31 = c00;                                             \
+        const char *row = (const char *)((a) + half * (stride));                                       \
+        size_t row_bytes = (stride) * sizeof(*(a));                                                     \
+        for (int g = 0; g < (groups); g++) {                                                            \
+            const char *panel = (const char *)(b) + (size_t)g * QUANTIZED_GROUP_BYTES;                 \
+            __m256i b0 = _mm256_loadu_si256((const __m256i *)panel);                                    \
+            __m256i b1 = _mm256_loadu_si256((const __m256i *)(panel + 32));                             \
+            size_t offset = (size_t)g * 4;                                                              \
+            __m256i a0 = _mm256_set1_epi32(loadGroup(row + offset));                                    \
+            __m256i a1 = _mm256_set1_epi32(loadGroup(row + row_bytes + offset));                        \
+            __m256i a2 = _mm256_set1_epi32(loadGroup(row + 2 * row_bytes + offset));                    \
+            __m256i a3 = _mm256_set1_epi32(loadGroup(row + 3 * row_bytes + offset));                    \
+            c00 = STEP(c00, a0, b0); c01 = STEP(c01, a0, b1);                                           \
+            c10 = STEP(c10, a1, b0); c11 = STEP(c11, a1, b1);                                           \
+            c20 = STEP(c20, a2, b0); c21 = STEP(c21, a2, b1);                                           \
+            c30 = STEP(c30, a3, b0); c31 = STEP(c31, a3, b1);                                           \
+        }                                                                                               \
+        int32_t *out = (tile) + half * QUANTIZED_NR;                                                    \
+        _mm256_storeu_si256((__m256i *)out, c00); _mm256_storeu_si256((__m256i *)(out + 8), c01);      \
+        _mm256_storeu_si256((__m256i *)(out + 16), c10); _mm256_storeu_si256((__m256i *)(out + 24), c11); \
+        _mm256_storeu_si256((__m256i *)(out + 32), c20); _mm256_storeu_si256((__m256i *)(out + 40), c21); \
+        _mm256_storeu_si256((__m256i *)(out + 48), c30); _mm256_storeu_si256((__m256i *)(out + 56), c31); \
+    }                                                                                                   \
+} while (0)
+
+// pmaddubsw multiplies unsigned by signed bytes and adds neighbours into
+// int16; pmaddwd by ones adds those pairs into int32
+#define INT8_AVX2_STEP(acc, a, b) \
+    _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(a, b), _mm256_set1_epi16(1)))
+#define INT16_AVX2_STEP(acc, a, b) _mm256_add_epi32(acc, _mm256_madd_epi16(a, b))
+#define INT8_VNNI_STEP(acc, a, b) _mm256_dpbusd_avx_epi32(acc, a, b)
+#define INT16_VNNI_STEP(acc, a, b) _mm256_dpwssd_avx_epi32(acc, a, b)
+
+__attribute__((target("avx2")))
+static void tileInt8Avx2(const uint8_t *a, size_t stride, const int8_t *b, int groups, int32_t *tile) {
+    TILE_256(INT8_AVX2_STEP, a, stride, b, groups, tile);
+}
+
+__attribute__((target("avx2")))
+static void tileInt16Avx2(const int16_t *a, size_t stride, const int16_t *b, int groups, int32_t *tile) {
+    TILE_256(INT16_AVX2_STEP, a, stride, b, groups, tile);
+}
+
+__attribute__((target("avx2,avxvnni")))
+static void tileInt8AvxVnni(const uint8_t *a, size_t stride, const int8_t *b, int groups, int32_t *tile) {
+    TILE_256(INT8_VNNI_STEP, a, stride, b, groups, tile);
+}
+
+__attribute__((target("avx2,avxvnni")))
+static void tileInt16AvxVnni(const int16_t *a, size_t stride, const int16_t *b, int groups, int32_t *tile) {
+    TILE_256(INT16_VNNI_STEP, a, stride, b, groups, tile);
+}
+
+// A group of the panel is one zmm, so all QUANTIZED_MR rows run at once;
+// named accumulators, since GCC keeps an array of them in memory
+#define TILE_512(STEP, a, stride, b, groups, tile) do {                                                 \
+    __m512i c0 = _mm512_setzero_si512(), c1 = c0, c2 = c0, c3 = c0, c4 = c0, c5 = c0, c6 = c0, c7 = c0; \
+    const char *row = (const char *)(a);                                                                \
+    size_t row_bytes = (stride) * sizeof(*(a));                                                         \
+    for (int g = 0; g < (groups); g++) {                                                                \
+        __m512i panel = _mm512_loadu_si512((const char *)(b) + (size_t)g * QUANTIZED_GROUP_BYTES);      \
+        const char *keys = row + (size_t)g * 4;                                                         \
+        c0 = STEP(c0, _mm512_set1_epi32(loadGroup(keys)), panel);                                       \
+        c1 = STEP(c1, _mm512_set1_epi32(loadGroup(keys + row_bytes)), panel);                           \
+        c2 = STEP(c2, _mm512_set1_epi32(loadGroup(keys + 2 * row_bytes)), panel);                       \
+        c3 = STEP(c3, _mm512_set1_epi32(loadGroup(keys + 3 * row_bytes)), panel);                       \
+        c4 = STEP(c4, _mm512_set1_epi32(loadGroup(keys + 4 * row_bytes)), panel);                       \
+        c5 = STEP(c5, _mm512_set1_epi32(loadGroup(keys + 5 * row_bytes)), panel);                       \
+        c6 = STEP(c6, _mm512_set1_epi32(loadGroup(keys + 6 * row_bytes)), panel);                       \
+        c7 = STEP(c7, _mm512_set1_epi32(loadGroup(keys + 7 * row_bytes)), panel);                       \
+    }                                                                                                   \
+    _mm512_storeu_si512((tile), c0); _mm512_storeu_si512((tile) + 16, c1);                              \
+    _mm512_storeu_si512((tile) + 32, c2); _mm512_storeu_si512((tile) + 48, c3);                         \
+    _mm512_storeu_si512((tile) + 64, c4); _mm512_storeu_si512((tile) + 80, c5);                         \
+    _mm512_storeu_si512((tile) + 96, c6); _mm512_storeu_si512((tile) + 112, c7);                        \
+} while (0)
+
+__attribute__((target("avx512f,avx512vnni")))
+static void tileInt8Avx512Vnni(const uint8_t *a, size_t stride, const int8_t *b, int groups, int32_t *tile) {
+    TILE_512(_mm512_dpbusd_epi32, a, stride, b, groups, tile);
+}
+
+__attribute__((target("avx512f,avx512vnni")))
+static void tileInt16Avx512Vnni(const int16_t *a, size_t stride, const int16_t *b, int groups, int32_t *tile) {
+    TILE_512(_mm512_dpwssd_epi32, a, stride, b, groups, tile);
+}
+#endif
+
+void quantizedTileInt8(PcmIsa isa, const uint8_t *a, size_t stride, const int8_t *b, int groups, int32_t *tile) {
+    switch (isa) {
+#ifdef QUANTIZED_X86
+        case PCM_ISA_AVX512_VNNI: tileInt8Avx512Vnni(a, stride, b, groups, tile); break;
+        case PCM_ISA_AVX_VNNI: tileInt8AvxVnni(a, stride, b, groups, tile); break;
+        case PCM_ISA_AVX2: tileInt8Avx2(a, stride, b, groups, tile); break;
+#endif
+        default: tileInt8Scalar(a, stride, b, groups, tile); break;
+    }
+}
+
+void quantizedTileInt16(PcmIsa isa, const int16_t *a, size_t stride, const int16_t *b, int groups, int32_t *tile) {
+    switch (isa) {
+#ifdef QUANTIZED_X86
+        case PCM_ISA_AVX512_VNNI: tileInt16Avx512Vnni(a, stride, b, groups, tile); break;
+        case PCM_ISA_AVX_VNNI: tileInt16AvxVnni(a, stride, b, groups, tile); break;
+        case PCM_ISA_AVX2: tileInt16Avx2(a, stride, b, groups, tile); break;
+#endif
+        default: tileInt16Scalar(a, stride, b, groups, tile); break;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef QUANTIZED_KERNELS_H
+#define QUANTIZED_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pcm.h"
+
+/*
+    Micro-kernels of pcmMultiplyQuantized, one per instruction set. A call
+    computes one QUANTIZED_MR x QUANTIZED_NR tile of C over the whole k
+    range into tile (row-major, QUANTIZED_NR per row), wrapping modulo 2^32
+    like the int kernels.
+
+    a points at the tile's first row of the narrow copy of A, stride
+    elements apart, k padded with zeros to a whole number of groups. b
+    points at one packed panel of B: for every group of k, QUANTIZED_NR
+    columns of 4 bytes, which hold 4 consecutive k of int8 or 2 of int16.
+    A group is QUANTIZED_GROUP_BYTES, one AVX-512 or two AVX2 loads.
+*/
+
+#define QUANTIZED_MR 8
+#define QUANTIZED_NR 16
+#define QUANTIZED_GROUP_BYTES (QUANTIZED_NR * 4)
+#define QUANTIZED_INT8_GROUP 4
+#define QUANTIZED_INT16_GROUP 2
+
+// The ISAs are not nested: an AVX-512 VNNI CPU may lack AVX-VNNI
+int quantizedIsaSupported(PcmIsa isa);
+PcmIsa quantizedBestIsa(void);
+// Unsigned A times signed B. The AVX2 kernel's pmaddubsw saturates pairs of
+// products to int16, so there A * B + A * B must fit an int16
+void quantizedTileInt8(PcmIsa isa, const uint8_t *a, size_t stride, const int8_t *b, int groups, int32_t *tile);
+void quantizedTileInt16(PcmIsa isa, const int16_t *a, size_t stride, const int16_t *b, int groups, int32_t *tile);
+
+#endif
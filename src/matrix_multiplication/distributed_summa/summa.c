@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include <omp.h>
+#include "../../common/verify.h"
+
+/*
+    command to compilte:
+    mpicc -Wall -std=c99 -O2 -fopenmp -o summaMatrixMulti summa.c ../../common/verify.c
+    command to execute:
+    mpirun -np [number of processes] ./summaMatrixMulti [matrix_1] [matrix_2] [threads per process] [--cannon] [--verify[=trials]]
+    mpirun -np [number of processes] ./summaMatrixMulti --random [matrix size] [threads per process] [--cannon] [--verify[=trials]]
+
+    The number of processes must be a perfect square; they form a q x q grid and
+    each one owns one (n/q) x (n/q) block of A, B and C. Every process multiplies
+    its blocks with OpenMP threads.
+*/
+
+typedef struct {
+    double compute;        // time inside the local block multiply
+    double communication;  // time blocked in MPI waiting for blocks to arrive
+    long long bytes;       // bytes this process received from other processes
+} RunStats;
+
+static int* allocateBlock(long elements) {
+    int *block = malloc(elements * sizeof(int));
+    if (block == NULL) {
+        fprintf(stderr, "Memory allocation failed for matrix block\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    return block;
+}
+
+// C += A * B on nb x nb row-major blocks
+static void localMultiplyAdd(const int *restrict A, const int *restrict B, int *restrict C, int nb) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < nb; i++) {
+        int *c_row = C + (long)i * nb;
+        for (int k = 0; k < nb; k++) {
+            const int a = A[(long)i * nb + k];
+            const int *b_row = B + (long)k * nb;
+            #pragma omp simd
+            for (int j = 0; j < nb; j++) {
+                c_row[j] += a * b_row[j];
+            }
+        }
+    }
+}
+
+// SUMMA: at step k the owners of block column k of A and block row k of B
+// broadcast along their grid row and column. The broadcasts for step k + 1
+// are posted before the multiply for step k, so they travel during compute.
+static void summaMultiply(const int *A, const int *B, int *C, int nb, int q,
+                          MPI_Comm row_comm, MPI_Comm col_comm, int my_row, int my_col, RunStats *stats) {
+    long elements = (long)nb * nb;
+    int *a_buf[2] = { allocateBlock(elements), allocateBlock(elements) };
+    int *b_buf[2] = { allocateBlock(elements), allocateBlock(elements) };
+    MPI_Request requests[2];
+
+    memset(C, 0, elements * sizeof(int));
+    if (my_col == 0) memcpy(a_buf[0], A, elements * sizeof(int));
+    if (my_row == 0) memcpy(b_buf[0], B, elements * sizeof(int));
+    MPI_Ibcast(a_buf[0], (int)elements, MPI_INT, 0, row_comm, &requests[0]);
+    MPI_Ibcast(b_buf[0], (int)elements, MPI_INT, 0, col_comm, &requests[1]);
+
+    for (int k = 0; k < q; k++) {
+        int cur = k % 2, next = (k + 1) % 2;
+
+        double wait_start = MPI_Wtime();
+        MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+        stats->communication += MPI_Wtime() - wait_start;
+        if (my_col != k) stats->bytes += elements * sizeof(int);
+        if (my_row != k) stats->bytes += elements * sizeof(int);
+
+        if (k + 1 < q) {
+            if (my_col == k + 1) memcpy(a_buf[next], A, elements * sizeof(int));
+            if (my_row == k + 1) memcpy(b_buf[next], B, elements * sizeof(int));
+            MPI_Ibcast(a_buf[next], (int)elements, MPI_INT, k + 1, row_comm, &requests[0]);
+            MPI_Ibcast(b_buf[next], (int)elements, MPI_INT, k + 1, col_comm, &requests[1]);
+        }
+
+        double compute_start = MPI_Wtime();
+        localMultiplyAdd(a_buf[cur], b_buf[cur], C, nb);
+        stats->compute += MPI_Wtime() - compute_start;
+
+        // Nudge the progress engine so the pending broadcasts keep moving
+        if (k + 1 < q) {
+            int flag;
+            MPI_Testall(2, requests, &flag, MPI_STATUSES_IGNORE);
+        }
+    }
+
+    free(a_buf[0]);
+    free(a_buf[1]);
+    free(b_buf[0]);
+    free(b_buf[1]);
+}
+
+// Cannon: skew A left by the grid row and B up by the grid column, then shift
+// both by one after every step. The shift for the next step is posted before
+// the multiply for the current one.
+static void cannonMultiply(const int *A, const int *B, int *C, int nb, int q,
+                           MPI_Comm grid_comm, int my_row, int my_col, RunStats *stats) {
+    long elements = (long)nb * nb;
+    int *a_buf[2] = { allocateBlock(elements), allocateBlock(elements) };
+    int *b_buf[2] = { allocateBlock(elements), allocateBlock(elements) };
+    memcpy(a_buf[0], A, elements * sizeof(int));
+    memcpy(b_buf[0], B, elements * sizeof(int));
+    memset(C, 0, elements * sizeof(int));
+
+    int left, right, up, down;
+    double skew_start = MPI_Wtime();
+    if (my_row > 0) {
+        MPI_Cart_shift(grid_comm, 1, -my_row, &right, &left);
+        MPI_Sendrecv_replace(a_buf[0], (int)elements, MPI_INT, left, 0, right, 0, grid_comm, MPI_STATUS_IGNORE);
+        stats->bytes += elements * sizeof(int);
+    }
+    if (my_col > 0) {
+        MPI_Cart_shift(grid_comm, 0, -my_col, &down, &up);
+        MPI_Sendrecv_replace(b_buf[0], (int)elements, MPI_INT, up, 0, down, 0, grid_comm, MPI_STATUS_IGNORE);
+        stats->bytes += elements * sizeof(int);
+    }
+    stats->communication += MPI_Wtime() - skew_start;
+
+    MPI_Cart_shift(grid_comm, 1, -1, &right, &left);
+    MPI_Cart_shift(grid_comm, 0, -1, &down, &up);
+    for (int k = 0; k < q; k++) {
+        int cur = k % 2, next = (k + 1) % 2;
+        MPI_Request requests[4];
+        int pending = 0;
+        if (k + 1 < q) {
+            MPI_Irecv(a_buf[next], (int)elements, MPI_INT, right, 1, grid_comm, &requests[pending++]);
+            MPI_Irecv(b_buf[next], (int)elements, MPI_INT, down, 2, grid_comm, &requests[pending++]);
+            MPI_Isend(a_buf[cur], (int)elements, MPI_INT, left, 1, grid_comm, &requests[pending++]);
+            MPI_Isend(b_buf[cur], (int)elements, MPI_INT, up, 2, grid_comm, &requests[pending++]);
+        }
+
+        double compute_start = MPI_Wtime();
+        localMultiplyAdd(a_buf[cur], b_buf[cur], C, nb);
+        stats->compute += MPI_Wtime() - compute_start;
+
+        double wait_start = MPI_Wtime();
+        MPI_Waitall(pending, requests, MPI_STATUSES_IGNORE);
+        stats->communication += MPI_Wtime() - wait_start;
+        if (pending > 0) stats->bytes += 2 * elements * sizeof(int);
+    }
+
+    free(a_buf[0]);
+    free(a_buf[1]);
+    free(b_buf[0]);
+    free(b_buf[1]);
+}
+
+static int* readMatrixFile(const char *filename, int *size) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening matrix file %s\n", filename);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    if (fscanf(file, "%d", size) != 1 || *size <= 0) {
+        fprintf(stderr, "Failed to read matrix size from %s\n", filename);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    int *matrix = allocateBlock((long)*size * *size);
+    for (long i = 0; i < (long)*size * *size; i++) {
+        if (fscanf(file, "%d", &matrix[i]) != 1) {
+            fprintf(stderr, "Failed to read data for matrix at [%ld][%ld]\n", i / *size, i % *size);
+            MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+        }
+    }
+    fclose(file);
+    return matrix;
+}
+
+// Rearrange an n x n matrix into q*q consecutive zero-padded nb x nb blocks,
+// block (r, c) first, in the rank order of the grid
+static void packBlocks(const int *matrix, int *packed, int n, int nb, int q) {
+    #pragma omp parallel for collapse(2)
+    for (int r = 0; r < q; r++) {
+        for (int c = 0; c < q; c++) {
+            int *block = packed + ((long)r * q + c) * nb * nb;
+            for (int i = 0; i < nb; i++) {
+                for (int j = 0; j < nb; j++) {
+                    int row = r * nb + i, col = c * nb + j;
+                    block[(long)i * nb + j] = (row < n && col < n) ? matrix[(long)row * n + col] : 0;
+                }
+            }
+        }
+    }
+}
+
+static void unpackBlocks(const int *packed, int *matrix, int n, int nb, int q) {
+    #pragma omp parallel for collapse(2)
+    for (int r = 0; r < q; r++) {
+        for (int c = 0; c < q; c++) {
+            const int *block = packed + ((long)r * q + c) * nb * nb;
+            for (int i = 0; i < nb && r * nb + i < n; i++) {
+                for (int j = 0; j < nb && c * nb + j < n; j++) {
+                    matrix[(long)(r * nb + i) * n + c * nb + j] = block[(long)i * nb + j];
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    if (argc < 4) {
+        if (rank == 0) {
+            fprintf(stderr, "Usage: %s <input_file_matrix_A> <input_file_matrix_B> <threads_per_process> [--cannon] " VERIFY_OPTIONS_USAGE "\n", argv[0]);
+            fprintf(stderr, "       %s --random <matrix_size> <threads_per_process> [--cannon] " VERIFY_OPTIONS_USAGE "\n", argv[0]);
+        }
+        MPI_Finalize();
+        return -1;
+    }
+
+    int use_cannon = 0;
+    VerifyOptions verify;
+    defaultVerifyOptions(&verify);
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--cannon") == 0) {
+            use_cannon = 1;
+        } else if (parseVerifyOption(argv[i], &verify)) {
+            continue;
+        } else {
+            if (rank == 0) fprintf(stderr, "Unknown option %s\n", argv[i]);
+            MPI_Finalize();
+            return -1;
+        }
+    }
+
+    int q = 1;
+    while ((q + 1) * (q + 1) <= num_procs) q++;
+    if (q * q != num_procs) {
+        if (rank == 0) fprintf(stderr, "Number of processes must be a perfect square, got %d\n", num_procs);
+        MPI_Finalize();
+        return -1;
+    }
+
+    int num_threads = atoi(argv[3]);
+    if (num_threads < 1) {
+        if (rank == 0) fprintf(stderr, "Number of threads must be at least 1\n");
+        MPI_Finalize();
+        return 1;
+    }
+    omp_set_num_threads(num_threads);
+
+    // Rank 0 reads or generates the inputs and hands every process its blocks
+    int n = 0;
+    int *A = NULL, *B = NULL;
+    if (rank == 0) {
+        if (strcmp(argv[1], "--random") == 0) {
+            n = atoi(argv[2]);
+            if (n < 1) {
+                fprintf(stderr, "Matrix size must be at least 1\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            A = allocateBlock((long)n * n);
+            B = allocateBlock((long)n * n);
+            srand(42);
+            for (long i = 0; i < (long)n * n; i++) {
+                A[i] = rand() % 100;
+                B[i] = rand() % 100;
+            }
+        } else {
+            int sizeB = 0;
+            A = readMatrixFile(argv[1], &n);
+            B = readMatrixFile(argv[2], &sizeB);
+            if (n != sizeB) {
+                fprintf(stderr, "Matrix dimensions must match!\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+        }
+    }
+    MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    int dims[2] = { q, q }, periods[2] = { 1, 1 }, coords[2];
+    MPI_Comm grid_comm, row_comm, col_comm;
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 0, &grid_comm);
+    MPI_Comm_rank(grid_comm, &rank);
+    MPI_Cart_coords(grid_comm, rank, 2, coords);
+    int my_row = coords[0], my_col = coords[1];
+    MPI_Comm_split(grid_comm, my_row, my_col, &row_comm);
+    MPI_Comm_split(grid_comm, my_col, my_row, &col_comm);
+
+    int nb = (n + q - 1) / q;
+    long block_elements = (long)nb * nb;
+    int *packed = NULL;
+    if (rank == 0) packed = allocateBlock(block_elements * num_procs);
+    int *local_A = allocateBlock(block_elements);
+    int *local_B = allocateBlock(block_elements);
+    int *local_C = allocateBlock(block_elements);
+
+    if (rank == 0) packBlocks(A, packed, n, nb, q);
+    MPI_Scatter(packed, (int)block_elements, MPI_INT, local_A, (int)block_elements, MPI_INT, 0, grid_comm);
+    if (rank == 0) packBlocks(B, packed, n, nb, q);
+    MPI_Scatter(packed, (int)block_elements, MPI_INT, local_B, (int)block_elements, MPI_INT, 0, grid_comm);
+
+    RunStats stats = { 0.0, 0.0, 0 };
+    MPI_Barrier(grid_comm);
+    double start_time = MPI_Wtime();
+    if (use_cannon) {
+        cannonMultiply(local_A, local_B, local_C, nb, q, grid_comm, my_row, my_col, &stats);
+    } else {
+        summaMultiply(local_A, local_B, local_C, nb, q, row_comm, col_comm, my_row, my_col, &stats);
+    }
+    MPI_Barrier(grid_comm);
+    double end_time = MPI_Wtime();
+
+    // The slowest process decides the superstep, the average shows the imbalance
+    double local_times[2] = { stats.compute, stats.communication };
+    double max_times[2], sum_times[2];
+    long long total_bytes = 0;
+    MPI_Reduce(local_times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, grid_comm);
+    MPI_Reduce(local_times, sum_times, 2, MPI_DOUBLE, MPI_SUM, 0, grid_comm);
+    MPI_Reduce(&stats.bytes, &total_bytes, 1, MPI_LONG_LONG, MPI_SUM, 0, grid_comm);
+
+    MPI_Gather(local_C, (int)block_elements, MPI_INT, packed, (int)block_elements, MPI_INT, 0, grid_comm);
+
+    int status = 0;
+    if (rank == 0) {
+        printf("Time taken to multiply two %dx%d matrices with %s on a %dx%d grid, %d threads per process: %f seconds\n",
+               n, n, use_cannon ? "Cannon" : "SUMMA", q, q, num_threads, end_time - start_time);
+        printf("Compute time: max %f seconds, average %f seconds\n", max_times[0], sum_times[0] / num_procs);
+        printf("Communication time: max %f seconds, average %f seconds\n", max_times[1], sum_times[1] / num_procs);
+        double average_bytes = (double)total_bytes / num_procs;
+        printf("Communication volume: %.0f bytes per process", average_bytes);
+        if (sum_times[1] > 0.0) {
+            printf(", %.3f GB/s per process while blocked\n", average_bytes / (sum_times[1] / num_procs) / 1e9);
+        } else {
+            printf("\n");
+        }
+
+        if (verify.trials > 0) {
+            int *C = allocateBlock((long)n * n);
+            unpackBlocks(packed, C, n, nb, q);
+            status = reportVerification(verifyFlat(A, n), verifyFlat(B, n), verifyFlat(C, n), verify.trials);
+            free(C);
+        }
+        free(A);
+        free(B);
+        free(packed);
+    }
+
+    free(local_A);
+    free(local_B);
+    free(local_C);
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    MPI_Comm_free(&grid_comm);
+    MPI_Finalize();
+    return status;
+}
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "batched_gemm.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -O2 -fopenmp -o batchedMatrixMulti batched_gemm.c
+    command to execute:
+    ./batchedMatrixMulti [matrix size] [batch count] [number of threads]
+*/
+
+// One kernel per supported size. With the size a compile-time constant the
+// compiler fully unrolls the k loop and turns each row update into SIMD code;
+// an AVX2 clone is picked at load time on CPUs that have it.
+#define DEFINE_FIXED_SIZE_KERNEL(N)                                              \
+__attribute__((target_clones("avx2", "default")))                               \
+static void multiplyFixed##N(const int *restrict A, const int *restrict B,       \
+                             int *restrict C) {                                  \
+    for (int i = 0; i < N; i++) {                                                \
+        int row[N];                                                              \
+        _Pragma("omp simd")                                                      \
+        for (int j = 0; j < N; j++) {                                            \
+            row[j] = 0;                                                          \
+        }                                                                        \
+        _Pragma("GCC unroll 64")                                                 \
+        for (int k = 0; k < N; k++) {                                            \
+            const int a = A[i * N + k];                                          \
+            _Pragma("omp simd")                                                  \
+            for (int j = 0; j < N; j++) {                                        \
+                row[j] += a * B[k * N + j];                                      \
+            }                                                                    \
+        }                                                                        \
+        _Pragma("omp simd")                                                      \
+        for (int j = 0; j < N; j++) {                                            \
+            C[i * N + j] = row[j];                                               \
+        }                                                                        \
+    }                                                                            \
+}
+
+DEFINE_FIXED_SIZE_KERNEL(4)
+DEFINE_FIXED_SIZE_KERNEL(8)
+DEFINE_FIXED_SIZE_KERNEL(16)
+DEFINE_FIXED_SIZE_KERNEL(32)
+DEFINE_FIXED_SIZE_KERNEL(64)
+
+// Sizes without a specialization still avoid a parallel region per matrix
+__attribute__((target_clones("avx2", "default")))
+static void multiplyGeneric(const int *restrict A, const int *restrict B, int *restrict C, int size) {
+    for (int i = 0; i < size; i++) {
+        int *c_row = C + (long)i * size;
+        for (int j = 0; j < size; j++) {
+            c_row[j] = 0;
+        }
+        for (int k = 0; k < size; k++) {
+            const int a = A[(long)i * size + k];
+            const int *b_row = B + (long)k * size;
+            #pragma omp simd
+            for (int j = 0; j < size; j++) {
+                c_row[j] += a * b_row[j];
+            }
+        }
+    }
+}
+
+#define RUN_FIXED_BATCH(N)                                                       \
+    _Pragma("omp parallel for schedule(static)")                                 \
+    for (int b = 0; b < batch_count; b++) {                                      \
+        multiplyFixed##N(A + b * stride_A, B + b * stride_B, C + b * stride_C);  \
+    }
+
+void batchedMultiplyStrided(const int *A, long stride_A, const int *B, long stride_B,
+                            int *C, long stride_C, int size, int batch_count) {
+    // The whole batch shares one parallel region; each thread owns whole matrices
+    switch (size) {
+        case 4: RUN_FIXED_BATCH(4); break;
+        case 8: RUN_FIXED_BATCH(8); break;
+        case 16: RUN_FIXED_BATCH(16); break;
+        case 32: RUN_FIXED_BATCH(32); break;
+        case 64: RUN_FIXED_BATCH(64); break;
+        default:
+            #pragma omp parallel for schedule(static)
+            for (int b = 0; b < batch_count; b++) {
+                multiplyGeneric(A + b * stride_A, B + b * stride_B, C + b * stride_C, size);
+            }
+            break;
+    }
+}
+
+void batchedMultiply(const int *A, const int *B, int *C, int size, int batch_count) {
+    long stride = (long)size * size;
+    batchedMultiplyStrided(A, stride, B, stride, C, stride, size, batch_count);
+}
+
+// The per-call kernel from parallel_naive, one parallel region per matrix
+void multiplyMatrices(const int *A, const int *B, int *C, int size) {
+    #pragma omp parallel for collapse(2)
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            C[i * size + j] = 0;
+            for (int k = 0; k < size; k++) {
+                C[i * size + j] += A[i * size + k] * B[k * size + j];
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <matrix_size> <batch_count> <num_of_threads>\n", argv[0]);
+        return -1;
+    }
+
+    int size = atoi(argv[1]);
+    int batch_count = atoi(argv[2]);
+    int num_threads = atoi(argv[3]);
+    if (size < 1 || batch_count < 1) {
+        fprintf(stderr, "Matrix size and batch count must be at least 1\n");
+        return -1;
+    }
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+
+    long elements = (long)size * size * batch_count;
+    int *A = malloc(elements * sizeof(int));
+    int *B = malloc(elements * sizeof(int));
+    int *C = malloc(elements * sizeof(int));
+    int *reference = malloc(elements * sizeof(int));
+    if (A == NULL || B == NULL || C == NULL || reference == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    // Values between 0 and 99, like create_matrix_file.py
+    srand(42);
+    for (long i = 0; i < elements; i++) {
+        A[i] = rand() % 100;
+        B[i] = rand() % 100;
+    }
+
+    omp_set_num_threads(num_threads);
+
+    long stride = (long)size * size;
+    double start_time = omp_get_wtime();
+    for (int b = 0; b < batch_count; b++) {
+        multiplyMatrices(A + b * stride, B + b * stride, reference + b * stride, size);
+    }
+    double end_time = omp_get_wtime();
+    double per_call_time = end_time - start_time;
+
+    start_time = omp_get_wtime();
+    batchedMultiply(A, B, C, size, batch_count);
+    end_time = omp_get_wtime();
+    double batched_time = end_time - start_time;
+
+    if (memcmp(C, reference, elements * sizeof(int)) != 0) {
+        fprintf(stderr, "Batched result does not match the per-call result\n");
+        return -1;
+    }
+
+    printf("Time taken to multiply %d %dx%d matrices one call at a time with %d threads: %f seconds\n", batch_count, size, size, num_threads, per_call_time);
+    printf("Time taken to multiply %d %dx%d matrices as one batch with %d threads: %f seconds\n", batch_count, size, size, num_threads, batched_time);
+    printf("Batched throughput: %.0f matrices/second (%.2fx faster)\n", batch_count / batched_time, per_call_time / batched_time);
+
+    free(A);
+    free(B);
+    free(C);
+    free(reference);
+    return 0;
+}
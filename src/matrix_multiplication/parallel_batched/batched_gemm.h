@@ -0,0 +1,10 @@
+#ifndef BATCHED_GEMM_H
+#define BATCHED_GEMM_H
+
+// Strided batch: matrix b of A starts at A + b * stride_A (same for B and C),
+// every matrix is size x size in row-major order.
+void batchedMultiplyStrided(const int *A, long stride_A, const int *B, long stride_B,
+                            int *C, long stride_C, int size, int batch_count);
+void batchedMultiply(const int *A, const int *B, int *C, int size, int batch_count);
+
+#endif
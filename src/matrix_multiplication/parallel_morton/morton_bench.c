@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "morton_matrix.h"
+#include "../../common/perf_counters.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -O2 -fopenmp -o mortonMatrixMulti morton_bench.c morton_matrix.c ../../common/perf_counters.c
+    command to execute:
+    ./mortonMatrixMulti [matrix_1] [matrix_2] [number of threads] [--perf]
+    ./mortonMatrixMulti --random [matrix size] [number of threads] [--perf]
+
+    Times the recursive multiply over strided row-major quadrants against
+    the same recursion and Strassen on the Morton layout, and checks that
+    all three agree. With --perf each run prints its per-thread counters,
+    so the LLC misses of the two layouts can be compared.
+*/
+
+static int* allocateBlock(long elements) {
+    int *block = malloc(elements * sizeof(int));
+    if (block == NULL) {
+        fprintf(stderr, "Memory allocation failed for matrix\n");
+        exit(EXIT_FAILURE);
+    }
+    return block;
+}
+
+static int* readMatrixFile(const char *filename, int *size) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening matrix file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    if (fscanf(file, "%d", size) != 1 || *size <= 0) {
+        fprintf(stderr, "Failed to read matrix size from %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    int *matrix = allocateBlock((long)*size * *size);
+    for (long i = 0; i < (long)*size * *size; i++) {
+        if (fscanf(file, "%d", &matrix[i]) != 1) {
+            fprintf(stderr, "Failed to read data for matrix at [%ld][%ld]\n", i / *size, i % *size);
+            exit(EXIT_FAILURE);
+        }
+    }
+    fclose(file);
+    return matrix;
+}
+
+// Copy into the top-left corner of a zero-padded padded_size x padded_size array
+static int* padRowMajor(const int *src, int size, int padded_size) {
+    int *padded = allocateBlock((long)padded_size * padded_size);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < padded_size; i++) {
+        for (int j = 0; j < padded_size; j++) {
+            padded[(long)i * padded_size + j] = (i < size && j < size) ? src[(long)i * size + j] : 0;
+        }
+    }
+    return padded;
+}
+
+static int countMismatches(const int *C, int size, const int *padded, int padded_size) {
+    int mismatches = 0;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            if (C[(long)i * size + j] != padded[(long)i * padded_size + j]) mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <input_file_matrix_A> <input_file_matrix_B> <num_of_threads> " PERF_OPTIONS_USAGE "\n", argv[0]);
+        fprintf(stderr, "       %s --random <matrix_size> <num_of_threads> " PERF_OPTIONS_USAGE "\n", argv[0]);
+        return -1;
+    }
+
+    PerfOptions perf_options;
+    defaultPerfOptions(&perf_options);
+    for (int i = 4; i < argc; i++) {
+        if (!parsePerfOption(argv[i], &perf_options)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    int num_threads = atoi(argv[3]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+
+    int size = 0, sizeB = 0;
+    int *A, *B;
+    if (strcmp(argv[1], "--random") == 0) {
+        size = atoi(argv[2]);
+        if (size < 1) {
+            fprintf(stderr, "Matrix size must be at least 1\n");
+            return -1;
+        }
+        A = allocateBlock((long)size * size);
+        B = allocateBlock((long)size * size);
+        srand(42);
+        for (long i = 0; i < (long)size * size; i++) {
+            A[i] = rand() % 100;
+            B[i] = rand() % 100;
+        }
+    } else {
+        A = readMatrixFile(argv[1], &size);
+        B = readMatrixFile(argv[2], &sizeB);
+        if (size != sizeB) {
+            fprintf(stderr, "Matrix dimensions must match!\n");
+            return -1;
+        }
+    }
+
+    omp_set_num_threads(num_threads);
+    omp_set_dynamic(0);
+
+    MortonMatrix mA, mB, mC;
+    allocateMortonMatrix(&mA, size, MORTON_TILE);
+    allocateMortonMatrix(&mB, size, MORTON_TILE);
+    allocateMortonMatrix(&mC, size, MORTON_TILE);
+    int padded_size = mC.padded_size;
+    long elements = (long)padded_size * padded_size;
+    // Compulsory traffic of every multiply, like matrix_multiplication: read
+    // the n x n A and B and write C once, not counting the padding
+    long keys = (long)size * size;
+    double bytes_moved = (2.0 * sizeof(int) + sizeof(int)) * keys;
+    printf("Multiplying two %dx%d matrices (padded to %d, %dx%d tiles) with %d threads\n",
+           size, size, padded_size, MORTON_TILE, MORTON_TILE, num_threads);
+
+    // Row-major baseline: the same recursion over strided quadrants
+    int *pA = padRowMajor(A, size, padded_size);
+    int *pB = padRowMajor(B, size, padded_size);
+    int *pC = allocateBlock(elements);
+    PerfRegion perf;
+    perfRegionBegin(&perf, &perf_options, "row-major recursive");
+    double start_time = omp_get_wtime();
+    rowMajorRecursiveMultiply(pA, pB, pC, padded_size, MORTON_TILE);
+    double end_time = omp_get_wtime();
+    perfRegionEnd(&perf, keys, bytes_moved);
+    printf("%-28s %f seconds\n", "Row-major recursive:", end_time - start_time);
+
+    start_time = omp_get_wtime();
+    rowMajorToMorton(A, size, &mA);
+    rowMajorToMorton(B, size, &mB);
+    end_time = omp_get_wtime();
+    printf("%-28s %f seconds\n", "Row-major to Morton:", end_time - start_time);
+
+    perfRegionBegin(&perf, &perf_options, "Morton recursive");
+    start_time = omp_get_wtime();
+    mortonMultiply(&mA, &mB, &mC);
+    end_time = omp_get_wtime();
+    perfRegionEnd(&perf, keys, bytes_moved);
+    printf("%-28s %f seconds\n", "Morton recursive:", end_time - start_time);
+
+    int *C = allocateBlock((long)size * size);
+    start_time = omp_get_wtime();
+    mortonToRowMajor(&mC, C, size);
+    end_time = omp_get_wtime();
+    printf("%-28s %f seconds\n", "Morton to row-major:", end_time - start_time);
+    int mismatches = countMismatches(C, size, pC, padded_size);
+
+    perfRegionBegin(&perf, &perf_options, "Morton Strassen");
+    start_time = omp_get_wtime();
+    mortonStrassenMultiply(&mA, &mB, &mC);
+    end_time = omp_get_wtime();
+    perfRegionEnd(&perf, keys, bytes_moved);
+    printf("%-28s %f seconds\n", "Morton Strassen:", end_time - start_time);
+
+    mortonToRowMajor(&mC, C, size);
+    mismatches += countMismatches(C, size, pC, padded_size);
+    if (mismatches != 0) {
+        fprintf(stderr, "Morton results differ from the row-major result in %d entries\n", mismatches);
+        return -1;
+    }
+
+    free(A);
+    free(B);
+    free(C);
+    free(pA);
+    free(pB);
+    free(pC);
+    freeMortonMatrix(&mA);
+    freeMortonMatrix(&mB);
+    freeMortonMatrix(&mC);
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "morton_matrix.h"
+
+#define TASK_CUTOFF 128      // below this dimension recursive calls run inline
+#define STRASSEN_CUTOFF 128  // below this dimension Strassen hands off to the recursive multiply
+
+// Spread the low 16 bits of x so a zero bit sits between each of them
+static unsigned int spreadBits(unsigned int x) {
+    x &= 0x0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+// Row bits go above column bits, so quadrants come out in 11, 12, 21, 22 order
+static long mortonTileOffset(int tile_row, int tile_col, int tile) {
+    unsigned int z = (spreadBits(tile_row) << 1) | spreadBits(tile_col);
+    return (long)z * tile * tile;
+}
+
+void allocateMortonMatrix(MortonMatrix *matrix, int size, int tile) {
+    int tiles = (size + tile - 1) / tile;
+    int tiles_per_side = 1;
+    while (tiles_per_side < tiles) tiles_per_side *= 2;
+
+    matrix->size = size;
+    matrix->tile = tile;
+    matrix->padded_size = tiles_per_side * tile;
+    matrix->data = malloc((long)matrix->padded_size * matrix->padded_size * sizeof(int));
+    if (matrix->data == NULL) {
+        fprintf(stderr, "Memory allocation failed for Morton matrix\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void freeMortonMatrix(MortonMatrix *matrix) {
+    free(matrix->data);
+    matrix->data = NULL;
+}
+
+// Each thread converts whole tiles, which also first-touches them where they will be used
+void rowMajorToMorton(const int *src, int size, MortonMatrix *dst) {
+    int tile = dst->tile;
+    int tiles_per_side = dst->padded_size / tile;
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (int ti = 0; ti < tiles_per_side; ti++) {
+        for (int tj = 0; tj < tiles_per_side; tj++) {
+            int *block = dst->data + mortonTileOffset(ti, tj, tile);
+            for (int i = 0; i < tile; i++) {
+                int row = ti * tile + i;
+                for (int j = 0; j < tile; j++) {
+                    int col = tj * tile + j;
+                    block[i * tile + j] = (row < size && col < size) ? src[(long)row * size + col] : 0;
+                }
+            }
+        }
+    }
+}
+
+void mortonToRowMajor(const MortonMatrix *src, int *dst, int size) {
+    int tile = src->tile;
+    int tiles_per_side = (size + tile - 1) / tile;
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (int ti = 0; ti < tiles_per_side; ti++) {
+        for (int tj = 0; tj < tiles_per_side; tj++) {
+            const int *block = src->data + mortonTileOffset(ti, tj, tile);
+            for (int i = 0; i < tile && ti * tile + i < size; i++) {
+                for (int j = 0; j < tile && tj * tile + j < size; j++) {
+                    dst[(long)(ti * tile + i) * size + tj * tile + j] = block[i * tile + j];
+                }
+            }
+        }
+    }
+}
+
+// C += A * B for blocks whose rows are `ld_a`, `ld_b`, `ld_c` apart. In Morton
+// order a tile is contiguous, so every leading dimension equals the tile size.
+__attribute__((target_clones("avx2", "default")))
+static void tileMultiplyAdd(const int *restrict A, int ld_a, const int *restrict B, int ld_b,
+                            int *restrict C, int ld_c, int tile) {
+    for (int i = 0; i < tile; i++) {
+        for (int k = 0; k < tile; k++) {
+            const int a = A[(long)i * ld_a + k];
+            const int *b_row = B + (long)k * ld_b;
+            int *c_row = C + (long)i * ld_c;
+            #pragma omp simd
+            for (int j = 0; j < tile; j++) {
+                c_row[j] += a * b_row[j];
+            }
+        }
+    }
+}
+
+// Cache-oblivious C += A * B where each quadrant is the next quarter of the block
+static void mortonMultiplyAdd(const int *A, const int *B, int *C, int dim, int tile) {
+    if (dim == tile) {
+        tileMultiplyAdd(A, tile, B, tile, C, tile, tile);
+        return;
+    }
+
+    long q = (long)(dim / 2) * (dim / 2);
+    int half = dim / 2;
+    // The four quadrants of C are independent; the two products into each one are not
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { mortonMultiplyAdd(A, B, C, half, tile); mortonMultiplyAdd(A + q, B + 2 * q, C, half, tile); }
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { mortonMultiplyAdd(A, B + q, C + q, half, tile); mortonMultiplyAdd(A + q, B + 3 * q, C + q, half, tile); }
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { mortonMultiplyAdd(A + 2 * q, B, C + 2 * q, half, tile); mortonMultiplyAdd(A + 3 * q, B + 2 * q, C + 2 * q, half, tile); }
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { mortonMultiplyAdd(A + 2 * q, B + q, C + 3 * q, half, tile); mortonMultiplyAdd(A + 3 * q, B + 3 * q, C + 3 * q, half, tile); }
+    #pragma omp taskwait
+}
+
+void mortonMultiply(const MortonMatrix *A, const MortonMatrix *B, MortonMatrix *C) {
+    long elements = (long)C->padded_size * C->padded_size;
+    memset(C->data, 0, elements * sizeof(int));
+    #pragma omp parallel
+    {
+        #pragma omp single
+        mortonMultiplyAdd(A->data, B->data, C->data, C->padded_size, C->tile);
+    }
+}
+
+static int* allocateBlock(long elements) {
+    int *block = malloc(elements * sizeof(int));
+    if (block == NULL) {
+        fprintf(stderr, "Memory allocation failed for Strassen temporary\n");
+        exit(EXIT_FAILURE);
+    }
+    return block;
+}
+
+// Quadrant sums are plain streaming loops because both operands are contiguous
+static void addBlock(const int *A, const int *B, int *result, long elements) {
+    #pragma omp simd
+    for (long i = 0; i < elements; i++) result[i] = A[i] + B[i];
+}
+
+static void subtractBlock(const int *A, const int *B, int *result, long elements) {
+    #pragma omp simd
+    for (long i = 0; i < elements; i++) result[i] = A[i] - B[i];
+}
+
+static void mortonStrassen(const int *A, const int *B, int *C, int dim, int tile) {
+    long elements = (long)dim * dim;
+    if (dim <= STRASSEN_CUTOFF || dim == tile) {
+        memset(C, 0, elements * sizeof(int));
+        mortonMultiplyAdd(A, B, C, dim, tile);
+        return;
+    }
+
+    int half = dim / 2;
+    long q = elements / 4;
+    const int *A11 = A, *A12 = A + q, *A21 = A + 2 * q, *A22 = A + 3 * q;
+    const int *B11 = B, *B12 = B + q, *B21 = B + 2 * q, *B22 = B + 3 * q;
+    int *M = allocateBlock(7 * q);
+    int *M1 = M, *M2 = M + q, *M3 = M + 2 * q, *M4 = M + 3 * q, *M5 = M + 4 * q, *M6 = M + 5 * q, *M7 = M + 6 * q;
+
+    // Each product owns its temporaries so the seven tasks never share scratch space
+    #pragma omp task
+    { int *t = allocateBlock(2 * q); addBlock(A11, A22, t, q); addBlock(B11, B22, t + q, q); mortonStrassen(t, t + q, M1, half, tile); free(t); }
+    #pragma omp task
+    { int *t = allocateBlock(q); addBlock(A21, A22, t, q); mortonStrassen(t, B11, M2, half, tile); free(t); }
+    #pragma omp task
+    { int *t = allocateBlock(q); subtractBlock(B12, B22, t, q); mortonStrassen(A11, t, M3, half, tile); free(t); }
+    #pragma omp task
+    { int *t = allocateBlock(q); subtractBlock(B21, B11, t, q); mortonStrassen(A22, t, M4, half, tile); free(t); }
+    #pragma omp task
+    { int *t = allocateBlock(q); addBlock(A11, A12, t, q); mortonStrassen(t, B22, M5, half, tile); free(t); }
+    #pragma omp task
+    { int *t = allocateBlock(2 * q); subtractBlock(A21, A11, t, q); addBlock(B11, B12, t + q, q); mortonStrassen(t, t + q, M6, half, tile); free(t); }
+    #pragma omp task
+    { int *t = allocateBlock(2 * q); subtractBlock(A12, A22, t, q); addBlock(B21, B22, t + q, q); mortonStrassen(t, t + q, M7, half, tile); free(t); }
+    #pragma omp taskwait
+
+    int *C11 = C, *C12 = C + q, *C21 = C + 2 * q, *C22 = C + 3 * q;
+    #pragma omp simd
+    for (long i = 0; i < q; i++) {
+        C11[i] = M1[i] + M4[i] - M5[i] + M7[i];
+        C12[i] = M3[i] + M5[i];
+        C21[i] = M2[i] + M4[i];
+        C22[i] = M1[i] - M2[i] + M3[i] + M6[i];
+    }
+    free(M);
+}
+
+void mortonStrassenMultiply(const MortonMatrix *A, const MortonMatrix *B, MortonMatrix *C) {
+    #pragma omp parallel
+    {
+        #pragma omp single
+        mortonStrassen(A->data, B->data, C->data, C->padded_size, C->tile);
+    }
+}
+
+// The same recursion on a plain row-major array: quadrants are strided views
+static void rowMajorMultiplyAdd(const int *A, const int *B, int *C, int dim, int ld, int tile) {
+    if (dim == tile) {
+        tileMultiplyAdd(A, ld, B, ld, C, ld, tile);
+        return;
+    }
+
+    int half = dim / 2;
+    long down = (long)half * ld;
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { rowMajorMultiplyAdd(A, B, C, half, ld, tile); rowMajorMultiplyAdd(A + half, B + down, C, half, ld, tile); }
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { rowMajorMultiplyAdd(A, B + half, C + half, half, ld, tile); rowMajorMultiplyAdd(A + half, B + down + half, C + half, half, ld, tile); }
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { rowMajorMultiplyAdd(A + down, B, C + down, half, ld, tile); rowMajorMultiplyAdd(A + down + half, B + down, C + down, half, ld, tile); }
+    #pragma omp task if(dim > TASK_CUTOFF)
+    { rowMajorMultiplyAdd(A + down, B + half, C + down + half, half, ld, tile); rowMajorMultiplyAdd(A + down + half, B + down + half, C + down + half, half, ld, tile); }
+    #pragma omp taskwait
+}
+
+void rowMajorRecursiveMultiply(const int *A, const int *B, int *C, int padded_size, int tile) {
+    memset(C, 0, (long)padded_size * padded_size * sizeof(int));
+    #pragma omp parallel
+    {
+        #pragma omp single
+        rowMajorMultiplyAdd(A, B, C, padded_size, padded_size, tile);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef MORTON_MATRIX_H
+#define MORTON_MATRIX_H
+
+#define MORTON_TILE 32
+
+// Square matrix stored as tile x tile row-major tiles laid out in Z-order.
+// The tile grid is padded to a power of two so every quadrant at every level
+// of the recursion is one contiguous block of memory.
+typedef struct {
+    int size;
+    int padded_size;
+    int tile;
+    int *data;
+} MortonMatrix;
+
+void allocateMortonMatrix(MortonMatrix *matrix, int size, int tile);
+void freeMortonMatrix(MortonMatrix *matrix);
+void rowMajorToMorton(const int *src, int size, MortonMatrix *dst);
+void mortonToRowMajor(const MortonMatrix *src, int *dst, int size);
+
+void mortonMultiply(const MortonMatrix *A, const MortonMatrix *B, MortonMatrix *C);
+void mortonStrassenMultiply(const MortonMatrix *A, const MortonMatrix *B, MortonMatrix *C);
+// The recursive multiply over strided quadrants of a zero-padded row-major
+// array, the baseline the Morton layout is measured against
+void rowMajorRecursiveMultiply(const int *A, const int *B, int *C, int padded_size, int tile);
+
+#endif
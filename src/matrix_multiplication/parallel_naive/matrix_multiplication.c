@@ -1,6 +1,25 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <omp.h>
+#include "../../libpcm/pcm.h"
+#include "../../common/numa_support.h"
+#include "../../common/perf_counters.h"
+#include "../../common/verify.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -DHAVE_LIBNUMA -pthread -o matrixMulti matrix_multiplication.c ../../common/numa_support.c ../../common/perf_counters.c ../../common/verify.c ../../../libpcm.a -lnuma
+    command to execute:
+    ./matrixMulti [matrix_1] [matrix_2] [number of threads] [--verify[=trials]] [--precision=int32|int16|int8|auto] [--isa=scalar|avx2|avx-vnni|avx512-vnni] [--pin=none|compact|scatter] [--numa=default|firsttouch|interleave] [--perf] [--runtime=omp|ws]
+
+    --precision below int32 multiplies int8 or int16 copies of A and B with
+    the widest dot-product kernel the CPU has (or the one --isa names) and
+    then runs the int32 kernel too, to show the results match bit for bit
+    and how much faster the narrow path was. auto picks the narrowest
+    precision the keys fit; the matrices create_matrix_file.py writes, with
+    keys 0-99, fit int8.
+*/
 
 int** allocateMatrix(int size) {
     int** matrix = (int**) malloc(size * sizeof(int*));
@@ -30,6 +49,27 @@ void freeMatrix(int **matrix, int size) {
     free(matrix);
 }
 
+// One contiguous row-major block, as pcmMultiply expects, with row pointers
+// into it. First touch splits its pages statically across the team, which is
+// how the kernel divides its collapse(2) iterations.
+int** allocateMatrixNuma(int size, const NumaOptions *options) {
+    int** matrix = (int**) malloc(size * sizeof(int*));
+    int* block = numaAllocate((size_t)size * size * sizeof(int), options);
+    if (matrix == NULL || block == NULL) {
+        fprintf(stderr, "Memory allocation failed for matrix\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < size; i++) {
+        matrix[i] = block + (size_t)i * size;
+    }
+    return matrix;
+}
+
+void freeMatrixNuma(int **matrix, int size, const NumaOptions *options) {
+    numaFree(matrix[0], (size_t)size * size * sizeof(int), options);
+    free(matrix);
+}
+
 void initializeMatrixFromFile(int **matrix, FILE *file, int size) {
     // Assume the size line has already been read, directly read the matrix data
     for (int i = 0; i < size; i++) {
@@ -42,18 +82,6 @@ void initializeMatrixFromFile(int **matrix, FILE *file, int size) {
     }
 }
 
-void multiplyMatrices(int **A, int **B, int **C, int size) {
-    #pragma omp parallel for collapse(2)
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            C[i][j] = 0;
-            for (int k = 0; k < size; k++) {
-                C[i][j] += A[i][k] * B[k][j];
-            }
-        }
-    }
-}
-
 // void printMatrix(int **matrix, int size) {
 //     if (matrix == NULL) {
 //         printf("Matrix is NULL\n");
@@ -69,12 +97,64 @@ void multiplyMatrices(int **A, int **B, int **C, int size) {
 //     }
 // }
 
+static int parsePrecision(const char *name, int *precision) {
+    for (int p = PCM_PRECISION_INT32; p <= PCM_PRECISION_INT8; p++) {
+        if (strcmp(name, pcmPrecisionName(p)) == 0) {
+            *precision = p;
+            return 1;
+        }
+    }
+    if (strcmp(name, "auto") == 0) {
+        *precision = -1;
+        return 1;
+    }
+    return 0;
+}
+
+static int parseIsa(const char *name, PcmIsa *isa) {
+    for (int i = PCM_ISA_SCALAR; i <= PCM_ISA_AVX512_VNNI; i++) {
+        if (strcmp(name, pcmIsaName(i)) == 0) {
+            *isa = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <input_file_matrix_A> <input_file_matrix_B> <num_of_threads>\n", argv[0]);
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <input_file_matrix_A> <input_file_matrix_B> <num_of_threads> " VERIFY_OPTIONS_USAGE " [--precision=int32|int16|int8|auto] [--isa=scalar|avx2|avx-vnni|avx512-vnni] " NUMA_OPTIONS_USAGE " " PERF_OPTIONS_USAGE " " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
         return -1;
     }
 
+    VerifyOptions verify;
+    defaultVerifyOptions(&verify);
+    int precision = PCM_PRECISION_INT32;    // -1 for auto
+    PcmIsa isa = pcmBestIsa();
+    NumaOptions numa;
+    defaultNumaOptions(&numa);
+    PerfOptions perf_options;
+    defaultPerfOptions(&perf_options);
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    for (int i = 4; i < argc; i++) {
+        if (parseNumaOption(argv[i], &numa) || parsePerfOption(argv[i], &perf_options)
+            || parseRuntimeOption(argv[i], &runtime)
+            || parseVerifyOption(argv[i], &verify)) {
+            continue;
+        } else if (strncmp(argv[i], "--precision=", 12) == 0 && parsePrecision(argv[i] + 12, &precision)) {
+            continue;
+        } else if (strncmp(argv[i], "--isa=", 6) == 0 && parseIsa(argv[i] + 6, &isa)) {
+            if (!pcmIsaSupported(isa)) {
+                fprintf(stderr, "This CPU has no %s; the best it runs is %s\n", argv[i] + 6, pcmIsaName(pcmBestIsa()));
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
     int sizeA = 0, sizeB = 0;
     FILE *fileA = fopen(argv[1], "r");
     FILE *fileB = fopen(argv[2], "r");
@@ -96,9 +176,13 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    int **A = allocateMatrix(sizeA);
-    int **B = allocateMatrix(sizeB);
-    int **C = allocateMatrix(sizeA);
+    int num_threads = atoi(argv[3]);
+    omp_set_num_threads(num_threads);
+    applyThreadPinning(&numa);
+
+    int **A = allocateMatrixNuma(sizeA, &numa);
+    int **B = allocateMatrixNuma(sizeB, &numa);
+    int **C = allocateMatrixNuma(sizeA, &numa);
 
     // Pass the already opened file handles to the initializer
     initializeMatrixFromFile(A, fileA, sizeA);
@@ -107,22 +191,78 @@ int main(int argc, char *argv[]) {
     fclose(fileA);
     fclose(fileB);
 
-    int num_threads = atoi(argv[3]);
-    omp_set_num_threads(num_threads);
 
+    // The context starts its threads before the clock
+    PcmOptions options;
+    pcmDefaultOptions(&options);
+    options.threads = num_threads;
+    options.runtime = runtime.kind;
+    PcmContext *context = pcmContextCreate(&options);
+    if (context == NULL) {
+        fprintf(stderr, "Failed to set up libpcm\n");
+        return -1;
+    }
+
+    if (precision < 0) {
+        precision = pcmNarrowestPrecision(context, A[0], B[0], sizeA, isa);
+    }
+    // Bytes per key of A and B as the kernel reads them
+    int key_bytes = precision == PCM_PRECISION_INT8 ? 1 : (precision == PCM_PRECISION_INT16 ? 2 : sizeof(int));
+
+    // The work-stealing workers are not an OpenMP team, so pin and count them by thread id
+    int *worker_ids = malloc(pcmContextThreads(context) * sizeof(int));
+    int workers = worker_ids != NULL ? pcmRuntimeThreadIds(context, worker_ids) : 0;
+    applyThreadIdPinning(&numa, worker_ids, workers);
+    PerfRegion perf;
+    perfRegionBeginThreads(&perf, &perf_options, "multiplyMatrices", worker_ids, workers);
+    free(worker_ids);
     double start_time = omp_get_wtime();
-    multiplyMatrices(A, B, C, sizeA);
+    int multiply_status = pcmMultiplyQuantized(context, A[0], B[0], C[0], sizeA, precision, isa);
     double end_time = omp_get_wtime();
+    // Compulsory traffic: read A and B and write C once
+    perfRegionEnd(&perf, (long)sizeA * sizeA, (2.0 * key_bytes + sizeof(int)) * sizeA * sizeA);
+    if (multiply_status != PCM_OK) {
+        fprintf(stderr, "The keys do not fit %s for the %s kernel\n", pcmPrecisionName(precision), pcmIsaName(isa));
+        return -1;
+    }
 
     // After multiplication, print the result
     //printf("Resultant Matrix C after multiplication:\n");
     //printMatrix(C, sizeA);
 
     printf("Time taken to multiply two %dx%d matrices with %d threads: %f seconds\n", sizeA, sizeA, num_threads, end_time - start_time);
+    // Before the int32 comparison, which is an API call of its own
+    pcmReportRuntime(context, "multiplyMatrices");
 
-    freeMatrix(A, sizeA);
-    freeMatrix(B, sizeA);
-    freeMatrix(C, sizeA);
+    int status = 0;
+    if (precision != PCM_PRECISION_INT32) {
+        // The int32 kernel on the same input: the results must match bit for bit
+        int **C32 = allocateMatrixNuma(sizeA, &numa);
+        double int32_start = omp_get_wtime();
+        pcmMultiply(context, A[0], B[0], C32[0], sizeA);
+        double int32_time = omp_get_wtime() - int32_start;
+        double quantized_time = end_time - start_time;
+        double operations = 2.0 * sizeA * sizeA * sizeA;
+        int exact = memcmp(C[0], C32[0], (size_t)sizeA * sizeA * sizeof(int)) == 0;
+        printf("%s GEMM (%s kernel): %f seconds, %.2f GOP/s; int32 pcmMultiply: %f seconds, %.2f GOP/s; %.1fx faster, %s\n",
+               pcmPrecisionName(precision), pcmIsaName(isa), quantized_time, operations / quantized_time / 1e9,
+               int32_time, operations / int32_time / 1e9, int32_time / quantized_time,
+               exact ? "bit-exact" : "RESULTS DIFFER");
+        status = !exact;
+        freeMatrixNuma(C32, sizeA, &numa);
+    }
 
-    return 0;
+    if (verify.trials > 0) {
+        status |= reportVerification(verifyRows(A, sizeA), verifyRows(B, sizeA), verifyRows(C, sizeA), verify.trials);
+    }
+
+    reportRowsPlacement("A", (void **)A, sizeA, sizeA * sizeof(int));
+    reportRowsPlacement("C", (void **)C, sizeA, sizeA * sizeof(int));
+    pcmContextDestroy(context);
+
+    freeMatrixNuma(A, sizeA, &numa);
+    freeMatrixNuma(B, sizeA, &numa);
+    freeMatrixNuma(C, sizeA, &numa);
+
+    return status;
 }
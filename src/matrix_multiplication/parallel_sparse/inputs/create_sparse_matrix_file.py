@@ -0,0 +1,26 @@
+import sys
+import numpy as np
+
+def create_sparse_matrix_file(n, density, filename):
+    matrix = np.random.randint(1, 100, size=(n, n))  # Random nonzero integers between 1 and 99
+    matrix[np.random.random(size=(n, n)) >= density] = 0  # Keep roughly `density` of the entries
+    with open(filename, 'w') as f:
+        f.write("{}\n".format(n))
+        for row in matrix:
+            f.write(' '.join(map(str, row.tolist())) + '\n')
+
+def create_sparse_matrix_binary_file(n, density, filename):
+    # int32 size followed by the row-major int32 values, read by files ending in .bin
+    matrix = np.random.randint(1, 100, size=(n, n)).astype(np.int32)
+    matrix[np.random.random(size=(n, n)) >= density] = 0
+    with open(filename, 'wb') as f:
+        np.array([n], dtype=np.int32).tofile(f)
+        matrix.tofile(f)
+
+create_sparse_matrix_file(100, 0.05, 'sparse_matrix_A_100.txt')
+create_sparse_matrix_file(100, 0.05, 'sparse_matrix_B_100.txt')
+create_sparse_matrix_file(1000, 0.02, 'sparse_matrix_A_1000.txt')
+create_sparse_matrix_file(1000, 0.02, 'sparse_matrix_B_1000.txt')
+if len(sys.argv) > 1 and sys.argv[1] == '--large':
+    create_sparse_matrix_binary_file(10000, 0.01, 'sparse_matrix_A_10000.bin')
+    create_sparse_matrix_binary_file(10000, 0.01, 'sparse_matrix_B_10000.bin')
@@ -0,0 +1,450 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "sparse_matrix.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -O2 -fopenmp -o sparseMatrixMulti sparse_matrix.c
+    command to execute:
+    ./sparseMatrixMulti [matrix_1] [matrix_2] [number of threads] [--path=auto|dense|sparse] [--threshold=0.10] [--spmv]
+
+    Matrices are read either from the text format produced by create_matrix_file.py
+    or, when the file name ends in ".bin", from a binary file holding an int32 size
+    followed by size*size int32 values in row-major order.
+*/
+
+#define DEFAULT_DENSITY_THRESHOLD 0.10
+
+int** allocateMatrix(int size) {
+    int** matrix = (int**) malloc(size * sizeof(int*));
+    if (matrix == NULL) {
+        fprintf(stderr, "Memory allocation failed for matrix pointers\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < size; i++) {
+        matrix[i] = (int*) malloc(size * sizeof(int));
+        if (matrix[i] == NULL) {
+            fprintf(stderr, "Memory allocation failed for matrix row %d\n", i);
+            // Free previously allocated rows
+            for (int j = 0; j < i; j++) {
+                free(matrix[j]);
+            }
+            free(matrix);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return matrix;
+}
+
+void freeMatrix(int **matrix, int size) {
+    for (int i = 0; i < size; i++) {
+        free(matrix[i]);
+    }
+    free(matrix);
+}
+
+void multiplyMatrices(int **A, int **B, int **C, int size) {
+    #pragma omp parallel for collapse(2)
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            C[i][j] = 0;
+            for (int k = 0; k < size; k++) {
+                C[i][j] += A[i][k] * B[k][j];
+            }
+        }
+    }
+}
+
+static int hasBinaryExtension(const char *filename) {
+    size_t len = strlen(filename);
+    return len > 4 && strcmp(filename + len - 4, ".bin") == 0;
+}
+
+static void *checkedRealloc(void *ptr, size_t bytes) {
+    void *grown = realloc(ptr, bytes);
+    if (grown == NULL) {
+        fprintf(stderr, "Memory allocation failed for sparse matrix storage\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+// Stream the matrix file straight into CSR so the dense n*n copy never exists
+void readCsrFromFile(const char *filename, CsrMatrix *matrix) {
+    int binary = hasBinaryExtension(filename);
+    FILE *file = fopen(filename, binary ? "rb" : "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening matrix file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    int size = 0;
+    int ok = binary ? fread(&size, sizeof(int), 1, file) == 1 : fscanf(file, "%d", &size) == 1;
+    if (!ok || size <= 0) {
+        fprintf(stderr, "Failed to read matrix size from %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    int capacity = size;
+    matrix->rows = size;
+    matrix->cols = size;
+    matrix->nnz = 0;
+    matrix->row_ptr = checkedRealloc(NULL, (size_t)(size + 1) * sizeof(int));
+    matrix->col_idx = checkedRealloc(NULL, (size_t)capacity * sizeof(int));
+    matrix->values = checkedRealloc(NULL, (size_t)capacity * sizeof(int));
+
+    int *row = checkedRealloc(NULL, (size_t)size * sizeof(int));
+    matrix->row_ptr[0] = 0;
+    for (int i = 0; i < size; i++) {
+        if (binary) {
+            if (fread(row, sizeof(int), size, file) != (size_t)size) {
+                fprintf(stderr, "Failed to read data for matrix row %d\n", i);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            for (int j = 0; j < size; j++) {
+                if (fscanf(file, "%d", &row[j]) != 1) {
+                    fprintf(stderr, "Failed to read data for matrix at [%d][%d]\n", i, j);
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+
+        for (int j = 0; j < size; j++) {
+            if (row[j] == 0) continue;
+            if (matrix->nnz == capacity) {
+                capacity *= 2;
+                matrix->col_idx = checkedRealloc(matrix->col_idx, (size_t)capacity * sizeof(int));
+                matrix->values = checkedRealloc(matrix->values, (size_t)capacity * sizeof(int));
+            }
+            matrix->col_idx[matrix->nnz] = j;
+            matrix->values[matrix->nnz] = row[j];
+            matrix->nnz++;
+        }
+        matrix->row_ptr[i + 1] = matrix->nnz;
+    }
+
+    free(row);
+    fclose(file);
+}
+
+void csrToCsc(const CsrMatrix *csr, CscMatrix *csc) {
+    csc->rows = csr->rows;
+    csc->cols = csr->cols;
+    csc->nnz = csr->nnz;
+    csc->col_ptr = calloc(csr->cols + 1, sizeof(int));
+    csc->row_idx = malloc((size_t)(csr->nnz > 0 ? csr->nnz : 1) * sizeof(int));
+    csc->values = malloc((size_t)(csr->nnz > 0 ? csr->nnz : 1) * sizeof(int));
+    int *next = malloc((size_t)csr->cols * sizeof(int));
+    if (csc->col_ptr == NULL || csc->row_idx == NULL || csc->values == NULL || next == NULL) {
+        fprintf(stderr, "Memory allocation failed for CSC conversion\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Count entries per column, prefix-sum into column offsets, then scatter rows in order
+    for (int nz = 0; nz < csr->nnz; nz++) {
+        csc->col_ptr[csr->col_idx[nz] + 1]++;
+    }
+    for (int j = 0; j < csr->cols; j++) {
+        csc->col_ptr[j + 1] += csc->col_ptr[j];
+        next[j] = csc->col_ptr[j];
+    }
+    for (int i = 0; i < csr->rows; i++) {
+        for (int nz = csr->row_ptr[i]; nz < csr->row_ptr[i + 1]; nz++) {
+            int dest = next[csr->col_idx[nz]]++;
+            csc->row_idx[dest] = i;
+            csc->values[dest] = csr->values[nz];
+        }
+    }
+    free(next);
+}
+
+void freeCsr(CsrMatrix *matrix) {
+    free(matrix->row_ptr);
+    free(matrix->col_idx);
+    free(matrix->values);
+}
+
+void freeCsc(CscMatrix *matrix) {
+    free(matrix->col_ptr);
+    free(matrix->row_idx);
+    free(matrix->values);
+}
+
+double csrDensity(const CsrMatrix *matrix) {
+    return (double)matrix->nnz / ((double)matrix->rows * (double)matrix->cols);
+}
+
+int** csrToDense(const CsrMatrix *csr) {
+    int **dense = allocateMatrix(csr->rows);
+    #pragma omp parallel for
+    for (int i = 0; i < csr->rows; i++) {
+        memset(dense[i], 0, csr->cols * sizeof(int));
+        for (int nz = csr->row_ptr[i]; nz < csr->row_ptr[i + 1]; nz++) {
+            dense[i][csr->col_idx[nz]] = csr->values[nz];
+        }
+    }
+    return dense;
+}
+
+// Locate where diagonal `diagonal` crosses the merge path of the row end offsets
+// (row_ptr + 1) and the nonzero indices. Every thread gets the same number of
+// rows + nonzeros, so a few very long rows can no longer serialize the run.
+static void mergePathSearch(int diagonal, const int *row_end_offsets, int num_rows, int nnz,
+                            int *path_row, int *path_nz) {
+    int row_min = diagonal - nnz > 0 ? diagonal - nnz : 0;
+    int row_max = diagonal < num_rows ? diagonal : num_rows;
+    while (row_min < row_max) {
+        int pivot = row_min + (row_max - row_min) / 2;
+        if (row_end_offsets[pivot] <= diagonal - pivot - 1) {
+            row_min = pivot + 1;
+        } else {
+            row_max = pivot;
+        }
+    }
+    *path_row = row_min;
+    *path_nz = diagonal - row_min;
+}
+
+void spmvMergePath(const CsrMatrix *A, const int *x, int *y) {
+    int num_threads = omp_get_max_threads();
+    int *carry_row = malloc(num_threads * sizeof(int));
+    int *carry_value = malloc(num_threads * sizeof(int));
+    if (carry_row == NULL || carry_value == NULL) {
+        fprintf(stderr, "Memory allocation failed for SpMV carries\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int path_length = A->rows + A->nnz;
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        int items_per_thread = (path_length + num_threads - 1) / num_threads;
+        int diagonal_start = tid * items_per_thread < path_length ? tid * items_per_thread : path_length;
+        int diagonal_end = diagonal_start + items_per_thread < path_length ? diagonal_start + items_per_thread : path_length;
+
+        int row, nz, row_end, nz_end;
+        mergePathSearch(diagonal_start, A->row_ptr + 1, A->rows, A->nnz, &row, &nz);
+        mergePathSearch(diagonal_end, A->row_ptr + 1, A->rows, A->nnz, &row_end, &nz_end);
+
+        // Rows that end inside this thread's share are written directly
+        for (; row < row_end; row++) {
+            int sum = 0;
+            for (; nz < A->row_ptr[row + 1]; nz++) {
+                sum += A->values[nz] * x[A->col_idx[nz]];
+            }
+            y[row] = sum;
+        }
+
+        // The trailing partial row is carried out and fixed up after the join
+        int sum = 0;
+        for (; nz < nz_end; nz++) {
+            sum += A->values[nz] * x[A->col_idx[nz]];
+        }
+        carry_row[tid] = row_end;
+        carry_value[tid] = sum;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        if (carry_row[t] < A->rows) {
+            y[carry_row[t]] += carry_value[t];
+        }
+    }
+    free(carry_row);
+    free(carry_value);
+}
+
+static void axpyRow(int *dest, const int *src, int scale, int length) {
+    for (int j = 0; j < length; j++) {
+        dest[j] += scale * src[j];
+    }
+}
+
+// C = A * B with A in CSR and B dense. Work is split along the same merge path as
+// SpMV, where each nonzero of A costs one row update of C.
+void spmmCsrDense(const CsrMatrix *A, int **B, int **C) {
+    int size = A->cols;
+    int num_threads = omp_get_max_threads();
+    int *carry_row = malloc(num_threads * sizeof(int));
+    int *carry = malloc((size_t)num_threads * size * sizeof(int));
+    if (carry_row == NULL || carry == NULL) {
+        fprintf(stderr, "Memory allocation failed for SpMM carries\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int path_length = A->rows + A->nnz;
+    #pragma omp parallel num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        int items_per_thread = (path_length + num_threads - 1) / num_threads;
+        int diagonal_start = tid * items_per_thread < path_length ? tid * items_per_thread : path_length;
+        int diagonal_end = diagonal_start + items_per_thread < path_length ? diagonal_start + items_per_thread : path_length;
+
+        int row, nz, row_end, nz_end;
+        mergePathSearch(diagonal_start, A->row_ptr + 1, A->rows, A->nnz, &row, &nz);
+        mergePathSearch(diagonal_end, A->row_ptr + 1, A->rows, A->nnz, &row_end, &nz_end);
+
+        for (; row < row_end; row++) {
+            memset(C[row], 0, size * sizeof(int));
+            for (; nz < A->row_ptr[row + 1]; nz++) {
+                axpyRow(C[row], B[A->col_idx[nz]], A->values[nz], size);
+            }
+        }
+
+        int *thread_carry = carry + (size_t)tid * size;
+        memset(thread_carry, 0, size * sizeof(int));
+        for (; nz < nz_end; nz++) {
+            axpyRow(thread_carry, B[A->col_idx[nz]], A->values[nz], size);
+        }
+        carry_row[tid] = row_end;
+    }
+
+    for (int t = 0; t < num_threads; t++) {
+        if (carry_row[t] < A->rows) {
+            axpyRow(C[carry_row[t]], carry + (size_t)t * size, 1, size);
+        }
+    }
+    free(carry);
+    free(carry_row);
+}
+
+// C = A * B with A dense and B in CSC. Every row of C costs nnz(B) + n, so a
+// static row split is already balanced; each row of A is gathered from cache.
+void spmmDenseCsc(int **A, const CscMatrix *B, int **C, int size) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < size; i++) {
+        const int *a_row = A[i];
+        for (int j = 0; j < B->cols; j++) {
+            int sum = 0;
+            for (int nz = B->col_ptr[j]; nz < B->col_ptr[j + 1]; nz++) {
+                sum += a_row[B->row_idx[nz]] * B->values[nz];
+            }
+            C[i][j] = sum;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <input_file_matrix_A> <input_file_matrix_B> <num_of_threads> [--path=auto|dense|sparse] [--threshold=<density>] [--spmv]\n", argv[0]);
+        return -1;
+    }
+
+    const char *path = "auto";
+    double threshold = DEFAULT_DENSITY_THRESHOLD;
+    int run_spmv = 0;
+    for (int i = 4; i < argc; i++) {
+        if (strncmp(argv[i], "--path=", 7) == 0) {
+            path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = atof(argv[i] + 12);
+        } else if (strcmp(argv[i], "--spmv") == 0) {
+            run_spmv = 1;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (strcmp(path, "auto") != 0 && strcmp(path, "dense") != 0 && strcmp(path, "sparse") != 0) {
+        fprintf(stderr, "--path must be one of auto, dense or sparse\n");
+        return -1;
+    }
+
+    int num_threads = atoi(argv[3]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+
+    CsrMatrix A, B;
+    readCsrFromFile(argv[1], &A);
+    readCsrFromFile(argv[2], &B);
+    if (A.rows != B.rows) {
+        fprintf(stderr, "Matrix dimensions must match!\n");
+        freeCsr(&A);
+        freeCsr(&B);
+        return -1;
+    }
+    int size = A.rows;
+
+    double density_A = csrDensity(&A);
+    double density_B = csrDensity(&B);
+    printf("Density of A: %.2f%% (%d nonzeros), density of B: %.2f%% (%d nonzeros)\n",
+           density_A * 100.0, A.nnz, density_B * 100.0, B.nnz);
+
+    omp_set_num_threads(num_threads);
+
+    // Pick the operand that makes the sparse kernel cheapest; fall back to the
+    // dense kernel when neither operand is sparse enough to pay for indirection.
+    const char *kernel;
+    if (strcmp(path, "dense") == 0) {
+        kernel = "dense";
+    } else if (density_A <= threshold || (strcmp(path, "sparse") == 0 && density_A <= density_B)) {
+        kernel = "csr x dense";
+    } else if (density_B <= threshold || strcmp(path, "sparse") == 0) {
+        kernel = "dense x csc";
+    } else {
+        kernel = "dense";
+    }
+
+    int **C = allocateMatrix(size);
+    double start_time, end_time;
+    if (strcmp(kernel, "csr x dense") == 0) {
+        int **denseB = csrToDense(&B);
+        start_time = omp_get_wtime();
+        spmmCsrDense(&A, denseB, C);
+        end_time = omp_get_wtime();
+        freeMatrix(denseB, size);
+    } else if (strcmp(kernel, "dense x csc") == 0) {
+        int **denseA = csrToDense(&A);
+        CscMatrix cscB;
+        csrToCsc(&B, &cscB);
+        start_time = omp_get_wtime();
+        spmmDenseCsc(denseA, &cscB, C, size);
+        end_time = omp_get_wtime();
+        freeCsc(&cscB);
+        freeMatrix(denseA, size);
+    } else {
+        int **denseA = csrToDense(&A);
+        int **denseB = csrToDense(&B);
+        start_time = omp_get_wtime();
+        multiplyMatrices(denseA, denseB, C, size);
+        end_time = omp_get_wtime();
+        freeMatrix(denseA, size);
+        freeMatrix(denseB, size);
+    }
+
+    printf("Kernel: %s (density threshold %.2f%%)\n", kernel, threshold * 100.0);
+    printf("Time taken to multiply two %dx%d matrices with %d threads: %f seconds\n", size, size, num_threads, end_time - start_time);
+
+    if (run_spmv) {
+        int *x = malloc(size * sizeof(int));
+        int *y = malloc(size * sizeof(int));
+        if (x == NULL || y == NULL) {
+            fprintf(stderr, "Memory allocation failed for SpMV vectors\n");
+            return -1;
+        }
+        for (int i = 0; i < size; i++) {
+            x[i] = 1;
+        }
+        double spmv_start = omp_get_wtime();
+        spmvMergePath(&A, x, y);
+        double spmv_end = omp_get_wtime();
+
+        long long checksum = 0;
+        for (int i = 0; i < size; i++) {
+            checksum += y[i];
+        }
+        printf("Time taken for SpMV y = A * 1 with %d threads: %f seconds (sum of y: %lld)\n", num_threads, spmv_end - spmv_start, checksum);
+        free(x);
+        free(y);
+    }
+
+    freeMatrix(C, size);
+    freeCsr(&A);
+    freeCsr(&B);
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+// Compressed sparse row storage: row i owns values[row_ptr[i] .. row_ptr[i+1]-1]
+typedef struct {
+    int rows;
+    int cols;
+    int nnz;
+    int *row_ptr;
+    int *col_idx;
+    int *values;
+} CsrMatrix;
+
+// Compressed sparse column storage: column j owns values[col_ptr[j] .. col_ptr[j+1]-1]
+typedef struct {
+    int rows;
+    int cols;
+    int nnz;
+    int *col_ptr;
+    int *row_idx;
+    int *values;
+} CscMatrix;
+
+void readCsrFromFile(const char *filename, CsrMatrix *matrix);
+void csrToCsc(const CsrMatrix *csr, CscMatrix *csc);
+void freeCsr(CsrMatrix *matrix);
+void freeCsc(CscMatrix *matrix);
+double csrDensity(const CsrMatrix *matrix);
+int** csrToDense(const CsrMatrix *csr);
+
+void spmvMergePath(const CsrMatrix *A, const int *x, int *y);
+void spmmCsrDense(const CsrMatrix *A, int **B, int **C);
+void spmmDenseCsc(int **A, const CscMatrix *B, int **C, int size);
+
+#endif
@@ -1,12 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <omp.h>
+#include "../../common/numa_support.h"
+#include "../../common/perf_counters.h"
+#include "../../common/verify.h"
+#include "../../common/task_trace.h"
+#include "../../common/work_stealing.h"
+#include "../parallel_morton/morton_matrix.h"
 
 /*
     command to compilte:
-    gcc -Wall -std=c99 -fopenmp -o strassenMatrixMulti matrix_multiplication.c
+    gcc -Wall -std=c99 -O2 -fopenmp -DHAVE_LIBNUMA -pthread -o strassenMatrixMulti matrix_multiplication.c ../parallel_morton/morton_matrix.c ../../common/numa_support.c ../../common/perf_counters.c ../../common/verify.c ../../common/task_trace.c ../../common/work_stealing.c -lnuma
     command to execute:
-    ./strassenMatrixMulti [matrix_1] [matrix_2] [number of threads]
+    ./strassenMatrixMulti [matrix_1] [matrix_2] [number of threads] [--verify[=trials]] [--layout=rowmajor|morton] [--pin=none|compact|scatter] [--numa=default|firsttouch|interleave] [--perf] [--trace[=trace.json]] [--runtime=omp|ws]
+
+    --layout=morton converts A and B to the Z-order tiled layout of
+    parallel_morton and runs Strassen there, where every quadrant is a
+    contiguous block and needs no split or join copies.
 */
 
 int** allocateMatrix(int size) {
@@ -37,6 +48,34 @@ void freeMatrix(int **matrix, int size) {
     free(matrix);
 }
 
+// Rows are allocated by the thread that owns them under a static row split,
+// which is how multiplyMatrices() divides its collapse(2) iterations
+int** allocateMatrixNuma(int size, const NumaOptions *options) {
+    int** matrix = (int**) malloc(size * sizeof(int*));
+    if (matrix == NULL) {
+        fprintf(stderr, "Memory allocation failed for matrix pointers\n");
+        exit(EXIT_FAILURE);
+    }
+    int failed = 0;
+    #pragma omp parallel for schedule(static) reduction(||:failed)
+    for (int i = 0; i < size; i++) {
+        matrix[i] = (int*) numaAllocate(size * sizeof(int), options);
+        failed = failed || matrix[i] == NULL;
+    }
+    if (failed) {
+        fprintf(stderr, "Memory allocation failed for matrix rows\n");
+        exit(EXIT_FAILURE);
+    }
+    return matrix;
+}
+
+void freeMatrixNuma(int **matrix, int size, const NumaOptions *options) {
+    for (int i = 0; i < size; i++) {
+        numaFree(matrix[i], size * sizeof(int), options);
+    }
+    free(matrix);
+}
+
 void initializeMatrixFromFile(int **matrix, FILE *file, int size) {
     // Assume the size line has already been read, directly read the matrix data
     for (int i = 0; i < size; i++) {
@@ -79,9 +118,35 @@ void multiplyMatrices(int **A, int **B, int **result, int size) {
     }
 }
 
-double task_total = 0.0;
-int task_count = 0;
-double start_time, end_time, total_time;
+// Copy the four new_size x new_size quadrants out of an n x n matrix. When n is
+// odd the bottom and right quadrants run one past the edge and are zero-filled.
+void splitQuadrants(int **M, int **M11, int **M12, int **M21, int **M22, int n, int new_size) {
+    #pragma omp parallel for collapse(2)
+    for (int i = 0; i < new_size; i++) {
+        for (int j = 0; j < new_size; j++) {
+            int row = i + new_size, col = j + new_size;
+            M11[i][j] = M[i][j];
+            M12[i][j] = col < n ? M[i][col] : 0;
+            M21[i][j] = row < n ? M[row][j] : 0;
+            M22[i][j] = (row < n && col < n) ? M[row][col] : 0;
+        }
+    }
+}
+
+// Write the quadrants back into the n x n result, dropping any padding
+void joinQuadrants(int **M11, int **M12, int **M21, int **M22, int **M, int n, int new_size) {
+    #pragma omp parallel for collapse(2)
+    for (int i = 0; i < new_size; i++) {
+        for (int j = 0; j < new_size; j++) {
+            int row = i + new_size, col = j + new_size;
+            M[i][j] = M11[i][j];
+            if (col < n) M[i][col] = M12[i][j];
+            if (row < n) M[row][j] = M21[i][j];
+            if (row < n && col < n) M[row][col] = M22[i][j];
+        }
+    }
+}
+
 void parallel_strassenMultiply(int **A, int **B, int **C, int n) {
     // Base case size, using direct multiplication for small matrices
     if (n <= 32) {  
@@ -89,7 +154,7 @@ void parallel_strassenMultiply(int **A, int **B, int **C, int n) {
         return;
     }
 
-    int new_size = n / 2;
+    int new_size = (n + 1) / 2;  // odd sizes get a zero row and column of padding
     int** A11 = allocateMatrix(new_size);
     int** A12 = allocateMatrix(new_size);
     int** A21 = allocateMatrix(new_size);
@@ -109,135 +174,123 @@ void parallel_strassenMultiply(int **A, int **B, int **C, int n) {
     int** M5 = allocateMatrix(new_size);
     int** M6 = allocateMatrix(new_size);
     int** M7 = allocateMatrix(new_size);
-    int** tempA = allocateMatrix(new_size);
-    int** tempB = allocateMatrix(new_size);
+    int** tempA[7];
+    int** tempB[7];
+    for (int t = 0; t < 7; t++) {
+        // Sections run concurrently, so each product needs its own scratch matrices
+        tempA[t] = allocateMatrix(new_size);
+        tempB[t] = allocateMatrix(new_size);
+    }
+
+    splitQuadrants(A, A11, A12, A21, A22, n, new_size);
+    splitQuadrants(B, B11, B12, B21, B22, n, new_size);
 
-    start_time = omp_get_wtime();
     // Divide matrices into quarters and call parallel_strassenMultiply recursively
+    TraceSpawn spawn = traceSpawn();
+    double wait = traceWaitBegin();
     #pragma omp parallel sections
     {
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            addMatrix(A11, A22, tempA, new_size); addMatrix(B11, B22, tempB, new_size); parallel_strassenMultiply(tempA, tempB, M1, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "M1", spawn);
+            addMatrix(A11, A22, tempA[0], new_size); addMatrix(B11, B22, tempB[0], new_size); parallel_strassenMultiply(tempA[0], tempB[0], M1, new_size); 
+            traceTaskEnd(&trace);
         }
 
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            addMatrix(A21, A22, tempA, new_size); parallel_strassenMultiply(tempA, B11, M2, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "M2", spawn);
+            addMatrix(A21, A22, tempA[1], new_size); parallel_strassenMultiply(tempA[1], B11, M2, new_size); 
+            traceTaskEnd(&trace);
         }
         
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            subtractMatrix(B12, B22, tempB, new_size); parallel_strassenMultiply(A11, tempB, M3, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "M3", spawn);
+            subtractMatrix(B12, B22, tempB[2], new_size); parallel_strassenMultiply(A11, tempB[2], M3, new_size); 
+            traceTaskEnd(&trace);
         }
 
 
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            subtractMatrix(B21, B11, tempB, new_size); parallel_strassenMultiply(A22, tempB, M4, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "M4", spawn);
+            subtractMatrix(B21, B11, tempB[3], new_size); parallel_strassenMultiply(A22, tempB[3], M4, new_size); 
+            traceTaskEnd(&trace);
         }
 
 
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            addMatrix(A11, A12, tempA, new_size); parallel_strassenMultiply(tempA, B22, M5, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "M5", spawn);
+            addMatrix(A11, A12, tempA[4], new_size); parallel_strassenMultiply(tempA[4], B22, M5, new_size); 
+            traceTaskEnd(&trace);
         }
 
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            subtractMatrix(A21, A11, tempA, new_size); addMatrix(B11, B12, tempB, new_size); parallel_strassenMultiply(tempA, tempB, M6, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "M6", spawn);
+            subtractMatrix(A21, A11, tempA[5], new_size); addMatrix(B11, B12, tempB[5], new_size); parallel_strassenMultiply(tempA[5], tempB[5], M6, new_size); 
+            traceTaskEnd(&trace);
         }
 
 
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            subtractMatrix(A12, A22, tempA, new_size); addMatrix(B21, B22, tempB, new_size); parallel_strassenMultiply(tempA, tempB, M7, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "M7", spawn);
+            subtractMatrix(A12, A22, tempA[6], new_size); addMatrix(B21, B22, tempB[6], new_size); parallel_strassenMultiply(tempA[6], tempB[6], M7, new_size); 
+            traceTaskEnd(&trace);
         }
     }
-    end_time = omp_get_wtime(); // Capture end time after parallel section
-    total_time = end_time - start_time;
+    traceWaitEnd(wait);
 
     // Combine results into the final matrix C
-    start_time = omp_get_wtime();
+    spawn = traceSpawn();
+    wait = traceWaitBegin();
     #pragma omp parallel sections
     {
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            addMatrix(M1, M4, tempA, new_size); subtractMatrix(tempA, M5, tempB, new_size); addMatrix(tempB, M7, C11, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "C11", spawn);
+            addMatrix(M1, M4, tempA[0], new_size); subtractMatrix(tempA[0], M5, tempB[0], new_size); addMatrix(tempB[0], M7, C11, new_size); 
+            traceTaskEnd(&trace);
         }
 
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
+            TraceTask trace;
+            traceTaskBegin(&trace, "C12", spawn);
             addMatrix(M3, M5, C12, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            traceTaskEnd(&trace);
         }
         
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
+            TraceTask trace;
+            traceTaskBegin(&trace, "C21", spawn);
             addMatrix(M2, M4, C21, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            traceTaskEnd(&trace);
         }
 
         #pragma omp section
         { 
-            double local_start = omp_get_wtime();
-            addMatrix(M1, M3, tempA, new_size); subtractMatrix(tempA, M2, tempB, new_size); addMatrix(tempB, M6, C22, new_size); 
-            double local_end = omp_get_wtime();
-            task_total += local_end - local_start;
-            #pragma omp atomic
-            task_count++;
+            TraceTask trace;
+            traceTaskBegin(&trace, "C22", spawn);
+            addMatrix(M1, M3, tempA[3], new_size); subtractMatrix(tempA[3], M2, tempB[3], new_size); addMatrix(tempB[3], M6, C22, new_size); 
+            traceTaskEnd(&trace);
         }
     }
-    end_time = omp_get_wtime(); // Capture end time after parallel section
-    total_time += end_time - start_time;
+    traceWaitEnd(wait);
+
+    joinQuadrants(C11, C12, C21, C22, C, n, new_size);
 
     // Deallocate temporary matrices
     freeMatrix(A11, new_size);
@@ -259,8 +312,177 @@ void parallel_strassenMultiply(int **A, int **B, int **C, int n) {
     freeMatrix(M5, new_size);
     freeMatrix(M6, new_size);
     freeMatrix(M7, new_size);
-    freeMatrix(tempA, new_size);
-    freeMatrix(tempB, new_size);
+    for (int t = 0; t < 7; t++) {
+        freeMatrix(tempA[t], new_size);
+        freeMatrix(tempB[t], new_size);
+    }
+}
+
+// A Strassen operand: the matrix a itself when b is NULL, otherwise a + b or
+// a - b written into the task's own scratch matrix
+typedef struct {
+    int **a;
+    int **b;
+    int sign;
+    int **scratch;
+} StrassenOperand;
+
+typedef struct {
+    const char *name;
+    StrassenOperand left;
+    StrassenOperand right;
+    int **product;
+    int size;
+    TraceSpawn spawn;
+} StrassenProduct;
+
+// result = sum of sign[t] * term[t]
+typedef struct {
+    const char *name;
+    int **term[4];
+    int sign[4];
+    int terms;
+    int **result;
+    int size;
+    TraceSpawn spawn;
+} StrassenCombine;
+
+void ws_strassenMultiply(int **A, int **B, int **C, int n);
+
+static int** evaluateOperand(StrassenOperand *operand, int size) {
+    if (operand->b == NULL) return operand->a;
+    if (operand->sign > 0) addMatrix(operand->a, operand->b, operand->scratch, size);
+    else subtractMatrix(operand->a, operand->b, operand->scratch, size);
+    return operand->scratch;
+}
+
+static void strassenProductTask(void *arg) {
+    StrassenProduct *task = arg;
+    TraceTask trace;
+    traceTaskBegin(&trace, task->name, task->spawn);
+    int **left = evaluateOperand(&task->left, task->size);
+    int **right = evaluateOperand(&task->right, task->size);
+    ws_strassenMultiply(left, right, task->product, task->size);
+    traceTaskEnd(&trace);
+}
+
+static void strassenCombineTask(void *arg) {
+    StrassenCombine *task = arg;
+    TraceTask trace;
+    traceTaskBegin(&trace, task->name, task->spawn);
+    for (int i = 0; i < task->size; i++) {
+        for (int j = 0; j < task->size; j++) {
+            int sum = 0;
+            for (int t = 0; t < task->terms; t++) {
+                sum += task->sign[t] * task->term[t][i][j];
+            }
+            task->result[i][j] = sum;
+        }
+    }
+    traceTaskEnd(&trace);
+}
+
+// Strassen on the work-stealing runtime. Six products and three combinations
+// are spawned, the last of each runs on this worker, then all are joined.
+// Workers run the OpenMP loops in the helpers with one thread.
+void ws_strassenMultiply(int **A, int **B, int **C, int n) {
+    // Base case size, using direct multiplication for small matrices
+    if (n <= 32) {
+        multiplyMatrices(A, B, C, n);
+        return;
+    }
+
+    int new_size = (n + 1) / 2;  // odd sizes get a zero row and column of padding
+    int **A11 = allocateMatrix(new_size), **A12 = allocateMatrix(new_size);
+    int **A21 = allocateMatrix(new_size), **A22 = allocateMatrix(new_size);
+    int **B11 = allocateMatrix(new_size), **B12 = allocateMatrix(new_size);
+    int **B21 = allocateMatrix(new_size), **B22 = allocateMatrix(new_size);
+    int **C11 = allocateMatrix(new_size), **C12 = allocateMatrix(new_size);
+    int **C21 = allocateMatrix(new_size), **C22 = allocateMatrix(new_size);
+    int **M[7], **tempA[7], **tempB[7];
+    for (int t = 0; t < 7; t++) {
+        M[t] = allocateMatrix(new_size);
+        tempA[t] = allocateMatrix(new_size);
+        tempB[t] = allocateMatrix(new_size);
+    }
+
+    splitQuadrants(A, A11, A12, A21, A22, n, new_size);
+    splitQuadrants(B, B11, B12, B21, B22, n, new_size);
+
+    TraceSpawn spawn = traceSpawn();
+    StrassenProduct products[7] = {
+        { "M1", { A11, A22, 1, tempA[0] }, { B11, B22, 1, tempB[0] }, M[0], new_size, spawn },
+        { "M2", { A21, A22, 1, tempA[1] }, { B11, NULL, 0, NULL }, M[1], new_size, spawn },
+        { "M3", { A11, NULL, 0, NULL }, { B12, B22, -1, tempB[2] }, M[2], new_size, spawn },
+        { "M4", { A22, NULL, 0, NULL }, { B21, B11, -1, tempB[3] }, M[3], new_size, spawn },
+        { "M5", { A11, A12, 1, tempA[4] }, { B22, NULL, 0, NULL }, M[4], new_size, spawn },
+        { "M6", { A21, A11, -1, tempA[5] }, { B11, B12, 1, tempB[5] }, M[5], new_size, spawn },
+        { "M7", { A12, A22, -1, tempA[6] }, { B21, B22, 1, tempB[6] }, M[6], new_size, spawn },
+    };
+    WsTask product_tasks[6];
+    for (int t = 0; t < 6; t++) {
+        wsSpawn(&product_tasks[t], strassenProductTask, &products[t]);
+    }
+    strassenProductTask(&products[6]);
+    double wait = traceWaitBegin();
+    for (int t = 5; t >= 0; t--) {
+        wsJoin(&product_tasks[t]);
+    }
+    traceWaitEnd(wait);
+
+    spawn = traceSpawn();
+    StrassenCombine combines[4] = {
+        { "C11", { M[0], M[3], M[4], M[6] }, { 1, 1, -1, 1 }, 4, C11, new_size, spawn },
+        { "C12", { M[2], M[4] }, { 1, 1 }, 2, C12, new_size, spawn },
+        { "C21", { M[1], M[3] }, { 1, 1 }, 2, C21, new_size, spawn },
+        { "C22", { M[0], M[1], M[2], M[5] }, { 1, -1, 1, 1 }, 4, C22, new_size, spawn },
+    };
+    WsTask combine_tasks[3];
+    for (int t = 0; t < 3; t++) {
+        wsSpawn(&combine_tasks[t], strassenCombineTask, &combines[t]);
+    }
+    strassenCombineTask(&combines[3]);
+    wait = traceWaitBegin();
+    for (int t = 2; t >= 0; t--) {
+        wsJoin(&combine_tasks[t]);
+    }
+    traceWaitEnd(wait);
+
+    joinQuadrants(C11, C12, C21, C22, C, n, new_size);
+
+    freeMatrix(A11, new_size);
+    freeMatrix(A12, new_size);
+    freeMatrix(A21, new_size);
+    freeMatrix(A22, new_size);
+    freeMatrix(B11, new_size);
+    freeMatrix(B12, new_size);
+    freeMatrix(B21, new_size);
+    freeMatrix(B22, new_size);
+    freeMatrix(C11, new_size);
+    freeMatrix(C12, new_size);
+    freeMatrix(C21, new_size);
+    freeMatrix(C22, new_size);
+    for (int t = 0; t < 7; t++) {
+        freeMatrix(M[t], new_size);
+        freeMatrix(tempA[t], new_size);
+        freeMatrix(tempB[t], new_size);
+    }
+}
+
+typedef struct {
+    int **A;
+    int **B;
+    int **C;
+    int n;
+    TraceSpawn spawn;
+} StrassenRoot;
+
+static void strassenRootTask(void *arg) {
+    StrassenRoot *root = arg;
+    TraceTask trace;
+    traceTaskBegin(&trace, "strassen", root->spawn);
+    ws_strassenMultiply(root->A, root->B, root->C, root->n);
+    traceTaskEnd(&trace);
 }
 
 void strassenMultiply(int **A, int **B, int **C, int n) {
@@ -270,7 +492,7 @@ void strassenMultiply(int **A, int **B, int **C, int n) {
         return;
     }
 
-    int new_size = n / 2;
+    int new_size = (n + 1) / 2;  // odd sizes get a zero row and column of padding
     int** A11 = allocateMatrix(new_size);
     int** A12 = allocateMatrix(new_size);
     int** A21 = allocateMatrix(new_size);
@@ -293,6 +515,9 @@ void strassenMultiply(int **A, int **B, int **C, int n) {
     int** tempA = allocateMatrix(new_size);
     int** tempB = allocateMatrix(new_size);
 
+    splitQuadrants(A, A11, A12, A21, A22, n, new_size);
+    splitQuadrants(B, B11, B12, B21, B22, n, new_size);
+
     addMatrix(A11, A22, tempA, new_size); addMatrix(B11, B22, tempB, new_size); strassenMultiply(tempA, tempB, M1, new_size);
     addMatrix(A21, A22, tempA, new_size); strassenMultiply(tempA, B11, M2, new_size);
     subtractMatrix(B12, B22, tempB, new_size); strassenMultiply(A11, tempB, M3, new_size);
@@ -306,6 +531,8 @@ void strassenMultiply(int **A, int **B, int **C, int n) {
     addMatrix(M2, M4, C21, new_size);
     addMatrix(M1, M3, tempA, new_size); subtractMatrix(tempA, M2, tempB, new_size); addMatrix(tempB, M6, C22, new_size);
 
+    joinQuadrants(C11, C12, C21, C22, C, n, new_size);
+
     // Deallocate temporary matrices
     freeMatrix(A11, new_size);
     freeMatrix(A12, new_size);
@@ -330,6 +557,35 @@ void strassenMultiply(int **A, int **B, int **C, int n) {
     freeMatrix(tempB, new_size);
 }
 
+// Row pointers to and from the Morton layout, through one contiguous copy
+static void rowsToMorton(int **M, int size, MortonMatrix *dst) {
+    int *flat = malloc((long)size * size * sizeof(int));
+    if (flat == NULL) {
+        fprintf(stderr, "Memory allocation failed for Morton conversion\n");
+        exit(EXIT_FAILURE);
+    }
+    #pragma omp parallel for
+    for (int i = 0; i < size; i++) {
+        memcpy(flat + (long)i * size, M[i], size * sizeof(int));
+    }
+    rowMajorToMorton(flat, size, dst);
+    free(flat);
+}
+
+static void mortonToRows(const MortonMatrix *src, int **M, int size) {
+    int *flat = malloc((long)size * size * sizeof(int));
+    if (flat == NULL) {
+        fprintf(stderr, "Memory allocation failed for Morton conversion\n");
+        exit(EXIT_FAILURE);
+    }
+    mortonToRowMajor(src, flat, size);
+    #pragma omp parallel for
+    for (int i = 0; i < size; i++) {
+        memcpy(M[i], flat + (long)i * size, size * sizeof(int));
+    }
+    free(flat);
+}
+
 void printMatrix(int **matrix, int size) {
     if (matrix == NULL) {
         printf("Matrix is NULL\n");
@@ -375,8 +631,38 @@ int** deepCopy2DArray(int** original, int rows, int cols) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <input_file_matrix_A> <input_file_matrix_B> <num_of_threads>\n", argv[0]);
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <input_file_matrix_A> <input_file_matrix_B> <num_of_threads> " VERIFY_OPTIONS_USAGE " " NUMA_OPTIONS_USAGE " " PERF_OPTIONS_USAGE " " TRACE_OPTIONS_USAGE " " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        return -1;
+    }
+
+    VerifyOptions verify;
+    defaultVerifyOptions(&verify);
+    int morton_layout = 0;
+    NumaOptions numa;
+    defaultNumaOptions(&numa);
+    PerfOptions perf_options;
+    defaultPerfOptions(&perf_options);
+    TraceOptions trace_options;
+    defaultTraceOptions(&trace_options);
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    for (int i = 4; i < argc; i++) {
+        if (parseNumaOption(argv[i], &numa) || parsePerfOption(argv[i], &perf_options)
+            || parseTraceOption(argv[i], &trace_options) || parseRuntimeOption(argv[i], &runtime)
+            || parseVerifyOption(argv[i], &verify)) {
+            continue;
+        } else if (strcmp(argv[i], "--layout=rowmajor") == 0) {
+            morton_layout = 0;
+        } else if (strcmp(argv[i], "--layout=morton") == 0) {
+            morton_layout = 1;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (morton_layout && runtime.kind == RUNTIME_WS) {
+        fprintf(stderr, "--layout=morton runs on OpenMP tasks and cannot be combined with --runtime=ws\n");
         return -1;
     }
 
@@ -401,9 +687,13 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    int **A = allocateMatrix(sizeA);
-    int **B = allocateMatrix(sizeB);
-    int **C = allocateMatrix(sizeA);
+    int num_threads = atoi(argv[3]);
+    omp_set_num_threads(num_threads);
+    applyThreadPinning(&numa);
+
+    int **A = allocateMatrixNuma(sizeA, &numa);
+    int **B = allocateMatrixNuma(sizeB, &numa);
+    int **C = allocateMatrixNuma(sizeA, &numa);
 
     // Pass the already opened file handles to the initializer
     initializeMatrixFromFile(A, fileA, sizeA);
@@ -416,24 +706,83 @@ int main(int argc, char *argv[]) {
     int **copy_B = deepCopy2DArray(B, sizeB, sizeB);
     int **copy_C = deepCopy2DArray(C, sizeA, sizeA);
 
-    int num_threads = atoi(argv[3]);
-    omp_set_num_threads(num_threads);
     omp_set_dynamic(0);
 
-    double start_time = omp_get_wtime();
-    parallel_strassenMultiply(A, B, C, sizeA);
-    double end_time = omp_get_wtime();
+    // The pool's workers start before the clock, like the OpenMP team that persists between regions
+    WsPool *pool = runtime.kind == RUNTIME_WS ? wsPoolCreate(num_threads) : NULL;
+    const char *kernel = runtime.kind == RUNTIME_WS ? "ws_strassenMultiply" : "parallel_strassenMultiply";
+    MortonMatrix mA, mB, mC;
+    if (morton_layout) {
+        kernel = "mortonStrassenMultiply";
+        allocateMortonMatrix(&mA, sizeA, MORTON_TILE);
+        allocateMortonMatrix(&mB, sizeA, MORTON_TILE);
+        allocateMortonMatrix(&mC, sizeA, MORTON_TILE);
+        double convert_start = omp_get_wtime();
+        rowsToMorton(A, sizeA, &mA);
+        rowsToMorton(B, sizeA, &mB);
+        printf("Row-major to Morton: %f seconds\n", omp_get_wtime() - convert_start);
+    }
+    // The work-stealing workers are not an OpenMP team, so pin and count them by thread id
+    int *worker_ids = malloc(num_threads * sizeof(int));
+    int workers = pool != NULL && worker_ids != NULL ? wsPoolThreadIds(pool, worker_ids) : 0;
+    applyThreadIdPinning(&numa, worker_ids, workers);
+    PerfRegion perf;
+    perfRegionBeginThreads(&perf, &perf_options, kernel, worker_ids, workers);
+    free(worker_ids);
+    traceStart(&trace_options);
+    double start_time, end_time;
+    if (runtime.kind == RUNTIME_WS) {
+        StrassenRoot root = { A, B, C, sizeA, traceSpawn() };
+        start_time = omp_get_wtime();
+        wsRun(pool, strassenRootTask, &root);
+        end_time = omp_get_wtime();
+    } else if (morton_layout) {
+        TraceTask trace;
+        traceTaskBegin(&trace, "strassen", traceSpawn());
+        start_time = omp_get_wtime();
+        mortonStrassenMultiply(&mA, &mB, &mC);
+        end_time = omp_get_wtime();
+        traceTaskEnd(&trace);
+    } else {
+        TraceTask trace;
+        traceTaskBegin(&trace, "strassen", traceSpawn());
+        start_time = omp_get_wtime();
+        parallel_strassenMultiply(A, B, C, sizeA);
+        end_time = omp_get_wtime();
+        traceTaskEnd(&trace);
+    }
+    traceStop();
+    // Compulsory traffic: read A and B and write C once
+    perfRegionEnd(&perf, (long)sizeA * sizeA, 3.0 * sizeof(int) * sizeA * sizeA);
     double parallel_time = end_time - start_time;
 
     printf("Time taken to multiply two %dx%d matrices with %d threads: %f seconds\n", sizeA, sizeA, num_threads, parallel_time);
+    if (morton_layout) {
+        mortonToRows(&mC, C, sizeA);
+        freeMortonMatrix(&mA);
+        freeMortonMatrix(&mB);
+        freeMortonMatrix(&mC);
+    }
 
     // After multiplication, print the result
     // printf("Resultant Matrix C after multiplication:\n");
     // printMatrix(C, sizeA);
 
-    freeMatrix(A, sizeA);
-    freeMatrix(B, sizeA);
-    freeMatrix(C, sizeA);
+    int status = 0;
+    if (verify.trials > 0) {
+        status = reportVerification(verifyRows(A, sizeA), verifyRows(B, sizeA), verifyRows(C, sizeA), verify.trials);
+    }
+
+    reportRowsPlacement("A", (void **)A, sizeA, sizeA * sizeof(int));
+    reportRowsPlacement("C", (void **)C, sizeA, sizeA * sizeof(int));
+    if (pool != NULL) {
+        wsReportStats(pool, kernel);
+        wsPoolDestroy(pool);
+    }
+
+    freeMatrixNuma(A, sizeA, &numa);
+    freeMatrixNuma(B, sizeA, &numa);
+    freeMatrixNuma(C, sizeA, &numa);
 
     if (num_threads == 1){
         double start = omp_get_wtime();
@@ -442,14 +791,8 @@ int main(int argc, char *argv[]) {
         double work_time = end - start;
         printf("Work Time: %f seconds\n", work_time);
     } 
-    // double total_time = end_time - start_time;
-    // double avg_task_time = task_total / task_count;
-    // double communication = total_time - avg_task_time;
-    // printf("Task time: %f, Task Count: %d\n", task_total, task_count);
-    // printf("Total time of parallel: %f seconds\n", total_time);
-    // printf("Task time: %f seconds\n", avg_task_time);
-    // printf("Communication: %f seconds\n", communication);
+    traceReport(kernel);
     
 
-    return 0;
+    return status;
 }
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "compressed_array.h"
+
+// Keys are compared as unsigned after flipping the sign bit, so gaps and
+// running sums can wrap freely
+#define KEY_BIAS 0x80000000u
+
+static uint32_t biased(int key) {
+    return (uint32_t)key ^ KEY_BIAS;
+}
+
+static int bitsFor(uint32_t value) {
+    int bits = 0;
+    while (bits < 32 && (value >> bits) != 0) bits++;
+    return bits;
+}
+
+static long blockLength(const CompressedArray *array, long block) {
+    long first = block * COMPRESSED_BLOCK;
+    return array->n - first < COMPRESSED_BLOCK ? array->n - first : COMPRESSED_BLOCK;
+}
+
+void compressedArrayFree(CompressedArray *array) {
+    free(array->heads);
+    free(array->min_gaps);
+    free(array->bits);
+    free(array->offsets);
+    free(array->packed);
+    memset(array, 0, sizeof(*array));
+}
+
+int compressedArrayBuild(CompressedArray *array, const int *keys, long n, int threads) {
+    memset(array, 0, sizeof(*array));
+    if (n < 0 || (n > 0 && keys == NULL)) return -1;
+    for (long i = 1; i < n; i++) {
+        if (keys[i - 1] > keys[i]) return -1;
+    }
+
+    long blocks = (n + COMPRESSED_BLOCK - 1) / COMPRESSED_BLOCK;
+    array->n = n;
+    array->blocks = blocks;
+    array->heads = malloc((blocks > 0 ? blocks : 1) * sizeof(int));
+    array->min_gaps = malloc((blocks > 0 ? blocks : 1) * sizeof(uint32_t));
+    array->bits = malloc(blocks > 0 ? blocks : 1);
+    array->offsets = malloc((blocks + 1) * sizeof(long));
+    if (array->heads == NULL || array->min_gaps == NULL || array->bits == NULL || array->offsets == NULL) {
+        compressedArrayFree(array);
+        return -1;
+    }
+
+    // Frame of reference: the smallest gap of a block is subtracted from all of them
+    #pragma omp parallel for num_threads(threads) schedule(static)
+    for (long b = 0; b < blocks; b++) {
+        long first = b * COMPRESSED_BLOCK, length = blockLength(array, b);
+        uint32_t min_gap = UINT32_MAX, max_gap = 0;
+        for (long i = first + 1; i < first + length; i++) {
+            uint32_t gap = biased(keys[i]) - biased(keys[i - 1]);
+            if (gap < min_gap) min_gap = gap;
+            if (gap > max_gap) max_gap = gap;
+        }
+        if (length == 1) min_gap = max_gap = 0;
+        array->heads[b] = keys[first];
+        array->min_gaps[b] = min_gap;
+        array->bits[b] = bitsFor(max_gap - min_gap);
+    }
+
+    // Every segment holds COMPRESSED_SEGMENT (32) gaps, so one word per bit
+    array->offsets[0] = 0;
+    for (long b = 0; b < blocks; b++) {
+        array->offsets[b + 1] = array->offsets[b] + (long)array->bits[b] * COMPRESSED_LANES;
+    }
+    array->packed_words = array->offsets[blocks];
+    array->packed = calloc(array->packed_words > 0 ? array->packed_words : 1, sizeof(uint32_t));
+    if (array->packed == NULL) {
+        compressedArrayFree(array);
+        return -1;
+    }
+
+    // Gap v of segment `lane` goes to bit v * bits of the lane's column of words
+    #pragma omp parallel for num_threads(threads) schedule(static)
+    for (long b = 0; b < blocks; b++) {
+        int bits = array->bits[b];
+        if (bits == 0) continue;
+        long first = b * COMPRESSED_BLOCK, length = blockLength(array, b);
+        uint32_t *words = array->packed + array->offsets[b];
+        for (long j = 1; j < length; j++) {
+            uint32_t delta = biased(keys[first + j]) - biased(keys[first + j - 1]) - array->min_gaps[b];
+            int lane = j / COMPRESSED_SEGMENT, v = j % COMPRESSED_SEGMENT;
+            int bit = v * bits, word = bit / 32, shift = bit % 32;
+            words[word * COMPRESSED_LANES + lane] |= delta << shift;
+            if (shift + bits > 32) {
+                words[(word + 1) * COMPRESSED_LANES + lane] |= delta >> (32 - shift);
+            }
+        }
+    }
+    return 0;
+}
+
+size_t compressedArrayBytes(const CompressedArray *array) {
+    size_t header = sizeof(int) + sizeof(uint32_t) + 1 + sizeof(long);
+    return sizeof(*array) + array->blocks * header + sizeof(long) + array->packed_words * sizeof(uint32_t);
+}
+
+// Decodes a block in lane order: keys[v * LANES + lane] is key lane * SEGMENT + v,
+// still biased. Every step reads one word per lane, so it maps onto one SIMD
+// register of 8 x 32 bits; the running sums then get each segment's start added.
+__attribute__((target_clones("avx2", "default")))
+static void decodeLanes(const uint32_t *restrict words, int bits, uint32_t min_gap, uint32_t head,
+                        uint32_t *restrict keys) {
+    uint32_t mask = bits == 32 ? UINT32_MAX : (1u << bits) - 1;
+    uint32_t sum[COMPRESSED_LANES] = { 0 };
+    for (int v = 0; v < COMPRESSED_SEGMENT; v++) {
+        int bit = v * bits, word = bit / 32, shift = bit % 32;
+        const uint32_t *row = words + word * COMPRESSED_LANES;
+        uint32_t *out = keys + v * COMPRESSED_LANES;
+        if (bits == 0) {
+            #pragma omp simd
+            for (int lane = 0; lane < COMPRESSED_LANES; lane++) {
+                sum[lane] += min_gap;
+                out[lane] = sum[lane];
+            }
+        } else if (shift + bits <= 32) {
+            #pragma omp simd
+            for (int lane = 0; lane < COMPRESSED_LANES; lane++) {
+                sum[lane] += ((row[lane] >> shift) & mask) + min_gap;
+                out[lane] = sum[lane];
+            }
+        } else {
+            #pragma omp simd
+            for (int lane = 0; lane < COMPRESSED_LANES; lane++) {
+                uint32_t delta = (row[lane] >> shift | row[lane + COMPRESSED_LANES] << (32 - shift)) & mask;
+                sum[lane] += delta + min_gap;
+                out[lane] = sum[lane];
+            }
+        }
+    }
+
+    // The first gap of the block is stored as 0, so its start sits min_gap below the head
+    uint32_t start[COMPRESSED_LANES];
+    start[0] = head - min_gap;
+    for (int lane = 1; lane < COMPRESSED_LANES; lane++) start[lane] = start[lane - 1] + sum[lane - 1];
+    for (int v = 0; v < COMPRESSED_SEGMENT; v++) {
+        #pragma omp simd
+        for (int lane = 0; lane < COMPRESSED_LANES; lane++) {
+            keys[v * COMPRESSED_LANES + lane] += start[lane];
+        }
+    }
+}
+
+// Keys of the block below target; lane-order position p is key (p % LANES) * SEGMENT + p / LANES
+__attribute__((target_clones("avx2", "default")))
+static int countBelow(const uint32_t *restrict keys, int length, uint32_t target) {
+    int count = 0;
+    for (int v = 0; v < COMPRESSED_SEGMENT; v++) {
+        #pragma omp simd reduction(+:count)
+        for (int lane = 0; lane < COMPRESSED_LANES; lane++) {
+            count += (keys[v * COMPRESSED_LANES + lane] < target) & (lane * COMPRESSED_SEGMENT + v < length);
+        }
+    }
+    return count;
+}
+
+int compressedArrayDecodeBlock(const CompressedArray *array, long block, int *out) {
+    uint32_t keys[COMPRESSED_BLOCK];
+    decodeLanes(array->packed + array->offsets[block], array->bits[block], array->min_gaps[block],
+                biased(array->heads[block]), keys);
+    int length = (int)blockLength(array, block);
+    for (int j = 0; j < length; j++) {
+        out[j] = (int)(keys[(j % COMPRESSED_SEGMENT) * COMPRESSED_LANES + j / COMPRESSED_SEGMENT] ^ KEY_BIAS);
+    }
+    return length;
+}
+
+long compressedArrayFind(const CompressedArray *array, int key) {
+    // Heads below key: the first copy of key lies in the last such block or starts the next one
+    long low = 0, high = array->blocks;
+    while (low < high) {
+        long mid = low + (high - low) / 2;
+        if (array->heads[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+    if (low == 0) return array->n > 0 && array->heads[0] == key ? 0 : -1;
+
+    long block = low - 1;
+    uint32_t keys[COMPRESSED_BLOCK];
+    decodeLanes(array->packed + array->offsets[block], array->bits[block], array->min_gaps[block],
+                biased(array->heads[block]), keys);
+    int length = (int)blockLength(array, block);
+    int position = countBelow(keys, length, biased(key));
+    if (position < length) {
+        uint32_t found = keys[(position % COMPRESSED_SEGMENT) * COMPRESSED_LANES + position / COMPRESSED_SEGMENT];
+        return found == biased(key) ? block * COMPRESSED_BLOCK + position : -1;
+    }
+    return low < array->blocks && array->heads[low] == key ? low * COMPRESSED_BLOCK : -1;
+}
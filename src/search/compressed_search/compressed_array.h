@@ -0,0 +1,48 @@
+#ifndef COMPRESSED_ARRAY_H
+#define COMPRESSED_ARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    A sorted int array stored as blocks of COMPRESSED_BLOCK keys.
+
+    Each block keeps its first key in an uncompressed skip array (heads) and
+    the gaps between its keys as frame-of-reference deltas: gap - min_gap,
+    bit-packed with the fewest bits that hold the block's largest one. The
+    block is split into COMPRESSED_LANES segments of consecutive keys whose
+    packed words are interleaved, so a SIMD register decodes one gap of every
+    segment at a time and keeps one running sum per segment.
+
+    A lookup binary-searches the heads and decodes a single block.
+*/
+
+#define COMPRESSED_BLOCK 256
+#define COMPRESSED_LANES 8
+#define COMPRESSED_SEGMENT (COMPRESSED_BLOCK / COMPRESSED_LANES)
+
+typedef struct {
+    long n;
+    long blocks;
+    int *heads;             // first key of every block
+    uint32_t *min_gaps;     // subtracted from every gap of the block
+    unsigned char *bits;    // packed width of the block's gaps, 0 to 32
+    long *offsets;          // first packed word of every block
+    uint32_t *packed;
+    long packed_words;
+} CompressedArray;
+
+// Ascending keys only; 0, or -1 for unsorted input or a failed allocation
+int compressedArrayBuild(CompressedArray *array, const int *keys, long n, int threads);
+void compressedArrayFree(CompressedArray *array);
+
+// Bytes of the heads, block headers and packed gaps
+size_t compressedArrayBytes(const CompressedArray *array);
+
+// Writes the keys of one block to out[COMPRESSED_BLOCK]; returns how many are real
+int compressedArrayDecodeBlock(const CompressedArray *array, long block, int *out);
+
+// Index of the first copy of key, or -1
+long compressedArrayFind(const CompressedArray *array, int key);
+
+#endif
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+#include "../../libpcm/pcm.h"
+#include "compressed_array.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -pthread -O2 -o compressed_search compressed_search.c compressed_array.c ../../../libpcm.a
+    command to execute:
+    ./compressed_search [sorted input] [number of threads] [queries] [--runtime=omp|ws]
+    ./compressed_search --random [n] [number of threads] [queries] [--runtime=omp|ws]
+
+    Compresses a sorted array into delta + bit-packed blocks, reports the
+    compression ratio, then answers the same random lookups three ways: one
+    pcmBinarySearch (parallelBinarySearch) call per query, a batch of plain
+    binary searches over the uncompressed array split across the threads,
+    and the same batch on the compressed array. Half of the queries are keys
+    of the array. --random draws gaps between 1 and 64.
+*/
+
+static int* readArray(const char *filename, long *n) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        return NULL;
+    }
+    long count = 0;
+    double temp;
+    while (fscanf(file, "%lf", &temp) == 1) count++;
+    int *arr = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (arr == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(file);
+        return NULL;
+    }
+    rewind(file);
+    for (long i = 0; i < count; i++) {
+        if (fscanf(file, "%lf", &temp) != 1) break;
+        arr[i] = (int)temp;
+    }
+    fclose(file);
+    *n = count;
+    return arr;
+}
+
+static uint64_t splitmix(uint64_t x) {
+    uint64_t z = x * 0x9E3779B97F4A7C15ULL + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int* randomSortedArray(long n) {
+    if (n > INT32_MAX / 64) {
+        fprintf(stderr, "n must be at most %d so the keys fit an int\n", INT32_MAX / 64);
+        return NULL;
+    }
+    int *arr = malloc(n * sizeof(int));
+    if (arr == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+    int key = 0;
+    for (long i = 0; i < n; i++) {
+        key += 1 + (int)(splitmix(i) % 64);
+        arr[i] = key;
+    }
+    return arr;
+}
+
+// First index whose key is >= target
+static long lowerBound(const int *arr, long n, int target) {
+    long low = 0, high = n;
+    while (low < high) {
+        long mid = low + (high - low) / 2;
+        if (arr[mid] < target) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <sorted_input> <num_of_threads> <queries> " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        fprintf(stderr, "       %s --random <n> <num_of_threads> <queries> " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        return -1;
+    }
+
+    int random_input = strcmp(argv[1], "--random") == 0;
+    int first_option = random_input ? 5 : 4;
+    if (argc < first_option) {
+        fprintf(stderr, "Missing the number of queries\n");
+        return -1;
+    }
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    for (int i = first_option; i < argc; i++) {
+        if (!parseRuntimeOption(argv[i], &runtime)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    int num_threads = atoi(argv[first_option - 2]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    long queries = atol(argv[first_option - 1]);
+    if (queries < 1) {
+        fprintf(stderr, "Number of queries must be at least 1\n");
+        return -1;
+    }
+    omp_set_dynamic(0);
+    omp_set_num_threads(num_threads);
+
+    long n = 0;
+    int *arr;
+    if (random_input) {
+        n = atol(argv[2]);
+        if (n < 1) {
+            fprintf(stderr, "n must be at least 1\n");
+            return -1;
+        }
+        arr = randomSortedArray(n);
+    } else {
+        arr = readArray(argv[1], &n);
+    }
+    if (arr == NULL) return -1;
+    if (n < 1 || n > INT32_MAX) {
+        fprintf(stderr, "The input must hold between 1 and %d keys\n", INT32_MAX);
+        return -1;
+    }
+
+    CompressedArray compressed;
+    double build_start = omp_get_wtime();
+    if (compressedArrayBuild(&compressed, arr, n, num_threads) != 0) {
+        fprintf(stderr, "The input must be sorted in ascending order\n");
+        return -1;
+    }
+    double build_time = omp_get_wtime() - build_start;
+
+    // Every decoded block must give back the input
+    int block_keys[COMPRESSED_BLOCK];
+    for (long b = 0; b < compressed.blocks; b++) {
+        int length = compressedArrayDecodeBlock(&compressed, b, block_keys);
+        if (memcmp(block_keys, arr + b * COMPRESSED_BLOCK, length * sizeof(int)) != 0) {
+            fprintf(stderr, "Block %ld does not decode to the input\n", b);
+            return -1;
+        }
+    }
+
+    size_t raw_bytes = n * sizeof(int), compressed_bytes = compressedArrayBytes(&compressed);
+    printf("Array loaded. Array size: %ld\n", n);
+    printf("Compressed %zu bytes into %zu (%.2fx, %.2f bits per key) in %f seconds\n", raw_bytes,
+           compressed_bytes, (double)raw_bytes / compressed_bytes, 8.0 * compressed_bytes / n, build_time);
+
+    int *targets = malloc(queries * sizeof(int));
+    long *expected = malloc(queries * sizeof(long));
+    long *results = malloc(queries * sizeof(long));
+    if (targets == NULL || expected == NULL || results == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    long span = (long)arr[n - 1] - arr[0] + 1;
+    for (long q = 0; q < queries; q++) {
+        uint64_t r = splitmix(q + 0x5eed);
+        targets[q] = (q % 2 == 0) ? arr[(r >> 1) % n] : (int)(arr[0] + (long)((r >> 1) % span));
+    }
+
+    PcmOptions options;
+    pcmDefaultOptions(&options);
+    options.threads = num_threads;
+    options.runtime = runtime.kind;
+    PcmContext *context = pcmContextCreate(&options);
+    if (context == NULL) {
+        fprintf(stderr, "Failed to set up libpcm\n");
+        return -1;
+    }
+
+    // One parallel search per query, the way binary_search runs it
+    long pcm_found = 0;
+    double start_time = omp_get_wtime();
+    for (long q = 0; q < queries; q++) {
+        int index;
+        pcmBinarySearch(context, arr, (int)n, targets[q], &index);
+        pcm_found += index >= 0;
+    }
+    double pcm_time = omp_get_wtime() - start_time;
+
+    start_time = omp_get_wtime();
+    #pragma omp parallel for schedule(static)
+    for (long q = 0; q < queries; q++) {
+        long index = lowerBound(arr, n, targets[q]);
+        expected[q] = index < n && arr[index] == targets[q] ? index : -1;
+    }
+    double raw_time = omp_get_wtime() - start_time;
+
+    start_time = omp_get_wtime();
+    #pragma omp parallel for schedule(static)
+    for (long q = 0; q < queries; q++) {
+        results[q] = compressedArrayFind(&compressed, targets[q]);
+    }
+    double compressed_time = omp_get_wtime() - start_time;
+
+    long found = 0;
+    for (long q = 0; q < queries; q++) {
+        if (results[q] != expected[q]) {
+            fprintf(stderr, "Query %d: compressed search gave %ld, expected %ld\n", targets[q], results[q], expected[q]);
+            return -1;
+        }
+        found += results[q] >= 0;
+    }
+    if (pcm_found != found) {
+        fprintf(stderr, "parallelBinarySearch found %ld of the queries, expected %ld\n", pcm_found, found);
+        return -1;
+    }
+
+    printf("%ld queries, %ld found\n", queries, found);
+    printf("parallelBinarySearch:   %f seconds, %.2f M queries/s\n", pcm_time, queries / pcm_time / 1e6);
+    printf("Uncompressed batch:     %f seconds, %.2f M queries/s\n", raw_time, queries / raw_time / 1e6);
+    printf("Compressed batch:       %f seconds, %.2f M queries/s (%.2fx parallelBinarySearch, %.2fx uncompressed)\n",
+           compressed_time, queries / compressed_time / 1e6, pcm_time / compressed_time, raw_time / compressed_time);
+    printf("Time taken: %f seconds with %d threads\n", compressed_time, num_threads);
+
+    pcmContextDestroy(context);
+    compressedArrayFree(&compressed);
+    free(targets);
+    free(expected);
+    free(results);
+    free(arr);
+    return 0;
+}
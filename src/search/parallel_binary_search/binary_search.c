@@ -2,40 +2,16 @@
 #include <stdlib.h>
 #include <omp.h>
 #include <time.h>
+#include "../../libpcm/pcm.h"
+#include "../../common/numa_support.h"
+#include "../../common/perf_counters.h"
 
-// Function to perform binary search in parallel
-int parallelBinarySearch(int *arr, int n, int target) {
-    int result = -1; // Index of the target element if found, otherwise -1
-
-    #pragma omp parallel
-    {
-        int thread_start, thread_end, mid;
-        #pragma omp single
-        {
-            int num_threads = omp_get_num_threads();
-            thread_start = omp_get_thread_num() * (n / num_threads);
-            thread_end = thread_start + (n / num_threads) - 1;
-            if (omp_get_thread_num() == num_threads - 1) {
-                thread_end = n-1; // last thread handles any remaining elements
-            }
-        }
-        
-        while (thread_start <= thread_end && result == -1) {
-            mid = thread_start + (thread_end - thread_start) / 2;
-            if (arr[mid] == target) {
-                #pragma omp critical
-                {
-                    result = mid; // Set result to the index of the target
-                }
-            } else if (arr[mid] < target) {
-                thread_start = mid + 1;
-            } else {
-                thread_end = mid - 1;
-            }
-        }
-    }
-    return result;
-}
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -DHAVE_LIBNUMA -pthread -o binarysearch binary_search.c ../../common/numa_support.c ../../common/perf_counters.c ../../../libpcm.a -lnuma
+    command to execute:
+    ./binarysearch [input] [number of threads] [target] [--pin=none|compact|scatter] [--numa=default|firsttouch|interleave] [--perf] [--runtime=omp|ws]
+*/
 
 // Function to print an array
 void printArray(int *arr, int size) {
@@ -46,11 +22,25 @@ void printArray(int *arr, int size) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s <input_file> <num_of_threads> <target>\n", argv[0]);
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <input_file> <num_of_threads> <target> " NUMA_OPTIONS_USAGE " " PERF_OPTIONS_USAGE " " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
         return -1;
     }
 
+    NumaOptions numa;
+    defaultNumaOptions(&numa);
+    PerfOptions perf_options;
+    defaultPerfOptions(&perf_options);
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    for (int i = 4; i < argc; i++) {
+        if (!parseNumaOption(argv[i], &numa) && !parsePerfOption(argv[i], &perf_options)
+            && !parseRuntimeOption(argv[i], &runtime)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
     const char *input_filename = argv[1];
     int num_threads = atoi(argv[2]);
     if (num_threads < 1) {
@@ -70,8 +60,12 @@ int main(int argc, char *argv[]) {
     double temp;
     while (fscanf(file, "%lf", &temp) == 1) n++;
 
+    // Each thread searches one static slice, so first touch puts the slice on its node
+    omp_set_num_threads(num_threads);
+    applyThreadPinning(&numa);
+
     // Allocate memory based on the number of integers
-    int *arr = malloc(n * sizeof(int));
+    int *arr = numaAllocate(n * sizeof(int), &numa);
     if (arr == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
         fclose(file);
@@ -92,11 +86,36 @@ int main(int argc, char *argv[]) {
     printf("Array loaded. Array size: %d\n", n);
     
 
-    omp_set_num_threads(num_threads);
+    // The context starts its threads before the clock
+    PcmOptions options;
+    pcmDefaultOptions(&options);
+    options.threads = num_threads;
+    options.runtime = runtime.kind;
+    PcmContext *context = pcmContextCreate(&options);
+    if (context == NULL) {
+        fprintf(stderr, "Failed to set up libpcm\n");
+        return -1;
+    }
 
+    // The work-stealing workers are not an OpenMP team, so pin and count them by thread id
+    int *worker_ids = malloc(pcmContextThreads(context) * sizeof(int));
+    int workers = worker_ids != NULL ? pcmRuntimeThreadIds(context, worker_ids) : 0;
+    applyThreadIdPinning(&numa, worker_ids, workers);
+    PerfRegion perf;
+    perfRegionBeginThreads(&perf, &perf_options, "parallelBinarySearch", worker_ids, workers);
+    free(worker_ids);
     double start_time = omp_get_wtime();
-    int index = parallelBinarySearch(arr, n, target);
+    int index;
+    int status = pcmBinarySearch(context, arr, n, target, &index);
     double end_time = omp_get_wtime();
+    // Every thread probes about log2(n / threads) cache lines of its slice
+    int probes = 0;
+    while ((1L << probes) < n / num_threads) probes++;
+    perfRegionEnd(&perf, n, 64.0 * num_threads * probes);
+    if (status != PCM_OK) {
+        fprintf(stderr, "pcmBinarySearch failed: %s\n", pcmStatusString(status));
+        return -1;
+    }
 
     if (index != -1) {
         printf("Target %d found at index %d\n", target, index);
@@ -105,7 +124,10 @@ int main(int argc, char *argv[]) {
     }
 
     printf("Time taken: %f seconds with %d threads\n", end_time - start_time, num_threads);
+    reportArrayLocality("array", arr, n * sizeof(int));
+    pcmReportRuntime(context, "parallelBinarySearch");
+    pcmContextDestroy(context);
 
-    free(arr);
+    numaFree(arr, n * sizeof(int), &numa);
     return 0;
 }
@@ -0,0 +1,546 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -O2 -o graph_search graph_search.c
+    command to execute:
+    ./graph_search [edge list] [number of threads] [--roots=N] [--seed=N] [--top-down]
+    ./graph_search --rmat [scale] [number of threads] [--edgefactor=N] [--roots=N] [--seed=N] [--top-down]
+
+    Breadth-first search, Graph500 style. The graph is read as "u v" lines
+    ('#' and '%' lines are comments) or generated as an R-MAT graph with
+    2^scale vertices and edgefactor * 2^scale edges, then stored undirected in
+    CSR form without self loops or duplicate edges.
+
+    The search is direction optimizing: top-down steps expand the frontier
+    queue into per-thread local queues, and once the frontier's edges
+    outnumber a fraction of the unexplored ones it switches to bottom-up
+    steps, where every unvisited vertex looks for a parent in a frontier
+    bitmap. Each BFS tree is validated: the root is its own parent, every
+    tree edge is a graph edge and every graph edge joins vertices at most
+    one level apart. The report gives traversed edges per second (TEPS)
+    over the roots, with the harmonic mean as the headline figure.
+*/
+
+#define LOCAL_QUEUE 1024
+#define ALPHA 14            // top-down -> bottom-up once frontier edges > unexplored edges / ALPHA
+#define BETA 24             // bottom-up -> top-down once the frontier shrinks below n / BETA
+
+// Graph500 R-MAT quadrant probabilities, in 1/65536
+#define RMAT_A 37355        // 0.57
+#define RMAT_B 12452        // 0.19
+#define RMAT_C 12452        // 0.19
+
+typedef struct {
+    int n;
+    long count;
+    int *u;
+    int *v;
+} EdgeList;
+
+typedef struct {
+    int n;
+    long m;                 // adjacency entries, twice the undirected edges
+    long *offsets;          // n + 1
+    int *adjacency;         // sorted per vertex
+} Graph;
+
+typedef struct {
+    int *queue;
+    int *next_queue;
+    uint64_t *frontier;
+    uint64_t *next_frontier;
+    long words;
+} BfsWork;
+
+typedef struct {
+    int top_down_steps;
+    int bottom_up_steps;
+} BfsSteps;
+
+static uint64_t splitmix(uint64_t x) {
+    uint64_t z = x * 0x9E3779B97F4A7C15ULL + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int readEdges(const char *filename, EdgeList *edges) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        return -1;
+    }
+    long capacity = 1 << 16;
+    edges->count = 0;
+    edges->n = 0;
+    edges->u = malloc(capacity * sizeof(int));
+    edges->v = malloc(capacity * sizeof(int));
+    char line[256];
+    while (edges->u != NULL && edges->v != NULL && fgets(line, sizeof(line), file) != NULL) {
+        long u, v;
+        if (line[0] == '#' || line[0] == '%' || sscanf(line, "%ld %ld", &u, &v) != 2) continue;
+        if (u < 0 || v < 0 || u >= INT32_MAX || v >= INT32_MAX) {
+            fprintf(stderr, "Vertex ids must lie in [0, %d)\n", INT32_MAX);
+            fclose(file);
+            return -1;
+        }
+        if (edges->count == capacity) {
+            capacity *= 2;
+            edges->u = realloc(edges->u, capacity * sizeof(int));
+            edges->v = realloc(edges->v, capacity * sizeof(int));
+            if (edges->u == NULL || edges->v == NULL) break;
+        }
+        edges->u[edges->count] = (int)u;
+        edges->v[edges->count] = (int)v;
+        edges->count++;
+        if (u >= edges->n) edges->n = (int)u + 1;
+        if (v >= edges->n) edges->n = (int)v + 1;
+    }
+    fclose(file);
+    if (edges->u == NULL || edges->v == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Every edge descends `scale` times into one quadrant of the adjacency
+// matrix; the labels are then scrambled by an odd multiplier, a bijection
+// modulo 2^scale, so vertex ids carry no hint of their degree
+static int generateRmat(int scale, int edgefactor, uint64_t seed, EdgeList *edges) {
+    edges->n = 1 << scale;
+    edges->count = (long)edgefactor << scale;
+    edges->u = malloc(edges->count * sizeof(int));
+    edges->v = malloc(edges->count * sizeof(int));
+    if (edges->u == NULL || edges->v == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    uint32_t mask = (uint32_t)edges->n - 1;
+    uint32_t multiplier = (uint32_t)splitmix(seed) | 1, shift = (uint32_t)splitmix(seed + 1);
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < edges->count; e++) {
+        uint64_t random = 0;
+        uint32_t u = 0, v = 0;
+        for (int bit = 0; bit < scale; bit++) {
+            if (bit % 4 == 0) random = splitmix(seed ^ ((uint64_t)e * 8 + bit / 4 + 2));
+            uint32_t r = random & 0xFFFF;
+            random >>= 16;
+            if (r >= RMAT_A + RMAT_B + RMAT_C) {
+                u |= 1u << bit;
+                v |= 1u << bit;
+            } else if (r >= RMAT_A + RMAT_B) {
+                u |= 1u << bit;
+            } else if (r >= RMAT_A) {
+                v |= 1u << bit;
+            }
+        }
+        edges->u[e] = (int)((u * multiplier + shift) & mask);
+        edges->v[e] = (int)((v * multiplier + shift) & mask);
+    }
+    return 0;
+}
+
+// Both directions of every edge, then each list sorted and deduplicated
+static int buildGraph(const EdgeList *edges, Graph *graph) {
+    int n = edges->n;
+    long *counts = calloc((long)n + 1, sizeof(long));
+    if (counts == NULL) return -1;
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < edges->count; e++) {
+        if (edges->u[e] == edges->v[e]) continue;
+        __atomic_fetch_add(&counts[edges->u[e] + 1], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&counts[edges->v[e] + 1], 1, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < n; i++) counts[i + 1] += counts[i];
+
+    long *cursor = malloc(((long)n + 1) * sizeof(long));
+    int *raw = malloc((counts[n] > 0 ? counts[n] : 1) * sizeof(int));
+    if (cursor == NULL || raw == NULL) return -1;
+    memcpy(cursor, counts, ((long)n + 1) * sizeof(long));
+    #pragma omp parallel for schedule(static)
+    for (long e = 0; e < edges->count; e++) {
+        int u = edges->u[e], v = edges->v[e];
+        if (u == v) continue;
+        raw[__atomic_fetch_add(&cursor[u], 1, __ATOMIC_RELAXED)] = v;
+        raw[__atomic_fetch_add(&cursor[v], 1, __ATOMIC_RELAXED)] = u;
+    }
+
+    // cursor[v + 1] becomes the number of distinct neighbours of v
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < n; v++) {
+        int *list = raw + counts[v];
+        long length = counts[v + 1] - counts[v], unique = 0;
+        qsort(list, length, sizeof(int), compareInts);
+        for (long i = 0; i < length; i++) {
+            if (unique == 0 || list[unique - 1] != list[i]) list[unique++] = list[i];
+        }
+        cursor[v + 1] = unique;
+    }
+    cursor[0] = 0;
+    for (int i = 0; i < n; i++) cursor[i + 1] += cursor[i];
+
+    graph->n = n;
+    graph->m = cursor[n];
+    graph->offsets = cursor;
+    graph->adjacency = malloc((graph->m > 0 ? graph->m : 1) * sizeof(int));
+    if (graph->adjacency == NULL) return -1;
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < n; v++) {
+        memcpy(graph->adjacency + cursor[v], raw + counts[v], (cursor[v + 1] - cursor[v]) * sizeof(int));
+    }
+    free(raw);
+    free(counts);
+    return 0;
+}
+
+static long degree(const Graph *graph, int v) {
+    return graph->offsets[v + 1] - graph->offsets[v];
+}
+
+// Claims the unvisited neighbours of the queue; returns the new frontier's edges
+static long topDownStep(const Graph *graph, int *parent, const int *queue, long queue_size,
+                        int *next_queue, long *next_size) {
+    long scout = 0, next_count = 0;
+    #pragma omp parallel reduction(+:scout)
+    {
+        int local[LOCAL_QUEUE];
+        int local_count = 0;
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (long i = 0; i < queue_size; i++) {
+            int u = queue[i];
+            for (long e = graph->offsets[u]; e < graph->offsets[u + 1]; e++) {
+                int v = graph->adjacency[e];
+                if (parent[v] < 0 && __sync_bool_compare_and_swap(&parent[v], -1, u)) {
+                    scout += degree(graph, v);
+                    local[local_count++] = v;
+                    if (local_count == LOCAL_QUEUE) {
+                        long position = __atomic_fetch_add(&next_count, local_count, __ATOMIC_RELAXED);
+                        memcpy(next_queue + position, local, local_count * sizeof(int));
+                        local_count = 0;
+                    }
+                }
+            }
+        }
+        long position = __atomic_fetch_add(&next_count, local_count, __ATOMIC_RELAXED);
+        memcpy(next_queue + position, local, local_count * sizeof(int));
+    }
+    *next_size = next_count;
+    return scout;
+}
+
+// Every unvisited vertex takes its first neighbour in the frontier as parent.
+// A thread owns whole bitmap words, so the next frontier needs no atomics.
+// *woken_edges gets the degrees of the vertices it reached.
+static long bottomUpStep(const Graph *graph, int *parent, const uint64_t *frontier, uint64_t *next_frontier,
+                         long words, long *woken_edges) {
+    long awake = 0, edges = 0;
+    #pragma omp parallel for schedule(dynamic, 16) reduction(+:awake, edges)
+    for (long w = 0; w < words; w++) {
+        uint64_t bits = 0;
+        int last = (w + 1) * 64 < graph->n ? (int)((w + 1) * 64) : graph->n;
+        for (int v = (int)(w * 64); v < last; v++) {
+            if (parent[v] >= 0) continue;
+            for (long e = graph->offsets[v]; e < graph->offsets[v + 1]; e++) {
+                int u = graph->adjacency[e];
+                if (frontier[u >> 6] & (1ULL << (u & 63))) {
+                    parent[v] = u;
+                    bits |= 1ULL << (v & 63);
+                    awake++;
+                    edges += degree(graph, v);
+                    break;
+                }
+            }
+        }
+        next_frontier[w] = bits;
+    }
+    *woken_edges = edges;
+    return awake;
+}
+
+static void queueToBitmap(const int *queue, long size, uint64_t *bitmap, long words) {
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static)
+        for (long w = 0; w < words; w++) bitmap[w] = 0;
+        #pragma omp for schedule(static)
+        for (long i = 0; i < size; i++) {
+            __atomic_fetch_or(&bitmap[queue[i] >> 6], 1ULL << (queue[i] & 63), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static long bitmapToQueue(const uint64_t *bitmap, long words, int *queue) {
+    long size = 0;
+    #pragma omp parallel
+    {
+        int local[LOCAL_QUEUE];
+        int local_count = 0;
+        #pragma omp for schedule(static) nowait
+        for (long w = 0; w < words; w++) {
+            for (uint64_t bits = bitmap[w]; bits != 0; bits &= bits - 1) {
+                local[local_count++] = (int)(w * 64 + __builtin_ctzll(bits));
+                if (local_count == LOCAL_QUEUE) {
+                    long position = __atomic_fetch_add(&size, local_count, __ATOMIC_RELAXED);
+                    memcpy(queue + position, local, local_count * sizeof(int));
+                    local_count = 0;
+                }
+            }
+        }
+        long position = __atomic_fetch_add(&size, local_count, __ATOMIC_RELAXED);
+        memcpy(queue + position, local, local_count * sizeof(int));
+    }
+    return size;
+}
+
+// Beamer's direction-optimizing BFS; parent[v] is -1 for unreached vertices
+static void breadthFirstSearch(const Graph *graph, int root, int *parent, BfsWork *work, int direction_optimizing,
+                               BfsSteps *steps) {
+    #pragma omp parallel for schedule(static)
+    for (int v = 0; v < graph->n; v++) parent[v] = -1;
+    parent[root] = root;
+    work->queue[0] = root;
+    long queue_size = 1;
+    long edges_to_check = graph->m, scout = degree(graph, root);
+    steps->top_down_steps = steps->bottom_up_steps = 0;
+
+    while (queue_size > 0) {
+        if (direction_optimizing && scout > edges_to_check / ALPHA) {
+            queueToBitmap(work->queue, queue_size, work->frontier, work->words);
+            // Vertices leave the unexplored edges as they are reached, the
+            // frontier's now and every bottom-up step's as it wakes them
+            edges_to_check -= scout;
+            long awake = queue_size, previous, woken_edges;
+            do {
+                previous = awake;
+                awake = bottomUpStep(graph, parent, work->frontier, work->next_frontier, work->words, &woken_edges);
+                edges_to_check -= woken_edges;
+                uint64_t *swap = work->frontier;
+                work->frontier = work->next_frontier;
+                work->next_frontier = swap;
+                steps->bottom_up_steps++;
+            } while (awake >= previous || awake > graph->n / BETA);
+            queue_size = bitmapToQueue(work->frontier, work->words, work->queue);
+            // Already subtracted; the next top-down step expands the frontier
+            scout = 0;
+        } else {
+            long next_size;
+            edges_to_check -= scout;
+            scout = topDownStep(graph, parent, work->queue, queue_size, work->next_queue, &next_size);
+            int *swap = work->queue;
+            work->queue = work->next_queue;
+            work->next_queue = swap;
+            queue_size = next_size;
+            steps->top_down_steps++;
+        }
+    }
+}
+
+static int isNeighbour(const Graph *graph, int v, int u) {
+    const int *list = graph->adjacency + graph->offsets[v];
+    return bsearch(&u, list, degree(graph, v), sizeof(int), compareInts) != NULL;
+}
+
+// Graph500 checks from the parent array alone; depth doubles as the work array.
+// Returns the undirected edges of the searched component, or -1.
+static long validateTree(const Graph *graph, int root, const int *parent, int *depth) {
+    int n = graph->n;
+    if (parent[root] != root) {
+        fprintf(stderr, "The root %d is not its own parent\n", root);
+        return -1;
+    }
+    for (int v = 0; v < n; v++) depth[v] = -1;
+    depth[root] = 0;
+
+    // Depths by walking up to a vertex of known depth; a walk longer than n is a cycle
+    int *path = malloc(n * sizeof(int));
+    if (path == NULL) return -1;
+    for (int v = 0; v < n; v++) {
+        if (parent[v] < 0 || depth[v] >= 0) continue;
+        int length = 0, u = v;
+        while (depth[u] < 0) {
+            if (length == n || parent[u] < 0 || parent[u] >= n) {
+                fprintf(stderr, "Vertex %d does not lead back to the root\n", v);
+                free(path);
+                return -1;
+            }
+            path[length++] = u;
+            u = parent[u];
+        }
+        while (length > 0) {
+            int w = path[--length];
+            depth[w] = depth[parent[w]] + 1;
+        }
+    }
+    free(path);
+
+    long errors = 0, edges = 0;
+    #pragma omp parallel for schedule(dynamic, 256) reduction(+:errors, edges)
+    for (int v = 0; v < n; v++) {
+        if (v != root && parent[v] >= 0 && !isNeighbour(graph, v, parent[v])) errors++;
+        for (long e = graph->offsets[v]; e < graph->offsets[v + 1]; e++) {
+            int u = graph->adjacency[e];
+            if ((depth[v] < 0) != (depth[u] < 0)) errors++;
+            else if (depth[v] >= 0 && (depth[v] - depth[u] > 1 || depth[u] - depth[v] > 1)) errors++;
+        }
+        if (depth[v] >= 0) edges += degree(graph, v);
+    }
+    if (errors > 0) {
+        fprintf(stderr, "BFS tree from %d fails %ld checks\n", root, errors);
+        return -1;
+    }
+    return edges / 2;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <edge_list> <num_of_threads> [--roots=N] [--seed=N] [--top-down]\n", argv[0]);
+        fprintf(stderr, "       %s --rmat <scale> <num_of_threads> [--edgefactor=N] [--roots=N] [--seed=N] [--top-down]\n", argv[0]);
+        return -1;
+    }
+
+    int generate = strcmp(argv[1], "--rmat") == 0;
+    int first_option = generate ? 4 : 3;
+    if (argc < first_option) {
+        fprintf(stderr, "Missing the number of threads\n");
+        return -1;
+    }
+    int roots = 16, edgefactor = 16, direction_optimizing = 1;
+    uint64_t seed = 1;
+    for (int i = first_option; i < argc; i++) {
+        if (strncmp(argv[i], "--roots=", 8) == 0) {
+            roots = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--edgefactor=", 13) == 0) {
+            edgefactor = atoi(argv[i] + 13);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strcmp(argv[i], "--top-down") == 0) {
+            direction_optimizing = 0;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    int num_threads = atoi(argv[first_option - 1]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    if (roots < 1 || edgefactor < 1) {
+        fprintf(stderr, "--roots and --edgefactor must be at least 1\n");
+        return -1;
+    }
+    omp_set_dynamic(0);
+    omp_set_num_threads(num_threads);
+
+    EdgeList edges;
+    double load_start = omp_get_wtime();
+    if (generate) {
+        int scale = atoi(argv[2]);
+        if (scale < 1 || scale > 30) {
+            fprintf(stderr, "The scale must lie between 1 and 30\n");
+            return -1;
+        }
+        if (generateRmat(scale, edgefactor, seed, &edges) != 0) return -1;
+    } else if (readEdges(argv[1], &edges) != 0) {
+        return -1;
+    }
+    if (edges.n == 0) {
+        fprintf(stderr, "The graph has no vertices\n");
+        return -1;
+    }
+
+    Graph graph;
+    if (buildGraph(&edges, &graph) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    double build_time = omp_get_wtime() - load_start;
+    printf("Graph: %d vertices, %ld input edges, %ld undirected edges in CSR (built in %f seconds)\n",
+           graph.n, edges.count, graph.m / 2, build_time);
+    free(edges.u);
+    free(edges.v);
+
+    BfsWork work;
+    work.words = (graph.n + 63) / 64;
+    work.queue = malloc(graph.n * sizeof(int));
+    work.next_queue = malloc(graph.n * sizeof(int));
+    work.frontier = malloc(work.words * sizeof(uint64_t));
+    work.next_frontier = malloc(work.words * sizeof(uint64_t));
+    int *parent = malloc(graph.n * sizeof(int));
+    int *depth = malloc(graph.n * sizeof(int));
+    double *teps = malloc(roots * sizeof(double));
+    if (work.queue == NULL || work.next_queue == NULL || work.frontier == NULL || work.next_frontier == NULL ||
+        parent == NULL || depth == NULL || teps == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    // Roots are random vertices with at least one edge, as in Graph500
+    long has_edges = 0;
+    for (int v = 0; v < graph.n; v++) has_edges += degree(&graph, v) > 0;
+    if (has_edges == 0) {
+        fprintf(stderr, "The graph has no edges\n");
+        return -1;
+    }
+
+    double total_time = 0.0;
+    long top_down_steps = 0, bottom_up_steps = 0;
+    uint64_t state = seed + 0x5eed;
+    for (int r = 0; r < roots; r++) {
+        int root;
+        do {
+            state = splitmix(state);
+            root = (int)(state % graph.n);
+        } while (degree(&graph, root) == 0);
+
+        BfsSteps steps;
+        double start_time = omp_get_wtime();
+        breadthFirstSearch(&graph, root, parent, &work, direction_optimizing, &steps);
+        double elapsed = omp_get_wtime() - start_time;
+
+        long traversed = validateTree(&graph, root, parent, depth);
+        if (traversed < 0) return -1;
+        teps[r] = traversed / elapsed;
+        total_time += elapsed;
+        top_down_steps += steps.top_down_steps;
+        bottom_up_steps += steps.bottom_up_steps;
+    }
+
+    double harmonic = 0.0;
+    for (int r = 0; r < roots; r++) harmonic += 1.0 / teps[r];
+    harmonic = roots / harmonic;
+    qsort(teps, roots, sizeof(double), compareDoubles);
+    printf("Validated %d BFS trees (%s): %ld top-down and %ld bottom-up steps\n", roots,
+           direction_optimizing ? "direction optimizing" : "top-down only", top_down_steps, bottom_up_steps);
+    printf("TEPS: harmonic mean %.4e, min %.4e, median %.4e, max %.4e\n", harmonic, teps[0], teps[roots / 2],
+           teps[roots - 1]);
+    printf("Time taken: %f seconds with %d threads\n", total_time / roots, num_threads);
+
+    free(graph.offsets);
+    free(graph.adjacency);
+    free(work.queue);
+    free(work.next_queue);
+    free(work.frontier);
+    free(work.next_frontier);
+    free(parent);
+    free(depth);
+    free(teps);
+    return 0;
+}
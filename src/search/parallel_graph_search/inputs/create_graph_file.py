@@ -0,0 +1,26 @@
+import random
+
+def create_graph_file(side, shortcuts, ring, filename, seed=42):
+    # A side x side grid with random shortcuts, plus a ring of `ring` vertices
+    # that no root in the grid reaches; edges are shuffled "u v" lines
+    rng = random.Random(seed)
+    edges = []
+    for r in range(side):
+        for c in range(side):
+            v = r * side + c
+            if c + 1 < side:
+                edges.append((v, v + 1))
+            if r + 1 < side:
+                edges.append((v, v + side))
+    for _ in range(shortcuts):
+        edges.append((rng.randrange(side * side), rng.randrange(side * side)))
+    first = side * side
+    for i in range(ring):
+        edges.append((first + i, first + (i + 1) % ring))
+    rng.shuffle(edges)
+    with open(filename, 'w') as f:
+        f.write("# {}x{} grid with {} random shortcuts plus a {}-vertex ring: u v per line\n".format(side, side, shortcuts, ring))
+        for u, v in edges:
+            f.write("{} {}\n".format(u, v))
+
+create_graph_file(64, 2000, 100, 'small_graph.txt')
@@ -0,0 +1,334 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <omp.h>
+#include "search_protocol.h"
+#include "../../libpcm/pcm.h"
+#include "../../common/xorshift.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -pthread -o search_client search_client.c search_protocol.c ../../../libpcm.a
+    command to execute:
+    ./search_client [socket path] [connections] [requests per connection] [queries per request] [--mode=lookup|range|mixed] [--seed=N] [--check=sorted input]
+
+    Load generator for search_server. Each connection is a thread that sends
+    its requests back to back and times every round trip; the report gives
+    throughput and the p50/p99/p999 request latency. --check loads the file
+    the server serves and, after the timed run, checks every answer: lookups
+    against pcmBinarySearch, range counts against a local lower bound.
+*/
+
+typedef enum { MODE_LOOKUP, MODE_RANGE, MODE_MIXED } QueryMode;
+
+typedef struct {
+    const char *socket_path;
+    int requests;
+    int batch;
+    QueryMode mode;
+    int32_t min_key;
+    int32_t max_key;
+    uint64_t seed;
+    double *latencies;     // one per request, in microseconds
+    long hits;             // lookups that found their key
+    long lookups;
+    long range_keys;       // keys counted by all range queries
+    SearchQuery *sent;     // every query and answer when checking, else NULL
+    int32_t *answers;
+    int failed;
+} ClientThread;
+
+static int connectTo(const char *path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int32_t randomKey(uint64_t *state, int32_t low, int32_t high) {
+    uint64_t span = (uint64_t)((int64_t)high - low) + 1;
+    return (int32_t)(low + (int64_t)(nextRandom(state) % span));
+}
+
+static void* runConnection(void *arg) {
+    ClientThread *client = arg;
+    int fd = connectTo(client->socket_path);
+    SearchQuery *queries = malloc(client->batch * sizeof(SearchQuery));
+    int32_t *results = malloc(client->batch * sizeof(int32_t));
+    if (fd < 0 || queries == NULL || results == NULL) {
+        client->failed = 1;
+        goto done;
+    }
+
+    // Ranges cover about a thousandth of the key space
+    int64_t range_width = ((int64_t)client->max_key - client->min_key) / 1000;
+    for (int r = 0; r < client->requests; r++) {
+        for (int q = 0; q < client->batch; q++) {
+            int lookup = client->mode == MODE_LOOKUP ||
+                         (client->mode == MODE_MIXED && (nextRandom(&client->seed) & 1));
+            int32_t key = randomKey(&client->seed, client->min_key, client->max_key);
+            queries[q].op = lookup ? SEARCH_LOOKUP : SEARCH_RANGE_COUNT;
+            queries[q].low = key;
+            queries[q].high = (int64_t)key + range_width > INT32_MAX ? INT32_MAX : (int32_t)(key + range_width);
+        }
+
+        double start = omp_get_wtime();
+        if (sendRequest(fd, queries, client->batch) != 0 ||
+            receiveResponse(fd, results, client->batch) != 0) {
+            client->failed = 1;
+            break;
+        }
+        client->latencies[r] = (omp_get_wtime() - start) * 1e6;
+        if (client->sent != NULL) {
+            memcpy(client->sent + (long)r * client->batch, queries, client->batch * sizeof(SearchQuery));
+            memcpy(client->answers + (long)r * client->batch, results, client->batch * sizeof(int32_t));
+        }
+
+        for (int q = 0; q < client->batch; q++) {
+            if (queries[q].op == SEARCH_LOOKUP) {
+                client->lookups++;
+                if (results[q] >= 0) client->hits++;
+            } else {
+                client->range_keys += results[q];
+            }
+        }
+    }
+
+done:
+    if (fd >= 0) close(fd);
+    free(queries);
+    free(results);
+    return NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, long count, double fraction) {
+    long rank = (long)(fraction * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// First position whose key is >= key, or n
+static long lowerBound(const int *keys, long n, long key) {
+    long low = 0, high = n;
+    while (low < high) {
+        long mid = low + (high - low) / 2;
+        if (keys[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// The number of answers that disagree with the local copy of the keys
+static long checkAnswers(PcmContext *context, const int *keys, long n, const SearchQuery *queries,
+                         const int32_t *answers, long count) {
+    long wrong = 0;
+    for (long q = 0; q < count; q++) {
+        const SearchQuery *query = &queries[q];
+        int32_t answer = answers[q];
+        if (query->op == SEARCH_LOOKUP) {
+            int index;
+            if (pcmBinarySearch(context, keys, (int)n, query->low, &index) != PCM_OK) return count;
+            // The server answers the first index holding the key
+            int correct = index < 0 ? answer == -1
+                                    : answer >= 0 && answer < n && keys[answer] == query->low &&
+                                      (answer == 0 || keys[answer - 1] != query->low);
+            wrong += !correct;
+        } else {
+            long expected = query->low > query->high ? 0
+                          : lowerBound(keys, n, (long)query->high + 1) - lowerBound(keys, n, query->low);
+            wrong += answer != expected;
+        }
+    }
+    return wrong;
+}
+
+static int queryInfo(const char *path, int32_t info[3]) {
+    int fd = connectTo(path);
+    if (fd < 0) return -1;
+    SearchQuery queries[3];
+    for (int i = 0; i < 3; i++) {
+        queries[i].op = SEARCH_INFO;
+        queries[i].low = i;
+        queries[i].high = 0;
+    }
+    int status = sendRequest(fd, queries, 3) == 0 && receiveResponse(fd, info, 3) == 0 ? 0 : -1;
+    close(fd);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <socket_path> <connections> <requests_per_connection> <queries_per_request> [--mode=lookup|range|mixed] [--seed=N] [--check=sorted_input_file]\n", argv[0]);
+        return -1;
+    }
+
+    QueryMode mode = MODE_LOOKUP;
+    uint64_t seed = 42;
+    const char *check_file = NULL;
+    for (int i = 5; i < argc; i++) {
+        if (strcmp(argv[i], "--mode=lookup") == 0) {
+            mode = MODE_LOOKUP;
+        } else if (strcmp(argv[i], "--mode=range") == 0) {
+            mode = MODE_RANGE;
+        } else if (strcmp(argv[i], "--mode=mixed") == 0) {
+            mode = MODE_MIXED;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--check=", 8) == 0) {
+            check_file = argv[i] + 8;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    const char *socket_path = argv[1];
+    int connections = atoi(argv[2]);
+    int requests = atoi(argv[3]);
+    int batch = atoi(argv[4]);
+    if (connections < 1 || requests < 1 || batch < 1 || batch > SEARCH_MAX_BATCH) {
+        fprintf(stderr, "Connections and requests must be at least 1, queries per request between 1 and %d\n", SEARCH_MAX_BATCH);
+        return -1;
+    }
+
+    int32_t info[3];
+    if (queryInfo(socket_path, info) != 0) {
+        fprintf(stderr, "Could not reach a search server on %s\n", socket_path);
+        return -1;
+    }
+
+    long check_n = 0;
+    int *check_keys = NULL;
+    if (check_file != NULL) {
+        check_keys = loadSearchKeys(check_file, &check_n);
+        if (check_keys == NULL) return -1;
+        if (check_n != info[SEARCH_INFO_SIZE]) {
+            fprintf(stderr, "%s holds %ld keys but the server holds %d\n", check_file, check_n, info[SEARCH_INFO_SIZE]);
+            return -1;
+        }
+    }
+
+    ClientThread *clients = calloc(connections, sizeof(ClientThread));
+    pthread_t *threads = malloc(connections * sizeof(pthread_t));
+    double *latencies = malloc((long)connections * requests * sizeof(double));
+    if (clients == NULL || threads == NULL || latencies == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    for (int c = 0; c < connections; c++) {
+        clients[c].socket_path = socket_path;
+        clients[c].requests = requests;
+        clients[c].batch = batch;
+        clients[c].mode = mode;
+        clients[c].min_key = info[SEARCH_INFO_MIN];
+        clients[c].max_key = info[SEARCH_INFO_MAX];
+        clients[c].seed = (seed + 1) * 0x9E3779B97F4A7C15ULL + c;
+        clients[c].latencies = latencies + (long)c * requests;
+        if (check_keys != NULL) {
+            clients[c].sent = malloc((long)requests * batch * sizeof(SearchQuery));
+            clients[c].answers = malloc((long)requests * batch * sizeof(int32_t));
+            if (clients[c].sent == NULL || clients[c].answers == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                return -1;
+            }
+        }
+    }
+
+    double start_time = omp_get_wtime();
+    int started = 0;
+    for (; started < connections; started++) {
+        int error = pthread_create(&threads[started], NULL, runConnection, &clients[started]);
+        if (error != 0) {
+            fprintf(stderr, "Failed to start connection %d: %s\n", started, strerror(error));
+            break;
+        }
+    }
+    for (int c = 0; c < started; c++) {
+        pthread_join(threads[c], NULL);
+    }
+    if (started < connections) return -1;
+    double end_time = omp_get_wtime();
+
+    long hits = 0, lookups = 0, range_keys = 0;
+    for (int c = 0; c < connections; c++) {
+        if (clients[c].failed) {
+            fprintf(stderr, "Connection %d failed\n", c);
+            return -1;
+        }
+        hits += clients[c].hits;
+        lookups += clients[c].lookups;
+        range_keys += clients[c].range_keys;
+    }
+
+    long total_requests = (long)connections * requests;
+    double elapsed = end_time - start_time;
+    qsort(latencies, total_requests, sizeof(double), compareDoubles);
+    double mean = 0.0;
+    for (long i = 0; i < total_requests; i++) mean += latencies[i];
+    mean /= total_requests;
+
+    printf("Server holds %d keys in [%d, %d]\n", info[SEARCH_INFO_SIZE], info[SEARCH_INFO_MIN], info[SEARCH_INFO_MAX]);
+    printf("%d connections x %d requests x %d queries in %f seconds\n", connections, requests, batch, elapsed);
+    printf("Throughput: %.0f queries/s, %.0f requests/s\n", total_requests * batch / elapsed, total_requests / elapsed);
+    printf("Request latency (us): mean %.1f, p50 %.1f, p99 %.1f, p999 %.1f, max %.1f\n", mean,
+           percentile(latencies, total_requests, 0.50), percentile(latencies, total_requests, 0.99),
+           percentile(latencies, total_requests, 0.999), latencies[total_requests - 1]);
+    if (lookups > 0) printf("Lookups: %ld, found %ld (%.1f%%)\n", lookups, hits, 100.0 * hits / lookups);
+    if (lookups < total_requests * batch) {
+        printf("Range counts: %ld, %.1f keys on average\n", total_requests * batch - lookups,
+               (double)range_keys / (total_requests * batch - lookups));
+    }
+
+    int status = 0;
+    if (check_keys != NULL) {
+        // One caller thread, so one single-threaded context answers every lookup
+        PcmOptions options;
+        pcmDefaultOptions(&options);
+        options.threads = 1;
+        PcmContext *context = pcmContextCreate(&options);
+        if (context == NULL) {
+            fprintf(stderr, "Failed to set up libpcm\n");
+            return -1;
+        }
+        long wrong = 0;
+        for (int c = 0; c < connections; c++) {
+            wrong += checkAnswers(context, check_keys, check_n, clients[c].sent, clients[c].answers, (long)requests * batch);
+            free(clients[c].sent);
+            free(clients[c].answers);
+        }
+        pcmContextDestroy(context);
+        if (wrong == 0) {
+            printf("Checked %ld answers against %s: all correct\n", total_requests * batch, check_file);
+        } else {
+            printf("Checked %ld answers against %s: %ld WRONG\n", total_requests * batch, check_file, wrong);
+            status = 1;
+        }
+        free(check_keys);
+    }
+
+    free(clients);
+    free(threads);
+    free(latencies);
+    return status;
+}
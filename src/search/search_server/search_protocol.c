@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "search_protocol.h"
+
+// 0 once every byte arrived, -1 on error or when the peer closed first
+int readFully(int fd, void *buffer, size_t bytes) {
+    char *data = buffer;
+    while (bytes > 0) {
+        ssize_t got = read(fd, data, bytes);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        data += got;
+        bytes -= (size_t)got;
+    }
+    return 0;
+}
+
+int writeFully(int fd, const void *buffer, size_t bytes) {
+    const char *data = buffer;
+    while (bytes > 0) {
+        ssize_t sent = write(fd, data, bytes);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return -1;
+        data += sent;
+        bytes -= (size_t)sent;
+    }
+    return 0;
+}
+
+// Header and body leave in one writev so small frames are a single packet
+static int sendFrame(int fd, uint32_t count, const void *body, size_t bytes) {
+    struct iovec parts[2] = {
+        { &count, sizeof(count) },
+        { (void *)body, bytes },
+    };
+    size_t total = sizeof(count) + bytes;
+    ssize_t sent;
+    do {
+        sent = writev(fd, parts, 2);
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0) return -1;
+    if ((size_t)sent == total) return 0;
+    // Short write: finish with plain writes
+    if ((size_t)sent < sizeof(count)) {
+        if (writeFully(fd, (char *)&count + sent, sizeof(count) - sent) != 0) return -1;
+        return writeFully(fd, body, bytes);
+    }
+    size_t done = (size_t)sent - sizeof(count);
+    return writeFully(fd, (const char *)body + done, bytes - done);
+}
+
+int sendRequest(int fd, const SearchQuery *queries, uint32_t count) {
+    return sendFrame(fd, count, queries, count * sizeof(SearchQuery));
+}
+
+// queries must hold SEARCH_MAX_BATCH records; larger frames are rejected
+int receiveRequest(int fd, SearchQuery *queries, uint32_t *count) {
+    if (readFully(fd, count, sizeof(*count)) != 0) return -1;
+    if (*count > SEARCH_MAX_BATCH) return -1;
+    return readFully(fd, queries, *count * sizeof(SearchQuery));
+}
+
+int sendResponse(int fd, const int32_t *results, uint32_t count) {
+    return sendFrame(fd, count, results, count * sizeof(int32_t));
+}
+
+int receiveResponse(int fd, int32_t *results, uint32_t count) {
+    uint32_t answered;
+    if (readFully(fd, &answered, sizeof(answered)) != 0 || answered != count) return -1;
+    return readFully(fd, results, count * sizeof(int32_t));
+}
+
+// The sorted input both ends load: the text format of the search inputs
+int* loadSearchKeys(const char *filename, long *n) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        return NULL;
+    }
+    // Same format as the binary search inputs: whitespace separated numbers
+    long count = 0;
+    double temp;
+    while (fscanf(file, "%lf", &temp) == 1) count++;
+    int *data = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (data == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(file);
+        return NULL;
+    }
+    rewind(file);
+    for (long i = 0; i < count; i++) {
+        if (fscanf(file, "%lf", &temp) != 1) break;
+        data[i] = (int)temp;
+    }
+    fclose(file);
+    *n = count;
+    return data;
+}
@@ -0,0 +1,50 @@
+#ifndef SEARCH_PROTOCOL_H
+#define SEARCH_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Wire format between search_server and search_client. Both ends run on the
+    same host, so integers travel in native byte order.
+
+    request:  uint32 count, then count SearchQuery records (12 bytes each)
+    response: uint32 count, then count int32 results, in query order
+
+    SEARCH_LOOKUP       low = key; result = first index holding it, or -1
+    SEARCH_RANGE_COUNT  result = number of keys in [low, high]
+    SEARCH_INFO         low = SEARCH_INFO_SIZE, _MIN or _MAX; result = that value
+*/
+
+#define SEARCH_MAX_BATCH 4096
+
+enum {
+    SEARCH_LOOKUP = 1,
+    SEARCH_RANGE_COUNT = 2,
+    SEARCH_INFO = 3
+};
+
+enum {
+    SEARCH_INFO_SIZE = 0,
+    SEARCH_INFO_MIN = 1,
+    SEARCH_INFO_MAX = 2
+};
+
+typedef struct {
+    uint32_t op;
+    int32_t low;
+    int32_t high;
+} SearchQuery;
+
+int readFully(int fd, void *buffer, size_t bytes);
+int writeFully(int fd, const void *buffer, size_t bytes);
+
+int sendRequest(int fd, const SearchQuery *queries, uint32_t count);
+int receiveRequest(int fd, SearchQuery *queries, uint32_t *count);
+int sendResponse(int fd, const int32_t *results, uint32_t count);
+int receiveResponse(int fd, int32_t *results, uint32_t count);
+
+// Whitespace separated keys, NULL after printing why the file could not be read
+int* loadSearchKeys(const char *filename, long *n);
+
+#endif
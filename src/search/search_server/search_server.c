@@ -0,0 +1,453 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <omp.h>
+#include "search_protocol.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -pthread -o search_server search_server.c search_protocol.c
+    command to execute:
+    ./search_server [sorted input] [socket path] [number of worker threads] [--mmap] [--write-binary=file] [--batch=queries]
+
+    Loads a sorted array once (the text format of the search inputs, or with
+    --mmap a raw file of native int32 keys as written by --write-binary) and
+    answers SEARCH_LOOKUP and SEARCH_RANGE_COUNT requests on a Unix socket
+    until SIGINT or SIGTERM. One thread per connection reads request frames
+    and queues them; the workers take every pending request up to --batch
+    queries at a time, so load from many connections is answered in batches.
+*/
+
+#define SEARCH_INDEX_STRIDE 64       // keys under each fence of the index
+#define DEFAULT_BATCH_QUERIES 256
+#define ACCEPT_POLL_MS 200           // how often the accept loop checks for a signal
+
+// The sorted keys plus every SEARCH_INDEX_STRIDE-th key in a small array that
+// stays in cache, so a lookup touches one block of the big array
+typedef struct {
+    const int *data;
+    long n;
+    int *fences;
+    long fence_count;
+} SortedIndex;
+
+typedef struct SearchJob {
+    const SearchQuery *queries;
+    int32_t *results;
+    uint32_t count;
+    int done;
+    pthread_cond_t finished;
+    struct SearchJob *next;
+} SearchJob;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t pending;
+    SearchJob *head;
+    SearchJob *tail;
+    int shutdown;
+    int batch_queries;
+    const SortedIndex *index;
+    long requests;
+    long queries;
+    long batches;
+} JobQueue;
+
+// Owned by main: the connection thread only reads from fd and sets finished,
+// main joins the thread and closes fd, so fd is never reused while in the list
+typedef struct Connection {
+    int fd;
+    JobQueue *queue;
+    pthread_t thread;
+    int finished;
+    struct Connection *next;
+} Connection;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void requestStop(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+static const int* mapBinary(const char *filename, long *n) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening file");
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size % sizeof(int) != 0 || status.st_size == 0) {
+        fprintf(stderr, "%s is not a non-empty file of int32 keys\n", filename);
+        close(fd);
+        return NULL;
+    }
+    void *data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    *n = status.st_size / sizeof(int);
+    return data;
+}
+
+static int writeBinary(const char *filename, const int *data, long n) {
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        perror("Error opening output file");
+        return -1;
+    }
+    long written = (long)fwrite(data, sizeof(int), n, file);
+    fclose(file);
+    return written == n ? 0 : -1;
+}
+
+static void buildIndex(SortedIndex *index, const int *data, long n) {
+    index->data = data;
+    index->n = n;
+    index->fence_count = (n + SEARCH_INDEX_STRIDE - 1) / SEARCH_INDEX_STRIDE;
+    index->fences = malloc((index->fence_count > 0 ? index->fence_count : 1) * sizeof(int));
+    if (index->fences == NULL) {
+        fprintf(stderr, "Memory allocation failed for the index\n");
+        exit(EXIT_FAILURE);
+    }
+    for (long b = 0; b < index->fence_count; b++) {
+        index->fences[b] = data[b * SEARCH_INDEX_STRIDE];
+    }
+}
+
+// First position whose key is >= key, or n
+static long lowerBound(const SortedIndex *index, long key) {
+    long low = 0, high = index->fence_count;
+    while (low < high) {
+        long mid = low + (high - low) / 2;
+        if (index->fences[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+    if (low == 0) return 0;
+
+    // Fence low-1 is below key and fence low is not, so the answer is in between
+    long first = (low - 1) * SEARCH_INDEX_STRIDE + 1;
+    long last = low * SEARCH_INDEX_STRIDE < index->n ? low * SEARCH_INDEX_STRIDE : index->n;
+    while (first < last) {
+        long mid = first + (last - first) / 2;
+        if (index->data[mid] < key) first = mid + 1;
+        else last = mid;
+    }
+    return first;
+}
+
+static int32_t answerQuery(const SortedIndex *index, const SearchQuery *query) {
+    switch (query->op) {
+        case SEARCH_LOOKUP: {
+            long position = lowerBound(index, query->low);
+            return position < index->n && index->data[position] == query->low ? (int32_t)position : -1;
+        }
+        case SEARCH_RANGE_COUNT:
+            if (query->low > query->high) return 0;
+            return (int32_t)(lowerBound(index, (long)query->high + 1) - lowerBound(index, query->low));
+        case SEARCH_INFO:
+            if (query->low == SEARCH_INFO_SIZE) return (int32_t)index->n;
+            if (query->low == SEARCH_INFO_MIN) return index->data[0];
+            if (query->low == SEARCH_INFO_MAX) return index->data[index->n - 1];
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+static void* workerMain(void *arg) {
+    JobQueue *queue = arg;
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->head == NULL && !queue->shutdown) {
+            pthread_cond_wait(&queue->pending, &queue->lock);
+        }
+        if (queue->head == NULL) {
+            pthread_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+        // Take whole requests until the batch is full
+        SearchJob *first = queue->head, *last = queue->head;
+        long queries = last->count, requests = 1;
+        while (last->next != NULL && queries < queue->batch_queries) {
+            last = last->next;
+            queries += last->count;
+            requests++;
+        }
+        queue->head = last->next;
+        if (queue->head == NULL) queue->tail = NULL;
+        last->next = NULL;
+        queue->requests += requests;
+        queue->queries += queries;
+        queue->batches++;
+        pthread_mutex_unlock(&queue->lock);
+
+        for (SearchJob *job = first; job != NULL; job = job->next) {
+            for (uint32_t q = 0; q < job->count; q++) {
+                job->results[q] = answerQuery(queue->index, &job->queries[q]);
+            }
+        }
+
+        pthread_mutex_lock(&queue->lock);
+        for (SearchJob *job = first, *next; job != NULL; job = next) {
+            next = job->next;
+            job->done = 1;
+            pthread_cond_signal(&job->finished);
+        }
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+static void* serveConnection(void *arg) {
+    Connection *connection = arg;
+    JobQueue *queue = connection->queue;
+    SearchQuery *queries = malloc(SEARCH_MAX_BATCH * sizeof(SearchQuery));
+    int32_t *results = malloc(SEARCH_MAX_BATCH * sizeof(int32_t));
+    SearchJob job;
+    pthread_cond_init(&job.finished, NULL);
+
+    uint32_t count;
+    while (queries != NULL && results != NULL && receiveRequest(connection->fd, queries, &count) == 0) {
+        job.queries = queries;
+        job.results = results;
+        job.count = count;
+        job.done = 0;
+        job.next = NULL;
+
+        pthread_mutex_lock(&queue->lock);
+        if (queue->tail != NULL) queue->tail->next = &job;
+        else queue->head = &job;
+        queue->tail = &job;
+        pthread_cond_signal(&queue->pending);
+        while (!job.done) {
+            pthread_cond_wait(&job.finished, &queue->lock);
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        if (sendResponse(connection->fd, results, count) != 0) break;
+    }
+
+    pthread_cond_destroy(&job.finished);
+    free(queries);
+    free(results);
+    __atomic_store_n(&connection->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void closeConnection(Connection *connection) {
+    pthread_join(connection->thread, NULL);
+    close(connection->fd);
+    free(connection);
+}
+
+// Join the threads of connections the clients already closed
+static void reapConnections(Connection **list) {
+    while (*list != NULL) {
+        Connection *connection = *list;
+        if (__atomic_load_n(&connection->finished, __ATOMIC_ACQUIRE)) {
+            *list = connection->next;
+            closeConnection(connection);
+        } else {
+            list = &connection->next;
+        }
+    }
+}
+
+// Shutting the sockets down wakes threads blocked in recv; the workers are
+// still running, so a request already queued is answered before its thread exits
+static void closeAllConnections(Connection *list) {
+    for (Connection *connection = list; connection != NULL; connection = connection->next) {
+        shutdown(connection->fd, SHUT_RDWR);
+    }
+    while (list != NULL) {
+        Connection *next = list->next;
+        closeConnection(list);
+        list = next;
+    }
+}
+
+static void stopWorkers(JobQueue *queue, pthread_t *workers, int count) {
+    pthread_mutex_lock(&queue->lock);
+    queue->shutdown = 1;
+    pthread_cond_broadcast(&queue->pending);
+    pthread_mutex_unlock(&queue->lock);
+    for (int w = 0; w < count; w++) {
+        pthread_join(workers[w], NULL);
+    }
+}
+
+static int listenOn(const char *path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <sorted_input_file> <socket_path> <num_of_threads> [--mmap] [--write-binary=file] [--batch=queries]\n", argv[0]);
+        return -1;
+    }
+
+    int use_mmap = 0;
+    const char *binary_output = NULL;
+    int batch_queries = DEFAULT_BATCH_QUERIES;
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--mmap") == 0) {
+            use_mmap = 1;
+        } else if (strncmp(argv[i], "--write-binary=", 15) == 0) {
+            binary_output = argv[i] + 15;
+        } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            batch_queries = atoi(argv[i] + 8);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    const char *socket_path = argv[2];
+    int num_threads = atoi(argv[3]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    if (batch_queries < 1) {
+        fprintf(stderr, "Batch size must be at least 1\n");
+        return -1;
+    }
+
+    double load_start = omp_get_wtime();
+    long n = 0;
+    const int *data = use_mmap ? mapBinary(argv[1], &n) : loadSearchKeys(argv[1], &n);
+    if (data == NULL) return -1;
+    if (n == 0 || n > INT32_MAX) {
+        fprintf(stderr, "The input must hold between 1 and %d keys\n", INT32_MAX);
+        return -1;
+    }
+    for (long i = 1; i < n; i++) {
+        if (data[i - 1] > data[i]) {
+            fprintf(stderr, "The input is not sorted at index %ld\n", i);
+            return -1;
+        }
+    }
+    if (binary_output != NULL && writeBinary(binary_output, data, n) != 0) {
+        fprintf(stderr, "Failed to write %s\n", binary_output);
+        return -1;
+    }
+    SortedIndex index;
+    buildIndex(&index, data, n);
+    double load_time = omp_get_wtime() - load_start;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = listenOn(socket_path);
+    if (listen_fd < 0) return -1;
+
+    JobQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.pending, NULL);
+    queue.batch_queries = batch_queries;
+    queue.index = &index;
+    pthread_t *workers = malloc(num_threads * sizeof(pthread_t));
+    if (workers == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    for (int w = 0; w < num_threads; w++) {
+        int error = pthread_create(&workers[w], NULL, workerMain, &queue);
+        if (error != 0) {
+            fprintf(stderr, "Failed to start worker %d: %s\n", w, strerror(error));
+            stopWorkers(&queue, workers, w);
+            close(listen_fd);
+            unlink(socket_path);
+            return -1;
+        }
+    }
+
+    printf("Serving %ld keys (%ld index fences, loaded in %f seconds) on %s with %d workers\n",
+           n, index.fence_count, load_time, socket_path, num_threads);
+    fflush(stdout);
+
+    double start_time = omp_get_wtime();
+    long connections = 0;
+    Connection *open_connections = NULL;
+    while (!stop_requested) {
+        reapConnections(&open_connections);
+        struct pollfd waiting = { listen_fd, POLLIN, 0 };
+        if (poll(&waiting, 1, ACCEPT_POLL_MS) <= 0) continue;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+        Connection *connection = calloc(1, sizeof(Connection));
+        if (connection == NULL) {
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        connection->queue = &queue;
+        int error = pthread_create(&connection->thread, NULL, serveConnection, connection);
+        if (error != 0) {
+            fprintf(stderr, "Failed to start a connection thread: %s\n", strerror(error));
+            close(fd);
+            free(connection);
+            continue;
+        }
+        connection->next = open_connections;
+        open_connections = connection;
+        connections++;
+    }
+    double end_time = omp_get_wtime();
+
+    close(listen_fd);
+    unlink(socket_path);
+    // Connection threads hold pointers to queue, so they finish before the workers stop
+    closeAllConnections(open_connections);
+    stopWorkers(&queue, workers, num_threads);
+
+    printf("Served %ld queries in %ld requests from %ld connections over %f seconds\n",
+           queue.queries, queue.requests, connections, end_time - start_time);
+    if (queue.batches > 0) {
+        printf("Workers ran %ld batches, %.2f requests and %.1f queries per batch\n", queue.batches,
+               (double)queue.requests / queue.batches, (double)queue.queries / queue.batches);
+    }
+    free(workers);
+    free(index.fences);
+    pthread_cond_destroy(&queue.pending);
+    pthread_mutex_destroy(&queue.lock);
+    return 0;
+}
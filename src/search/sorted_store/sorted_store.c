@@ -0,0 +1,723 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <omp.h>
+#include "sorted_store.h"
+
+#define L0_MERGE_TRIGGER 4          // level-0 runs that start a merge into level 1
+#define L0_STALL 12                 // level-0 runs at which buffer flushes wait
+#define MAX_LEVELS 12
+#define LEVEL_RATIO 8               // each level may hold this many times the one above
+#define BLOOM_HASHES 7
+#define BUFFER_FILTER_BITS (1 << 16)
+#define PARALLEL_MERGE_MIN (1 << 16) // smaller merges stay on the merge thread
+#define MERGE_PIECES_PER_THREAD 4
+
+typedef struct {
+    int *keys;
+    unsigned char *deleted;     // 1 for a tombstone
+    long size;
+    int *fences;                // keys[b * STORE_FENCE_STRIDE]
+    long fence_count;
+    uint64_t *bloom;
+    long bloom_bits;            // 0 without a filter
+    int refs;
+} Run;
+
+// An immutable snapshot of the runs: level 0 newest first, then one run per level
+typedef struct {
+    Run *l0[L0_STALL];
+    int l0_count;
+    Run *levels[MAX_LEVELS];    // levels[0] is unused; level 0 is l0
+    int refs;
+} Version;
+
+typedef struct {
+    int key;
+    int deleted;
+} Operation;
+
+struct SortedStore {
+    SortedStoreOptions options;
+
+    pthread_mutex_t buffer_lock;
+    pthread_cond_t buffer_free;     // a frozen buffer became a run, or level 0 shrank
+    Operation *active;              // the newest operations, in arrival order
+    int active_count;
+    Operation *frozen;              // the previous buffer while it becomes a run
+    int frozen_count;
+    int freezing;
+    uint64_t *active_filter;        // one bit per hashed key, so most lookups skip the scan
+    uint64_t *frozen_filter;
+
+    pthread_mutex_t version_lock;
+    Version *current;
+
+    pthread_mutex_t merge_lock;
+    pthread_cond_t merge_wanted;
+    pthread_cond_t merge_idle;
+    int merge_requested;
+    int merging;
+    int stopping;
+    pthread_t merger;
+
+    long merges;
+    long merged_entries;
+    double merge_seconds;
+    long stalls;
+    long bloom_skips;
+};
+
+static void* checkedAlloc(size_t bytes) {
+    void *memory = malloc(bytes > 0 ? bytes : 1);
+    if (memory == NULL) {
+        fprintf(stderr, "Memory allocation failed in the sorted store\n");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+static uint64_t hashKey(int key) {
+    uint64_t h = (uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+static Run* newRun(long size) {
+    Run *run = checkedAlloc(sizeof(Run));
+    run->keys = checkedAlloc(size * sizeof(int));
+    run->deleted = checkedAlloc(size);
+    run->size = size;
+    run->fences = NULL;
+    run->fence_count = 0;
+    run->bloom = NULL;
+    run->bloom_bits = 0;
+    run->refs = 1;
+    return run;
+}
+
+static void retainRun(Run *run) {
+    if (run != NULL) __atomic_add_fetch(&run->refs, 1, __ATOMIC_RELAXED);
+}
+
+static void releaseRun(Run *run) {
+    if (run == NULL || __atomic_sub_fetch(&run->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    free(run->keys);
+    free(run->deleted);
+    free(run->fences);
+    free(run->bloom);
+    free(run);
+}
+
+// Fence pointers and the Bloom filter, once the keys are in place
+static void finishRun(Run *run, int bits_per_key, int threads) {
+    run->fence_count = (run->size + STORE_FENCE_STRIDE - 1) / STORE_FENCE_STRIDE;
+    run->fences = checkedAlloc(run->fence_count * sizeof(int));
+    for (long b = 0; b < run->fence_count; b++) {
+        run->fences[b] = run->keys[b * STORE_FENCE_STRIDE];
+    }
+    if (bits_per_key <= 0 || run->size == 0) return;
+
+    long words = (run->size * bits_per_key + 63) / 64;
+    run->bloom_bits = words * 64;
+    run->bloom = calloc(words, sizeof(uint64_t));
+    if (run->bloom == NULL) {
+        fprintf(stderr, "Memory allocation failed in the sorted store\n");
+        exit(EXIT_FAILURE);
+    }
+    #pragma omp parallel for num_threads(threads) if(run->size >= PARALLEL_MERGE_MIN)
+    for (long i = 0; i < run->size; i++) {
+        uint64_t h = hashKey(run->keys[i]), step = (h >> 32) | 1;
+        for (int j = 0; j < BLOOM_HASHES; j++) {
+            uint64_t bit = (h + j * step) % run->bloom_bits;
+            __atomic_fetch_or(&run->bloom[bit / 64], 1ULL << (bit % 64), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int bloomMayContain(const Run *run, int key) {
+    if (run->bloom_bits == 0) return 1;
+    uint64_t h = hashKey(key), step = (h >> 32) | 1;
+    for (int j = 0; j < BLOOM_HASHES; j++) {
+        uint64_t bit = (h + j * step) % run->bloom_bits;
+        if (!(run->bloom[bit / 64] & (1ULL << (bit % 64)))) return 0;
+    }
+    return 1;
+}
+
+// First index whose key is >= key: the fences narrow it to one stride
+static long runLowerBound(const Run *run, long key) {
+    long low = 0, high = run->fence_count;
+    while (low < high) {
+        long mid = low + (high - low) / 2;
+        if (run->fences[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+    if (low == 0) return 0;
+    long first = (low - 1) * STORE_FENCE_STRIDE + 1;
+    long last = low * STORE_FENCE_STRIDE < run->size ? low * STORE_FENCE_STRIDE : run->size;
+    while (first < last) {
+        long mid = first + (last - first) / 2;
+        if (run->keys[mid] < key) first = mid + 1;
+        else last = mid;
+    }
+    return first;
+}
+
+static int comparePacked(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorted and deduplicated operations; the latest operation on a key wins
+static Run* runFromOperations(const Operation *operations, int count, int bits_per_key) {
+    uint64_t *packed = checkedAlloc(count * sizeof(uint64_t));
+    for (int i = 0; i < count; i++) {
+        packed[i] = (uint64_t)((uint32_t)operations[i].key ^ 0x80000000u) << 32 |
+                    (uint64_t)i << 1 | (operations[i].deleted != 0);
+    }
+    // Sorting by key, then arrival, leaves each key's latest operation last
+    qsort(packed, count, sizeof(uint64_t), comparePacked);
+
+    Run *run = newRun(count);
+    long size = 0;
+    for (int i = 0; i < count; i++) {
+        if (i + 1 < count && packed[i] >> 32 == packed[i + 1] >> 32) continue;
+        run->keys[size] = (int)((uint32_t)(packed[i] >> 32) ^ 0x80000000u);
+        run->deleted[size] = packed[i] & 1;
+        size++;
+    }
+    run->size = size;
+    free(packed);
+    finishRun(run, bits_per_key, 1);
+    return run;
+}
+
+// The merge of one key range of both runs, written at out_start
+typedef struct {
+    const Run *newer;
+    const Run *older;
+    long newer_start, newer_end;
+    long older_start, older_end;
+    long out_start;
+    long written;
+} MergePiece;
+
+static void mergePiece(MergePiece *piece, int *keys, unsigned char *deleted, int drop_tombstones) {
+    const Run *a = piece->newer, *b = piece->older;
+    long i = piece->newer_start, j = piece->older_start, w = piece->out_start;
+    while (i < piece->newer_end || j < piece->older_end) {
+        int key;
+        unsigned char tombstone;
+        if (j == piece->older_end || (i < piece->newer_end && a->keys[i] < b->keys[j])) {
+            key = a->keys[i];
+            tombstone = a->deleted[i++];
+        } else if (i == piece->newer_end || b->keys[j] < a->keys[i]) {
+            key = b->keys[j];
+            tombstone = b->deleted[j++];
+        } else {
+            // The same key in both: the newer run's operation wins
+            key = a->keys[i];
+            tombstone = a->deleted[i++];
+            j++;
+        }
+        if (tombstone && drop_tombstones) continue;
+        keys[w] = key;
+        deleted[w] = tombstone;
+        w++;
+    }
+    piece->written = w - piece->out_start;
+}
+
+// Large merges are cut at keys of the larger run, so equal keys never land in
+// different pieces; the pieces then move into place behind each other
+static Run* mergeRuns(const Run *newer, const Run *older, int drop_tombstones, int threads, int bits_per_key) {
+    long total = newer->size + older->size;
+    int pieces = total >= PARALLEL_MERGE_MIN && threads > 1 ? threads * MERGE_PIECES_PER_THREAD : 1;
+    const Run *larger = newer->size > older->size ? newer : older;
+    MergePiece *piece = checkedAlloc(pieces * sizeof(MergePiece));
+    for (int p = 0; p < pieces; p++) {
+        long split = p == 0 ? LONG_MIN : larger->keys[larger->size * p / pieces];
+        piece[p].newer = newer;
+        piece[p].older = older;
+        piece[p].newer_start = p == 0 ? 0 : runLowerBound(newer, split);
+        piece[p].older_start = p == 0 ? 0 : runLowerBound(older, split);
+        piece[p].out_start = piece[p].newer_start + piece[p].older_start;
+        if (p > 0) {
+            piece[p - 1].newer_end = piece[p].newer_start;
+            piece[p - 1].older_end = piece[p].older_start;
+        }
+    }
+    piece[pieces - 1].newer_end = newer->size;
+    piece[pieces - 1].older_end = older->size;
+
+    int *keys = checkedAlloc(total * sizeof(int));
+    unsigned char *deleted = checkedAlloc(total);
+    #pragma omp parallel for num_threads(threads) schedule(dynamic, 1) if(pieces > 1)
+    for (int p = 0; p < pieces; p++) {
+        mergePiece(&piece[p], keys, deleted, drop_tombstones);
+    }
+
+    long size = 0;
+    for (int p = 0; p < pieces; p++) size += piece[p].written;
+    Run *run = newRun(size);
+    long offset = 0;
+    for (int p = 0; p < pieces; p++) {
+        long from = piece[p].out_start;
+        piece[p].out_start = offset;
+        offset += piece[p].written;
+        piece[p].newer_start = from;    // reused: where the piece was written
+    }
+    #pragma omp parallel for num_threads(threads) if(pieces > 1)
+    for (int p = 0; p < pieces; p++) {
+        memcpy(run->keys + piece[p].out_start, keys + piece[p].newer_start, piece[p].written * sizeof(int));
+        memcpy(run->deleted + piece[p].out_start, deleted + piece[p].newer_start, piece[p].written);
+    }
+    free(keys);
+    free(deleted);
+    free(piece);
+    finishRun(run, bits_per_key, threads);
+    return run;
+}
+
+static Version* copyVersion(const Version *from) {
+    Version *version = checkedAlloc(sizeof(Version));
+    *version = *from;
+    version->refs = 1;
+    for (int r = 0; r < version->l0_count; r++) retainRun(version->l0[r]);
+    for (int level = 1; level < MAX_LEVELS; level++) retainRun(version->levels[level]);
+    return version;
+}
+
+static void releaseVersion(Version *version) {
+    if (__atomic_sub_fetch(&version->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    for (int r = 0; r < version->l0_count; r++) releaseRun(version->l0[r]);
+    for (int level = 1; level < MAX_LEVELS; level++) releaseRun(version->levels[level]);
+    free(version);
+}
+
+static Version* acquireVersion(SortedStore *store) {
+    pthread_mutex_lock(&store->version_lock);
+    Version *version = store->current;
+    __atomic_add_fetch(&version->refs, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&store->version_lock);
+    return version;
+}
+
+// Called with version_lock held
+static void replaceVersion(SortedStore *store, Version *next) {
+    Version *previous = store->current;
+    store->current = next;
+    releaseVersion(previous);
+}
+
+static long levelCapacity(const SortedStore *store, int level) {
+    long capacity = (long)store->options.buffer_keys * L0_MERGE_TRIGGER;
+    for (int l = 0; l < level; l++) capacity *= LEVEL_RATIO;
+    return capacity;
+}
+
+static void requestMerge(SortedStore *store) {
+    pthread_mutex_lock(&store->merge_lock);
+    store->merge_requested = 1;
+    pthread_cond_signal(&store->merge_wanted);
+    pthread_mutex_unlock(&store->merge_lock);
+}
+
+static int level0Count(SortedStore *store) {
+    pthread_mutex_lock(&store->version_lock);
+    int count = store->current->l0_count;
+    pthread_mutex_unlock(&store->version_lock);
+    return count;
+}
+
+// Called and returns with buffer_lock held; sorts outside of it, so inserts
+// into the fresh buffer and lookups go on meanwhile
+static void freezeBuffer(SortedStore *store) {
+    int stalled = 0;
+    while (store->freezing || level0Count(store) >= L0_STALL) {
+        if (!store->freezing && !stalled) {
+            store->stalls++;
+            stalled = 1;
+        }
+        pthread_cond_wait(&store->buffer_free, &store->buffer_lock);
+    }
+    if (store->active_count == 0) return;
+
+    Operation *operations = store->active;
+    uint64_t *filter = store->active_filter;
+    store->active = store->frozen;
+    store->active_filter = store->frozen_filter;
+    store->frozen = operations;
+    store->frozen_filter = filter;
+    store->frozen_count = store->active_count;
+    store->active_count = 0;
+    memset(store->active_filter, 0, BUFFER_FILTER_BITS / 8);
+    store->freezing = 1;
+    pthread_mutex_unlock(&store->buffer_lock);
+
+    Run *run = runFromOperations(store->frozen, store->frozen_count, store->options.bloom_bits);
+    pthread_mutex_lock(&store->version_lock);
+    Version *next = copyVersion(store->current);
+    memmove(next->l0 + 1, next->l0, next->l0_count * sizeof(Run *));
+    next->l0[0] = run;
+    next->l0_count++;
+    int merge_due = next->l0_count >= L0_MERGE_TRIGGER;
+    replaceVersion(store, next);
+    pthread_mutex_unlock(&store->version_lock);
+    if (merge_due) requestMerge(store);
+
+    pthread_mutex_lock(&store->buffer_lock);
+    store->frozen_count = 0;
+    store->freezing = 0;
+    pthread_cond_broadcast(&store->buffer_free);
+}
+
+// One merge that is due, installed as a new version; 0 when none is due
+static int mergeOnce(SortedStore *store) {
+    Version *version = acquireVersion(store);
+    int threads = store->options.merge_threads, bits = store->options.bloom_bits;
+    int taken = 0, source = 0, target;
+    Run *output;
+    double start = omp_get_wtime();
+
+    if (version->l0_count >= L0_MERGE_TRIGGER) {
+        // All of level 0, oldest first, then into level 1
+        taken = version->l0_count;
+        target = 1;
+        Run *combined = version->l0[taken - 1];
+        retainRun(combined);
+        for (int r = taken - 2; r >= 0; r--) {
+            Run *merged = mergeRuns(version->l0[r], combined, 0, threads, 0);
+            releaseRun(combined);
+            combined = merged;
+        }
+        if (version->levels[1] != NULL) {
+            int bottom = 1;
+            for (int level = 2; level < MAX_LEVELS; level++) bottom &= version->levels[level] == NULL;
+            output = mergeRuns(combined, version->levels[1], bottom, threads, bits);
+            releaseRun(combined);
+        } else {
+            free(combined->fences);
+            finishRun(combined, bits, threads);
+            output = combined;
+        }
+    } else {
+        for (source = 1; source < MAX_LEVELS - 1; source++) {
+            Run *run = version->levels[source];
+            if (run != NULL && run->size > levelCapacity(store, source)) break;
+        }
+        if (source == MAX_LEVELS - 1) {
+            releaseVersion(version);
+            return 0;
+        }
+        target = source + 1;
+        if (version->levels[target] != NULL) {
+            int bottom = 1;
+            for (int level = target + 1; level < MAX_LEVELS; level++) bottom &= version->levels[level] == NULL;
+            output = mergeRuns(version->levels[source], version->levels[target], bottom, threads, bits);
+        } else {
+            output = version->levels[source];
+            retainRun(output);
+        }
+    }
+    long written = output->size;
+
+    pthread_mutex_lock(&store->version_lock);
+    Version *next = copyVersion(store->current);
+    // Level-0 runs frozen during the merge stay in front of the ones it took
+    for (int r = next->l0_count - taken; r < next->l0_count; r++) releaseRun(next->l0[r]);
+    next->l0_count -= taken;
+    if (source > 0) {
+        releaseRun(next->levels[source]);
+        next->levels[source] = NULL;
+    }
+    releaseRun(next->levels[target]);
+    next->levels[target] = output;
+    replaceVersion(store, next);
+    pthread_mutex_unlock(&store->version_lock);
+    releaseVersion(version);
+
+    pthread_mutex_lock(&store->merge_lock);
+    store->merges++;
+    store->merged_entries += written;
+    store->merge_seconds += omp_get_wtime() - start;
+    pthread_mutex_unlock(&store->merge_lock);
+
+    pthread_mutex_lock(&store->buffer_lock);
+    pthread_cond_broadcast(&store->buffer_free);
+    pthread_mutex_unlock(&store->buffer_lock);
+    return 1;
+}
+
+static void* mergerMain(void *arg) {
+    SortedStore *store = arg;
+    for (;;) {
+        pthread_mutex_lock(&store->merge_lock);
+        while (!store->merge_requested && !store->stopping) {
+            pthread_cond_wait(&store->merge_wanted, &store->merge_lock);
+        }
+        if (!store->merge_requested) {
+            pthread_mutex_unlock(&store->merge_lock);
+            return NULL;
+        }
+        store->merge_requested = 0;
+        store->merging = 1;
+        pthread_mutex_unlock(&store->merge_lock);
+
+        while (mergeOnce(store)) {
+        }
+
+        pthread_mutex_lock(&store->merge_lock);
+        store->merging = 0;
+        pthread_cond_broadcast(&store->merge_idle);
+        pthread_mutex_unlock(&store->merge_lock);
+    }
+}
+
+void sortedStoreDefaultOptions(SortedStoreOptions *options) {
+    options->buffer_keys = 4096;
+    options->merge_threads = omp_get_max_threads();
+    options->bloom_bits = 10;
+}
+
+SortedStore* sortedStoreCreate(const SortedStoreOptions *options) {
+    if (options->buffer_keys < 1 || options->merge_threads < 1 || options->bloom_bits < 0) return NULL;
+    SortedStore *store = calloc(1, sizeof(SortedStore));
+    if (store == NULL) return NULL;
+    store->options = *options;
+    store->active = malloc(options->buffer_keys * sizeof(Operation));
+    store->frozen = malloc(options->buffer_keys * sizeof(Operation));
+    store->active_filter = calloc(BUFFER_FILTER_BITS / 64, sizeof(uint64_t));
+    store->frozen_filter = calloc(BUFFER_FILTER_BITS / 64, sizeof(uint64_t));
+    store->current = calloc(1, sizeof(Version));
+    if (store->active == NULL || store->frozen == NULL || store->active_filter == NULL ||
+        store->frozen_filter == NULL || store->current == NULL) {
+        free(store->active);
+        free(store->frozen);
+        free(store->active_filter);
+        free(store->frozen_filter);
+        free(store->current);
+        free(store);
+        return NULL;
+    }
+    store->current->refs = 1;
+    pthread_mutex_init(&store->buffer_lock, NULL);
+    pthread_cond_init(&store->buffer_free, NULL);
+    pthread_mutex_init(&store->version_lock, NULL);
+    pthread_mutex_init(&store->merge_lock, NULL);
+    pthread_cond_init(&store->merge_wanted, NULL);
+    pthread_cond_init(&store->merge_idle, NULL);
+    pthread_create(&store->merger, NULL, mergerMain, store);
+    return store;
+}
+
+// Operations still in the buffer are dropped; flush first to keep them
+void sortedStoreDestroy(SortedStore *store) {
+    if (store == NULL) return;
+    pthread_mutex_lock(&store->merge_lock);
+    store->stopping = 1;
+    pthread_cond_signal(&store->merge_wanted);
+    pthread_mutex_unlock(&store->merge_lock);
+    pthread_join(store->merger, NULL);
+
+    releaseVersion(store->current);
+    free(store->active);
+    free(store->frozen);
+    free(store->active_filter);
+    free(store->frozen_filter);
+    pthread_mutex_destroy(&store->buffer_lock);
+    pthread_cond_destroy(&store->buffer_free);
+    pthread_mutex_destroy(&store->version_lock);
+    pthread_mutex_destroy(&store->merge_lock);
+    pthread_cond_destroy(&store->merge_wanted);
+    pthread_cond_destroy(&store->merge_idle);
+    free(store);
+}
+
+int sortedStoreLoad(SortedStore *store, const int *keys, long n) {
+    if (n < 0 || (n > 0 && keys == NULL)) return -1;
+    for (long i = 1; i < n; i++) {
+        if (keys[i - 1] > keys[i]) return -1;
+    }
+    Run *run = newRun(n);
+    long size = 0;
+    for (long i = 0; i < n; i++) {
+        if (size > 0 && run->keys[size - 1] == keys[i]) continue;
+        run->keys[size] = keys[i];
+        run->deleted[size] = 0;
+        size++;
+    }
+    run->size = size;
+    finishRun(run, store->options.bloom_bits, store->options.merge_threads);
+
+    // The shallowest level with room, so later merges into it stay proportionate
+    int level = 1;
+    while (level < MAX_LEVELS - 1 && size > levelCapacity(store, level)) level++;
+
+    pthread_mutex_lock(&store->version_lock);
+    Version *version = store->current;
+    int empty = version->l0_count == 0;
+    for (int l = 1; l < MAX_LEVELS; l++) empty &= version->levels[l] == NULL;
+    if (!empty) {
+        pthread_mutex_unlock(&store->version_lock);
+        releaseRun(run);
+        return -1;
+    }
+    Version *next = copyVersion(version);
+    next->levels[level] = run;
+    replaceVersion(store, next);
+    pthread_mutex_unlock(&store->version_lock);
+    return 0;
+}
+
+static void addOperations(SortedStore *store, const int *keys, int count, int deleted) {
+    pthread_mutex_lock(&store->buffer_lock);
+    for (int i = 0; i < count; i++) {
+        // Others may fill the fresh buffer while this thread sorts the old one
+        while (store->active_count == store->options.buffer_keys) freezeBuffer(store);
+        store->active[store->active_count].key = keys[i];
+        store->active[store->active_count].deleted = deleted;
+        store->active_count++;
+        uint64_t bit = hashKey(keys[i]) % BUFFER_FILTER_BITS;
+        store->active_filter[bit / 64] |= 1ULL << (bit % 64);
+    }
+    pthread_mutex_unlock(&store->buffer_lock);
+}
+
+void sortedStoreInsert(SortedStore *store, const int *keys, int count) {
+    addOperations(store, keys, count, 0);
+}
+
+void sortedStoreDelete(SortedStore *store, const int *keys, int count) {
+    addOperations(store, keys, count, 1);
+}
+
+// 1 present, 0 deleted, -1 when the buffer holds no operation on key
+static int bufferFind(const Operation *operations, int count, const uint64_t *filter, int key) {
+    uint64_t bit = hashKey(key) % BUFFER_FILTER_BITS;
+    if (!(filter[bit / 64] & (1ULL << (bit % 64)))) return -1;
+    for (int i = count - 1; i >= 0; i--) {
+        if (operations[i].key == key) return !operations[i].deleted;
+    }
+    return -1;
+}
+
+int sortedStoreContains(SortedStore *store, int key) {
+    pthread_mutex_lock(&store->buffer_lock);
+    int found = bufferFind(store->active, store->active_count, store->active_filter, key);
+    if (found < 0 && store->frozen_count > 0) {
+        found = bufferFind(store->frozen, store->frozen_count, store->frozen_filter, key);
+    }
+    pthread_mutex_unlock(&store->buffer_lock);
+    if (found >= 0) return found;
+
+    // Newest run first; the first one holding the key decides
+    Version *version = acquireVersion(store);
+    long skipped = 0;
+    for (int r = 0; r < version->l0_count + MAX_LEVELS - 1 && found < 0; r++) {
+        const Run *run = r < version->l0_count ? version->l0[r] : version->levels[r - version->l0_count + 1];
+        if (run == NULL || run->size == 0) continue;
+        if (!bloomMayContain(run, key)) {
+            skipped++;
+            continue;
+        }
+        long position = runLowerBound(run, key);
+        if (position < run->size && run->keys[position] == key) found = !run->deleted[position];
+    }
+    releaseVersion(version);
+    if (skipped > 0) __atomic_add_fetch(&store->bloom_skips, skipped, __ATOMIC_RELAXED);
+    return found > 0;
+}
+
+// Walks every run's part of [low, high] at once, newest run first on equal keys
+long sortedStoreRangeCount(SortedStore *store, int low, int high) {
+    if (low > high) return 0;
+
+    // The buffered operations in range, oldest first, as a temporary run
+    pthread_mutex_lock(&store->buffer_lock);
+    int buffered = 0;
+    Operation *operations = checkedAlloc((store->frozen_count + store->active_count) * sizeof(Operation));
+    for (int i = 0; i < store->frozen_count; i++) {
+        if (store->frozen[i].key >= low && store->frozen[i].key <= high) operations[buffered++] = store->frozen[i];
+    }
+    for (int i = 0; i < store->active_count; i++) {
+        if (store->active[i].key >= low && store->active[i].key <= high) operations[buffered++] = store->active[i];
+    }
+    // Pinned before the buffer can change: a frozen buffer leaves frozen only
+    // after its run is in the current version, so nothing is missed, and a run
+    // that holds it as well agrees with the copy. buffer_lock is taken before
+    // version_lock here as in freezeBuffer.
+    Version *version = acquireVersion(store);
+    pthread_mutex_unlock(&store->buffer_lock);
+    Run *buffer_run = runFromOperations(operations, buffered, 0);
+    free(operations);
+
+    const Run *sources[1 + L0_STALL + MAX_LEVELS];
+    long cursor[1 + L0_STALL + MAX_LEVELS], end[1 + L0_STALL + MAX_LEVELS];
+    int count = 0;
+    sources[count++] = buffer_run;
+    for (int r = 0; r < version->l0_count; r++) sources[count++] = version->l0[r];
+    for (int level = 1; level < MAX_LEVELS; level++) {
+        if (version->levels[level] != NULL) sources[count++] = version->levels[level];
+    }
+    for (int s = 0; s < count; s++) {
+        cursor[s] = runLowerBound(sources[s], low);
+        end[s] = runLowerBound(sources[s], (long)high + 1);
+    }
+
+    long live = 0;
+    for (;;) {
+        int best = -1, key = 0;
+        for (int s = 0; s < count; s++) {
+            if (cursor[s] < end[s] && (best < 0 || sources[s]->keys[cursor[s]] < key)) {
+                best = s;
+                key = sources[s]->keys[cursor[s]];
+            }
+        }
+        if (best < 0) break;
+        if (!sources[best]->deleted[cursor[best]]) live++;
+        for (int s = 0; s < count; s++) {
+            if (cursor[s] < end[s] && sources[s]->keys[cursor[s]] == key) cursor[s]++;
+        }
+    }
+    releaseVersion(version);
+    releaseRun(buffer_run);
+    return live;
+}
+
+void sortedStoreFlush(SortedStore *store) {
+    pthread_mutex_lock(&store->buffer_lock);
+    freezeBuffer(store);
+    pthread_mutex_unlock(&store->buffer_lock);
+
+    requestMerge(store);
+    pthread_mutex_lock(&store->merge_lock);
+    while (store->merge_requested || store->merging) {
+        pthread_cond_wait(&store->merge_idle, &store->merge_lock);
+    }
+    pthread_mutex_unlock(&store->merge_lock);
+}
+
+void sortedStoreGetStats(SortedStore *store, SortedStoreStats *stats) {
+    Version *version = acquireVersion(store);
+    memset(stats, 0, sizeof(*stats));
+    stats->l0_runs = version->l0_count;
+    for (int r = 0; r < version->l0_count; r++) stats->entries += version->l0[r]->size;
+    for (int level = 1; level < MAX_LEVELS; level++) {
+        if (version->levels[level] == NULL) continue;
+        stats->entries += version->levels[level]->size;
+        stats->levels = level;
+    }
+    releaseVersion(version);
+
+    pthread_mutex_lock(&store->merge_lock);
+    stats->merges = store->merges;
+    stats->merged_entries = store->merged_entries;
+    stats->merge_seconds = store->merge_seconds;
+    pthread_mutex_unlock(&store->merge_lock);
+    stats->stalls = store->stalls;
+    stats->bloom_skips = __atomic_load_n(&store->bloom_skips, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,61 @@
+#ifndef SORTED_STORE_H
+#define SORTED_STORE_H
+
+#include <stdint.h>
+
+/*
+    An updatable sorted set of ints, organised like an LSM tree.
+
+    Inserts and deletes go to a small unsorted buffer. A full buffer is sorted
+    into a run on level 0; a background thread merges level 0 into level 1 and
+    every level that outgrows its capacity into the next one, splitting large
+    merges over OpenMP threads. Every run carries fence pointers (every
+    STORE_FENCE_STRIDE-th key) and a Bloom filter. Lookups read an immutable
+    snapshot of the runs, so they never wait for a merge; inserts only wait
+    when level 0 is full because merging has fallen behind.
+
+    Deletes leave tombstones that hide older copies of the key until a merge
+    into the bottom level drops them.
+*/
+
+#define STORE_FENCE_STRIDE 64
+
+typedef struct SortedStore SortedStore;
+
+typedef struct {
+    int buffer_keys;        // operations buffered before they become a run
+    int merge_threads;      // OpenMP threads of one background merge
+    int bloom_bits;         // Bloom filter bits per key, 0 for none
+} SortedStoreOptions;
+
+typedef struct {
+    long entries;           // keys and tombstones over all runs
+    int l0_runs;
+    int levels;             // deepest non-empty level
+    long merges;
+    long merged_entries;    // entries written by merges
+    double merge_seconds;
+    long stalls;            // buffer flushes that waited for level 0 to drain
+    long bloom_skips;       // runs a lookup skipped thanks to the filter
+} SortedStoreStats;
+
+void sortedStoreDefaultOptions(SortedStoreOptions *options);
+SortedStore* sortedStoreCreate(const SortedStoreOptions *options);
+void sortedStoreDestroy(SortedStore *store);
+
+// Bulk load of ascending keys into an empty store; 0 or -1
+int sortedStoreLoad(SortedStore *store, const int *keys, long n);
+
+void sortedStoreInsert(SortedStore *store, const int *keys, int count);
+void sortedStoreDelete(SortedStore *store, const int *keys, int count);
+
+int sortedStoreContains(SortedStore *store, int key);
+// Live keys in [low, high] as of one instant: the runs are pinned while the
+// buffer is copied, so the count is a consistent snapshot of the store
+long sortedStoreRangeCount(SortedStore *store, int low, int high);
+
+// Turn the buffer into a run and wait until no merge is due
+void sortedStoreFlush(SortedStore *store);
+void sortedStoreGetStats(SortedStore *store, SortedStoreStats *stats);
+
+#endif
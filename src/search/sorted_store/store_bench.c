@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <omp.h>
+#include "sorted_store.h"
+#include "../../common/xorshift.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -pthread -O2 -o sorted_store store_bench.c sorted_store.c
+    command to execute:
+    ./sorted_store [sorted input] [writer threads] [reader threads] [seconds] [--merge-threads=N] [--buffer=N] [--batch=N] [--delete-every=N]
+
+    Loads the sorted input into a sorted store, then lets writers insert new
+    odd keys (and, every --delete-every batches, delete one of the loaded keys)
+    while readers time random lookups. Once the time is up the store is
+    flushed and checked: the loaded, inserted and deleted keys must answer as
+    expected and a count over the whole key range must match.
+*/
+
+#define MAX_LATENCIES (1 << 21)
+
+typedef struct {
+    SortedStore *store;
+    int id;
+    int writers;
+    int batch;
+    int delete_every;
+    const int *base;
+    long base_n;
+    volatile int *stop;
+    long inserted;
+    long deleted;          // loaded keys removed; they are unique per writer
+    long batches;
+} Writer;
+
+typedef struct {
+    SortedStore *store;
+    int max_key;
+    uint64_t seed;
+    volatile int *stop;
+    double *latencies;     // microseconds, the first MAX_LATENCIES lookups
+    long lookups;
+    long hits;
+} Reader;
+
+static int* loadText(const char *filename, long *n) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        return NULL;
+    }
+    long count = 0;
+    double temp;
+    while (fscanf(file, "%lf", &temp) == 1) count++;
+    int *data = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (data == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(file);
+        return NULL;
+    }
+    rewind(file);
+    for (long i = 0; i < count; i++) {
+        if (fscanf(file, "%lf", &temp) != 1) break;
+        data[i] = (int)temp;
+    }
+    fclose(file);
+    *n = count;
+    return data;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, long count, double fraction) {
+    long rank = (long)(fraction * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// Writer w inserts 2 * (w + writers * i) + 1 and deletes base[w + writers * d]
+static int insertedKey(const Writer *writer, long i) {
+    return (int)(2 * ((long)writer->id + (long)writer->writers * i) + 1);
+}
+
+static void* runWriter(void *arg) {
+    Writer *writer = arg;
+    int *keys = malloc(writer->batch * sizeof(int));
+    if (keys == NULL) return NULL;
+    while (!*writer->stop) {
+        for (int i = 0; i < writer->batch; i++) keys[i] = insertedKey(writer, writer->inserted + i);
+        sortedStoreInsert(writer->store, keys, writer->batch);
+        writer->inserted += writer->batch;
+        writer->batches++;
+        long next_delete = writer->id + (long)writer->writers * writer->deleted;
+        if (writer->delete_every > 0 && writer->batches % writer->delete_every == 0 && next_delete < writer->base_n) {
+            sortedStoreDelete(writer->store, &writer->base[next_delete], 1);
+            writer->deleted++;
+        }
+    }
+    free(keys);
+    return NULL;
+}
+
+static void* runReader(void *arg) {
+    Reader *reader = arg;
+    while (!*reader->stop) {
+        int key = (int)(nextRandom(&reader->seed) % ((uint64_t)reader->max_key + 1));
+        double start = omp_get_wtime();
+        reader->hits += sortedStoreContains(reader->store, key);
+        double elapsed = omp_get_wtime() - start;
+        if (reader->lookups < MAX_LATENCIES) reader->latencies[reader->lookups] = elapsed * 1e6;
+        reader->lookups++;
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <sorted_input> <writer_threads> <reader_threads> <seconds> [--merge-threads=N] [--buffer=N] [--batch=N] [--delete-every=N]\n", argv[0]);
+        return -1;
+    }
+
+    SortedStoreOptions options;
+    sortedStoreDefaultOptions(&options);
+    int batch = 64, delete_every = 16;
+    for (int i = 5; i < argc; i++) {
+        if (strncmp(argv[i], "--merge-threads=", 16) == 0) {
+            options.merge_threads = atoi(argv[i] + 16);
+        } else if (strncmp(argv[i], "--buffer=", 9) == 0) {
+            options.buffer_keys = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            batch = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--delete-every=", 15) == 0) {
+            delete_every = atoi(argv[i] + 15);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    int writers = atoi(argv[2]);
+    int readers = atoi(argv[3]);
+    double seconds = atof(argv[4]);
+    if (writers < 1 || readers < 0 || options.merge_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    if (seconds <= 0 || batch < 1 || delete_every < 0 || options.buffer_keys < 1) {
+        fprintf(stderr, "Seconds, --batch and --buffer must be positive, --delete-every at least 0\n");
+        return -1;
+    }
+
+    long n;
+    int *base = loadText(argv[1], &n);
+    if (base == NULL) return -1;
+    for (long i = 1; i < n; i++) {
+        if (base[i - 1] >= base[i]) {
+            fprintf(stderr, "%s must hold strictly ascending keys\n", argv[1]);
+            return -1;
+        }
+    }
+    if (n == 0 || base[0] < 0) {
+        fprintf(stderr, "%s must hold non-negative keys\n", argv[1]);
+        return -1;
+    }
+
+    SortedStore *store = sortedStoreCreate(&options);
+    if (store == NULL || sortedStoreLoad(store, base, n) != 0) {
+        fprintf(stderr, "Could not create the sorted store\n");
+        return -1;
+    }
+
+    volatile int stop = 0;
+    Writer *writer = calloc(writers, sizeof(Writer));
+    Reader *reader = calloc(readers > 0 ? readers : 1, sizeof(Reader));
+    pthread_t *threads = malloc((writers + readers) * sizeof(pthread_t));
+    double *latencies = malloc((readers > 0 ? (long)readers * MAX_LATENCIES : 1) * sizeof(double));
+    if (writer == NULL || reader == NULL || threads == NULL || latencies == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    for (int w = 0; w < writers; w++) {
+        writer[w].store = store;
+        writer[w].id = w;
+        writer[w].writers = writers;
+        writer[w].batch = batch;
+        writer[w].delete_every = delete_every;
+        writer[w].base = base;
+        writer[w].base_n = n;
+        writer[w].stop = &stop;
+    }
+    for (int r = 0; r < readers; r++) {
+        reader[r].store = store;
+        reader[r].max_key = base[n - 1];
+        reader[r].seed = (r + 1) * 0x9E3779B97F4A7C15ULL;
+        reader[r].stop = &stop;
+        reader[r].latencies = latencies + (long)r * MAX_LATENCIES;
+    }
+
+    double start_time = omp_get_wtime();
+    for (int w = 0; w < writers; w++) pthread_create(&threads[w], NULL, runWriter, &writer[w]);
+    for (int r = 0; r < readers; r++) pthread_create(&threads[writers + r], NULL, runReader, &reader[r]);
+    struct timespec duration = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+    nanosleep(&duration, NULL);
+    stop = 1;
+    for (int t = 0; t < writers + readers; t++) pthread_join(threads[t], NULL);
+    double elapsed = omp_get_wtime() - start_time;
+
+    double flush_start = omp_get_wtime();
+    sortedStoreFlush(store);
+    double flush_time = omp_get_wtime() - flush_start;
+
+    long inserted = 0, deleted = 0, lookups = 0, hits = 0, recorded = 0;
+    for (int w = 0; w < writers; w++) {
+        inserted += writer[w].inserted;
+        deleted += writer[w].deleted;
+    }
+    for (int r = 0; r < readers; r++) {
+        long count = reader[r].lookups < MAX_LATENCIES ? reader[r].lookups : MAX_LATENCIES;
+        memmove(latencies + recorded, reader[r].latencies, count * sizeof(double));
+        recorded += count;
+        lookups += reader[r].lookups;
+        hits += reader[r].hits;
+    }
+
+    printf("Loaded %ld keys, then ran %d writers and %d readers for %f seconds\n", n, writers, readers, elapsed);
+    printf("Inserts: %ld (%.2f M/s), deletes: %ld\n", inserted, inserted / elapsed / 1e6, deleted);
+    if (recorded > 0) {
+        qsort(latencies, recorded, sizeof(double), compareDoubles);
+        printf("Lookups: %ld (%.2f M/s), found %.1f%%\n", lookups, lookups / elapsed / 1e6, 100.0 * hits / lookups);
+        printf("Lookup latency (us): p50 %.2f, p99 %.2f, p999 %.2f, max %.2f\n",
+               percentile(latencies, recorded, 0.50), percentile(latencies, recorded, 0.99),
+               percentile(latencies, recorded, 0.999), latencies[recorded - 1]);
+    }
+
+    SortedStoreStats stats;
+    sortedStoreGetStats(store, &stats);
+    printf("Merges: %ld writing %ld entries in %f seconds with %d threads, %ld stalls\n",
+           stats.merges, stats.merged_entries, stats.merge_seconds, options.merge_threads, stats.stalls);
+    printf("Runs: %d on level 0, deepest level %d, %ld entries; Bloom filters skipped %ld runs\n",
+           stats.l0_runs, stats.levels, stats.entries, stats.bloom_skips);
+    printf("Time taken: %f seconds to flush\n", flush_time);
+
+    // Every writer's first and last key, and the loaded keys around its deletes
+    int failures = 0;
+    for (int w = 0; w < writers; w++) {
+        if (writer[w].inserted > 0) {
+            failures += !sortedStoreContains(store, insertedKey(&writer[w], 0));
+            failures += !sortedStoreContains(store, insertedKey(&writer[w], writer[w].inserted - 1));
+        }
+        failures += sortedStoreContains(store, insertedKey(&writer[w], writer[w].inserted));
+        if (writer[w].deleted > 0) {
+            long last = w + (long)writers * (writer[w].deleted - 1);
+            failures += sortedStoreContains(store, base[w]);
+            failures += sortedStoreContains(store, base[last]);
+            if (last + writers < n) failures += !sortedStoreContains(store, base[last + writers]);
+        }
+    }
+    long expected = n + inserted - deleted;
+    long counted = sortedStoreRangeCount(store, INT_MIN, INT_MAX);
+    printf("Range count over all keys: %ld (expected %ld)\n", counted, expected);
+    if (failures > 0 || counted != expected) {
+        fprintf(stderr, "Sorted store check failed: %d wrong lookups\n", failures);
+        return -1;
+    }
+
+    sortedStoreDestroy(store);
+    free(base);
+    free(writer);
+    free(reader);
+    free(threads);
+    free(latencies);
+    return 0;
+}
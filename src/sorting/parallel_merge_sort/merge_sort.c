@@ -1,78 +1,21 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include "merge_sort.h"
+#include "../../libpcm/pcm.h"
+#include "../../common/numa_support.h"
+#include "../../common/perf_counters.h"
 #include <time.h>
 #include <omp.h>
+#include <string.h>
 
-// Function to merge two halves of an array
-void merge(int *arr, int left, int mid, int right) {
-    int i, j, k;
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
-
-    // Temporary arrays
-    int *L = malloc(n1 * sizeof(int));
-    int *R = malloc(n2 * sizeof(int));
-
-    // Copy data to temp arrays L[] and R[]
-    for (i = 0; i < n1; i++)
-        L[i] = arr[left + i];
-    for (j = 0; j < n2; j++)
-        R[j] = arr[mid + 1 + j];
-
-    // Merge the temp arrays back into arr[l..r]
-    i = 0; // Initial index of first subarray
-    j = 0; // Initial index of second subarray
-    k = left; // Initial index of merged subarray
-    while (i < n1 && j < n2) {
-        if (L[i] <= R[j]) {
-            arr[k] = L[i];
-            i++;
-        } else {
-            arr[k] = R[j];
-            j++;
-        }
-        k++;
-    }
-
-    // Copy the remaining elements of L[], if there are any
-    while (i < n1) {
-        arr[k] = L[i];
-        i++;
-        k++;
-    }
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -DHAVE_LIBNUMA -pthread -o mergesort merge_sort.c ../../common/numa_support.c ../../common/perf_counters.c ../../../libpcm.a -lnuma
+    command to execute:
+    ./mergesort [input] [number of threads] [--pin=none|compact|scatter] [--numa=default|firsttouch|interleave] [--perf] [--runtime=omp|ws] [--adaptive]
 
-    // Copy the remaining elements of R[], if there are any
-    while (j < n2) {
-        arr[k] = R[j];
-        j++;
-        k++;
-    }
-
-    free(L);
-    free(R);
-}
-
-// Function to perform merge sort
-void mergeSort(int *arr, int left, int right) {
-    if (left < right) {
-        int mid = left + (right - left) / 2;
-
-        #pragma omp parallel sections
-        {
-            #pragma omp section
-            {
-                mergeSort(arr, left, mid);
-            }
-            #pragma omp section
-            {
-                mergeSort(arr, mid + 1, right);
-            }
-        }
-
-        merge(arr, left, mid, right);
-    }
-}
+    --adaptive sorts with pcmNaturalMergeSort, which detects the runs already in
+    the input and merges them; sorted input takes one parallel scan.
+*/
 
 // Function to print an array
 void printArray(int *arr, int size) {
@@ -83,11 +26,28 @@ void printArray(int *arr, int size) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <input_file> <num_of_threads>\n", argv[0]);
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input_file> <num_of_threads> " NUMA_OPTIONS_USAGE " " PERF_OPTIONS_USAGE " " RUNTIME_OPTIONS_USAGE " [--adaptive]\n", argv[0]);
         return -1;
     }
 
+    NumaOptions numa;
+    defaultNumaOptions(&numa);
+    PerfOptions perf_options;
+    defaultPerfOptions(&perf_options);
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    int adaptive = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--adaptive") == 0) {
+            adaptive = 1;
+        } else if (!parseNumaOption(argv[i], &numa) && !parsePerfOption(argv[i], &perf_options)
+            && !parseRuntimeOption(argv[i], &runtime)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
     const char *input_filename = argv[1];
     int num_threads = atoi(argv[2]);  
     if (num_threads < 1) {
@@ -106,8 +66,12 @@ int main(int argc, char *argv[]) {
     int temp;
     while (fscanf(file, "%d", &temp) == 1) n++;
 
+    // Pin the team first so the first-touch placement lands on the threads that sort
+    omp_set_num_threads(num_threads);
+    applyThreadPinning(&numa);
+
     // Allocate memory based on the number of integers
-    int *arr = malloc(n * sizeof(int));
+    int *arr = numaAllocate(n * sizeof(int), &numa);
     if (arr == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
         fclose(file);
@@ -126,17 +90,47 @@ int main(int argc, char *argv[]) {
     printf("Original array (first 10 elements): \n");
     printArray(arr, 10);  // Print first 10 elements
 
-    omp_set_num_threads(num_threads);  
-
+    // The context starts its threads and sizes its scratch before the clock
+    PcmOptions options;
+    pcmDefaultOptions(&options);
+    options.threads = num_threads;
+    options.runtime = runtime.kind;
+    PcmContext *context = pcmContextCreate(&options);
+    int status = context != NULL ? pcmReserve(context, n) : PCM_ERROR_ALLOCATION;
+    if (status != PCM_OK) {
+        fprintf(stderr, "Failed to set up libpcm: %s\n", pcmStatusString(status));
+        return -1;
+    }
+    const char *kernel = adaptive ? (runtime.kind == RUNTIME_WS ? "ws_naturalMergeSort" : "naturalMergeSort")
+                                  : (runtime.kind == RUNTIME_WS ? "ws_mergeSort" : "mergeSort");
+    // The work-stealing workers are not an OpenMP team, so pin and count them by thread id
+    int *worker_ids = malloc(pcmContextThreads(context) * sizeof(int));
+    int workers = worker_ids != NULL ? pcmRuntimeThreadIds(context, worker_ids) : 0;
+    applyThreadIdPinning(&numa, worker_ids, workers);
+    PerfRegion perf;
+    perfRegionBeginThreads(&perf, &perf_options, kernel, worker_ids, workers);
+    free(worker_ids);
     double start_time = omp_get_wtime();  // Start time measurement
-    mergeSort(arr, 0, n - 1);
+    int sort_status = adaptive ? pcmNaturalMergeSort(context, arr, n) : pcmMergeSort(context, arr, n);
     double end_time = omp_get_wtime();    // End time measurement
+    // Every level copies each element out to the scratch and merges it back;
+    // an upper bound for the adaptive sort
+    int levels = 0;
+    while ((1L << levels) < n) levels++;
+    perfRegionEnd(&perf, n, 4.0 * sizeof(int) * n * levels);
+    if (sort_status != PCM_OK) {
+        fprintf(stderr, "Failed to sort: %s\n", pcmStatusString(sort_status));
+        return -1;
+    }
 
     printf("Sorted array (first 10 elements): \n");
     printArray(arr, 10);  // Print first 10 elements for brevity
 
     printf("Time taken: %f seconds with %d threads\n", end_time - start_time, num_threads);
+    reportArrayLocality("array", arr, n * sizeof(int));
+    pcmReportRuntime(context, kernel);
+    pcmContextDestroy(context);
 
-    free(arr);
+    numaFree(arr, n * sizeof(int), &numa);
     return 0;
 }
\ No newline at end of file
@@ -1,7 +0,0 @@
-#ifndef MERGE_SORT_H
-#define MERGE_SORT_H
-
-void mergeSort(int *arr, int left, int right);
-void merge(int *arr, int left, int mid, int right);
-
-#endif
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+#include "../../libpcm/pcm.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -pthread -o quick_select quick_select.c ../../../libpcm.a
+    command to execute:
+    ./quick_select [input] [number of threads] [--select=k | --quantiles=q | --topk=k] [--runtime=omp|ws]
+    ./quick_select --random [n] [number of threads] [--select=k | --quantiles=q | --topk=k] [--runtime=omp|ws]
+
+    Times one selection kernel (default: the median), then sorts a copy of the
+    same input with pcmQuickSort, checks the answers against it and reports how
+    much faster the selection was. --random needs about 12 bytes per element.
+*/
+
+typedef enum { MODE_SELECT, MODE_QUANTILES, MODE_TOPK } SelectionMode;
+
+// Up to 10 values, like the sorting programs print their arrays
+void printArray(const int *arr, int size) {
+    for (int i = 0; i < size && i < 10; i++) {
+        printf("%d ", arr[i]);
+    }
+    printf("%s\n", size > 10 ? "..." : "");
+}
+
+static int* readArray(const char *filename, int *n) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        return NULL;
+    }
+    int count = 0;
+    int temp;
+    while (fscanf(file, "%d", &temp) == 1) count++;
+    int *arr = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (arr == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(file);
+        return NULL;
+    }
+    rewind(file);
+    for (int i = 0; i < count; i++) {
+        if (fscanf(file, "%d", &arr[i]) != 1) break;
+    }
+    fclose(file);
+    *n = count;
+    return arr;
+}
+
+// splitmix64 of the index, so the keys do not depend on the thread count
+static int* randomArray(int n) {
+    int *arr = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (arr == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        uint64_t z = (uint64_t)i * 0x9E3779B97F4A7C15ULL + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        arr[i] = (int)((z ^ (z >> 31)) >> 33);
+    }
+    return arr;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input_file> <num_of_threads> [--select=k | --quantiles=q | --topk=k] " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        fprintf(stderr, "       %s --random <n> <num_of_threads> [--select=k | --quantiles=q | --topk=k] " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        return -1;
+    }
+
+    int random_input = strcmp(argv[1], "--random") == 0;
+    int first_option = random_input ? 4 : 3;
+    if (argc < first_option) {
+        fprintf(stderr, "Missing the number of threads\n");
+        return -1;
+    }
+
+    SelectionMode mode = MODE_SELECT;
+    long parameter = -1;    // the rank, the number of quantiles or k
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    for (int i = first_option; i < argc; i++) {
+        if (strncmp(argv[i], "--select=", 9) == 0) {
+            mode = MODE_SELECT;
+            parameter = atol(argv[i] + 9);
+        } else if (strncmp(argv[i], "--quantiles=", 12) == 0) {
+            mode = MODE_QUANTILES;
+            parameter = atol(argv[i] + 12);
+        } else if (strncmp(argv[i], "--topk=", 7) == 0) {
+            mode = MODE_TOPK;
+            parameter = atol(argv[i] + 7);
+        } else if (!parseRuntimeOption(argv[i], &runtime)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    int num_threads = atoi(argv[first_option - 1]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    omp_set_dynamic(0);
+    omp_set_num_threads(num_threads);
+
+    int n = 0;
+    int *arr;
+    if (random_input) {
+        n = atoi(argv[2]);
+        if (n < 1) {
+            fprintf(stderr, "n must be at least 1\n");
+            return -1;
+        }
+        arr = randomArray(n);
+    } else {
+        arr = readArray(argv[1], &n);
+    }
+    if (arr == NULL) return -1;
+    if (n < 1) {
+        fprintf(stderr, "The input is empty\n");
+        return -1;
+    }
+
+    if (mode == MODE_SELECT && parameter < 0) parameter = n / 2;
+    if ((mode == MODE_SELECT && parameter >= n) || (mode == MODE_QUANTILES && (parameter < 2 || parameter > n)) ||
+        (mode == MODE_TOPK && (parameter < 1 || parameter > n))) {
+        fprintf(stderr, "The rank, quantile count or k does not fit an input of %d keys\n", n);
+        return -1;
+    }
+
+    // Quantile q of `parameter` is the key of rank n*q/parameter
+    int count = mode == MODE_QUANTILES ? (int)parameter - 1 : (mode == MODE_TOPK ? (int)parameter : 1);
+    int *ranks = malloc(count * sizeof(int));
+    int *answers = malloc(count * sizeof(int));
+    int *work = malloc(n * sizeof(int));
+    if (ranks == NULL || answers == NULL || work == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        ranks[i] = mode == MODE_QUANTILES ? (int)((long)n * (i + 1) / parameter)
+                 : (mode == MODE_TOPK ? i : (int)parameter);
+    }
+
+    // The context starts its threads and sizes its scratch before the clock
+    PcmOptions options;
+    pcmDefaultOptions(&options);
+    options.threads = num_threads;
+    options.runtime = runtime.kind;
+    PcmContext *context = pcmContextCreate(&options);
+    if (context == NULL || pcmReserve(context, n) != PCM_OK) {
+        fprintf(stderr, "Failed to set up libpcm\n");
+        return -1;
+    }
+
+    const char *kernel = mode == MODE_SELECT ? "pcmSelect" : (mode == MODE_QUANTILES ? "pcmMultiSelect" : "pcmTopK");
+    memcpy(work, arr, n * sizeof(int));
+    int status;
+    double start_time = omp_get_wtime();
+    if (mode == MODE_SELECT) {
+        status = pcmSelect(context, work, n, ranks[0]);
+        answers[0] = work[ranks[0]];
+    } else if (mode == MODE_QUANTILES) {
+        status = pcmMultiSelect(context, arr, n, ranks, count, answers);
+    } else {
+        status = pcmTopK(context, arr, n, count, answers);
+    }
+    double end_time = omp_get_wtime();
+    if (status != PCM_OK) {
+        fprintf(stderr, "%s failed: %s\n", kernel, pcmStatusString(status));
+        return -1;
+    }
+    double select_time = end_time - start_time;
+
+    if (mode == MODE_SELECT) {
+        printf("Key of rank %d among %d: %d\n", ranks[0], n, answers[0]);
+    } else if (mode == MODE_QUANTILES) {
+        printf("%d quantile cut points among %d keys: \n", count, n);
+        printArray(answers, count);
+    } else {
+        printf("%d smallest of %d keys: \n", count, n);
+        printArray(answers, count);
+    }
+    printf("Time taken: %f seconds with %d threads\n", select_time, num_threads);
+    pcmReportRuntime(context, kernel);
+
+    // Baseline: sort everything and read the same ranks off the sorted copy
+    memcpy(work, arr, n * sizeof(int));
+    start_time = omp_get_wtime();
+    pcmQuickSort(context, work, n);
+    end_time = omp_get_wtime();
+    double sort_time = end_time - start_time;
+    printf("Full sort: %f seconds (%.1fx the %s time)\n", sort_time, sort_time / select_time, kernel);
+
+    for (int i = 0; i < count; i++) {
+        if (answers[i] != work[ranks[i]]) {
+            fprintf(stderr, "Mismatch at rank %d: %d, the sorted array holds %d\n", ranks[i], answers[i], work[ranks[i]]);
+            return -1;
+        }
+    }
+    printf("All %d answers match the sorted array\n", count);
+
+    pcmContextDestroy(context);
+    free(arr);
+    free(work);
+    free(ranks);
+    free(answers);
+    return 0;
+}
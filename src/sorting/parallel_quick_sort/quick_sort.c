@@ -1,90 +1,108 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include "quick_sort.h"
+#include "../../libpcm/pcm.h"
+#include "../../common/numa_support.h"
+#include "../../common/perf_counters.h"
+#include "../../common/task_trace.h"
 #include <time.h>
 #include <omp.h>
 #include <string.h>
 
 /*
     command to compilte:
-    gcc -Wall -std=c99 -fopenmp -o quicksort quick_sort.c
+    gcc -Wall -std=c99 -fopenmp -DHAVE_LIBNUMA -pthread -o quicksort quick_sort.c ../../common/numa_support.c ../../common/perf_counters.c ../../../libpcm.a -lnuma
     command to execute:
-    ./quicksort [input] [number of threads]
+    ./quicksort [input] [number of threads] [--pin=none|compact|scatter] [--numa=default|firsttouch|interleave] [--perf] [--trace[=trace.json]] [--runtime=omp|ws]
+    ./quicksort --random [n] [number of threads] [--pattern=random|reversed|sawtooth] [options]
+
+    --random builds the input instead of reading it; reversed and sawtooth
+    (runs of 37 keys alternately ascending and descending) are the inputs
+    median-of-three partitioning splits worst. The sorted copy is checked.
 */
 
-void swap(int* a, int* b) {
-    int temp = *a;
-    *a = *b;
-    *b = temp;
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
 }
 
-int partition(int *arr, int low, int high) {
-    int pivot = arr[high];
-    int i = low - 1;
-
-    for (int j = low; j < high; j++) {
-        if (arr[j] < pivot) {
-            i++;
-            swap(&arr[i], &arr[j]);
+int cnt = 0;
+double p_time_used = 0;
+// Serial baseline with the same bounds as pcmQuickSort: recurse into the
+// smaller side, loop on the larger, and leave a range still unsorted after
+// depth partitions to qsort
+void quickSort(int *arr, int low, int high, int depth) {
+    while (low < high) {
+        if (depth-- == 0) {
+            qsort(arr + low, high - low + 1, sizeof(int), compareInts);
+            return;
+        }
+        double p_start = omp_get_wtime(); // Start partition timing
+        int pi = pcmPartition(arr, low, high);
+        double p_end = omp_get_wtime(); 
+        p_time_used += p_end - p_start;
+        cnt++;
+        if (pi - low < high - pi) {
+            quickSort(arr, low, pi - 1, depth);
+            low = pi + 1;
+        } else {
+            quickSort(arr, pi + 1, high, depth);
+            high = pi - 1;
         }
     }
-    swap(&arr[i + 1], &arr[high]);
-    return i + 1;
 }
 
-double task_start, task_end, task_total, p_total, p_count = 0;
-int task_count, max_depth = 0;
-void parallel_quickSort(int *arr, int low, int high, int depth) {
-
-    #pragma omp atomic write
-    max_depth = depth > max_depth ? depth : max_depth;
-
-    if (low < high) {
-        double p_start = omp_get_wtime();
-        int pi = partition(arr, low, high);
-        double p_end = omp_get_wtime();
-        #pragma omp atomic
-        p_total += p_end - p_start;
-        #pragma omp atomic
-        p_count++;
-
-        
-        task_start = omp_get_wtime();
-        #pragma omp task
-        {
-            parallel_quickSort(arr, low, pi - 1, depth+1);
+static const char *patterns[] = { "random", "reversed", "sawtooth" };
+#define PATTERNS (int)(sizeof(patterns) / sizeof(patterns[0]))
+
+static int* patternArray(int n, int pattern) {
+    int *arr = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (arr == NULL) return NULL;
+    srand(42);
+    for (int i = 0; i < n; i++) {
+        switch (pattern) {
+            case 1: arr[i] = n - i; break;
+            case 2: arr[i] = (i / 37) % 2 ? n - i : i; break;
+            default: arr[i] = rand(); break;
         }
-        task_end = omp_get_wtime();
+    }
+    return arr;
+}
 
-        task_total += task_end - task_start;
-        #pragma omp atomic
-        task_count++;
+static int readArray(const char *filename, int **arr) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        return -1;
+    }
 
-        task_start = omp_get_wtime();
-        #pragma omp task
-        {
-            parallel_quickSort(arr, pi + 1, high, depth+1);
-        }
-        task_end = omp_get_wtime();
+    // Determine the number of integers in the file
+    int n = 0;
+    int temp;
+    while (fscanf(file, "%d", &temp) == 1) n++;
 
-        task_total += task_end - task_start;
-        #pragma omp atomic
-        task_count++;
+    // Allocate memory based on the number of integers
+    *arr = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (*arr == NULL) {
+        fclose(file);
+        return -1;
     }
+
+    // Reset file pointer to the beginning of the file
+    rewind(file);
+
+    // Read numbers from file into the array
+    for (int i = 0; i < n; i++) {
+        fscanf(file, "%d", &(*arr)[i]);
+    }
+    fclose(file);
+    return n;
 }
 
-int cnt = 0;
-double p_time_used = 0;
-void quickSort(int *arr, int low, int high) {
-    if (low < high) {
-        double p_start = omp_get_wtime(); // Start partition timing
-        int pi = partition(arr, low, high);
-        double p_end = omp_get_wtime(); 
-        p_time_used += p_end - p_start;
-        cnt++;
-        quickSort(arr, low, pi - 1);
-        quickSort(arr, pi + 1, high);
+static int isSorted(const int *arr, int n) {
+    for (int i = 1; i < n; i++) {
+        if (arr[i - 1] > arr[i]) return 0;
     }
+    return 1;
 }
 
 // Function to print an array
@@ -95,92 +113,139 @@ void printArray(int *arr, int size) {
     printf("\n");
 }
 
-int *intdup(int const *src, size_t len)
-{
-   int *p = malloc(len * sizeof(int));
-   memcpy(p, src, len * sizeof(int));
-   return p;
-}
-
 int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <input_file> <num_of_threads>\n", argv[0]);
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input_file> <num_of_threads> " NUMA_OPTIONS_USAGE " " PERF_OPTIONS_USAGE " " TRACE_OPTIONS_USAGE " " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        fprintf(stderr, "       %s --random <n> <num_of_threads> [--pattern=random|reversed|sawtooth] [options]\n", argv[0]);
         return -1;
     }
-
-    const char *input_filename = argv[1];
-    FILE *file = fopen(input_filename, "r");
-    if (file == NULL) {
-        perror("Error opening file");
+    int random_input = strcmp(argv[1], "--random") == 0;
+    if (random_input && argc < 4) {
+        fprintf(stderr, "Usage: %s --random <n> <num_of_threads> [--pattern=random|reversed|sawtooth] [options]\n", argv[0]);
         return -1;
     }
+    int first_option = random_input ? 4 : 3;
+    int pattern = 0;
+
+    NumaOptions numa;
+    defaultNumaOptions(&numa);
+    PerfOptions perf_options;
+    defaultPerfOptions(&perf_options);
+    TraceOptions trace_options;
+    defaultTraceOptions(&trace_options);
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    for (int i = first_option; i < argc; i++) {
+        if (random_input && strncmp(argv[i], "--pattern=", 10) == 0) {
+            for (pattern = 0; pattern < PATTERNS && strcmp(argv[i] + 10, patterns[pattern]) != 0; pattern++) {
+            }
+            if (pattern == PATTERNS) {
+                fprintf(stderr, "Unknown pattern %s\n", argv[i] + 10);
+                return -1;
+            }
+        } else if (!parseNumaOption(argv[i], &numa) && !parsePerfOption(argv[i], &perf_options)
+            && !parseTraceOption(argv[i], &trace_options) && !parseRuntimeOption(argv[i], &runtime)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
 
-    int num_threads = atoi(argv[2]);  
+    int num_threads = atoi(argv[first_option - 1]);  
     if (num_threads < 1) {
         fprintf(stderr, "Number of threads must be at least 1\n");
         return 1;
     }
 
-    // Determine the number of integers in the file
-    int n = 0;
-    int temp;
-    while (fscanf(file, "%d", &temp) == 1) n++;
-
-    // Allocate memory based on the number of integers
-    int *arr = malloc(n * sizeof(int));
+    int n;
+    int *arr = NULL;
+    if (random_input) {
+        n = atoi(argv[2]);
+        if (n < 1) {
+            fprintf(stderr, "n must be at least 1\n");
+            return -1;
+        }
+        arr = patternArray(n, pattern);
+    } else {
+        n = readArray(argv[1], &arr);
+        if (n < 0) return -1;
+    }
     if (arr == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
-        fclose(file);
         return -1;
     }
 
-    // Reset file pointer to the beginning of the file
-    rewind(file);
-
-    // Read numbers from file into the array
-    for (int i = 0; i < n; i++) {
-        fscanf(file, "%d", &arr[i]);
-    }
-    fclose(file);
-
     printf("Original array (first 10 elements): \n");
     printArray(arr, 10);  // Print first 10 elements
 
 
-    int *copy_arr = intdup(arr, n);
     omp_set_nested(1);
     omp_set_dynamic(0);
     omp_set_num_threads(num_threads);  
-    double start_time = omp_get_wtime();  // Start time measurement
-    #pragma omp parallel
-    {
-        #pragma omp single
-        {
-            parallel_quickSort(copy_arr, 0, n - 1, 1);
-        }
+    applyThreadPinning(&numa);
+
+    // The parallel sort works on a copy placed by the NUMA policy; memcpy keeps the placement
+    int *copy_arr = numaAllocate(n * sizeof(int), &numa);
+    if (copy_arr == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    memcpy(copy_arr, arr, n * sizeof(int));
+    // The context starts its threads before the clock
+    PcmOptions options;
+    pcmDefaultOptions(&options);
+    options.threads = num_threads;
+    options.runtime = runtime.kind;
+    PcmContext *context = pcmContextCreate(&options);
+    if (context == NULL) {
+        fprintf(stderr, "Failed to set up libpcm\n");
+        return -1;
     }
+    const char *kernel = runtime.kind == RUNTIME_WS ? "ws_quickSort" : "parallel_quickSort";
+    // The work-stealing workers are not an OpenMP team, so pin and count them by thread id
+    int *worker_ids = malloc(pcmContextThreads(context) * sizeof(int));
+    int workers = worker_ids != NULL ? pcmRuntimeThreadIds(context, worker_ids) : 0;
+    applyThreadIdPinning(&numa, worker_ids, workers);
+    PerfRegion perf;
+    perfRegionBeginThreads(&perf, &perf_options, kernel, worker_ids, workers);
+    free(worker_ids);
+    traceStart(&trace_options);
+    double start_time = omp_get_wtime();  // Start time measurement
+    int sort_status = pcmQuickSort(context, copy_arr, n);
     double end_time = omp_get_wtime();    // End time measurement
+    traceStop();
+    // Each partitioning level reads and writes every element about once
+    int levels = 0;
+    while ((1L << levels) < n) levels++;
+    perfRegionEnd(&perf, n, 2.0 * sizeof(int) * n * levels);
+    if (sort_status != PCM_OK) {
+        fprintf(stderr, "Failed to sort: %s\n", pcmStatusString(sort_status));
+        return -1;
+    }
     double parallel_time = end_time - start_time;
     printf("Sorted array (first 10 elements): \n");
     printArray(copy_arr, 10);  // Print first 10 elements for brevity
     printf("Time taken: %f seconds with %d threads\n", parallel_time, num_threads);
+    if (!isSorted(copy_arr, n)) {
+        fprintf(stderr, "The array is not sorted\n");
+        return -1;
+    }
+    reportArrayLocality("array", copy_arr, n * sizeof(int));
+    pcmReportRuntime(context, kernel);
+    pcmContextDestroy(context);
 
     if (num_threads == 1){
         double start = omp_get_wtime();
-        quickSort(arr, 0, n - 1);
+        quickSort(arr, 0, n - 1, 2 * levels);
         double end = omp_get_wtime();
         double work_time = end - start;
         printf("Work Time: %f seconds\n", work_time);
         // printf("Computation count: %d\n", cnt);
         // printf("Computation Time: %f seconds\n", p_time_used);
     }
-    
-    // printf("Task time: %f seconds\n", task_total/task_count);
-    // printf("Depth of recursion: %d\n", max_depth);
-    // printf("P_time: %f, P_count: %f\n", p_total, p_count);
-    // printf("Cost: %f seconds\n", total_latency/task_count);
+    traceReport(kernel);
+
     free(arr);
-    free(copy_arr);
+    numaFree(copy_arr, n * sizeof(int), &numa);
 
     return 0;
 }
\ No newline at end of file
@@ -1,7 +0,0 @@
-#ifndef QUICK_SORT_H
-#define QUICK_SORT_H
-
-void quickSort(int *arr, int low, int high);
-int partition(int *arr, int low, int high);
-
-#endif
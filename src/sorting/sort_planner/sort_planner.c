@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <omp.h>
+#include "../../libpcm/pcm.h"
+
+/*
+    command to compilte:
+    gcc -Wall -std=c99 -fopenmp -pthread -o sort_planner sort_planner.c ../../../libpcm.a
+    command to execute:
+    ./sort_planner [input] [number of threads] [options] [--runtime=omp|ws]
+    ./sort_planner --random [n] [number of threads] [--pattern=random|sorted|reversed|nearly|dups|narrow] [options] [--runtime=omp|ws]
+    options: --engine=auto|quick|merge|radix|sample|adaptive  --calibrate[=file]  --costs=file  --log=file  --compare
+
+    Samples the input (windows of consecutive keys, profiled on all threads)
+    for its presortedness, duplicate ratio and the bits on which its keys
+    differ, predicts the time of every libpcm sort from a cost table at every
+    thread count it may use, and sorts with the cheapest. --calibrate times
+    every sort on this machine first and saves the table (default
+    sort_costs.json), which --costs loads on later runs. --log appends the
+    profile, the predictions and the outcome to a file as one JSON line per
+    run, and --compare runs every engine after the planned one, however slow
+    it is predicted to be, to show how far the predictions are off. --engine
+    overrides the choice. The input and one working copy take 8 bytes per
+    element.
+*/
+
+static int* readArray(const char *filename, int *n) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening file");
+        return NULL;
+    }
+    int count = 0;
+    int temp;
+    while (fscanf(file, "%d", &temp) == 1) count++;
+    int *arr = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (arr == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(file);
+        return NULL;
+    }
+    rewind(file);
+    for (int i = 0; i < count; i++) {
+        if (fscanf(file, "%d", &arr[i]) != 1) break;
+    }
+    fclose(file);
+    *n = count;
+    return arr;
+}
+
+static uint64_t splitmix(uint64_t x) {
+    uint64_t z = x * 0x9E3779B97F4A7C15ULL + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static const char *patterns[] = { "random", "sorted", "reversed", "nearly", "dups", "narrow" };
+#define PATTERNS (int)(sizeof(patterns) / sizeof(patterns[0]))
+
+// Keys of the index alone, so they do not depend on the thread count.
+// nearly: sorted with 1% of the keys replaced at random; dups: 16 distinct
+// keys; narrow: keys below 65536
+static int* patternArray(int n, int pattern) {
+    int *arr = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (arr == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+    int64_t step = ((int64_t)UINT32_MAX + 1) / n;
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        uint64_t r = splitmix(i);
+        int ascending = (int)(INT_MIN + step * i);
+        switch (pattern) {
+            case 1: arr[i] = ascending; break;
+            case 2: arr[i] = (int)(INT_MIN + step * (n - 1 - i)); break;
+            case 3: arr[i] = r % 100 == 0 ? (int)(r >> 32) : ascending; break;
+            case 4: arr[i] = (int)(r % 16); break;
+            case 5: arr[i] = (int)(r % 65536); break;
+            default: arr[i] = (int)(r >> 32); break;
+        }
+    }
+    return arr;
+}
+
+// Order-independent digest, so a sort that loses or duplicates keys shows up
+static uint64_t checksum(const int *arr, int n) {
+    uint64_t sum = 0;
+    #pragma omp parallel for reduction(+:sum) schedule(static)
+    for (int i = 0; i < n; i++) {
+        sum += splitmix((uint32_t)arr[i]);
+    }
+    return sum;
+}
+
+static int isSorted(const int *arr, int n) {
+    for (int i = 1; i < n; i++) {
+        if (arr[i - 1] > arr[i]) return 0;
+    }
+    return 1;
+}
+
+static const char *cost_names[PCM_SORT_ENGINES + 2] = {
+    "quick_ns", "merge_ns", "radix_ns", "sample_ns", "adaptive_ns", "radix_wide_ns", "fork_join_us"
+};
+
+static double* costField(PcmSortCosts *costs, int field) {
+    if (field < PCM_SORT_ENGINES) return &costs->ns[field];
+    return field == PCM_SORT_ENGINES ? &costs->radix_wide_ns : &costs->fork_join_us;
+}
+
+static int writeCosts(const char *filename, PcmSortCosts *costs) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        perror("Error opening cost file");
+        return -1;
+    }
+    fprintf(file, "{\n");
+    for (int f = 0; f < PCM_SORT_ENGINES + 2; f++) {
+        fprintf(file, "    \"%s\": %.6f%s\n", cost_names[f], *costField(costs, f), f + 1 < PCM_SORT_ENGINES + 2 ? "," : "");
+    }
+    fprintf(file, "}\n");
+    fclose(file);
+    return 0;
+}
+
+// Reads the "name": value lines writeCosts wrote; missing fields keep the defaults
+static int readCosts(const char *filename, PcmSortCosts *costs) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        perror("Error opening cost file");
+        return -1;
+    }
+    char line[256], name[64];
+    double value;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, " \"%63[^\"]\" : %lf", name, &value) != 2) continue;
+        for (int f = 0; f < PCM_SORT_ENGINES + 2; f++) {
+            if (strcmp(name, cost_names[f]) == 0) *costField(costs, f) = value;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+// One JSON object per line, so the decisions of many runs can be audited together
+static int appendLog(const char *filename, const PcmSortPlan *plan, const char *source, RuntimeKind runtime,
+                     int num_threads, int forced, double plan_time, double sort_time) {
+    FILE *file = fopen(filename, "a");
+    if (file == NULL) {
+        perror("Error opening log file");
+        return -1;
+    }
+    const PcmSortProfile *profile = &plan->profile;
+    fprintf(file, "{\"input\": \"%s\", \"n\": %d, \"threads\": %d, \"runtime\": \"%s\", \"sampled\": %d, "
+            "\"ascending\": %.4f, \"descending\": %.4f, \"distinct\": %.4f, \"varying_bits\": %u, \"runs\": %ld, "
+            "\"predicted_seconds\": {", source, profile->n, num_threads, runtime == RUNTIME_WS ? "ws" : "omp",
+            profile->sampled, profile->ascending, profile->descending, profile->distinct, profile->varying_bits,
+            profile->runs);
+    for (int e = 0; e < PCM_SORT_ENGINES; e++) {
+        fprintf(file, "%s\"%s\": %.6f", e > 0 ? ", " : "", pcmSortEngineName(e), plan->predicted[e]);
+    }
+    fprintf(file, "}, \"engine\": \"%s\", \"forced\": %s, \"engine_threads\": %d, \"radix_bits\": %d, "
+            "\"sample_buckets\": %d, \"plan_seconds\": %.6f, \"sort_seconds\": %.6f}\n",
+            pcmSortEngineName(plan->engine), forced ? "true" : "false", plan->threads, plan->radix_bits,
+            plan->sample_buckets, plan_time, sort_time);
+    fclose(file);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input_file> <num_of_threads> [--engine=auto|quick|merge|radix|sample|adaptive] "
+                "[--calibrate[=file]] [--costs=file] [--log=file] [--compare] " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        fprintf(stderr, "       %s --random <n> <num_of_threads> [--pattern=random|sorted|reversed|nearly|dups|narrow] "
+                "[options] " RUNTIME_OPTIONS_USAGE "\n", argv[0]);
+        return -1;
+    }
+
+    int random_input = strcmp(argv[1], "--random") == 0;
+    int first_option = random_input ? 4 : 3;
+    if (argc < first_option) {
+        fprintf(stderr, "Missing the number of threads\n");
+        return -1;
+    }
+
+    int pattern = 0, engine = -1, compare = 0;
+    const char *calibrate_file = NULL, *costs_file = NULL, *log_file = NULL;
+    RuntimeOptions runtime;
+    defaultRuntimeOptions(&runtime);
+    for (int i = first_option; i < argc; i++) {
+        if (strncmp(argv[i], "--pattern=", 10) == 0) {
+            for (pattern = 0; pattern < PATTERNS && strcmp(argv[i] + 10, patterns[pattern]) != 0; pattern++) {
+            }
+            if (pattern == PATTERNS) {
+                fprintf(stderr, "Unknown pattern %s\n", argv[i] + 10);
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--engine=", 9) == 0) {
+            engine = -1;
+            for (int e = 0; e < PCM_SORT_ENGINES; e++) {
+                if (strcmp(argv[i] + 9, pcmSortEngineName(e)) == 0) engine = e;
+            }
+            if (engine < 0 && strcmp(argv[i] + 9, "auto") != 0) {
+                fprintf(stderr, "Unknown engine %s\n", argv[i] + 9);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--calibrate") == 0) {
+            calibrate_file = "sort_costs.json";
+        } else if (strncmp(argv[i], "--calibrate=", 12) == 0) {
+            calibrate_file = argv[i] + 12;
+        } else if (strncmp(argv[i], "--costs=", 8) == 0) {
+            costs_file = argv[i] + 8;
+        } else if (strncmp(argv[i], "--log=", 6) == 0) {
+            log_file = argv[i] + 6;
+        } else if (strcmp(argv[i], "--compare") == 0) {
+            compare = 1;
+        } else if (!parseRuntimeOption(argv[i], &runtime)) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (pattern != 0 && !random_input) {
+        fprintf(stderr, "--pattern only applies to --random input\n");
+        return -1;
+    }
+
+    int num_threads = atoi(argv[first_option - 1]);
+    if (num_threads < 1) {
+        fprintf(stderr, "Number of threads must be at least 1\n");
+        return 1;
+    }
+    omp_set_dynamic(0);
+    omp_set_num_threads(num_threads);
+
+    PcmSortCosts costs;
+    pcmDefaultSortCosts(&costs);
+    if (calibrate_file != NULL) {
+        if (pcmCalibrateSortCosts(&costs) != PCM_OK || writeCosts(calibrate_file, &costs) != 0) {
+            fprintf(stderr, "Calibration failed\n");
+            return -1;
+        }
+        printf("Calibrated sort costs written to %s:", calibrate_file);
+        for (int f = 0; f < PCM_SORT_ENGINES + 2; f++) {
+            printf(" %s=%.3f", cost_names[f], *costField(&costs, f));
+        }
+        printf("\n");
+    } else if (costs_file != NULL && readCosts(costs_file, &costs) != 0) {
+        return -1;
+    }
+
+    int n = 0;
+    int *arr;
+    if (random_input) {
+        n = atoi(argv[2]);
+        if (n < 1) {
+            fprintf(stderr, "n must be at least 1\n");
+            return -1;
+        }
+        arr = patternArray(n, pattern);
+    } else {
+        arr = readArray(argv[1], &n);
+    }
+    if (arr == NULL) return -1;
+    if (n < 1) {
+        fprintf(stderr, "The input is empty\n");
+        return -1;
+    }
+    int *work = malloc(n * sizeof(int));
+    if (work == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+    uint64_t expected = checksum(arr, n);
+
+    // The context starts its threads and sizes its scratch before the clock
+    PcmOptions options;
+    pcmDefaultOptions(&options);
+    options.threads = num_threads;
+    options.runtime = runtime.kind;
+    PcmContext *context = pcmContextCreate(&options);
+    if (context == NULL || pcmReserve(context, n) != PCM_OK) {
+        fprintf(stderr, "Failed to set up libpcm\n");
+        return -1;
+    }
+
+    PcmSortPlan plan;
+    double start_time = omp_get_wtime();
+    int status = pcmPlanSort(context, arr, n, &costs, &plan);
+    double plan_time = omp_get_wtime() - start_time;
+    if (status != PCM_OK) {
+        fprintf(stderr, "pcmPlanSort failed: %s\n", pcmStatusString(status));
+        return -1;
+    }
+    if (engine >= 0) {
+        plan.engine = engine;
+        plan.threads = plan.engine_threads[engine];
+    }
+
+    memcpy(work, arr, n * sizeof(int));
+    start_time = omp_get_wtime();
+    status = pcmSortWithPlan(context, work, n, &plan);
+    double sort_time = omp_get_wtime() - start_time;
+    if (status != PCM_OK) {
+        fprintf(stderr, "pcmSortWithPlan failed: %s\n", pcmStatusString(status));
+        return -1;
+    }
+    if (!isSorted(work, n) || checksum(work, n) != expected) {
+        fprintf(stderr, "The %s sort did not sort the input\n", pcmSortEngineName(plan.engine));
+        return -1;
+    }
+
+    printf("Array loaded. Array size: %d\n", n);
+    pcmReportSortPlan(&plan, stdout);
+    printf("Planned in %f seconds; %s sort on %d threads took %f seconds (predicted %f)%s\n", plan_time,
+           pcmSortEngineName(plan.engine), plan.threads, sort_time, plan.predicted[plan.engine],
+           engine >= 0 ? ", forced by --engine" : "");
+    printf("Time taken: %f seconds with %d threads\n", plan_time + sort_time, num_threads);
+    pcmReportRuntime(context, pcmSortEngineName(plan.engine));
+
+    if (log_file != NULL) {
+        const char *source = random_input ? patterns[pattern] : argv[1];
+        if (appendLog(log_file, &plan, source, runtime.kind, num_threads, engine >= 0, plan_time, sort_time) != 0) {
+            return -1;
+        }
+    }
+
+    if (compare) {
+        printf("Engine     threads   predicted      actual\n");
+        int fastest = plan.engine;
+        double actual[PCM_SORT_ENGINES];
+        for (int e = 0; e < PCM_SORT_ENGINES; e++) {
+            PcmSortPlan forced = plan;
+            forced.engine = e;
+            forced.threads = plan.engine_threads[e];
+            memcpy(work, arr, n * sizeof(int));
+            start_time = omp_get_wtime();
+            status = pcmSortWithPlan(context, work, n, &forced);
+            actual[e] = omp_get_wtime() - start_time;
+            if (status != PCM_OK || !isSorted(work, n) || checksum(work, n) != expected) {
+                fprintf(stderr, "The %s sort did not sort the input\n", pcmSortEngineName(e));
+                return -1;
+            }
+            if (actual[e] < actual[fastest]) fastest = e;
+            printf("%-8s %9d %11f %11f\n", pcmSortEngineName(e), forced.threads, plan.predicted[e], actual[e]);
+        }
+        printf("Fastest: %s; the plan's %s took %.2fx its time\n", pcmSortEngineName(fastest),
+               pcmSortEngineName(plan.engine), actual[plan.engine] / actual[fastest]);
+    }
+
+    pcmContextDestroy(context);
+    free(arr);
+    free(work);
+    return 0;
+}